@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 11
+#define LTO_API_VERSION 12
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -443,6 +443,27 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Generates code for all added modules into one native object file for each
+ * code generation partition requested with the -lto-partitions option; the
+ * partitions are code generated in parallel. The number of files is written
+ * to count, and their names are available from lto_codegen_get_object_file().
+ * Returns true on error.
+ *
+ * \since LTO_API_VERSION=12
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, unsigned *count);
+
+/**
+ * Returns the name of the object file generated for the given partition by
+ * the last call to lto_codegen_compile_to_files().
+ *
+ * \since LTO_API_VERSION=12
+ */
+extern const char*
+lto_codegen_get_object_file(lto_code_gen_t cg, unsigned index);
+
 
 /**
  * Sets options to help debug codegen bugs.
@@ -102,6 +102,21 @@ public:
   iterator end() const { return Nodes.end(); }
 };
 
+/// DummyCGSCCPass - A CallGraphSCCPass that does nothing. Function passes
+/// added after it run on one call graph SCC at a time, callees before their
+/// callers.
+class DummyCGSCCPass : public CallGraphSCCPass {
+public:
+  static char ID;
+  DummyCGSCCPass();
+
+  bool runOnSCC(CallGraphSCC &SCC) override { return false; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+};
+
 } // End llvm namespace
 
 #endif
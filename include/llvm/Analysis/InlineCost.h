@@ -14,9 +14,11 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include <cassert>
 #include <climits>
+#include <memory>
 
 namespace llvm {
 class CallSite;
@@ -98,9 +100,21 @@ public:
 };
 
 /// \brief Cost analyzer used by inliner.
+///
+/// The analysis keeps a summary of every callee it analyzes, which gives the
+/// cost of later call sites that pass no arguments the analysis can simplify
+/// without walking the callee again. Summaries are only kept for functions
+/// outside the SCC being visited, which the inliner and the passes running on
+/// the SCC do not change.
 class InlineCostAnalysis : public CallGraphSCCPass {
   const TargetTransformInfo *TTI;
 
+  struct SummaryCache;
+  std::unique_ptr<SummaryCache> Summaries;
+
+  /// The functions of the SCC being visited.
+  SmallPtrSet<const Function *, 8> CurrentSCC;
+
 public:
   static char ID;
 
@@ -108,8 +122,12 @@ public:
   ~InlineCostAnalysis();
 
   // Pass interface implementation.
+  using llvm::Pass::doInitialization;
+  using llvm::Pass::doFinalization;
   void getAnalysisUsage(AnalysisUsage &AU) const override;
+  bool doInitialization(CallGraph &CG) override;
   bool runOnSCC(CallGraphSCC &SCC) override;
+  bool doFinalization(CallGraph &CG) override;
 
   /// \brief Get an InlineCost object representing the cost of inlining this
   /// callsite.
@@ -44,6 +44,17 @@ namespace llvm {
   //
   ModulePass *createAliasAnalysisCounterPass();
 
+  //===--------------------------------------------------------------------===//
+  //
+  // createAliasAnalysisCachePass - This pass memoizes the results of alias
+  // queries made against the rest of the alias analysis chain.  Results are
+  // only reused within a single pass, and are dropped on every deleteValue,
+  // copyValue or addEscapingUse.  Passes that change the address computed by
+  // an instruction in place and query it again must report the change through
+  // one of those methods.
+  //
+  ImmutablePass *createAliasAnalysisCachePass();
+
   //===--------------------------------------------------------------------===//
   //
   // createAAEvalPass - This pass implements a simple N^2 alias analysis
@@ -250,6 +250,11 @@ namespace llvm {
     ///
     ValueExprMapType ValueExprMap;
 
+    /// CreationDepth - The number of getSCEV calls currently on the stack that
+    /// are creating a new SCEV. Used to bound the recursion on very deep
+    /// expression trees.
+    unsigned CreationDepth;
+
     /// Mark predicate values currently being processed by isImpliedCond.
     DenseSet<Value*> PendingLoopPredicates;
 
@@ -922,6 +927,12 @@ namespace llvm {
     FoldingSet<SCEV> UniqueSCEVs;
     BumpPtrAllocator SCEVAllocator;
 
+    /// FunctionStartMemory - The amount of memory SCEVAllocator held when
+    /// the current function started being analyzed. Expressions are uniqued
+    /// across functions, so the memory limit is applied to the growth since
+    /// this point.
+    size_t FunctionStartMemory;
+
     /// FirstUnknown - The head of a linked list of all SCEVUnknown
     /// values that have been allocated. This is used by releaseMemory
     /// to locate them all and call their destructors.
@@ -313,6 +313,19 @@ public:
                                  Type *Ty) const;
   virtual unsigned getIntImmCost(Intrinsic::ID IID, unsigned Idx,
                                  const APInt &Imm, Type *Ty) const;
+
+  /// \brief Return the size of a cache line in bytes, or zero if software
+  /// prefetches should not be inserted for this target.
+  virtual unsigned getCacheLineSize() const;
+
+  /// \brief Return the expected number of cycles a load that misses in the
+  /// cache waits for memory. Software prefetches are issued this far ahead of
+  /// the loads they cover.
+  virtual unsigned getCacheMissLatency() const;
+
+  /// \brief Return the smallest stride, in bytes, of a strided load that the
+  /// hardware prefetchers are not expected to cover.
+  virtual unsigned getMinPrefetchStride() const;
   /// @}
 
   /// \name Vector Target Information
@@ -347,6 +360,19 @@ public:
   /// and the number of execution units in the CPU.
   virtual unsigned getMaximumUnrollFactor() const;
 
+  /// \return True if the vectorizer should combine groups of strided loads or
+  /// stores that together access whole structures, such as the real and
+  /// imaginary parts of an array of complex numbers, into wide accesses and
+  /// shuffles.
+  virtual bool enableInterleavedAccessVectorization() const;
+
+  /// \return True if the target can load or store a vector of type
+  /// \p DataType with a per-element mask (llvm.masked.load and
+  /// llvm.masked.store) without scalarizing the operation. A scalar
+  /// \p DataType asks whether register-sized vectors of it can be masked.
+  virtual bool isLegalMaskedLoad(Type *DataType) const;
+  virtual bool isLegalMaskedStore(Type *DataType) const;
+
   /// \return The expected cost of arithmetic ops, such as mul, xor, fsub, etc.
   virtual unsigned getArithmeticInstrCost(unsigned Opcode, Type *Ty,
                                   OperandValueKind Opd1Info = OK_AnyValue,
@@ -381,6 +407,21 @@ public:
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
 
+  /// \return The cost of a masked Load or Store of vector type \p Src.
+  virtual unsigned getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                         unsigned Alignment,
+                                         unsigned AddressSpace) const;
+
+  /// \return The cost of an interleaved group of \p Factor loads or stores.
+  /// \p VecTy is the type of the wide vector that covers all of the members,
+  /// and member i accesses elements i, i + Factor, i + 2 * Factor, etc. The
+  /// cost includes the wide memory operation and the shuffles that split it
+  /// into one vector per member, or build it from them.
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
+
   /// \brief Calculate the cost of performing a vector reduction.
   ///
   /// This is the cost of reducing the vector value of type \p Ty to a scalar
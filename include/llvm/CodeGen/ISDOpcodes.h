@@ -632,6 +632,15 @@ namespace ISD {
     ATOMIC_LOAD_UMIN,
     ATOMIC_LOAD_UMAX,
 
+    /// MLOAD and MSTORE - Masked vector loads and stores, which come from the
+    /// llvm.masked.load and llvm.masked.store intrinsics.  MLOAD takes a
+    /// chain, a pointer, a mask and a pass-through vector, and returns the
+    /// loaded vector and a chain.  Lanes whose mask bit is clear are not
+    /// accessed and take their value from the pass-through vector.  MSTORE
+    /// takes a chain, a pointer, a mask and the vector to store, and only
+    /// writes the lanes whose mask bit is set.
+    MLOAD, MSTORE,
+
     /// This corresponds to the llvm.lifetime.* intrinsics. The first operand
     /// is the chain and the second operand is the alloca pointer.
     LIFETIME_START, LIFETIME_END,
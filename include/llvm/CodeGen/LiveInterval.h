@@ -235,6 +235,11 @@ namespace llvm {
       segments.clear();
     }
 
+    /// compact - Release the unused capacity of the segment and value number
+    /// lists. Ranges are built by repeated insertion, which leaves up to half
+    /// of a large list unused, and most of them change little afterwards.
+    void compact();
+
     size_t size() const {
       return segments.size();
     }
@@ -207,6 +207,13 @@ class MachineFrameInfo {
   /// CSIValid - Has CSInfo been set yet?
   bool CSIValid;
 
+  /// SavePoint, RestorePoint - When the prolog/epilog code inserter shrink-
+  /// wraps the function, the block that gets the callee saved register spills
+  /// and the prologue, and the block that gets the restores and the epilogue.
+  /// Null when they are in the entry and return blocks.
+  MachineBasicBlock *SavePoint;
+  MachineBasicBlock *RestorePoint;
+
   /// LocalFrameObjects - References to frame indices which are mapped
   /// into the local frame allocation block. <FrameIdx, LocalOffset>
   SmallVector<std::pair<int, int64_t>, 32> LocalFrameObjects;
@@ -246,6 +253,8 @@ public:
     FunctionContextIdx = -1;
     MaxCallFrameSize = 0;
     CSIValid = false;
+    SavePoint = nullptr;
+    RestorePoint = nullptr;
     LocalFrameSize = 0;
     LocalFrameMaxAlign = 0;
     UseLocalStackAllocationBlock = false;
@@ -558,6 +567,16 @@ public:
 
   void setCalleeSavedInfoValid(bool v) { CSIValid = v; }
 
+  /// getSavePoint/getRestorePoint - Return the blocks that the prologue and
+  /// epilogue were shrink-wrapped into, or null if they are in the entry and
+  /// return blocks.
+  MachineBasicBlock *getSavePoint() const { return SavePoint; }
+  void setSavePoint(MachineBasicBlock *NewSave) { SavePoint = NewSave; }
+  MachineBasicBlock *getRestorePoint() const { return RestorePoint; }
+  void setRestorePoint(MachineBasicBlock *NewRestore) {
+    RestorePoint = NewRestore;
+  }
+
   /// getPristineRegs - Return a set of physical registers that are pristine on
   /// entry to the MBB.
   ///
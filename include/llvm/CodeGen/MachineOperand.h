@@ -524,6 +524,13 @@ public:
     Contents.MBB = MBB;
   }
 
+  /// setRegMask - Replace the mask of a RegMask operand. The mask is not
+  /// copied, so it must outlive the operand.
+  void setRegMask(const uint32_t *RegMaskPtr) {
+    assert(isRegMask() && "Wrong MachineOperand mutator");
+    Contents.RegMask = RegMaskPtr;
+  }
+
   //===--------------------------------------------------------------------===//
   // Other methods.
   //===--------------------------------------------------------------------===//
@@ -452,6 +452,12 @@ namespace llvm {
   ///
   FunctionPass *createGreedyRegisterAllocator();
 
+  /// LinearScanRegisterAllocation Pass - This pass implements a global linear
+  /// scan register allocator with simple live range splitting, for clients
+  /// that need short compile times.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+
   /// PBQPRegisterAllocation Pass - This pass implements the Partitioned Boolean
   /// Quadratic Prograaming (PBQP) based register allocator.
   ///
@@ -592,6 +598,20 @@ namespace llvm {
   /// the intrinsic for later emission to the StackMap.
   extern char &StackMapLivenessID;
 
+  /// RegUsageInfoCollector - This pass records the registers each function
+  /// preserves once it has been compiled, for interprocedural register
+  /// allocation.
+  extern char &RegUsageInfoCollectorID;
+
+  /// RegUsageInfoPropagation - This pass gives direct calls to already
+  /// compiled functions the register mask RegUsageInfoCollector recorded for
+  /// the callee.
+  extern char &RegUsageInfoPropagationID;
+
+  /// MachineOutliner - This pass replaces repeated sequences of instructions
+  /// with calls to functions shared across the module.
+  extern char &MachineOutlinerID;
+
 } // End llvm namespace
 
 #endif
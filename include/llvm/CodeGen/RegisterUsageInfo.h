@@ -0,0 +1,60 @@
+//==- RegisterUsageInfo.h - Register Usage Information Storage -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass keeps the registers preserved by each function compiled so far, as
+// a register mask. It is used for interprocedural register allocation: code
+// generation runs over the call graph bottom-up, RegUsageInfoCollector records
+// the mask of each function once it has been compiled, and
+// RegUsageInfoPropagation replaces the calling convention mask of direct calls
+// to that function with it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_REGISTERUSAGEINFO_H
+#define LLVM_CODEGEN_REGISTERUSAGEINFO_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Pass.h"
+#include <vector>
+
+namespace llvm {
+
+class Function;
+
+class PhysicalRegisterUsageInfo : public ImmutablePass {
+  virtual void anchor();
+
+  /// RegMasks - The preserved register mask of each compiled function.
+  DenseMap<const Function *, std::vector<uint32_t> > RegMasks;
+
+public:
+  static char ID;
+
+  PhysicalRegisterUsageInfo() : ImmutablePass(ID) {
+    PassRegistry &Registry = *PassRegistry::getPassRegistry();
+    initializePhysicalRegisterUsageInfoPass(Registry);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+  /// setRegMask - Record RegMask as the registers preserved by F.
+  void setRegMask(const Function &F, const std::vector<uint32_t> &RegMask);
+
+  /// getRegMask - Return the registers preserved by F, or null if F has not
+  /// been compiled yet. The mask stays valid as long as this pass lives.
+  const uint32_t *getRegMask(const Function &F) const;
+
+  void releaseMemory() override { RegMasks.clear(); }
+};
+
+} // End llvm namespace
+
+#endif
@@ -20,6 +20,7 @@
 #include "llvm/ADT/ilist.h"
 #include "llvm/CodeGen/DAGCombine.h"
 #include "llvm/CodeGen/SelectionDAGNodes.h"
+#include "llvm/Support/ArrayRecycler.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include "llvm/Target/TargetMachine.h"
 #include <cassert>
@@ -96,6 +97,46 @@ private:
   static void createNode(const SDNode &);
 };
 
+/// SDNodeCSETable - An open-addressed hash table memoizing the nodes that are
+/// identified by their opcode, value types and operands alone. Hashes are
+/// computed straight from those fields, without building a FoldingSetNodeID,
+/// and stored next to each node so that growing and removing do not need to
+/// recompute them. A node must be removed before any of these fields change.
+class SDNodeCSETable {
+  struct Bucket {
+    SDNode *Node;
+    unsigned Hash;
+  };
+
+  std::vector<Bucket> Buckets;
+  unsigned NumEntries;
+
+  void grow();
+
+public:
+  SDNodeCSETable() : NumEntries(0) {}
+
+  static unsigned getHash(unsigned short Opcode, SDVTList VTs,
+                          ArrayRef<SDValue> Ops);
+  static unsigned getHash(const SDNode *N);
+
+  /// find - Return the node with these fields, or null.
+  SDNode *find(unsigned short Opcode, SDVTList VTs,
+               ArrayRef<SDValue> Ops) const;
+
+  /// insert - Add N, which must not match any node in the table.
+  void insert(SDNode *N);
+
+  /// remove - Remove N, returning false if it was not in the table.
+  bool remove(SDNode *N);
+
+  /// getOrInsert - Return the node matching N if there is one, otherwise
+  /// add N and return it.
+  SDNode *getOrInsert(SDNode *N);
+
+  void clear();
+};
+
 /// SDDbgInfo - Keeps track of dbg_value information through SDISel.  We do
 /// not build SDNodes for these so as not to perturb the generated code;
 /// instead the info is kept off to the side in this structure. Each SDNode may
@@ -192,12 +233,19 @@ class SelectionDAG {
   NodeAllocatorType NodeAllocator;
 
   /// CSEMap - This structure is used to memoize nodes, automatically performing
-  /// CSE with existing nodes when a duplicate is requested.
+  /// CSE with existing nodes when a duplicate is requested. It holds the nodes
+  /// that carry more than their opcode, value types and operands, such as
+  /// constants and memory operations; PlainCSEMap holds the others.
   FoldingSet<SDNode> CSEMap;
+  SDNodeCSETable PlainCSEMap;
 
-  /// OperandAllocator - Pool allocation for machine-opcode SDNode operands.
+  /// OperandAllocator - Pool allocation for SDNode operands.
   BumpPtrAllocator OperandAllocator;
 
+  /// OperandRecycler - Recycles the operand lists of deleted nodes, except
+  /// those of machine nodes, which are not recycled.
+  ArrayRecycler<SDUse> OperandRecycler;
+
   /// Allocator - Pool allocation for misc. objects that are created once per
   /// SelectionDAG.
   BumpPtrAllocator Allocator;
@@ -798,6 +846,13 @@ public:
   SDValue getIndexedStore(SDValue OrigStoe, SDLoc dl, SDValue Base,
                            SDValue Offset, ISD::MemIndexedMode AM);
 
+  /// getMaskedLoad/getMaskedStore - Helper functions to build ISD::MLOAD and
+  /// ISD::MSTORE nodes.
+  SDValue getMaskedLoad(EVT VT, SDLoc dl, SDValue Chain, SDValue Ptr,
+                        SDValue Mask, SDValue Src0, MachineMemOperand *MMO);
+  SDValue getMaskedStore(SDValue Chain, SDLoc dl, SDValue Val, SDValue Ptr,
+                         SDValue Mask, MachineMemOperand *MMO);
+
   /// getSrcValue - Construct a node to track a Value* through the backend.
   SDValue getSrcValue(const Value *v);
 
@@ -1160,6 +1215,9 @@ public:
 private:
   bool RemoveNodeFromCSEMaps(SDNode *N);
   void AddModifiedNodeToCSEMaps(SDNode *N);
+  SDNode *FindNodeOrInsertPos(unsigned short Opcode, SDVTList VTs,
+                              ArrayRef<SDValue> Ops, void *&InsertPos);
+  void InsertNode(SDNode *N, void *InsertPos);
   SDNode *FindModifiedNodeSlot(SDNode *N, SDValue Op, void *&InsertPos);
   SDNode *FindModifiedNodeSlot(SDNode *N, SDValue Op1, SDValue Op2,
                                void *&InsertPos);
@@ -1167,6 +1225,9 @@ private:
                                void *&InsertPos);
   SDNode *UpdadeSDLocOnMergedSDNode(SDNode *N, SDLoc loc);
 
+  void createOperands(SDNode *N, ArrayRef<SDValue> Vals);
+  void removeOperands(SDNode *N);
+
   void DeleteNodeNotInCSEMaps(SDNode *N);
   void DeallocateNode(SDNode *N);
 
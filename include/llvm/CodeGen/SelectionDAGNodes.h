@@ -318,8 +318,9 @@ private:
   ///
   int16_t NodeType;
 
-  /// OperandsNeedDelete - This is true if OperandList was new[]'d.  If true,
-  /// then they will be delete[]'d when the node is destroyed.
+  /// OperandsNeedDelete - This is true if OperandList was allocated from the
+  /// SelectionDAG's operand recycler, and must be returned to it when the node
+  /// is destroyed or its operand list is replaced.
   uint16_t OperandsNeedDelete : 1;
 
   /// HasDebugValue - This tracks whether this node has one or more dbg_value
@@ -714,23 +715,8 @@ protected:
     return Ret;
   }
 
-  SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs,
-         ArrayRef<SDValue> Ops)
-    : NodeType(Opc), OperandsNeedDelete(true), HasDebugValue(false),
-      SubclassData(0), NodeId(-1),
-      OperandList(Ops.size() ? new SDUse[Ops.size()] : nullptr),
-      ValueList(VTs.VTs), UseList(nullptr),
-      NumOperands(Ops.size()), NumValues(VTs.NumVTs),
-      debugLoc(dl), IROrder(Order) {
-    for (unsigned i = 0; i != Ops.size(); ++i) {
-      OperandList[i].setUser(this);
-      OperandList[i].setInitial(Ops[i]);
-    }
-    checkForCycles(this);
-  }
-
-  /// This constructor adds no operands itself; operands can be
-  /// set later with InitOperands.
+  /// This constructor adds no operands itself; operands can be set later
+  /// with InitOperands, or by SelectionDAG::createOperands.
   SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs)
     : NodeType(Opc), OperandsNeedDelete(false), HasDebugValue(false),
       SubclassData(0), NodeId(-1), OperandList(nullptr), ValueList(VTs.VTs),
@@ -997,9 +983,6 @@ public:
   MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
             EVT MemoryVT, MachineMemOperand *MMO);
 
-  MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
-            ArrayRef<SDValue> Ops, EVT MemoryVT, MachineMemOperand *MMO);
-
   bool readMem() const { return MMO->isLoad(); }
   bool writeMem() const { return MMO->isStore(); }
 
@@ -1090,6 +1073,8 @@ public:
            N->getOpcode() == ISD::ATOMIC_LOAD_UMAX    ||
            N->getOpcode() == ISD::ATOMIC_LOAD         ||
            N->getOpcode() == ISD::ATOMIC_STORE        ||
+           N->getOpcode() == ISD::MLOAD               ||
+           N->getOpcode() == ISD::MSTORE              ||
            N->isTargetMemoryOpcode();
   }
 };
@@ -1214,9 +1199,8 @@ public:
 class MemIntrinsicSDNode : public MemSDNode {
 public:
   MemIntrinsicSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
-                     ArrayRef<SDValue> Ops, EVT MemoryVT,
-                     MachineMemOperand *MMO)
-    : MemSDNode(Opc, Order, dl, VTs, Ops, MemoryVT, MMO) {
+                     EVT MemoryVT, MachineMemOperand *MMO)
+    : MemSDNode(Opc, Order, dl, VTs, MemoryVT, MMO) {
   }
 
   // Methods to support isa and dyn_cast
@@ -1686,10 +1670,8 @@ class CvtRndSatSDNode : public SDNode {
   ISD::CvtCode CvtCode;
   friend class SelectionDAG;
   explicit CvtRndSatSDNode(EVT VT, unsigned Order, DebugLoc dl,
-                           ArrayRef<SDValue> Ops, ISD::CvtCode Code)
-    : SDNode(ISD::CONVERT_RNDSAT, Order, dl, getSDVTList(VT), Ops),
-      CvtCode(Code) {
-    assert(Ops.size() == 5 && "wrong number of operations");
+                           ISD::CvtCode Code)
+    : SDNode(ISD::CONVERT_RNDSAT, Order, dl, getSDVTList(VT)), CvtCode(Code) {
   }
 public:
   ISD::CvtCode getCvtCode() const { return CvtCode; }
@@ -1821,6 +1803,69 @@ public:
   }
 };
 
+/// MaskedLoadStoreSDNode - Base class for MaskedLoadSDNode and
+/// MaskedStoreSDNode.
+///
+class MaskedLoadStoreSDNode : public MemSDNode {
+  // Operands: chain, pointer, mask and pass-through or stored value.
+  SDUse Ops[4];
+public:
+  MaskedLoadStoreSDNode(ISD::NodeType NodeTy, unsigned Order, DebugLoc dl,
+                        SDValue *Operands, SDVTList VTs, EVT MemVT,
+                        MachineMemOperand *MMO)
+    : MemSDNode(NodeTy, Order, dl, VTs, MemVT, MMO) {
+    InitOperands(Ops, Operands, 4);
+  }
+
+  const SDValue &getBasePtr() const { return getOperand(1); }
+  const SDValue &getMask() const { return getOperand(2); }
+
+  static bool classof(const SDNode *N) {
+    return N->getOpcode() == ISD::MLOAD ||
+           N->getOpcode() == ISD::MSTORE;
+  }
+};
+
+/// MaskedLoadSDNode - This class is used to represent ISD::MLOAD nodes.
+///
+class MaskedLoadSDNode : public MaskedLoadStoreSDNode {
+  friend class SelectionDAG;
+  MaskedLoadSDNode(SDValue *Operands, unsigned Order, DebugLoc dl,
+                   SDVTList VTs, EVT MemVT, MachineMemOperand *MMO)
+    : MaskedLoadStoreSDNode(ISD::MLOAD, Order, dl, Operands, VTs, MemVT, MMO) {
+    assert(readMem() && "Masked load MachineMemOperand is not a load!");
+    assert(!writeMem() && "Masked load MachineMemOperand is a store!");
+  }
+public:
+
+  /// getSrc0 - Return the vector that supplies the masked off lanes.
+  const SDValue &getSrc0() const { return getOperand(3); }
+
+  static bool classof(const SDNode *N) {
+    return N->getOpcode() == ISD::MLOAD;
+  }
+};
+
+/// MaskedStoreSDNode - This class is used to represent ISD::MSTORE nodes.
+///
+class MaskedStoreSDNode : public MaskedLoadStoreSDNode {
+  friend class SelectionDAG;
+  MaskedStoreSDNode(SDValue *Operands, unsigned Order, DebugLoc dl,
+                    SDVTList VTs, EVT MemVT, MachineMemOperand *MMO)
+    : MaskedLoadStoreSDNode(ISD::MSTORE, Order, dl, Operands, VTs, MemVT,
+                            MMO) {
+    assert(!readMem() && "Masked store MachineMemOperand is a load!");
+    assert(writeMem() && "Masked store MachineMemOperand is not a store!");
+  }
+public:
+
+  const SDValue &getValue() const { return getOperand(3); }
+
+  static bool classof(const SDNode *N) {
+    return N->getOpcode() == ISD::MSTORE;
+  }
+};
+
 /// MachineSDNode - An SDNode that represents everything that will be needed
 /// to construct a MachineInstr. These nodes are created during the
 /// instruction selection proper phase.
@@ -407,6 +407,19 @@ public:
   /// If the pointer isn't i8* it will be converted.
   CallInst *CreateLifetimeEnd(Value *Ptr, ConstantInt *Size = nullptr);
 
+  /// \brief Create a call to the masked.load intrinsic.
+  ///
+  /// Ptr must point to the loaded vector type. Lanes whose bit in Mask is
+  /// clear take their value from PassThru, or are undefined if it is null.
+  CallInst *CreateMaskedLoad(Value *Ptr, unsigned Align, Value *Mask,
+                             Value *PassThru = nullptr, const Twine &Name = "");
+
+  /// \brief Create a call to the masked.store intrinsic.
+  ///
+  /// Ptr must point to the type of Val.
+  CallInst *CreateMaskedStore(Value *Val, Value *Ptr, unsigned Align,
+                              Value *Mask);
+
 private:
   Value *getCastedInt8PtrValue(Value *Ptr);
 };
@@ -104,6 +104,7 @@ enum PassDebuggingString {
   EXECUTION_MSG, // "Executing Pass '" + PassName
   MODIFICATION_MSG, // "Made Modification '" + PassName
   FREEING_MSG, // " Freeing Pass '" + PassName
+  SKIPPING_MSG, // "Skipping Unchanged '" + PassName
   ON_BASICBLOCK_MSG, // "' on BasicBlock '" + InstructionName + "'...\n"
   ON_FUNCTION_MSG, // "' on Function '" + FunctionName + "'...\n"
   ON_MODULE_MSG, // "' on Module '" + ModuleName + "'...\n"
@@ -224,6 +225,16 @@ public:
   void dumpPasses() const;
   void dumpArguments() const;
 
+  /// Record that F, or any function in the module if F is null, was modified.
+  void bumpModificationEpoch(const Function *F);
+
+  /// Return true if an idempotent pass with the same ID as P has already run
+  /// on F and nothing has modified F since.
+  bool isUnchangedSinceLastRun(const Pass *P, const Function *F) const;
+
+  /// Record that idempotent pass P just finished running on F.
+  void recordIdempotentRun(const Pass *P, const Function *F);
+
   // Active Pass Managers
   PMStack activeStack;
 
@@ -251,6 +262,21 @@ private:
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  /// Modification epochs. Every recorded change gets a fresh epoch number.
+  /// The epoch of a function is the later of its own last change and the
+  /// last change that may have touched the whole module.
+  unsigned LastEpoch, ModuleEpoch;
+  DenseMap<const Function *, unsigned> FunctionEpochs;
+
+  /// The epoch of each function when each kind of idempotent pass last ran
+  /// on it.
+  DenseMap<std::pair<AnalysisID, const Function *>, unsigned>
+    IdempotentRunEpochs;
+
+  unsigned getModificationEpoch(const Function *F) const {
+    return std::max(FunctionEpochs.lookup(F), ModuleEpoch);
+  }
 };
 
 
@@ -280,6 +306,13 @@ public:
   /// Remove Analysis that is not preserved by the pass
   void removeNotPreservedAnalysis(Pass *P);
 
+  /// Record that P modified F, or any function if F is null: advance the
+  /// modification epoch and tell the immutable passes.
+  void functionModifiedBy(Pass *P, Function *F);
+
+  /// Tell the immutable passes that a pass has finished running.
+  void passFinished();
+
   /// Remove dead passes used by P.
   void removeDeadPasses(Pass *P, StringRef Msg,
                         enum PassDebuggingString);
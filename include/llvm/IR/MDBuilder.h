@@ -55,6 +55,12 @@ public:
   /// \brief Return metadata containing a number of branch weights.
   MDNode *createBranchWeights(ArrayRef<uint32_t> Weights);
 
+  /// \brief Return metadata describing the profiled targets of an indirect
+  /// call, given by name, out of a total of TotalCount calls.
+  MDNode *
+  createIndirectCallTargets(uint64_t TotalCount,
+                            ArrayRef<std::pair<StringRef, uint64_t> > Targets);
+
   //===------------------------------------------------------------------===//
   // Range metadata.
   //===------------------------------------------------------------------===//
@@ -0,0 +1,82 @@
+//===- PassCostReport.h - Per-function, per-pass compile cost ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the PassCostRegion class, which the pass managers use to
+// attribute compile time, instruction count changes and heap growth to every
+// (pass, function) pair when -pass-cost-report is given.  Module passes and
+// call graph SCC passes are attributed to the module and the SCC instead.
+// Unlike -time-passes, which aggregates by pass across the whole module, this
+// identifies the individual functions that make a pass expensive.  The N most
+// expensive pairs are written out as CSV when the program shuts down.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSCOSTREPORT_H
+#define LLVM_IR_PASSCOSTREPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+/// PassCostReportIsEnabled - This is the storage for the -pass-cost-report
+/// option.
+extern bool PassCostReportIsEnabled;
+
+/// PassCostRegion - Measure the cost of running one pass on one unit of IR,
+/// usually a function, for the lifetime of this object.  Does nothing unless
+/// -pass-cost-report is enabled.
+class PassCostRegion {
+public:
+  /// Callbacks that name a unit of IR and count its instructions.  They are
+  /// only called when the report is enabled.
+  typedef std::string (*NameFn)(void *Unit);
+  typedef unsigned (*CountFn)(void *Unit);
+
+private:
+  StringRef PassName;
+  void *Unit;
+  CountFn Count;
+  std::string UnitName;
+  unsigned InstsBefore;
+  size_t MallocBefore;
+  double WallBefore;
+
+  PassCostRegion(const PassCostRegion &) LLVM_DELETED_FUNCTION;
+  void operator=(const PassCostRegion &) LLVM_DELETED_FUNCTION;
+
+  void start(void *U, NameFn Name, CountFn Cnt);
+  void finish();
+public:
+  PassCostRegion(StringRef Name, Function &Fn);
+  PassCostRegion(StringRef Name, Module &M);
+
+  /// Measure a pass on another kind of unit, such as an SCC of the call
+  /// graph.  Cnt is called again when the region ends, so it must not rely on
+  /// anything the pass may delete.
+  PassCostRegion(StringRef Name, void *U, NameFn UName, CountFn Cnt)
+      : PassName(Name), Unit(nullptr) {
+    if (PassCostReportIsEnabled)
+      start(U, UName, Cnt);
+  }
+
+  ~PassCostRegion() {
+    if (Unit)
+      finish();
+  }
+};
+
+} // End llvm namespace
+
+#endif
@@ -105,6 +105,26 @@ struct LTOCodeGenerator {
                        bool disableGVNLoadPRE,
                        std::string &errMsg);
 
+  // Compile the merged module into one object file for each of the code
+  // generation partitions requested with -lto-partitions, which are code
+  // generated in parallel. The paths to the object files are returned to the
+  // caller via argument "names", in partition order, and remain valid until
+  // the next compilation. Return true on success.
+  //
+  // As with compile_to_file(), it is up to the linker to remove the object
+  // files.
+  bool compile_to_files(std::vector<const char *> &names,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
+  // Return the path to the object file of the given partition, generated by
+  // the last call to compile_to_files().
+  const char *getObjectFile(unsigned i) const {
+    return NativeObjectPaths[i].c_str();
+  }
+
   // As with compile_to_file(), this function compiles the merged module into
   // single object file. Instead of returning the object-file-path to the caller
   // (linker), it brings the object to a buffer, and return the buffer to the
@@ -121,10 +141,17 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
-  bool generateObjectFile(llvm::raw_ostream &out,
-                          bool disableOpt,
-                          bool disableInline,
-                          bool disableGVNLoadPRE,
+  bool compileToFiles(unsigned NumParts,
+                      bool disableOpt,
+                      bool disableInline,
+                      bool disableGVNLoadPRE,
+                      std::string &errMsg);
+  bool generateObjectFiles(llvm::ArrayRef<llvm::raw_ostream *> Outs,
+                           bool disableOpt,
+                           bool disableInline,
+                           bool disableGVNLoadPRE,
+                           std::string &errMsg);
+  bool generatePartitions(std::vector<std::string> &Objects,
                           std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
@@ -152,7 +179,7 @@ private:
   std::vector<char *> CodegenOptions;
   std::string MCpu;
   std::string MAttr;
-  std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
   llvm::TargetOptions Options;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
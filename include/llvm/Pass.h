@@ -273,6 +273,19 @@ public:
 
   ImmutablePass *getAsImmutablePass() override { return this; }
 
+  /// functionModified - Immutable passes are never invalidated, but some of
+  /// them memoize results about the IR. The pass managers call this method
+  /// after any pass has changed F, whatever it preserves, or with a null F if
+  /// the pass may have changed any function in the module.
+  ///
+  virtual void functionModified(Function *F) {}
+
+  /// passFinished - The pass managers call this method after every pass they
+  /// run, whether or not it reported a change, so that memoized results do not
+  /// outlive the pass that asked for them.
+  ///
+  virtual void passFinished() {}
+
   /// ImmutablePasses are never run.
   ///
   bool runOnModule(Module &) override { return false; }
@@ -306,6 +319,15 @@ public:
   ///
   virtual bool runOnFunction(Function &F) = 0;
 
+  /// isIdempotent - Return true if running this pass a second time on a
+  /// function it has just processed never changes the function.  When asked
+  /// to, the pass manager skips such passes on functions that have not been
+  /// modified since a pass with the same ID last ran on them.  Runs are
+  /// matched by pass ID, so a pass whose instances can be configured
+  /// differently must return false.
+  ///
+  virtual bool isIdempotent() const { return false; }
+
   void assignPassManager(PMStack &PMS, PassManagerType T) override;
 
   ///  Return what kind of Pass Manager can manage this pass.
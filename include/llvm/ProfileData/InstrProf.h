@@ -36,7 +36,8 @@ struct instrprof_error {
     unknown_function,
     hash_mismatch,
     count_mismatch,
-    counter_overflow
+    counter_overflow,
+    value_site_count_mismatch
   };
   ErrorType V;
 
@@ -29,16 +29,59 @@ namespace llvm {
 
 class InstrProfReader;
 
+/// A profiled target of an indirect call site and the number of times it was
+/// called from there.
+struct InstrProfValueData {
+  InstrProfValueData() : Count(0) {}
+  InstrProfValueData(StringRef Name, uint64_t Count)
+      : Name(Name), Count(Count) {}
+  StringRef Name;
+  uint64_t Count;
+};
+
+/// The profiled targets of a single indirect call site, most frequent first.
+typedef ArrayRef<InstrProfValueData> InstrProfValueSite;
+
 /// Profiling information for a single function.
 struct InstrProfRecord {
   InstrProfRecord() {}
-  InstrProfRecord(StringRef Name, uint64_t Hash, ArrayRef<uint64_t> Counts)
-      : Name(Name), Hash(Hash), Counts(Counts) {}
+  InstrProfRecord(StringRef Name, uint64_t Hash, ArrayRef<uint64_t> Counts,
+                  ArrayRef<InstrProfValueSite> IndirectCallSites = None)
+      : Name(Name), Hash(Hash), Counts(Counts),
+        IndirectCallSites(IndirectCallSites) {}
   StringRef Name;
   uint64_t Hash;
   ArrayRef<uint64_t> Counts;
+  /// The targets of each indirect call site in the function, in the order in
+  /// which the instrumentation numbered the sites. Empty if the function was
+  /// not value profiled.
+  ArrayRef<InstrProfValueSite> IndirectCallSites;
+};
+
+/// Storage for the indirect call targets of the record that a reader most
+/// recently returned.
+class InstrProfValueSiteBuffer {
+  std::vector<InstrProfValueData> Targets;
+  std::vector<unsigned> SiteSizes;
+  std::vector<InstrProfValueSite> Sites;
+public:
+  void clear() {
+    Targets.clear();
+    SiteSizes.clear();
+    Sites.clear();
+  }
+  /// Start a new call site. Its targets are the ones added until the next
+  /// call to addSite().
+  void addSite() { SiteSizes.push_back(0); }
+  void addTarget(StringRef Name, uint64_t Count) {
+    Targets.push_back(InstrProfValueData(Name, Count));
+    ++SiteSizes.back();
+  }
+  /// Return the sites that were added since the last clear().
+  ArrayRef<InstrProfValueSite> getSites();
 };
 
+
 /// A file format agnostic iterator over profiling data.
 class InstrProfIterator : public std::iterator<std::input_iterator_tag,
                                                InstrProfRecord> {
@@ -104,7 +147,10 @@ public:
 /// new lines.
 ///
 /// Each record consists of a function name, a function hash, a number of
-/// counters, and then each counter value, in that order.
+/// counters, and then each counter value, in that order. It may be followed by
+/// a line "indirect-call-sites: <N>" and the targets of N indirect call sites.
+/// Each site is a number of targets followed by that many "<name>:<count>"
+/// lines.
 class TextInstrProfReader : public InstrProfReader {
 private:
   /// The profile data file contents.
@@ -113,6 +159,10 @@ private:
   line_iterator Line;
   /// The current set of counter values.
   std::vector<uint64_t> Counts;
+  /// The current set of indirect call targets.
+  InstrProfValueSiteBuffer ValueSites;
+
+  error_code readValueSites(InstrProfRecord &Record);
 
   TextInstrProfReader(const TextInstrProfReader &) LLVM_DELETED_FUNCTION;
   TextInstrProfReader &operator=(const TextInstrProfReader &)
@@ -204,9 +254,12 @@ enum class HashT : uint32_t;
 /// format.
 class InstrProfLookupTrait {
   std::vector<uint64_t> CountBuffer;
+  InstrProfValueSiteBuffer ValueSiteBuffer;
   IndexedInstrProf::HashT HashType;
+  uint64_t FormatVersion;
 public:
-  InstrProfLookupTrait(IndexedInstrProf::HashT HashType) : HashType(HashType) {}
+  InstrProfLookupTrait(IndexedInstrProf::HashT HashType, uint64_t FormatVersion)
+      : HashType(HashType), FormatVersion(FormatVersion) {}
 
   typedef InstrProfRecord data_type;
   typedef StringRef internal_key_type;
@@ -231,26 +284,7 @@ public:
     return StringRef((const char *)D, N);
   }
 
-  InstrProfRecord ReadData(StringRef K, const unsigned char *D, offset_type N) {
-    if (N < 2 * sizeof(uint64_t) || N % sizeof(uint64_t)) {
-      // The data is corrupt, don't try to read it.
-      CountBuffer.clear();
-      return InstrProfRecord("", 0, CountBuffer);
-    }
-
-    using namespace support;
-
-    // The first stored value is the hash.
-    uint64_t Hash = endian::readNext<uint64_t, little, unaligned>(D);
-    // Each counter follows.
-    unsigned NumCounters = N / sizeof(uint64_t) - 1;
-    CountBuffer.clear();
-    CountBuffer.reserve(NumCounters - 1);
-    for (unsigned I = 0; I < NumCounters; ++I)
-      CountBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
-
-    return InstrProfRecord(K, Hash, CountBuffer);
-  }
+  InstrProfRecord ReadData(StringRef K, const unsigned char *D, offset_type N);
 };
 typedef OnDiskIterableChainedHashTable<InstrProfLookupTrait>
     InstrProfReaderIndex;
@@ -286,6 +320,12 @@ public:
   /// Fill Counts with the profile data for the given function name.
   error_code getFunctionCounts(StringRef FuncName, uint64_t &FuncHash,
                                std::vector<uint64_t> &Counts);
+  /// Fill Counts and IndirectCallSites with the profile data for the given
+  /// function name. The target names stay valid as long as the reader.
+  error_code getFunctionCounts(StringRef FuncName, uint64_t &FuncHash,
+                               std::vector<uint64_t> &Counts,
+                               std::vector<std::vector<InstrProfValueData>>
+                                   &IndirectCallSites);
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return MaxFunctionCount; }
 
@@ -18,9 +18,12 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace llvm {
@@ -28,18 +31,29 @@ namespace llvm {
 /// Writer for instrumentation based profile data.
 class InstrProfWriter {
 public:
+  typedef std::vector<std::pair<std::string, uint64_t> > ValueSiteData;
   struct CounterData {
     uint64_t Hash;
     std::vector<uint64_t> Counts;
+    std::vector<ValueSiteData> IndirectCallSites;
   };
 private:
   StringMap<CounterData> FunctionData;
+  unsigned MaxTargetsPerSite;
 public:
+  /// If MaxTargetsPerSite is non-zero, only that many of the most frequent
+  /// targets of each indirect call site are written out.
+  InstrProfWriter(unsigned MaxTargetsPerSite = 0)
+      : MaxTargetsPerSite(MaxTargetsPerSite) {}
+
   /// Add function counts for the given function. If there are already counts
   /// for this function and the hash and number of counts match, each counter is
-  /// summed.
+  /// summed. The counts of the indirect call targets are summed by target
+  /// name. A function without indirect call data merges with any other.
   error_code addFunctionCounts(StringRef FunctionName, uint64_t FunctionHash,
-                               ArrayRef<uint64_t> Counters);
+                               ArrayRef<uint64_t> Counters,
+                               ArrayRef<InstrProfValueSite> IndirectCallSites =
+                                   None);
   /// Ensure that all data is written to disk.
   void write(raw_fd_ostream &OS);
 };
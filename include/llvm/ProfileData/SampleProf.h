@@ -0,0 +1,156 @@
+//=-- SampleProf.h - Sampling profiling format support -----------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains common definitions used in the reading and writing of
+// sample profile data, as produced by sampling profilers such as Linux Perf.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROF_H_
+#define LLVM_PROFILEDATA_SAMPLEPROF_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/system_error.h"
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+const error_category &sampleprof_category();
+
+struct sampleprof_error {
+  enum ErrorType {
+    success = 0,
+    bad_magic,
+    unsupported_version,
+    too_large,
+    truncated,
+    malformed,
+    unknown_function
+  };
+  ErrorType V;
+
+  sampleprof_error(ErrorType V) : V(V) {}
+  operator ErrorType() const { return V; }
+};
+
+inline error_code make_error_code(sampleprof_error E) {
+  return error_code(static_cast<int>(E), sampleprof_category());
+}
+
+template <> struct is_error_code_enum<sampleprof_error> : std::true_type {};
+template <> struct is_error_code_enum<sampleprof_error::ErrorType>
+  : std::true_type {};
+
+/// \brief Represents the relative location of an instruction.
+///
+/// Instruction locations are specified by the line offset from the
+/// beginning of the function (marked by the line where the function
+/// header is) and the discriminator value within that line.
+///
+/// The discriminator value is useful to distinguish instructions
+/// that are on the same line but belong to different basic blocks
+/// (e.g., the two post-increment instructions in "if (p) x++; else y++;").
+struct LineLocation {
+  LineLocation(int L, unsigned D) : LineOffset(L), Discriminator(D) {}
+  int LineOffset;
+  unsigned Discriminator;
+};
+
+template <> struct DenseMapInfo<LineLocation> {
+  typedef DenseMapInfo<int> OffsetInfo;
+  typedef DenseMapInfo<unsigned> DiscriminatorInfo;
+  static inline LineLocation getEmptyKey() {
+    return LineLocation(OffsetInfo::getEmptyKey(),
+                        DiscriminatorInfo::getEmptyKey());
+  }
+  static inline LineLocation getTombstoneKey() {
+    return LineLocation(OffsetInfo::getTombstoneKey(),
+                        DiscriminatorInfo::getTombstoneKey());
+  }
+  static inline unsigned getHashValue(LineLocation Val) {
+    return DenseMapInfo<std::pair<int, unsigned>>::getHashValue(
+        std::pair<int, unsigned>(Val.LineOffset, Val.Discriminator));
+  }
+  static inline bool isEqual(LineLocation LHS, LineLocation RHS) {
+    return LHS.LineOffset == RHS.LineOffset &&
+           LHS.Discriminator == RHS.Discriminator;
+  }
+};
+
+typedef DenseMap<LineLocation, unsigned> BodySampleMap;
+
+/// \brief Representation of the samples collected for a function.
+///
+/// This data structure contains the total number of samples collected
+/// in the function, the number of samples collected at its entry and
+/// a map of samples collected in every statement.
+class FunctionSamples {
+public:
+  FunctionSamples() : TotalSamples(0), TotalHeadSamples(0) {}
+
+  void addTotalSamples(unsigned Num) {
+    TotalSamples = saturatingAdd(TotalSamples, Num);
+  }
+  void addHeadSamples(unsigned Num) {
+    TotalHeadSamples = saturatingAdd(TotalHeadSamples, Num);
+  }
+  void addBodySamples(int LineOffset, unsigned Discriminator, unsigned Num) {
+    assert(LineOffset >= 0);
+    unsigned &Samples = BodySamples[LineLocation(LineOffset, Discriminator)];
+    Samples = saturatingAdd(Samples, Num);
+  }
+
+  /// \brief Add the samples collected in \p Other to this profile.
+  void merge(const FunctionSamples &Other);
+
+  /// \brief Return the number of samples collected at \p Loc, or zero if
+  /// there are none.
+  unsigned getSamplesAt(LineLocation Loc) const {
+    return BodySamples.lookup(Loc);
+  }
+
+  unsigned getTotalSamples() const { return TotalSamples; }
+  unsigned getHeadSamples() const { return TotalHeadSamples; }
+  const BodySampleMap &getBodySamples() const { return BodySamples; }
+  /// \brief Fill \p Lines with the sampled lines, ordered by line offset and
+  /// discriminator.
+  void getSortedBodySamples(
+      std::vector<std::pair<LineLocation, unsigned> > &Lines) const;
+  bool empty() const { return BodySamples.empty(); }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  static unsigned saturatingAdd(unsigned A, unsigned B) {
+    return A + B < A ? ~0U : A + B;
+  }
+
+  /// \brief Total number of samples collected inside this function.
+  ///
+  /// Samples are cumulative, they include all the samples collected
+  /// inside this function and all its inlined callees.
+  unsigned TotalSamples;
+
+  /// \brief Total number of samples collected at the head of the function.
+  unsigned TotalHeadSamples;
+
+  /// \brief Map line offsets to collected samples.
+  ///
+  /// Each entry in this map contains the number of samples
+  /// collected at the corresponding line offset. All line locations
+  /// are an offset from the start of the function.
+  BodySampleMap BodySamples;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PROFILEDATA_SAMPLEPROF_H_
@@ -0,0 +1,227 @@
+//=-- SampleProfReader.h - Sampling profile reader ----------------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for reading sample profiles, in either the
+// text format or the indexed binary format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROF_READER_H_
+#define LLVM_PROFILEDATA_SAMPLEPROF_READER_H_
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/OnDiskHashTable.h"
+
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+/// Base class and interface for reading sample profiles.
+///
+/// Clients look up the samples of the functions they care about with
+/// getFunctionSamples. Readers of the indexed format only decode the
+/// functions that are asked for, so a compilation only pays for the
+/// functions in its module.
+class SampleProfileReader {
+  /// Message and line number of the last parse error, if any.
+  std::string LastErrorMessage;
+  unsigned LastErrorLine;
+
+public:
+  SampleProfileReader() : LastErrorLine(0) {}
+  virtual ~SampleProfileReader() {}
+
+  /// Read the profile, or its header and index for indexed profiles.
+  /// Required before any lookup.
+  virtual error_code read() = 0;
+
+  /// Fill \p Samples with the samples for function \p FName. Returns
+  /// sampleprof_error::unknown_function if the profile has no samples for
+  /// it.
+  virtual error_code getFunctionSamples(StringRef FName,
+                                        FunctionSamples &Samples) = 0;
+
+  /// Add the samples of every function in the profile to \p Profiles.
+  virtual error_code getAllFunctionSamples(
+      StringMap<FunctionSamples> &Profiles) = 0;
+
+  /// Return a description of the last parse error, if there is one.
+  StringRef getErrorMessage() const { return LastErrorMessage; }
+  /// Return the line of the last parse error, or zero if it was not
+  /// associated with a line.
+  unsigned getErrorLine() const { return LastErrorLine; }
+
+  /// Factory method to create an appropriately typed reader for the given
+  /// sample profile file.
+  static error_code create(std::string Path,
+                           std::unique_ptr<SampleProfileReader> &Result);
+
+protected:
+  /// Record a parse error at \p LineNumber and return
+  /// sampleprof_error::malformed.
+  error_code parseError(unsigned LineNumber, const Twine &Msg);
+};
+
+/// Reader for the text sample profile format.
+///
+/// The file contains a list of samples for every function executed at
+/// runtime. Each function profile has the following format:
+///
+///    function1:total_samples:total_head_samples
+///    offset1[.discriminator]: number_of_samples [fn1:num fn2:num ... ]
+///    offset2[.discriminator]: number_of_samples [fn3:num fn4:num ... ]
+///    ...
+///    offsetN[.discriminator]: number_of_samples [fn5:num fn6:num ... ]
+///
+/// Function names must be mangled in order for the profile loader to
+/// match them in the current translation unit. The two numbers in the
+/// function header specify how many total samples were accumulated in
+/// the function (first number), and the total number of samples accumulated
+/// at the prologue of the function (second number). This head sample
+/// count provides an indicator of how frequent is the function invoked.
+///
+/// Each sampled line may contain several items. Some are optional
+/// (marked below):
+///
+/// a- Source line offset. This number represents the line number
+///    in the function where the sample was collected. The line number
+///    is always relative to the line where symbol of the function
+///    is defined. So, if the function has its header at line 280,
+///    the offset 13 is at line 293 in the file.
+///
+/// b- [OPTIONAL] Discriminator. This is used if the sampled program
+///    was compiled with DWARF discriminator support
+///    (http://wiki.dwarfstd.org/index.php?title=Path_Discriminators)
+///
+/// c- Number of samples. This is the number of samples collected by
+///    the profiler at this source location.
+///
+/// d- [OPTIONAL] Potential call targets and samples. If present, this
+///    line contains a call instruction. This models both direct and
+///    indirect calls. Each called target is listed together with the
+///    number of samples. For example,
+///
+///    130: 7  foo:3  bar:2  baz:7
+///
+///    The above means that at relative line offset 130 there is a
+///    call instruction that calls one of foo(), bar() and baz(). With
+///    baz() being the relatively more frequent call target.
+///
+///    FIXME: This is currently unhandled, but it has a lot of
+///           potential for aiding the inliner.
+///
+/// Since this is a flat profile, a function that shows up more than
+/// once gets all its samples aggregated across all its instances.
+///
+/// This textual representation is useful to generate unit tests and
+/// for debugging purposes, but it should not be used to generate
+/// profiles for large programs, as the whole file has to be parsed
+/// before any function can be looked up. Use the indexed format for
+/// those.
+class TextSampleProfileReader : public SampleProfileReader {
+  /// The profile data file contents.
+  std::unique_ptr<MemoryBuffer> DataBuffer;
+  /// The samples of every function in the profile.
+  StringMap<FunctionSamples> Profiles;
+
+  TextSampleProfileReader(const TextSampleProfileReader &)
+    LLVM_DELETED_FUNCTION;
+  TextSampleProfileReader &operator=(const TextSampleProfileReader &)
+    LLVM_DELETED_FUNCTION;
+public:
+  TextSampleProfileReader(std::unique_ptr<MemoryBuffer> DataBuffer)
+      : DataBuffer(std::move(DataBuffer)) {}
+
+  error_code read() override;
+  error_code getFunctionSamples(StringRef FName,
+                                FunctionSamples &Samples) override;
+  error_code
+  getAllFunctionSamples(StringMap<FunctionSamples> &Profiles) override;
+};
+
+namespace IndexedSampleProf {
+const uint64_t Magic = 0x8169666f727073ff; // "\xffsprofi\x81"
+const uint64_t Version = 1;
+}
+
+/// Trait for lookups into the on-disk hash table of the indexed sample
+/// profile format.
+class SampleProfLookupTrait {
+public:
+  /// The samples of a function, and whether they were decoded successfully.
+  typedef std::pair<bool, FunctionSamples> data_type;
+  typedef StringRef internal_key_type;
+  typedef StringRef external_key_type;
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static bool EqualKey(StringRef A, StringRef B) { return A == B; }
+  static StringRef GetInternalKey(StringRef K) { return K; }
+  static StringRef GetExternalKey(StringRef K) { return K; }
+
+  static hash_value_type ComputeHash(StringRef K);
+
+  static std::pair<offset_type, offset_type>
+  ReadKeyDataLength(const unsigned char *&D) {
+    using namespace support;
+    offset_type KeyLen = endian::readNext<offset_type, little, unaligned>(D);
+    offset_type DataLen = endian::readNext<offset_type, little, unaligned>(D);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  StringRef ReadKey(const unsigned char *D, offset_type N) {
+    return StringRef((const char *)D, N);
+  }
+
+  static data_type ReadData(StringRef K, const unsigned char *D,
+                            offset_type N);
+};
+typedef OnDiskIterableChainedHashTable<SampleProfLookupTrait>
+    SampleProfReaderIndex;
+
+/// Reader for the indexed binary sample profile format.
+///
+/// The file starts with a magic number, a version and the offset of an
+/// on-disk hash table that maps function names to their samples. The
+/// samples of a function are its total and head sample counts, the number
+/// of sampled lines and, for every line, its offset, discriminator and
+/// sample count, all encoded as ULEB128.
+class IndexedSampleProfileReader : public SampleProfileReader {
+  /// The profile data file contents.
+  std::unique_ptr<MemoryBuffer> DataBuffer;
+  /// The index into the profile data.
+  std::unique_ptr<SampleProfReaderIndex> Index;
+
+  IndexedSampleProfileReader(const IndexedSampleProfileReader &)
+    LLVM_DELETED_FUNCTION;
+  IndexedSampleProfileReader &operator=(const IndexedSampleProfileReader &)
+    LLVM_DELETED_FUNCTION;
+public:
+  IndexedSampleProfileReader(std::unique_ptr<MemoryBuffer> DataBuffer)
+      : DataBuffer(std::move(DataBuffer)) {}
+
+  /// Return true if the given buffer is in the indexed sample profile
+  /// format.
+  static bool hasFormat(const MemoryBuffer &DataBuffer);
+
+  error_code read() override;
+  error_code getFunctionSamples(StringRef FName,
+                                FunctionSamples &Samples) override;
+  error_code
+  getAllFunctionSamples(StringMap<FunctionSamples> &Profiles) override;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PROFILEDATA_SAMPLEPROF_READER_H_
@@ -0,0 +1,43 @@
+//=-- SampleProfWriter.h - Sampling profile writer ----------------*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for writing sample profiles, in either the
+// text format or the indexed binary format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROF_WRITER_H_
+#define LLVM_PROFILEDATA_SAMPLEPROF_WRITER_H_
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+
+/// Writer for sample profiles.
+class SampleProfileWriter {
+  StringMap<FunctionSamples> Profiles;
+
+public:
+  /// Add the samples of function \p FName. If there already are samples for
+  /// it, they are summed.
+  void addFunctionSamples(StringRef FName, const FunctionSamples &Samples);
+
+  /// Write the profile in the text format, with functions and lines in a
+  /// deterministic order.
+  void writeText(raw_ostream &OS);
+
+  /// Write the profile in the indexed binary format.
+  void write(raw_fd_ostream &OS);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PROFILEDATA_SAMPLEPROF_WRITER_H_
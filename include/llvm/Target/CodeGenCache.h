@@ -0,0 +1,76 @@
+//===-- llvm/Target/CodeGenCache.h - On-disk object file cache --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the CodeGenCache class, a content-addressed on-disk cache
+// of object files produced by the code generator.  Entries are keyed on an MD5
+// hash of the input bitcode and of everything about the TargetMachine that
+// affects the generated code, so byte-identical inputs compiled with identical
+// options can skip code generation entirely.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TARGET_CODEGENCACHE_H
+#define LLVM_TARGET_CODEGENCACHE_H
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class LockFileManager;
+class MemoryBuffer;
+class TargetMachine;
+
+class CodeGenCache {
+  SmallString<128> CacheDir;
+  uint64_t MaxSize;
+
+  void getEntryPath(StringRef Key, SmallVectorImpl<char> &Path) const;
+
+public:
+  /// Create a cache in the given directory, which is created if needed.  If
+  /// MaxSize is non-zero, the least recently used entries are removed
+  /// whenever the cache grows beyond MaxSize bytes.
+  CodeGenCache(StringRef Dir, uint64_t MaxSize = 0);
+
+  /// computeKey - Hash the inputs that determine the output of the code
+  /// generator: the LLVM version, the module's bitcode and identifier, which
+  /// the bitcode does not record but which names the source file in the
+  /// output, the target triple, CPU and features, the TargetOptions,
+  /// relocation and code models, the optimization level and the settings
+  /// reported by TargetMachine::printOutputOptions.  Most code generator
+  /// options are global cl::opts that none of these record, so ExtraOptions
+  /// must cover them, usually by holding the command line, along with
+  /// anything else the client knows about, such as the output file type.
+  static std::string computeKey(StringRef Bitcode, StringRef ModuleID,
+                                const TargetMachine &TM,
+                                StringRef ExtraOptions = "");
+
+  /// acquire - Return the cached object file for Key, if any.  On a miss,
+  /// take the lock for the entry so that other processes that want the same
+  /// entry wait for this one to store it instead of compiling it again.  The
+  /// lock is released when Lock is destroyed.
+  std::unique_ptr<MemoryBuffer> acquire(StringRef Key,
+                                        std::unique_ptr<LockFileManager> &Lock);
+
+  /// store - Atomically add Object to the cache under Key, then prune the
+  /// cache to its size limit.  Returns false on failure.
+  bool store(StringRef Key, StringRef Object);
+
+  /// prune - Remove the least recently used entries until the cache fits in
+  /// its size limit.
+  void prune();
+};
+
+} // End llvm namespace
+
+#endif
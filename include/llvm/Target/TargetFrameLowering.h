@@ -129,6 +129,27 @@ public:
   /// the assembly prologue to explicitly handle the stack.
   virtual void adjustForHiPEPrologue(MachineFunction &MF) const { }
 
+  /// enableShrinkWrapping - Returns true if the target can put the prologue
+  /// and epilogue of the function somewhere other than the entry and return
+  /// blocks. emitPrologue and emitEpilogue must then honor the save and
+  /// restore points of the MachineFrameInfo.
+  virtual bool enableShrinkWrapping(const MachineFunction &MF) const {
+    return false;
+  }
+
+  /// canUseAsPrologue - Returns true if the prologue can be inserted at the
+  /// start of MBB when shrink-wrapping.
+  virtual bool canUseAsPrologue(const MachineBasicBlock &MBB) const {
+    return true;
+  }
+
+  /// canUseAsEpilogue - Returns true if the epilogue can be inserted before
+  /// the terminators of MBB when shrink-wrapping. MBB need not be a return
+  /// block.
+  virtual bool canUseAsEpilogue(const MachineBasicBlock &MBB) const {
+    return true;
+  }
+
   /// spillCalleeSavedRegisters - Issues instruction(s) to spill all callee
   /// saved registers and returns true if it isn't possible / profitable to do
   /// so by issuing a series of store instructions via
@@ -1006,6 +1006,39 @@ public:
     return nullptr;
   }
 
+  /// isFunctionSafeToOutlineFrom - Return true if sequences of instructions
+  /// in MF may be replaced by calls to outlined functions. Targets must reject
+  /// functions that keep live data where a call would write its return
+  /// address, such as in a red zone.
+  virtual bool isFunctionSafeToOutlineFrom(const MachineFunction &MF) const {
+    return false;
+  }
+
+  /// isLegalToOutline - Return true if MI may be moved into an outlined
+  /// function and executed there after a call. MI must not be a terminator,
+  /// call or label, and must not depend on its position or on the stack
+  /// pointer.
+  virtual bool isLegalToOutline(const MachineInstr &MI) const {
+    return false;
+  }
+
+  /// insertOutlinedCall - Insert a call to the outlined function Callee
+  /// before InsertPt, and return it.
+  virtual MachineInstr *insertOutlinedCall(MachineBasicBlock &MBB,
+                                           MachineBasicBlock::iterator InsertPt,
+                                           const Function &Callee,
+                                           DebugLoc DL) const {
+    llvm_unreachable(
+      "Target didn't implement TargetInstrInfo::insertOutlinedCall!");
+  }
+
+  /// insertOutlinedReturn - Append the return that ends the body of an
+  /// outlined function to MBB.
+  virtual void insertOutlinedReturn(MachineBasicBlock &MBB) const {
+    llvm_unreachable(
+      "Target didn't implement TargetInstrInfo::insertOutlinedReturn!");
+  }
+
 private:
   int CallFrameSetupOpcode, CallFrameDestroyOpcode;
 };
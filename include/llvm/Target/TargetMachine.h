@@ -252,6 +252,11 @@ public:
   /// \brief Register analysis passes for this target with a pass manager.
   virtual void addAnalysisPasses(PassManagerBase &) {}
 
+  /// printOutputOptions - Print the code generator settings that are not part
+  /// of TargetOptions but still change the emitted file, such as the asm
+  /// verbosity.  Caches of generated code include them in their keys.
+  virtual void printOutputOptions(raw_ostream &) const {}
+
   /// CodeGenFileType - These enums are meant to be passed into
   /// addPassesToEmitFile to indicate what type of file to emit, and returned by
   /// it to indicate what type of file could actually be made.
@@ -320,6 +325,8 @@ public:
   /// This registers target independent analysis passes.
   void addAnalysisPasses(PassManagerBase &PM) override;
 
+  void printOutputOptions(raw_ostream &OS) const override;
+
   /// createPassConfig - Create a pass configuration object to be used by
   /// addPassToEmitX methods for generating a pipeline of CodeGen passes.
   virtual TargetPassConfig *createPassConfig(PassManagerBase &PM);
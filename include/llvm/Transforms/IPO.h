@@ -192,6 +192,25 @@ ModulePass *createMergeFunctionsPass();
 ///
 ModulePass *createPartialInliningPass();
 
+//===----------------------------------------------------------------------===//
+/// createIndirectCallPromotionPass - This pass turns the hot targets of
+/// profiled indirect calls into guarded direct calls.
+///
+ModulePass *createIndirectCallPromotionPass();
+
+//===----------------------------------------------------------------------===//
+/// createHotColdSplittingPass - This pass outlines the cold regions of
+/// functions into separate cold functions.
+///
+ModulePass *createHotColdSplittingPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionOrderingPass - This pass orders the functions of a module so
+/// that functions which call each other often are close, and marks functions
+/// hot or cold from their estimated call counts.
+///
+ModulePass *createFunctionOrderingPass();
+
 //===----------------------------------------------------------------------===//
 // createMetaRenamerPass - Rename everything with metasyntatic names.
 //
@@ -305,6 +305,27 @@ FunctionPass *createMemCpyOptPass();
 // can prove are dead.
 //
 Pass *createLoopDeletionPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopDataPrefetch - This pass inserts software prefetches for the strided
+// loads of innermost loops that the hardware prefetchers will miss.
+//
+Pass *createLoopDataPrefetchPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopInterchange - This pass interchanges the loops of perfect loop nests
+// whose innermost loop would otherwise walk memory with a large stride.
+//
+FunctionPass *createLoopInterchangePass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopDistribute - This pass splits loops into several loops to separate
+// the statements of dependence cycles from the ones that can be vectorized.
+//
+FunctionPass *createLoopDistributePass();
   
 //===----------------------------------------------------------------------===//
 //
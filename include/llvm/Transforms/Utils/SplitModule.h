@@ -0,0 +1,41 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <memory>
+#include <vector>
+
+namespace llvm {
+
+class Module;
+
+/// Split \p M into \p N modules that, linked together, define the same
+/// symbols as \p M. The partitions are returned in \p Partitions.
+///
+/// Functions in the same call graph SCC, aliases and their aliasees, and the
+/// values that module level inline asm may refer to are kept in the same
+/// partition, and the partitions are balanced by the number of instructions
+/// they define. Local values referenced from another partition are given
+/// hidden external linkage in \p M, and renamed unless inline asm may refer
+/// to them. The partitioning only depends on \p M, so splitting the same
+/// module always produces the same partitions.
+void SplitModule(Module &M, unsigned N,
+                 std::vector<std::unique_ptr<Module>> &Partitions);
+
+} // End llvm namespace
+
+#endif
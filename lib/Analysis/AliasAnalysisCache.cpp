@@ -0,0 +1,211 @@
+//===- AliasAnalysisCache.cpp - Memoize Alias Analysis Queries ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass which sits on top of the alias analysis chain and
+// memoizes the result of alias() queries.  Clients such as LICM, GVN and DSE
+// tend to ask the same questions over and over, and the answers do not change
+// as long as the function is not modified.
+//
+// Because this is an ImmutablePass it lives for the whole pipeline, but results
+// are never reused across passes: the cache is dropped after every pass the
+// pass managers run.  Within a pass it is dropped whenever one of the pointers
+// it refers to is deleted or replaced, and on every update the pass reports
+// through the AliasAnalysis interface (deleteValue, copyValue and
+// addEscapingUse), whatever value the update is about.  Each of these starts a
+// new epoch.
+//
+// The AliasAnalysis update interface cannot describe every change, such as a
+// setOperand on a GEP or select whose address is being queried.  A pass that
+// makes such a change and then queries the same pointers again must report it
+// through one of the update methods, just as it would for any other stateful
+// alias analysis in the chain.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+#define DEBUG_TYPE "aa-cache"
+
+STATISTIC(NumHits, "Number of alias queries answered from the cache");
+STATISTIC(NumMisses, "Number of alias queries forwarded down the AA chain");
+STATISTIC(NumEpochs, "Number of times the alias query cache was dropped");
+
+static cl::opt<unsigned>
+MaxEntries("aa-cache-max-entries", cl::Hidden, cl::init(65536),
+           cl::desc("Maximum number of alias results to memoize before "
+                    "dropping the cache"));
+
+static cl::opt<bool>
+PrintReport("aa-cache-report", cl::Hidden,
+            cl::desc("Print the alias query cache hit rate on exit"));
+
+namespace {
+  class AliasAnalysisCache;
+
+  /// PtrVH - Drops the whole cache when a pointer it refers to is deleted, so
+  /// that a new value allocated at the same address cannot hit stale entries,
+  /// or when all of its uses are replaced.
+  class PtrVH : public CallbackVH {
+    AliasAnalysisCache *Cache;
+    void deleted() override;
+    void allUsesReplacedWith(Value *) override;
+  public:
+    PtrVH(Value *V, AliasAnalysisCache *C) : CallbackVH(V), Cache(C) {}
+
+    /// detach - Stop tracking the pointer without destroying the handle.
+    void detach() { setValPtr(nullptr); }
+  };
+
+  class AliasAnalysisCache : public ImmutablePass, public AliasAnalysis {
+    typedef std::pair<Location, Location> LocPair;
+
+    /// Cache - The memoized alias() results for the current epoch.
+    DenseMap<LocPair, AliasResult> Cache;
+
+    /// TrackedPtrs/Handles - The pointers mentioned by any key in Cache.  After
+    /// an invalidation Handles only holds detached handles, which are freed
+    /// the next time a pointer is tracked: the invalidation may come from one
+    /// of their own callbacks.
+    SmallPtrSet<const Value *, 32> TrackedPtrs;
+    std::vector<PtrVH> Handles;
+
+    /// Hits/Misses - Totals over the lifetime of the pass, for the report.
+    uint64_t Hits, Misses;
+
+    void track(const Value *V) {
+      if (TrackedPtrs.empty())
+        Handles.clear();
+      if (TrackedPtrs.insert(V))
+        Handles.push_back(PtrVH(const_cast<Value *>(V), this));
+    }
+
+  public:
+    static char ID; // Class identification, replacement for typeinfo
+    AliasAnalysisCache() : ImmutablePass(ID), Hits(0), Misses(0) {
+      initializeAliasAnalysisCachePass(*PassRegistry::getPassRegistry());
+    }
+
+    ~AliasAnalysisCache() {
+      if (!PrintReport || Hits + Misses == 0)
+        return;
+      errs() << "\n===== Alias Analysis Cache Report =====\n"
+             << "  " << Hits + Misses << " Total Alias Queries Performed\n"
+             << "  " << Hits << " answered from the cache ("
+             << Hits * 100 / (Hits + Misses) << "%)\n"
+             << "  " << Misses << " forwarded down the chain\n\n";
+    }
+
+    void initializePass() override {
+      InitializeAliasAnalysis(this);
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AliasAnalysis::getAnalysisUsage(AU);
+      AU.setPreservesAll();
+    }
+
+    /// getAdjustedAnalysisPointer - This method is used when a pass implements
+    /// an analysis interface through multiple inheritance.  If needed, it
+    /// should override this to adjust the this pointer as needed for the
+    /// specified pass info.
+    void *getAdjustedAnalysisPointer(AnalysisID PI) override {
+      if (PI == &AliasAnalysis::ID)
+        return (AliasAnalysis*)this;
+      return this;
+    }
+
+    /// invalidate - Start a new epoch by dropping everything memoized so far.
+    void invalidate() {
+      if (Cache.empty())
+        return;
+      ++NumEpochs;
+      Cache.clear();
+      TrackedPtrs.clear();
+      for (std::vector<PtrVH>::iterator I = Handles.begin(), E = Handles.end();
+           I != E; ++I)
+        I->detach();
+    }
+
+    void functionModified(Function *) override { invalidate(); }
+    void passFinished() override { invalidate(); }
+
+    AliasResult alias(const Location &LocA, const Location &LocB) override;
+
+    // Any update means the pass is rewriting the IR, and the value it names
+    // need not be the one our entries depend on, so drop everything.
+    void deleteValue(Value *V) override {
+      invalidate();
+      AliasAnalysis::deleteValue(V);
+    }
+
+    void copyValue(Value *From, Value *To) override {
+      invalidate();
+      AliasAnalysis::copyValue(From, To);
+    }
+
+    void addEscapingUse(Use &U) override {
+      invalidate();
+      AliasAnalysis::addEscapingUse(U);
+    }
+  };
+}
+
+void PtrVH::deleted() {
+  detach();
+  Cache->invalidate();
+}
+
+void PtrVH::allUsesReplacedWith(Value *) {
+  // Results about the users of the old value may no longer hold.
+  Cache->invalidate();
+}
+
+char AliasAnalysisCache::ID = 0;
+INITIALIZE_AG_PASS(AliasAnalysisCache, AliasAnalysis, "aa-cache",
+                   "Alias Analysis Query Cache", false, true, false)
+
+ImmutablePass *llvm::createAliasAnalysisCachePass() {
+  return new AliasAnalysisCache();
+}
+
+AliasAnalysis::AliasResult
+AliasAnalysisCache::alias(const Location &LocA, const Location &LocB) {
+  // alias() is symmetric, so canonicalize the key to get more hits.
+  LocPair Key = LocA.Ptr <= LocB.Ptr ? LocPair(LocA, LocB)
+                                     : LocPair(LocB, LocA);
+  DenseMap<LocPair, AliasResult>::iterator I = Cache.find(Key);
+  if (I != Cache.end()) {
+    ++NumHits;
+    ++Hits;
+    return I->second;
+  }
+  ++NumMisses;
+  ++Misses;
+
+  AliasResult R = AliasAnalysis::alias(LocA, LocB);
+
+  // The query may have recursively invalidated the cache, so don't hold on to
+  // an insertion point across it.
+  if (Cache.size() >= MaxEntries)
+    invalidate();
+  track(LocA.Ptr);
+  track(LocB.Ptr);
+  Cache[Key] = R;
+  return R;
+}
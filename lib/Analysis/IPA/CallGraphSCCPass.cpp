@@ -22,6 +22,8 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/IR/PassCostReport.h"
+#include "llvm/InitializePasses.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
@@ -107,6 +109,34 @@ private:
 char CGPassManager::ID = 0;
 
 
+/// getSCCName - Name an SCC in the pass cost report by its functions.
+static std::string getSCCName(void *SCC) {
+  std::string Name;
+  CallGraphSCC &CurSCC = *static_cast<CallGraphSCC *>(SCC);
+  for (CallGraphSCC::iterator I = CurSCC.begin(), E = CurSCC.end(); I != E;
+       ++I)
+    if (Function *F = (*I)->getFunction()) {
+      if (!Name.empty())
+        Name += ' ';
+      Name += F->getName();
+    }
+  return Name.empty() ? "<external node>" : Name;
+}
+
+/// countSCCInstructions - Count the instructions in the functions of an SCC.
+/// Passes such as argument promotion replace functions, and update the SCC
+/// when they do.
+static unsigned countSCCInstructions(void *SCC) {
+  unsigned Count = 0;
+  CallGraphSCC &CurSCC = *static_cast<CallGraphSCC *>(SCC);
+  for (CallGraphSCC::iterator I = CurSCC.begin(), E = CurSCC.end(); I != E;
+       ++I)
+    if (Function *F = (*I)->getFunction())
+      for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+        Count += BB->size();
+  return Count;
+}
+
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate,
                                  bool &DevirtualizedCall) {
@@ -122,8 +152,16 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassCostRegion PassCost(CGSP->getPassName(), &CurSCC, getSCCName,
+                              countSCCInstructions);
       Changed = CGSP->runOnSCC(CurSCC);
     }
+    passFinished();
+
+    // CallGraphSCC passes may delete functions and create new ones (e.g.
+    // argument promotion), so treat the whole module as modified.
+    if (Changed)
+      functionModifiedBy(CGSP, nullptr);
     
     // After the CGSCCPass is done, when assertions are enabled, use
     // RefreshCallGraph to verify that the callgraph was correctly updated.
@@ -576,6 +614,13 @@ void CallGraphSCCPass::getAnalysisUsage(AnalysisUsage &AU) const {
 }
 
 
+char DummyCGSCCPass::ID = 0;
+
+DummyCGSCCPass::DummyCGSCCPass() : CallGraphSCCPass(ID) {
+  // Code generators use this pass without initializing the analysis library.
+  initializeCallGraphWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
 //===----------------------------------------------------------------------===//
 // PrintCallGraphPass Implementation
 //===----------------------------------------------------------------------===//
@@ -17,6 +17,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -28,6 +29,8 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -36,9 +39,61 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCallsSummarized,
+          "Number of call sites analyzed from a callee summary");
+STATISTIC(NumSummaries, "Number of callee summaries computed");
+
+static cl::opt<bool>
+DisableSummaries("disable-inline-cost-summaries", cl::init(false), cl::Hidden,
+                 cl::desc("Analyze the callee at every call site instead of "
+                          "reusing a summary of it"));
 
 namespace {
 
+/// \brief The part of the analysis of a callee that does not depend on the
+/// call site.
+///
+/// Walking the callee only depends on the call site through the arguments it
+/// passes, the caller, and the threshold at which the walk stops. For call
+/// sites that pass no arguments the analysis can simplify, this summary of a
+/// walk that ignores the threshold gives the same cost, along with enough
+/// about the costs along the way to tell whether the walk would have stopped
+/// early.
+struct CalleeSummary {
+  /// False if the walk found a construct that stops the analysis.
+  bool Complete;
+  /// True if a live block of the callee has more than one successor.
+  bool MultiBlock;
+  bool ContainsNoDuplicateCall;
+  int BodyCost;
+  uint64_t AllocatedSize;
+  unsigned NumInstructions, NumVectorInstructions;
+  /// The largest cost at which the walk would have compared the cost against
+  /// the threshold, indexed by whether the single block bonus had been
+  /// taken off the threshold and by the kind of vector bonus in effect.
+  int MaxCost[2][3];
+
+  CalleeSummary()
+      : Complete(false), MultiBlock(false), ContainsNoDuplicateCall(false),
+        BodyCost(0), AllocatedSize(0), NumInstructions(0),
+        NumVectorInstructions(0) {
+    for (unsigned i = 0; i != 2; ++i)
+      for (unsigned j = 0; j != 3; ++j)
+        MaxCost[i][j] = INT_MIN;
+  }
+};
+
+/// \brief Return 2 if vector instructions make up more than half of the
+/// instructions, 1 if they make up more than a tenth, and 0 otherwise.
+static unsigned getVectorBonusKind(unsigned NumVectorInstructions,
+                                   unsigned NumInstructions) {
+  if (NumVectorInstructions > NumInstructions/2)
+    return 2;
+  if (NumVectorInstructions > NumInstructions/10)
+    return 1;
+  return 0;
+}
+
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   typedef InstVisitor<CallAnalyzer, bool> Base;
   friend class InstVisitor<CallAnalyzer, bool>;
@@ -55,6 +110,11 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   int Threshold;
   int Cost;
 
+  // The callee summary being built, or null when analyzing a call site.
+  CalleeSummary *Summary;
+
+  bool SingleBB;
+  int SingleBBBonus;
   bool IsCallerRecursive;
   bool IsRecursiveCall;
   bool ExposesReturnsTwice;
@@ -102,9 +162,13 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   bool accumulateGEPOffset(GEPOperator &GEP, APInt &Offset);
   bool simplifyCallSite(Function *F, CallSite CS);
   ConstantInt *stripAndComputeInBoundsConstantOffsets(Value *&V);
+  bool isOverThreshold();
+  bool canUseSummary(CallSite CS);
+  bool applySummary(const CalleeSummary &S);
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB);
+  bool analyzeBody();
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -143,6 +207,7 @@ public:
   CallAnalyzer(const DataLayout *DL, const TargetTransformInfo &TTI,
                Function &Callee, int Threshold)
       : DL(DL), TTI(TTI), F(Callee), Threshold(Threshold), Cost(0),
+        Summary(nullptr), SingleBB(true), SingleBBBonus(0),
         IsCallerRecursive(false), IsRecursiveCall(false),
         ExposesReturnsTwice(false), HasDynamicAlloca(false),
         ContainsNoDuplicateCall(false), HasReturn(false), HasIndirectBr(false),
@@ -153,7 +218,8 @@ public:
         NumInstructionsSimplified(0), SROACostSavings(0),
         SROACostSavingsLost(0) {}
 
-  bool analyzeCall(CallSite CS);
+  bool analyzeCall(CallSite CS, const CalleeSummary *S = nullptr);
+  void summarize(CalleeSummary &S);
 
   int getThreshold() { return Threshold; }
   int getCost() { return Cost; }
@@ -931,7 +997,7 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB) {
 
     // Check if we've past the threshold so we don't spin in huge basic
     // blocks that will never inline.
-    if (Cost > (Threshold + VectorBonus))
+    if (isOverThreshold())
       return false;
   }
 
@@ -983,14 +1049,13 @@ ConstantInt *CallAnalyzer::stripAndComputeInBoundsConstantOffsets(Value *&V) {
 /// factors and heuristics. If this method returns false but the computed cost
 /// is below the computed threshold, then inlining was forcibly disabled by
 /// some artifact of the routine.
-bool CallAnalyzer::analyzeCall(CallSite CS) {
+bool CallAnalyzer::analyzeCall(CallSite CS, const CalleeSummary *S) {
   ++NumCallsAnalyzed;
 
   // Track whether the post-inlining function would have more than one basic
   // block. A single basic block is often intended for inlining. Balloon the
   // threshold by 50% until we pass the single-BB phase.
-  bool SingleBB = true;
-  int SingleBBBonus = Threshold / 2;
+  SingleBBBonus = Threshold / 2;
   Threshold += SingleBBBonus;
 
   // Perform some tweaks to the cost and threshold based on the direct
@@ -1099,6 +1164,27 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
 
+  if (!S || !canUseSummary(CS) || !applySummary(*S)) {
+    if (!analyzeBody())
+      return false;
+  }
+
+  // If this is a noduplicate call, we can still inline as long as
+  // inlining this would cause the removal of the caller (so the instruction
+  // is not actually duplicated, just moved).
+  if (!OnlyOneCallAndLocalLinkage && ContainsNoDuplicateCall)
+    return false;
+
+  Threshold += VectorBonus;
+
+  return Cost < Threshold;
+}
+
+/// \brief Walk the blocks of the callee that are live after inlining.
+///
+/// Returns false if inlining is not viable, and true if it remains viable or
+/// the walk stopped because the cost crossed the threshold.
+bool CallAnalyzer::analyzeBody() {
   // The worklist of live basic blocks in the callee *after* inlining. We avoid
   // adding basic blocks of the callee which can be proven to be dead for this
   // particular call site in order to get more accurate cost estimates. This
@@ -1114,7 +1200,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
     // Bail out the moment we cross the threshold. This means we'll under-count
     // the cost, but only when undercounting doesn't matter.
-    if (Cost > (Threshold + VectorBonus))
+    if (isOverThreshold())
       break;
 
     BasicBlock *BB = BBWorklist[Idx];
@@ -1176,16 +1262,105 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
       SingleBB = false;
     }
   }
+  return true;
+}
 
-  // If this is a noduplicate call, we can still inline as long as
-  // inlining this would cause the removal of the caller (so the instruction
-  // is not actually duplicated, just moved).
-  if (!OnlyOneCallAndLocalLinkage && ContainsNoDuplicateCall)
+/// \brief Return true if the cost has crossed the threshold.
+///
+/// When building a callee summary there is no threshold; record the cost for
+/// the kind of threshold in effect instead.
+bool CallAnalyzer::isOverThreshold() {
+  if (!Summary)
+    return Cost > (Threshold + VectorBonus);
+
+  int &MaxCost = Summary->MaxCost[!SingleBB][getVectorBonusKind(
+      NumVectorInstructions, NumInstructions)];
+  MaxCost = std::max(MaxCost, Cost);
+  return false;
+}
+
+/// \brief Test whether a callee summary gives the cost of this call site.
+///
+/// The arguments must not be constants or allocas, and pointer arguments
+/// must have distinct bases, as the summary treats each pointer argument as
+/// its own base.
+bool CallAnalyzer::canUseSummary(CallSite CS) {
+  if (!SimplifiedValues.empty() || !SROAArgValues.empty())
     return false;
 
-  Threshold += VectorBonus;
+  SmallPtrSet<Value *, 8> Bases;
+  for (CallSite::arg_iterator AI = CS.arg_begin(), AE = CS.arg_end();
+       AI != AE; ++AI) {
+    if (!DL || !(*AI)->getType()->isPointerTy())
+      continue;
+    Value *Base = *AI;
+    if (!stripAndComputeInBoundsConstantOffsets(Base) || !Bases.insert(Base))
+      return false;
+  }
+  return true;
+}
 
-  return Cost < Threshold;
+/// \brief Account for the callee from its summary.
+///
+/// Returns false, leaving the analysis unchanged, if the callee has to be
+/// walked to get the same result: if the walk would stop before the end of
+/// the callee, because of the threshold or because of what it finds.
+bool CallAnalyzer::applySummary(const CalleeSummary &S) {
+  if (!S.Complete ||
+      (IsCallerRecursive &&
+       S.AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller))
+    return false;
+
+  int VectorBonuses[3] = { 0, TenPercentVectorBonus, FiftyPercentVectorBonus };
+  for (unsigned Taken = 0; Taken != 2; ++Taken)
+    for (unsigned Kind = 0; Kind != 3; ++Kind)
+      if (S.MaxCost[Taken][Kind] != INT_MIN &&
+          Cost + S.MaxCost[Taken][Kind] >
+              Threshold - (Taken ? SingleBBBonus : 0) + VectorBonuses[Kind])
+        return false;
+
+  ++NumCallsSummarized;
+  Cost += S.BodyCost;
+  AllocatedSize = S.AllocatedSize;
+  NumInstructions = S.NumInstructions;
+  NumVectorInstructions = S.NumVectorInstructions;
+  ContainsNoDuplicateCall = S.ContainsNoDuplicateCall;
+  if (S.MultiBlock) {
+    Threshold -= SingleBBBonus;
+    SingleBB = false;
+  }
+  VectorBonus =
+      VectorBonuses[getVectorBonusKind(NumVectorInstructions, NumInstructions)];
+  return true;
+}
+
+/// \brief Summarize the callee for call sites that pass no arguments the
+/// analysis can simplify.
+void CallAnalyzer::summarize(CalleeSummary &S) {
+  ++NumSummaries;
+  if (F.empty())
+    return;
+  Summary = &S;
+
+  // Every pointer argument is its own base.
+  if (DL)
+    for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+         AI != AE; ++AI)
+      if (AI->getType()->isPointerTy())
+        ConstantOffsetPtrs[AI] = std::make_pair(
+            AI, APInt::getNullValue(DL->getPointerSizeInBits()));
+
+  analyzeBody();
+
+  S.Complete = !IsRecursiveCall && !ExposesReturnsTwice && !HasDynamicAlloca &&
+               !HasIndirectBr;
+  S.MultiBlock = !SingleBB;
+  S.ContainsNoDuplicateCall = ContainsNoDuplicateCall;
+  S.BodyCost = Cost;
+  S.AllocatedSize = AllocatedSize;
+  S.NumInstructions = NumInstructions;
+  S.NumVectorInstructions = NumVectorInstructions;
+  Summary = nullptr;
 }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
@@ -1216,7 +1391,20 @@ INITIALIZE_PASS_END(InlineCostAnalysis, "inline-cost", "Inline Cost Analysis",
 
 char InlineCostAnalysis::ID = 0;
 
-InlineCostAnalysis::InlineCostAnalysis() : CallGraphSCCPass(ID) {}
+namespace {
+/// Drop the summary of a function when it is deleted, and keep it with the
+/// function when its uses are replaced.
+struct SummaryCacheConfig : ValueMapConfig<Function *> {
+  enum { FollowRAUW = false };
+};
+}
+
+struct InlineCostAnalysis::SummaryCache {
+  ValueMap<Function *, CalleeSummary, SummaryCacheConfig> Map;
+};
+
+InlineCostAnalysis::InlineCostAnalysis()
+    : CallGraphSCCPass(ID), Summaries(new SummaryCache()) {}
 
 InlineCostAnalysis::~InlineCostAnalysis() {}
 
@@ -1226,8 +1414,28 @@ void InlineCostAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
   CallGraphSCCPass::getAnalysisUsage(AU);
 }
 
+bool InlineCostAnalysis::doInitialization(CallGraph &CG) {
+  Summaries->Map.clear();
+  return false;
+}
+
 bool InlineCostAnalysis::runOnSCC(CallGraphSCC &SCC) {
   TTI = &getAnalysis<TargetTransformInfo>();
+
+  // The functions of the SCC are about to change. Callees outside of it were
+  // visited before, and no longer change.
+  CurrentSCC.clear();
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    if (Function *F = (*I)->getFunction()) {
+      CurrentSCC.insert(F);
+      Summaries->Map.erase(F);
+    }
+  return false;
+}
+
+bool InlineCostAnalysis::doFinalization(CallGraph &CG) {
+  Summaries->Map.clear();
+  CurrentSCC.clear();
   return false;
 }
 
@@ -1284,8 +1492,19 @@ InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
   DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
         << "...\n");
 
+  const CalleeSummary *Summary = nullptr;
+  if (!DisableSummaries && !CurrentSCC.count(Callee)) {
+    auto It = Summaries->Map.find(Callee);
+    if (It == Summaries->Map.end()) {
+      CalleeSummary S;
+      CallAnalyzer(Callee->getDataLayout(), *TTI, *Callee, 0).summarize(S);
+      It = Summaries->Map.insert(std::make_pair(Callee, S)).first;
+    }
+    Summary = &It->second;
+  }
+
   CallAnalyzer CA(Callee->getDataLayout(), *TTI, *Callee, Threshold);
-  bool ShouldInline = CA.analyzeCall(CS);
+  bool ShouldInline = CA.analyzeCall(CS, Summary);
 
   DEBUG(CA.dump());
 
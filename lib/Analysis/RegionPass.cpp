@@ -90,12 +90,17 @@ bool RGPassManager::runOnFunction(Function &F) {
 
       initializeAnalysisImpl(P);
 
+      bool LocalChanged = false;
       {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
-        Changed |= P->runOnRegion(CurrentRegion, *this);
+        LocalChanged = P->runOnRegion(CurrentRegion, *this);
       }
+      passFinished();
+      Changed |= LocalChanged;
+      if (LocalChanged)
+        functionModifiedBy(P, &F);
 
       if (Changed)
         dumpPassInfo(P, MODIFICATION_MSG, ON_REGION_MSG,
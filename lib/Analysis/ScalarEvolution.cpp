@@ -98,6 +98,20 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumValueExprMapHits,
+          "Number of getSCEV queries answered from the cache");
+STATISTIC(NumValueExprMapMisses,
+          "Number of getSCEV queries that created a new SCEV");
+STATISTIC(NumValuesAtScopeHits,
+          "Number of getSCEVAtScope queries answered from the cache");
+STATISTIC(NumBackedgeTakenCountHits,
+          "Number of backedge-taken count queries answered from the cache");
+STATISTIC(NumValueExprMapEvictions,
+          "Number of cached SCEVs dropped by forgetLoop and forgetValue");
+STATISTIC(NumDepthLimitFallbacks,
+          "Number of values treated as unknown due to the depth limit");
+STATISTIC(NumMemoryLimitFallbacks,
+          "Number of values treated as unknown due to the memory limit");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -106,6 +120,19 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxSCEVCreationDepth("scalar-evolution-max-expr-depth", cl::Hidden,
+                     cl::desc("Maximum recursion depth when analyzing a "
+                              "value; deeper values become SCEVUnknown"),
+                     cl::init(1024));
+
+static cl::opt<unsigned>
+MaxSCEVMemoryKB("scalar-evolution-max-memory", cl::Hidden,
+                cl::desc("Maximum memory in KB that ScalarEvolution may "
+                         "allocate for expressions before treating newly "
+                         "analyzed values as SCEVUnknown (0 = unlimited)"),
+                cl::init(0));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -2815,12 +2842,32 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
     const SCEV *S = I->second;
-    if (checkValidity(S))
+    if (checkValidity(S)) {
+      ++NumValueExprMapHits;
       return S;
-    else
-      ValueExprMap.erase(I);
+    }
+    ValueExprMap.erase(I);
+  }
+  ++NumValueExprMapMisses;
+
+  // Analyzing a value recursively analyzes its operands. On very deep
+  // expression trees, or once the expression arena has grown past the
+  // configured budget, give up and treat the value as opaque. This is always
+  // conservatively correct.
+  const SCEV *S;
+  if (CreationDepth >= MaxSCEVCreationDepth) {
+    ++NumDepthLimitFallbacks;
+    S = getUnknown(V);
+  } else if (MaxSCEVMemoryKB &&
+             (SCEVAllocator.getTotalMemory() - FunctionStartMemory) / 1024 >=
+                 MaxSCEVMemoryKB) {
+    ++NumMemoryLimitFallbacks;
+    S = getUnknown(V);
+  } else {
+    ++CreationDepth;
+    S = createSCEV(V);
+    --CreationDepth;
   }
-  const SCEV *S = createSCEV(V);
 
   // The process of creating a SCEV for V may have caused other SCEVs
   // to have been created, so it's necessary to insert the new entry
@@ -4167,8 +4214,10 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
     BackedgeTakenCounts.insert(std::make_pair(L, BackedgeTakenInfo()));
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++NumBackedgeTakenCountHits;
     return Pair.first->second;
+  }
 
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
@@ -4258,6 +4307,7 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
     if (It != ValueExprMap.end()) {
       forgetMemoizedResults(It->second);
       ValueExprMap.erase(It);
+      ++NumValueExprMapEvictions;
       if (PHINode *PN = dyn_cast<PHINode>(I))
         ConstantEvolutionLoopExitValue.erase(PN);
     }
@@ -4292,6 +4342,7 @@ void ScalarEvolution::forgetValue(Value *V) {
     if (It != ValueExprMap.end()) {
       forgetMemoizedResults(It->second);
       ValueExprMap.erase(It);
+      ++NumValueExprMapEvictions;
       if (PHINode *PN = dyn_cast<PHINode>(I))
         ConstantEvolutionLoopExitValue.erase(PN);
     }
@@ -5189,8 +5240,10 @@ const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   // Check to see if we've folded this expression at this loop before.
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values = ValuesAtScopes[V];
   for (unsigned u = 0; u < Values.size(); u++) {
-    if (Values[u].first == L)
+    if (Values[u].first == L) {
+      ++NumValuesAtScopeHits;
       return Values[u].second ? Values[u].second : V;
+    }
   }
   Values.push_back(std::make_pair(L, static_cast<const SCEV *>(nullptr)));
   // Otherwise compute it.
@@ -7378,8 +7431,9 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 //===----------------------------------------------------------------------===//
 
 ScalarEvolution::ScalarEvolution()
-  : FunctionPass(ID), ValuesAtScopes(64), LoopDispositions(64),
-    BlockDispositions(64), FirstUnknown(nullptr) {
+  : FunctionPass(ID), CreationDepth(0), ValuesAtScopes(64),
+    LoopDispositions(64), BlockDispositions(64), FunctionStartMemory(0),
+    FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
 
@@ -7390,6 +7444,7 @@ bool ScalarEvolution::runOnFunction(Function &F) {
   DL = DLP ? &DLP->getDataLayout() : nullptr;
   TLI = &getAnalysis<TargetLibraryInfo>();
   DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  FunctionStartMemory = SCEVAllocator.getTotalMemory();
   return false;
 }
 
@@ -159,6 +159,18 @@ unsigned TargetTransformInfo::getIntImmCost(Intrinsic::ID IID, unsigned Idx,
   return PrevTTI->getIntImmCost(IID, Idx, Imm, Ty);
 }
 
+unsigned TargetTransformInfo::getCacheLineSize() const {
+  return PrevTTI->getCacheLineSize();
+}
+
+unsigned TargetTransformInfo::getCacheMissLatency() const {
+  return PrevTTI->getCacheMissLatency();
+}
+
+unsigned TargetTransformInfo::getMinPrefetchStride() const {
+  return PrevTTI->getMinPrefetchStride();
+}
+
 unsigned TargetTransformInfo::getNumberOfRegisters(bool Vector) const {
   return PrevTTI->getNumberOfRegisters(Vector);
 }
@@ -171,6 +183,18 @@ unsigned TargetTransformInfo::getMaximumUnrollFactor() const {
   return PrevTTI->getMaximumUnrollFactor();
 }
 
+bool TargetTransformInfo::enableInterleavedAccessVectorization() const {
+  return PrevTTI->enableInterleavedAccessVectorization();
+}
+
+bool TargetTransformInfo::isLegalMaskedLoad(Type *DataType) const {
+  return PrevTTI->isLegalMaskedLoad(DataType);
+}
+
+bool TargetTransformInfo::isLegalMaskedStore(Type *DataType) const {
+  return PrevTTI->isLegalMaskedStore(DataType);
+}
+
 unsigned TargetTransformInfo::getArithmeticInstrCost(unsigned Opcode,
                                                 Type *Ty,
                                                 OperandValueKind Op1Info,
@@ -209,6 +233,22 @@ unsigned TargetTransformInfo::getMemoryOpCost(unsigned Opcode, Type *Src,
   ;
 }
 
+unsigned
+TargetTransformInfo::getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                           unsigned Alignment,
+                                           unsigned AddressSpace) const {
+  return PrevTTI->getMaskedMemoryOpCost(Opcode, Src, Alignment, AddressSpace);
+}
+
+unsigned
+TargetTransformInfo::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                                unsigned Factor,
+                                                unsigned Alignment,
+                                                unsigned AddressSpace) const {
+  return PrevTTI->getInterleavedMemoryOpCost(Opcode, VecTy, Factor, Alignment,
+                                             AddressSpace);
+}
+
 unsigned
 TargetTransformInfo::getIntrinsicInstrCost(Intrinsic::ID ID,
                                            Type *RetTy,
@@ -550,6 +590,18 @@ struct NoTTI final : ImmutablePass, TargetTransformInfo {
     return TCC_Free;
   }
 
+  unsigned getCacheLineSize() const override {
+    return 0;
+  }
+
+  unsigned getCacheMissLatency() const override {
+    return 0;
+  }
+
+  unsigned getMinPrefetchStride() const override {
+    return 1;
+  }
+
   unsigned getNumberOfRegisters(bool Vector) const override {
     return 8;
   }
@@ -562,6 +614,18 @@ struct NoTTI final : ImmutablePass, TargetTransformInfo {
     return 1;
   }
 
+  bool enableInterleavedAccessVectorization() const override {
+    return false;
+  }
+
+  bool isLegalMaskedLoad(Type *DataType) const override {
+    return false;
+  }
+
+  bool isLegalMaskedStore(Type *DataType) const override {
+    return false;
+  }
+
   unsigned getArithmeticInstrCost(unsigned Opcode, Type *Ty, OperandValueKind,
                                   OperandValueKind) const override {
     return 1;
@@ -596,6 +660,18 @@ struct NoTTI final : ImmutablePass, TargetTransformInfo {
     return 1;
   }
 
+  unsigned getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                 unsigned Alignment,
+                                 unsigned AddressSpace) const override {
+    return 1;
+  }
+
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor, unsigned Alignment,
+                                      unsigned AddressSpace) const override {
+    return 1;
+  }
+
   unsigned getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
                                  ArrayRef<Type*> Tys) const override {
     return 1;
@@ -582,6 +582,7 @@ lltok::Kind LLLexer::LexIdentifier() {
   KEYWORD(byval);
   KEYWORD(inalloca);
   KEYWORD(cold);
+  KEYWORD(hot);
   KEYWORD(inlinehint);
   KEYWORD(inreg);
   KEYWORD(minsize);
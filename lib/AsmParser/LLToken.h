@@ -105,6 +105,7 @@ namespace lltok {
     kw_byval,
     kw_inalloca,
     kw_cold,
+    kw_hot,
     kw_inlinehint,
     kw_inreg,
     kw_minsize,
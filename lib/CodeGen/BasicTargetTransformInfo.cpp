@@ -104,6 +104,9 @@ public:
                               unsigned Index) const override;
   unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
                            unsigned AddressSpace) const override;
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor, unsigned Alignment,
+                                      unsigned AddressSpace) const override;
   unsigned getIntrinsicInstrCost(Intrinsic::ID, Type *RetTy,
                                  ArrayRef<Type*> Tys) const override;
   unsigned getNumberOfParts(Type *Tp) const override;
@@ -445,6 +448,34 @@ unsigned BasicTTI::getMemoryOpCost(unsigned Opcode, Type *Src,
   return Cost;
 }
 
+unsigned BasicTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const {
+  VectorType *VT = cast<VectorType>(VecTy);
+  unsigned NumElts = VT->getNumElements();
+  assert(Factor > 1 && NumElts % Factor == 0 && "Invalid interleave factor");
+  unsigned NumSubElts = NumElts / Factor;
+  Type *SubVecTy = VectorType::get(VT->getElementType(), NumSubElts);
+
+  // The wide load or store.
+  unsigned Cost = getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace);
+
+  // Without target specific knowledge of the shuffles involved, assume every
+  // element is moved individually: extracted from the wide vector and
+  // inserted into a member vector for loads, and the reverse for stores.
+  bool IsLoad = Opcode == Instruction::Load;
+  for (unsigned i = 0; i < NumElts; ++i) {
+    Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement,
+                                       IsLoad ? VecTy : SubVecTy,
+                                       IsLoad ? i : i / Factor);
+    Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement,
+                                       IsLoad ? SubVecTy : VecTy,
+                                       IsLoad ? i / Factor : i);
+  }
+  return Cost;
+}
+
 unsigned BasicTTI::getIntrinsicInstrCost(Intrinsic::ID IID, Type *RetTy,
                                          ArrayRef<Type *> Tys) const {
   unsigned ISD = 0;
@@ -29,6 +29,7 @@
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/IR/ValueMap.h"
@@ -63,6 +64,7 @@ STATISTIC(NumRetsDup,    "Number of return instructions duplicated");
 STATISTIC(NumDbgValueMoved, "Number of debug value instructions moved");
 STATISTIC(NumSelectsExpanded, "Number of selects turned into branches");
 STATISTIC(NumAndCmpsMoved, "Number of and/cmp's pushed into branches");
+STATISTIC(NumMaskedScalarized, "Number of masked loads and stores scalarized");
 
 static cl::opt<bool> DisableBranchOpts(
   "disable-cgp-branch-opts", cl::Hidden, cl::init(false),
@@ -72,6 +74,11 @@ static cl::opt<bool> DisableSelectToBranch(
   "disable-cgp-select2branch", cl::Hidden, cl::init(false),
   cl::desc("Disable select to branch conversion."));
 
+static cl::opt<unsigned> SelectBiasPercent(
+  "cgp-select-bias-percent", cl::Hidden, cl::init(98),
+  cl::desc("Turn a select into a branch when profile data says one side is "
+           "taken at least this often (percent)."));
+
 static cl::opt<bool> AddrSinkUsingGEPs(
   "addr-sink-using-gep", cl::Hidden, cl::init(false),
   cl::desc("Address sinking in CGP using GEPs."));
@@ -826,6 +833,107 @@ protected:
 };
 } // end anonymous namespace
 
+/// scalarizeMaskedLoad - Translate a masked load that the target can't select
+/// into a chain of conditional scalar loads, one per lane:
+///
+///   %mask_0 = extractelement <4 x i1> %mask, i32 0
+///   br i1 %mask_0, label %cond.load, label %else
+/// cond.load:
+///   %gep_0 = getelementptr float* %base, i32 0
+///   %elt_0 = load float* %gep_0
+///   %res_0 = insertelement <4 x float> %passthru, float %elt_0, i32 0
+///   br label %else
+/// else:
+///   %res.phi.else = phi <4 x float> [ %res_0, %cond.load ],
+///                                   [ %passthru, %entry ]
+///   ...
+static void scalarizeMaskedLoad(CallInst *CI, const DataLayout *TD) {
+  Value *Ptr = CI->getArgOperand(0);
+  unsigned Alignment = cast<ConstantInt>(CI->getArgOperand(1))->getZExtValue();
+  Value *Mask = CI->getArgOperand(2);
+  Value *VResult = CI->getArgOperand(3);
+
+  VectorType *VecTy = cast<VectorType>(CI->getType());
+  Type *EltTy = VecTy->getElementType();
+  unsigned AddrSpace = Ptr->getType()->getPointerAddressSpace();
+  unsigned EltAlign = Alignment ? MinAlign(Alignment,
+                                           TD->getTypeStoreSize(EltTy)) : 0;
+
+  IRBuilder<> Builder(CI);
+  Value *FirstEltPtr =
+      Builder.CreateBitCast(Ptr, EltTy->getPointerTo(AddrSpace));
+
+  BasicBlock *IfBlock = CI->getParent();
+  for (unsigned Idx = 0, E = VecTy->getNumElements(); Idx != E; ++Idx) {
+    Value *Predicate = Builder.CreateExtractElement(Mask,
+                                                    Builder.getInt32(Idx));
+
+    BasicBlock *CondBlock = IfBlock->splitBasicBlock(CI, "cond.load");
+    Builder.SetInsertPoint(CI);
+    Value *Gep = Builder.CreateInBoundsGEP(FirstEltPtr, Builder.getInt32(Idx));
+    LoadInst *Load = Builder.CreateLoad(Gep);
+    Load->setAlignment(EltAlign);
+    Value *NewVResult = Builder.CreateInsertElement(VResult, Load,
+                                                    Builder.getInt32(Idx));
+
+    BasicBlock *NewIfBlock = CondBlock->splitBasicBlock(CI, "else");
+    Instruction *OldBr = IfBlock->getTerminator();
+    BranchInst::Create(CondBlock, NewIfBlock, Predicate, OldBr);
+    OldBr->eraseFromParent();
+
+    Builder.SetInsertPoint(CI);
+    PHINode *Phi = Builder.CreatePHI(VecTy, 2, "res.phi.else");
+    Phi->addIncoming(NewVResult, CondBlock);
+    Phi->addIncoming(VResult, IfBlock);
+    VResult = Phi;
+    IfBlock = NewIfBlock;
+  }
+
+  CI->replaceAllUsesWith(VResult);
+  CI->eraseFromParent();
+}
+
+/// scalarizeMaskedStore - Translate a masked store that the target can't
+/// select into a chain of conditional scalar stores, one per lane.
+static void scalarizeMaskedStore(CallInst *CI, const DataLayout *TD) {
+  Value *Src = CI->getArgOperand(0);
+  Value *Ptr = CI->getArgOperand(1);
+  unsigned Alignment = cast<ConstantInt>(CI->getArgOperand(2))->getZExtValue();
+  Value *Mask = CI->getArgOperand(3);
+
+  VectorType *VecTy = cast<VectorType>(Src->getType());
+  Type *EltTy = VecTy->getElementType();
+  unsigned AddrSpace = Ptr->getType()->getPointerAddressSpace();
+  unsigned EltAlign = Alignment ? MinAlign(Alignment,
+                                           TD->getTypeStoreSize(EltTy)) : 0;
+
+  IRBuilder<> Builder(CI);
+  Value *FirstEltPtr =
+      Builder.CreateBitCast(Ptr, EltTy->getPointerTo(AddrSpace));
+
+  BasicBlock *IfBlock = CI->getParent();
+  for (unsigned Idx = 0, E = VecTy->getNumElements(); Idx != E; ++Idx) {
+    Value *Predicate = Builder.CreateExtractElement(Mask,
+                                                    Builder.getInt32(Idx));
+
+    BasicBlock *CondBlock = IfBlock->splitBasicBlock(CI, "cond.store");
+    Builder.SetInsertPoint(CI);
+    Value *OneElt = Builder.CreateExtractElement(Src, Builder.getInt32(Idx));
+    Value *Gep = Builder.CreateInBoundsGEP(FirstEltPtr, Builder.getInt32(Idx));
+    Builder.CreateStore(OneElt, Gep)->setAlignment(EltAlign);
+
+    BasicBlock *NewIfBlock = CondBlock->splitBasicBlock(CI, "else");
+    Instruction *OldBr = IfBlock->getTerminator();
+    BranchInst::Create(CondBlock, NewIfBlock, Predicate, OldBr);
+    OldBr->eraseFromParent();
+
+    Builder.SetInsertPoint(CI);
+    IfBlock = NewIfBlock;
+  }
+
+  CI->eraseFromParent();
+}
+
 bool CodeGenPrepare::OptimizeCallInst(CallInst *CI) {
   BasicBlock *BB = CI->getParent();
 
@@ -871,6 +979,27 @@ bool CodeGenPrepare::OptimizeCallInst(CallInst *CI) {
     return true;
   }
 
+  // Scalarize masked loads and stores that the target can't select.
+  if (II && TLI && TLI->getDataLayout() &&
+      (II->getIntrinsicID() == Intrinsic::masked_load ||
+       II->getIntrinsicID() == Intrinsic::masked_store)) {
+    bool IsLoad = II->getIntrinsicID() == Intrinsic::masked_load;
+    Type *DataTy = IsLoad ? CI->getType() : CI->getArgOperand(0)->getType();
+    if (!TLI->isOperationLegalOrCustom(IsLoad ? ISD::MLOAD : ISD::MSTORE,
+                                       TLI->getValueType(DataTy, true))) {
+      ++NumMaskedScalarized;
+      if (IsLoad)
+        scalarizeMaskedLoad(CI, TLI->getDataLayout());
+      else
+        scalarizeMaskedStore(CI, TLI->getDataLayout());
+      ModifiedDT = true;
+      // The rest of the block was moved into the new blocks.
+      CurInstIterator = BB->begin();
+      SunkAddrs.clear();
+      return true;
+    }
+  }
+
   if (II && TLI) {
     SmallVector<Value*, 2> PtrOps;
     Type *AccessTy;
@@ -2957,13 +3086,39 @@ bool CodeGenPrepare::OptimizeExtUses(Instruction *I) {
   return MadeChange;
 }
 
+/// isHighlyBiasedSelect - Returns true if SI carries branch weight metadata
+/// saying that one of its operands is chosen almost always.
+static bool isHighlyBiasedSelect(SelectInst *SI) {
+  MDNode *WeightsNode = SI->getMetadata(LLVMContext::MD_prof);
+  if (!WeightsNode || WeightsNode->getNumOperands() != 3)
+    return false;
+  MDString *Name = dyn_cast<MDString>(WeightsNode->getOperand(0));
+  if (!Name || Name->getString() != "branch_weights")
+    return false;
+  ConstantInt *TrueWeight = dyn_cast<ConstantInt>(WeightsNode->getOperand(1));
+  ConstantInt *FalseWeight = dyn_cast<ConstantInt>(WeightsNode->getOperand(2));
+  if (!TrueWeight || !FalseWeight)
+    return false;
+
+  uint64_t T = TrueWeight->getLimitedValue(UINT32_MAX);
+  uint64_t F = FalseWeight->getLimitedValue(UINT32_MAX);
+  uint64_t Sum = T + F;
+  if (Sum == 0)
+    return false;
+  return std::max(T, F) * 100 >= Sum * SelectBiasPercent;
+}
+
 /// isFormingBranchFromSelectProfitable - Returns true if a SelectInst should be
 /// turned into an explicit branch.
 static bool isFormingBranchFromSelectProfitable(SelectInst *SI) {
+  // A branch that is almost always predicted right costs next to nothing,
+  // while a cmov puts the condition and both operands on the critical path.
+  if (isHighlyBiasedSelect(SI))
+    return true;
+
   // FIXME: This should use the same heuristics as IfConversion to determine
-  // whether a select is better represented as a branch.  This requires that
-  // branch probability metadata is preserved for the select, which is not the
-  // case currently.
+  // whether a select is better represented as a branch when there is no
+  // profile data for it.
 
   CmpInst *Cmp = dyn_cast<CmpInst>(SI->getCondition());
 
@@ -3028,8 +3183,12 @@ bool CodeGenPrepare::OptimizeSelectInst(SelectInst *SI) {
   StartBlock->getTerminator()->eraseFromParent();
   BranchInst::Create(NextBlock, SmallBlock);
 
-  // Insert the real conditional branch based on the original condition.
-  BranchInst::Create(NextBlock, SmallBlock, SI->getCondition(), SI);
+  // Insert the real conditional branch based on the original condition. The
+  // select's branch weights, if any, describe it exactly.
+  BranchInst *Br = BranchInst::Create(NextBlock, SmallBlock, SI->getCondition(),
+                                      SI);
+  if (MDNode *Weights = SI->getMetadata(LLVMContext::MD_prof))
+    Br->setMetadata(LLVMContext::MD_prof, Weights);
 
   // The select itself is replaced with a PHI Node.
   PHINode *PN = PHINode::Create(SI->getType(), 2, "", NextBlock->begin());
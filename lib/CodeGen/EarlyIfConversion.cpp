@@ -30,6 +30,9 @@
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/MachineTraceMetrics.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -51,6 +54,13 @@ BlockInstrLimit("early-ifcvt-limit", cl::init(30), cl::Hidden,
 static cl::opt<bool> Stress("stress-early-ifcvt", cl::Hidden,
   cl::desc("Turn all knobs to 11"));
 
+// Branches whose less likely side is profiled below this rate are left alone.
+static cl::opt<unsigned>
+BiasedPercent("early-ifcvt-biased-percent", cl::init(2), cl::Hidden,
+  cl::desc("Don't if-convert branches taken less than this often (percent) "
+           "according to profile data."));
+
+STATISTIC(NumBiasedSkipped, "Number of profiled branches kept as branches");
 STATISTIC(NumDiamondsSeen,  "Number of diamonds");
 STATISTIC(NumDiamondsConv,  "Number of diamonds converted");
 STATISTIC(NumTrianglesSeen, "Number of triangles");
@@ -584,6 +594,7 @@ class EarlyIfConverter : public MachineFunctionPass {
   MachineRegisterInfo *MRI;
   MachineDominatorTree *DomTree;
   MachineLoopInfo *Loops;
+  MachineBranchProbabilityInfo *MBPI;
   MachineTraceMetrics *Traces;
   MachineTraceMetrics::Ensemble *MinInstr;
   SSAIfConv IfConv;
@@ -600,6 +611,7 @@ private:
   void updateDomTree(ArrayRef<MachineBasicBlock*> Removed);
   void updateLoops(ArrayRef<MachineBasicBlock*> Removed);
   void invalidateTraces();
+  bool getProfiledMispredictRate(BranchProbability &Rate);
   bool shouldConvertIf();
 };
 } // end anonymous namespace
@@ -670,6 +682,42 @@ static unsigned adjCycles(unsigned Cyc, int Delta) {
   return Cyc + Delta;
 }
 
+/// Compute the probability of the less likely side of the IfConv.Head
+/// branch when it comes from profile data. A predictor that learns the bias
+/// mispredicts about that often. Return false when there is no profile data.
+bool EarlyIfConverter::getProfiledMispredictRate(BranchProbability &Rate) {
+  // Heuristic edge weights describe the program, not its inputs, so they say
+  // nothing about predictability.
+  const BasicBlock *BB = IfConv.Head->getBasicBlock();
+  if (!BB || !BB->getTerminator()->getMetadata(LLVMContext::MD_prof))
+    return false;
+
+  // The weights describe the IR branch, which is only the branch that ends
+  // Head if Head is the whole IR block and leads straight to the IR
+  // successors.  An IR branch lowered into several machine blocks, such as
+  // br (and a, b), doesn't qualify: take the default rate instead.
+  const TerminatorInst *TI = BB->getTerminator();
+  if (TI->getNumSuccessors() != 2 || IfConv.Head->succ_size() != 2)
+    return false;
+  for (MachineBasicBlock::const_pred_iterator I = IfConv.Head->pred_begin(),
+       E = IfConv.Head->pred_end(); I != E; ++I)
+    if (*I != IfConv.Head && (*I)->getBasicBlock() == BB)
+      return false;
+  const BasicBlock *SuccBB0 = (*IfConv.Head->succ_begin())->getBasicBlock();
+  const BasicBlock *SuccBB1 = (*std::next(IfConv.Head->succ_begin()))
+                                  ->getBasicBlock();
+  if (!SuccBB0 || !SuccBB1 || SuccBB0 == SuccBB1 ||
+      !((SuccBB0 == TI->getSuccessor(0) && SuccBB1 == TI->getSuccessor(1)) ||
+        (SuccBB0 == TI->getSuccessor(1) && SuccBB1 == TI->getSuccessor(0))))
+    return false;
+
+  const MachineBasicBlock *Succ = *IfConv.Head->succ_begin();
+  BranchProbability P = MBPI->getEdgeProbability(IfConv.Head, Succ);
+  uint32_t N = P.getNumerator(), D = P.getDenominator();
+  Rate = BranchProbability(std::min(N, D - N), D);
+  return true;
+}
+
 /// Apply cost model and heuristics to the if-conversion in IfConv.
 /// Return true if the conversion is a good idea.
 ///
@@ -678,6 +726,17 @@ bool EarlyIfConverter::shouldConvertIf() {
   if (Stress)
     return true;
 
+  // A well predicted branch lets the CPU start on the likely side before the
+  // condition is known. Selects have to wait for the condition and both sides.
+  BranchProbability Mispredict(1, 2);
+  bool Profiled = getProfiledMispredictRate(Mispredict);
+  if (Profiled &&
+      Mispredict < BranchProbability(BiasedPercent, 100)) {
+    DEBUG(dbgs() << "Branch is biased, mispredicted " << Mispredict << '\n');
+    ++NumBiasedSkipped;
+    return false;
+  }
+
   if (!MinInstr)
     MinInstr = Traces->getEnsemble(MachineTraceMetrics::TS_MinInstrCount);
 
@@ -687,8 +746,11 @@ bool EarlyIfConverter::shouldConvertIf() {
   unsigned MinCrit = std::min(TBBTrace.getCriticalPath(),
                               FBBTrace.getCriticalPath());
 
-  // Set a somewhat arbitrary limit on the critical path extension we accept.
+  // Accept a critical path extension up to the expected misprediction cost.
+  // Without profile data, assume the branch goes either way half the time.
   unsigned CritLimit = SchedModel->MispredictPenalty/2;
+  if (Profiled)
+    CritLimit = Mispredict.scale(SchedModel->MispredictPenalty);
 
   // If-conversion only makes sense when there is unexploited ILP. Compute the
   // maximum-ILP resource length of the trace after if-conversion. Compare it
@@ -783,6 +845,7 @@ bool EarlyIfConverter::runOnMachineFunction(MachineFunction &MF) {
   MRI = &MF.getRegInfo();
   DomTree = &getAnalysis<MachineDominatorTree>();
   Loops = getAnalysisIfAvailable<MachineLoopInfo>();
+  MBPI = &getAnalysis<MachineBranchProbabilityInfo>();
   Traces = &getAnalysis<MachineTraceMetrics>();
   MinInstr = nullptr;
 
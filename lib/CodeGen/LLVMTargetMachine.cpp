@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/CodeGen/MachineFunctionAnalysis.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
@@ -36,6 +37,10 @@
 #include "llvm/Transforms/Scalar.h"
 using namespace llvm;
 
+namespace llvm {
+extern cl::opt<bool> EnableIPRA;
+}
+
 // Enable or disable FastISel. Both options are needed, because
 // FastISel is enabled by default with -fast, and we wish to be
 // able to enable or disable fast-isel independently from -O0.
@@ -61,6 +66,11 @@ static bool getVerboseAsm() {
   llvm_unreachable("Invalid verbose asm state");
 }
 
+void LLVMTargetMachine::printOutputOptions(raw_ostream &OS) const {
+  OS << EnableFastISelOption << getVerboseAsm() << ShowMCEncoding
+     << ShowMCInst;
+}
+
 void LLVMTargetMachine::initAsmInfo() {
   MCAsmInfo *TmpAsmInfo = TheTarget.createMCAsmInfo(*getRegisterInfo(),
                                                     TargetTriple);
@@ -112,6 +122,11 @@ static MCContext *addPassesToGenerateCode(LLVMTargetMachine *TM,
 
   PM.add(PassConfig);
 
+  // Compile the functions bottom-up over the call graph so that the register
+  // usage of callees is known when their callers are allocated.
+  if (EnableIPRA)
+    PM.add(new DummyCGSCCPass);
+
   PassConfig->addIRPasses();
 
   PassConfig->addCodeGenPrepare();
@@ -214,6 +214,24 @@ void LiveRange::RenumberValues() {
   }
 }
 
+/// shrinkToFit - Reallocate V to exactly its size if it has outgrown its inline
+/// storage and more than a fifth of it is unused.
+template <typename VectorT>
+static void shrinkToFit(VectorT &V) {
+  if (V.capacity() - V.size() <= V.size() / 4)
+    return;
+  VectorT Tmp(V.begin(), V.end());
+  // Vectors still in their inline storage cannot shrink.
+  if (Tmp.capacity() >= V.capacity())
+    return;
+  V.swap(Tmp);
+}
+
+void LiveRange::compact() {
+  shrinkToFit(segments);
+  shrinkToFit(valnos);
+}
+
 /// This method is used when we want to extend the segment specified by I to end
 /// at the specified endpoint.  To do this, we should merge and eliminate all
 /// segments that this will overlap with.  The iterator is not invalidated.
@@ -186,6 +186,7 @@ void LiveIntervals::computeVirtRegInterval(LiveInterval &LI) {
   LRCalc->reset(MF, getSlotIndexes(), DomTree, &getVNInfoAllocator());
   LRCalc->createDeadDefs(LI);
   LRCalc->extendToUses(LI);
+  LI.compact();
 }
 
 void LiveIntervals::computeVirtRegs() {
@@ -260,6 +261,7 @@ void LiveIntervals::computeRegUnitRange(LiveRange &LR, unsigned Unit) {
         LRCalc->extendToUses(LR, Reg);
     }
   }
+  LR.compact();
 }
 
 
@@ -441,6 +443,7 @@ bool LiveIntervals::shrinkToUses(LiveInterval *li,
 
   // Move the trimmed segments back.
   li->segments.swap(NewLR.segments);
+  li->compact();
   DEBUG(dbgs() << "Shrunk: " << *li << '\n');
   return CanSeparate;
 }
@@ -23,6 +23,13 @@
 // first time it reaches a chain of basic blocks, it schedules them in the
 // function in-order.
 //
+// Alternatively, the blocks of a function can be laid out to maximize its
+// extended TSP score over the whole function: the frequency of fall-throughs,
+// plus a fraction of the frequency of short forward and backward jumps that
+// decreases with their length. The layout starts from single block chains and
+// greedily applies the chain merge that increases the score the most, in the
+// spirit of "Improved Basic Block Reordering" by Newell and Pupyrev.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/Passes.h"
@@ -37,12 +44,15 @@
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetLowering.h"
 #include <algorithm>
+#include <map>
 using namespace llvm;
 
 #define DEBUG_TYPE "block-placement2"
@@ -53,6 +63,7 @@ STATISTIC(CondBranchTakenFreq,
           "Potential frequency of taking conditional branches");
 STATISTIC(UncondBranchTakenFreq,
           "Potential frequency of taking unconditional branches");
+STATISTIC(NumExtTSPLayouts, "Number of functions laid out by ext-TSP");
 
 static cl::opt<unsigned> AlignAllBlock("align-all-blocks",
                                        cl::desc("Force the alignment of all "
@@ -66,6 +77,33 @@ ExitBlockBias("block-placement-exit-block-bias",
                        "over the original exit to be considered the new exit."),
               cl::init(0), cl::Hidden);
 
+namespace {
+enum ExtTSPMode { ExtTSPNever, ExtTSPProfile, ExtTSPAlways };
+}
+
+static cl::opt<ExtTSPMode>
+ExtTSPPlacement("ext-tsp-block-placement",
+                cl::desc("Lay out blocks by maximizing the ext-TSP score"),
+                cl::init(ExtTSPNever), cl::Hidden,
+                cl::values(clEnumValN(ExtTSPNever, "never",
+                                      "Only when a function asks for it"),
+                           clEnumValN(ExtTSPProfile, "profile",
+                                      "For functions with profile data"),
+                           clEnumValN(ExtTSPAlways, "always",
+                                      "For all functions"),
+                           clEnumValEnd));
+
+static cl::opt<unsigned>
+ExtTSPMaxBlocks("ext-tsp-max-blocks",
+                cl::desc("Largest function, in blocks, laid out by ext-TSP"),
+                cl::init(1024), cl::Hidden);
+
+static cl::opt<unsigned>
+ExtTSPSplitThreshold("ext-tsp-split-threshold",
+                     cl::desc("Largest chain, in blocks, that ext-TSP splits "
+                              "to insert another chain in the middle"),
+                     cl::init(64), cl::Hidden);
+
 namespace {
 class BlockChain;
 /// \brief Type for our function-wide basic block -> block chain mapping.
@@ -230,6 +268,8 @@ class MachineBlockPlacement : public MachineFunctionPass {
   void buildLoopChains(MachineFunction &F, MachineLoop &L);
   void rotateLoop(BlockChain &LoopChain, MachineBasicBlock *ExitingBB,
                   const BlockFilterSet &LoopBlockSet);
+  bool shouldUseExtTSP(const MachineFunction &F);
+  void buildExtTSPChain(MachineFunction &F);
   void buildCFGChains(MachineFunction &F);
 
 public:
@@ -872,6 +912,388 @@ void MachineBlockPlacement::buildLoopChains(MachineFunction &F,
   });
 }
 
+namespace {
+/// \brief Computes a block order that maximizes the extended TSP score.
+///
+/// The nodes of the layout are sequences of blocks that must stay together,
+/// such as blocks whose fallthrough cannot be analyzed. Node 0 holds the entry
+/// block and always comes first. The score of an order sums, over the CFG
+/// edges, the edge frequency times a weight that is 1 for a fallthrough and
+/// decreases linearly with the distance for short forward and backward jumps.
+class ExtTSPLayout {
+public:
+  struct Edge {
+    unsigned Dst;
+    uint64_t Freq;
+  };
+
+private:
+  // Weights and maximal distances of the ext-TSP score, in bytes.
+  static const double FallthroughWeight;
+  static const double ForwardWeight;
+  static const double BackwardWeight;
+  static const uint64_t ForwardDistance = 1024;
+  static const uint64_t BackwardDistance = 640;
+
+  typedef SmallVector<unsigned, 8> NodeSeq;
+
+  /// \brief A sequence of nodes laid out together.
+  struct Chain {
+    NodeSeq Nodes;
+    double Score;
+  };
+
+  /// \brief The best way found to merge two chains.
+  struct MergeCandidate {
+    double Gain;
+    NodeSeq Nodes;
+  };
+
+  ArrayRef<SmallVector<unsigned, 4> > NodeBlocks;
+  ArrayRef<uint64_t> BlockSize;
+  ArrayRef<uint64_t> BlockFreq;
+  ArrayRef<SmallVector<Edge, 2> > Succs;
+
+  /// \brief Nodes connected to each node by an edge in either direction.
+  std::vector<SmallVector<unsigned, 4> > Adjacent;
+  std::vector<unsigned> ChainOfNode;
+  std::vector<Chain> Chains;
+
+  /// \brief Candidate merges keyed by the ids of the two chains, lowest first.
+  std::map<std::pair<unsigned, unsigned>, MergeCandidate> Candidates;
+
+  // Scratch space for score().
+  std::vector<uint64_t> Offset;
+  std::vector<unsigned> Stamp;
+  unsigned CurStamp;
+
+  static double edgeScore(uint64_t SrcEnd, uint64_t DstStart, uint64_t Freq);
+  double score(ArrayRef<unsigned> Nodes);
+  void tryMerge(ArrayRef<unsigned> Nodes, double BaseScore,
+                MergeCandidate &Best);
+  void tryMerges(const NodeSeq &X, const NodeSeq &Y, double BaseScore,
+                 MergeCandidate &Best);
+  void updateCandidates(unsigned C);
+
+public:
+  ExtTSPLayout(ArrayRef<SmallVector<unsigned, 4> > NodeBlocks,
+               ArrayRef<uint64_t> BlockSize, ArrayRef<uint64_t> BlockFreq,
+               ArrayRef<SmallVector<Edge, 2> > Succs)
+    : NodeBlocks(NodeBlocks), BlockSize(BlockSize), BlockFreq(BlockFreq),
+      Succs(Succs), CurStamp(0) {}
+
+  /// \brief Compute the order of the nodes.
+  void run(SmallVectorImpl<unsigned> &Order);
+};
+}
+
+const double ExtTSPLayout::FallthroughWeight = 1.0;
+const double ExtTSPLayout::ForwardWeight = 0.1;
+const double ExtTSPLayout::BackwardWeight = 0.1;
+
+double ExtTSPLayout::edgeScore(uint64_t SrcEnd, uint64_t DstStart,
+                               uint64_t Freq) {
+  if (SrcEnd == DstStart)
+    return Freq * FallthroughWeight;
+  if (SrcEnd < DstStart) {
+    uint64_t Dist = DstStart - SrcEnd;
+    if (Dist <= ForwardDistance)
+      return Freq * ForwardWeight * (1.0 - double(Dist) / ForwardDistance);
+    return 0;
+  }
+  uint64_t Dist = SrcEnd - DstStart;
+  if (Dist <= BackwardDistance)
+    return Freq * BackwardWeight * (1.0 - double(Dist) / BackwardDistance);
+  return 0;
+}
+
+/// \brief Return the score of the edges between the blocks of Nodes when they
+/// are laid out in that order.
+double ExtTSPLayout::score(ArrayRef<unsigned> Nodes) {
+  ++CurStamp;
+  uint64_t Off = 0;
+  for (unsigned i = 0, e = Nodes.size(); i != e; ++i) {
+    ArrayRef<unsigned> Blocks = NodeBlocks[Nodes[i]];
+    for (unsigned j = 0, je = Blocks.size(); j != je; ++j) {
+      Stamp[Blocks[j]] = CurStamp;
+      Offset[Blocks[j]] = Off;
+      Off += BlockSize[Blocks[j]];
+    }
+  }
+
+  double Score = 0;
+  for (unsigned i = 0, e = Nodes.size(); i != e; ++i) {
+    ArrayRef<unsigned> Blocks = NodeBlocks[Nodes[i]];
+    for (unsigned j = 0, je = Blocks.size(); j != je; ++j) {
+      unsigned Src = Blocks[j];
+      for (unsigned k = 0, ke = Succs[Src].size(); k != ke; ++k) {
+        const Edge &E = Succs[Src][k];
+        if (Stamp[E.Dst] == CurStamp)
+          Score += edgeScore(Offset[Src] + BlockSize[Src], Offset[E.Dst],
+                             E.Freq);
+      }
+    }
+  }
+  return Score;
+}
+
+/// \brief Record Nodes as the best merge if it scores higher than the best one
+/// so far. The entry node must stay first.
+void ExtTSPLayout::tryMerge(ArrayRef<unsigned> Nodes, double BaseScore,
+                            MergeCandidate &Best) {
+  if (Nodes[0] != 0 && std::find(Nodes.begin(), Nodes.end(), 0) != Nodes.end())
+    return;
+  double Gain = score(Nodes) - BaseScore;
+  if (Gain > Best.Gain) {
+    Best.Gain = Gain;
+    Best.Nodes.clear();
+    Best.Nodes.append(Nodes.begin(), Nodes.end());
+  }
+}
+
+/// \brief Try the ways of merging Y into X: X Y, and, when X is small enough
+/// to be split into X1 X2, X1 Y X2, Y X2 X1 and X2 Y X1.
+void ExtTSPLayout::tryMerges(const NodeSeq &X, const NodeSeq &Y,
+                             double BaseScore, MergeCandidate &Best) {
+  NodeSeq Seq(X.begin(), X.end());
+  Seq.append(Y.begin(), Y.end());
+  tryMerge(Seq, BaseScore, Best);
+
+  if (X.size() > ExtTSPSplitThreshold)
+    return;
+  for (unsigned Split = 1, e = X.size(); Split != e; ++Split) {
+    NodeSeq::const_iterator Mid = X.begin() + Split;
+    Seq.clear();
+    Seq.append(X.begin(), Mid);
+    Seq.append(Y.begin(), Y.end());
+    Seq.append(Mid, X.end());
+    tryMerge(Seq, BaseScore, Best);
+
+    Seq.clear();
+
+    Seq.append(Y.begin(), Y.end());
+    Seq.append(Mid, X.end());
+    Seq.append(X.begin(), Mid);
+    tryMerge(Seq, BaseScore, Best);
+
+    Seq.clear();
+
+    Seq.append(Mid, X.end());
+    Seq.append(Y.begin(), Y.end());
+    Seq.append(X.begin(), Mid);
+    tryMerge(Seq, BaseScore, Best);
+  }
+}
+
+/// \brief Recompute the best merge of chain C with each chain it is connected
+/// to.
+void ExtTSPLayout::updateCandidates(unsigned C) {
+  SmallVector<unsigned, 8> Neighbors;
+  const NodeSeq &Nodes = Chains[C].Nodes;
+  for (unsigned i = 0, e = Nodes.size(); i != e; ++i)
+    for (unsigned j = 0, je = Adjacent[Nodes[i]].size(); j != je; ++j) {
+      unsigned Other = ChainOfNode[Adjacent[Nodes[i]][j]];
+      if (Other != C)
+        Neighbors.push_back(Other);
+    }
+  std::sort(Neighbors.begin(), Neighbors.end());
+  Neighbors.erase(std::unique(Neighbors.begin(), Neighbors.end()),
+                  Neighbors.end());
+
+  for (unsigned i = 0, e = Neighbors.size(); i != e; ++i) {
+    unsigned Other = Neighbors[i];
+    double BaseScore = Chains[C].Score + Chains[Other].Score;
+    MergeCandidate Best;
+    Best.Gain = 0;
+    tryMerges(Chains[C].Nodes, Chains[Other].Nodes, BaseScore, Best);
+    tryMerges(Chains[Other].Nodes, Chains[C].Nodes, BaseScore, Best);
+    std::pair<unsigned, unsigned> Key(std::min(C, Other), std::max(C, Other));
+    if (Best.Nodes.empty())
+      Candidates.erase(Key);
+    else
+      Candidates[Key] = Best;
+  }
+}
+
+void ExtTSPLayout::run(SmallVectorImpl<unsigned> &Order) {
+  unsigned NumNodes = NodeBlocks.size();
+  unsigned NumBlocks = BlockSize.size();
+  Offset.assign(NumBlocks, 0);
+  Stamp.assign(NumBlocks, 0);
+
+  std::vector<unsigned> NodeOfBlock(NumBlocks);
+  for (unsigned N = 0; N != NumNodes; ++N)
+    for (unsigned i = 0, e = NodeBlocks[N].size(); i != e; ++i)
+      NodeOfBlock[NodeBlocks[N][i]] = N;
+  Adjacent.assign(NumNodes, SmallVector<unsigned, 4>());
+  for (unsigned B = 0; B != NumBlocks; ++B)
+    for (unsigned i = 0, e = Succs[B].size(); i != e; ++i) {
+      unsigned Src = NodeOfBlock[B], Dst = NodeOfBlock[Succs[B][i].Dst];
+      if (Src == Dst)
+        continue;
+      Adjacent[Src].push_back(Dst);
+      Adjacent[Dst].push_back(Src);
+    }
+
+  // Start with one chain per node.
+  Chains.resize(NumNodes);
+  ChainOfNode.resize(NumNodes);
+  for (unsigned N = 0; N != NumNodes; ++N) {
+    Chains[N].Nodes.push_back(N);
+    Chains[N].Score = score(Chains[N].Nodes);
+    ChainOfNode[N] = N;
+  }
+  for (unsigned N = 0; N != NumNodes; ++N)
+    updateCandidates(N);
+
+  // Greedily apply the merge with the highest gain.
+  while (!Candidates.empty()) {
+    typedef std::map<std::pair<unsigned, unsigned>, MergeCandidate>::iterator
+      CandIter;
+    CandIter Best = Candidates.begin();
+    for (CandIter I = std::next(Best), E = Candidates.end(); I != E; ++I)
+      if (I->second.Gain > Best->second.Gain)
+        Best = I;
+    // Ignore gains that are only rounding noise.
+    if (Best->second.Gain <= 1e-9 * (Chains[Best->first.first].Score +
+                                     Chains[Best->first.second].Score))
+      break;
+
+    unsigned Into = Best->first.first, From = Best->first.second;
+    Chains[Into].Nodes = Best->second.Nodes;
+    Chains[Into].Score += Chains[From].Score + Best->second.Gain;
+    for (unsigned i = 0, e = Chains[From].Nodes.size(); i != e; ++i)
+      ChainOfNode[Chains[From].Nodes[i]] = Into;
+    Chains[From].Nodes.clear();
+
+    for (CandIter I = Candidates.begin(), E = Candidates.end(); I != E;) {
+      CandIter Cur = I++;
+      if (Cur->first.first == Into || Cur->first.first == From ||
+          Cur->first.second == Into || Cur->first.second == From)
+        Candidates.erase(Cur);
+    }
+    updateCandidates(Into);
+  }
+
+  // Put the entry chain first and the other chains by decreasing execution
+  // density, so that hot code stays together.
+  SmallVector<std::pair<double, unsigned>, 16> Rest;
+  for (unsigned C = 0; C != NumNodes; ++C) {
+    if (Chains[C].Nodes.empty() || ChainOfNode[0] == C)
+      continue;
+    double Freq = 0, Size = 0;
+    for (unsigned i = 0, e = Chains[C].Nodes.size(); i != e; ++i) {
+      ArrayRef<unsigned> Blocks = NodeBlocks[Chains[C].Nodes[i]];
+      for (unsigned j = 0, je = Blocks.size(); j != je; ++j) {
+        Freq += BlockFreq[Blocks[j]] * double(BlockSize[Blocks[j]]);
+        Size += BlockSize[Blocks[j]];
+      }
+    }
+    Rest.push_back(std::make_pair(-Freq / Size, C));
+  }
+  std::stable_sort(Rest.begin(), Rest.end());
+
+  const NodeSeq &EntryChain = Chains[ChainOfNode[0]].Nodes;
+  Order.clear();
+  Order.append(EntryChain.begin(), EntryChain.end());
+  for (unsigned i = 0, e = Rest.size(); i != e; ++i)
+    Order.append(Chains[Rest[i].second].Nodes.begin(),
+                 Chains[Rest[i].second].Nodes.end());
+}
+
+/// \brief Return true if F should be laid out with the ext-TSP algorithm.
+///
+/// A "block-placement"="ext-tsp" function attribute selects it for a single
+/// function; otherwise the -ext-tsp-block-placement option decides, either for
+/// every function or only for those with branch weight metadata.
+bool MachineBlockPlacement::shouldUseExtTSP(const MachineFunction &F) {
+  if (F.size() > ExtTSPMaxBlocks)
+    return false;
+  const Function *Fn = F.getFunction();
+  if (Fn->hasFnAttribute("block-placement"))
+    return Fn->getFnAttribute("block-placement").getValueAsString() ==
+           "ext-tsp";
+
+  switch (ExtTSPPlacement) {
+  case ExtTSPNever:
+    return false;
+  case ExtTSPAlways:
+    return true;
+  case ExtTSPProfile:
+    for (Function::const_iterator BB = Fn->begin(), E = Fn->end(); BB != E;
+         ++BB)
+      if (BB->getTerminator()->getMetadata(LLVMContext::MD_prof))
+        return true;
+    return false;
+  }
+  llvm_unreachable("Unknown ext-TSP mode");
+}
+
+/// \brief Estimate the size of a block in bytes.
+///
+/// Instruction sizes are not known before emission, so count the instructions
+/// at a rough average size; jump distances only need to be approximate.
+static uint64_t estimateBlockSize(const MachineBasicBlock &MBB) {
+  uint64_t NumInstrs = 0;
+  for (MachineBasicBlock::const_iterator I = MBB.begin(), E = MBB.end();
+       I != E; ++I)
+    if (!I->isDebugValue())
+      ++NumInstrs;
+  return std::max<uint64_t>(NumInstrs, 1) * 4;
+}
+
+/// \brief Merge the chains of F into a single chain ordered by ext-TSP.
+///
+/// The chains built so far only hold blocks that must stay together; each of
+/// them is a node of the layout and begins with its first block in function
+/// order, so the entry block's chain is node 0.
+void MachineBlockPlacement::buildExtTSPChain(MachineFunction &F) {
+  SmallVector<BlockChain *, 16> NodeChains;
+  SmallVector<SmallVector<unsigned, 4>, 16> NodeBlocks;
+  DenseMap<const MachineBasicBlock *, unsigned> BlockIndex;
+  SmallVector<MachineBasicBlock *, 16> Blocks;
+  for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE; ++FI) {
+    BlockChain *Chain = BlockToChain[FI];
+    if (*Chain->begin() != FI)
+      continue;
+    NodeChains.push_back(Chain);
+    NodeBlocks.push_back(SmallVector<unsigned, 4>());
+    for (BlockChain::iterator BI = Chain->begin(), BE = Chain->end(); BI != BE;
+         ++BI) {
+      BlockIndex[*BI] = Blocks.size();
+      NodeBlocks.back().push_back(Blocks.size());
+      Blocks.push_back(*BI);
+    }
+  }
+
+  SmallVector<uint64_t, 16> BlockSize, BlockFreq;
+  SmallVector<SmallVector<ExtTSPLayout::Edge, 2>, 16> Succs(Blocks.size());
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    MachineBasicBlock *BB = Blocks[i];
+    BlockFrequency Freq = MBFI->getBlockFreq(BB);
+    BlockSize.push_back(estimateBlockSize(*BB));
+    BlockFreq.push_back(Freq.getFrequency());
+    for (MachineBasicBlock::succ_iterator SI = BB->succ_begin(),
+         SE = BB->succ_end(); SI != SE; ++SI) {
+      ExtTSPLayout::Edge E;
+      E.Dst = BlockIndex[*SI];
+      E.Freq = (Freq * MBPI->getEdgeProbability(BB, *SI)).getFrequency();
+      Succs[i].push_back(E);
+    }
+  }
+
+  SmallVector<unsigned, 16> Order;
+  ExtTSPLayout(NodeBlocks, BlockSize, BlockFreq, Succs).run(Order);
+  assert(Order[0] == 0 && "The entry block must come first");
+
+  BlockChain &FunctionChain = *NodeChains[0];
+  for (unsigned i = 1, e = Order.size(); i != e; ++i) {
+    BlockChain *Chain = NodeChains[Order[i]];
+    FunctionChain.merge(*Chain->begin(), Chain);
+  }
+  ++NumExtTSPLayouts;
+}
+
 void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
   // Ensure that every BB in the function has an associated chain to simplify
   // the assumptions of the remaining algorithm.
@@ -902,39 +1324,45 @@ void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
     }
   }
 
-  // Build any loop-based chains.
-  for (MachineLoopInfo::iterator LI = MLI->begin(), LE = MLI->end(); LI != LE;
-       ++LI)
-    buildLoopChains(F, **LI);
-
-  SmallVector<MachineBasicBlock *, 16> BlockWorkList;
-
-  SmallPtrSet<BlockChain *, 4> UpdatedPreds;
-  for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE; ++FI) {
-    MachineBasicBlock *BB = &*FI;
-    BlockChain &Chain = *BlockToChain[BB];
-    if (!UpdatedPreds.insert(&Chain))
-      continue;
+  if (shouldUseExtTSP(F)) {
+    buildExtTSPChain(F);
+  } else {
+    // Build any loop-based chains.
+    for (MachineLoopInfo::iterator LI = MLI->begin(), LE = MLI->end();
+         LI != LE; ++LI)
+      buildLoopChains(F, **LI);
+
+    SmallVector<MachineBasicBlock *, 16> BlockWorkList;
+
+    SmallPtrSet<BlockChain *, 4> UpdatedPreds;
+    for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE;
+         ++FI) {
+      MachineBasicBlock *BB = &*FI;
+      BlockChain &Chain = *BlockToChain[BB];
+      if (!UpdatedPreds.insert(&Chain))
+        continue;
 
-    assert(Chain.LoopPredecessors == 0);
-    for (BlockChain::iterator BCI = Chain.begin(), BCE = Chain.end();
-         BCI != BCE; ++BCI) {
-      assert(BlockToChain[*BCI] == &Chain);
-      for (MachineBasicBlock::pred_iterator PI = (*BCI)->pred_begin(),
-                                            PE = (*BCI)->pred_end();
-           PI != PE; ++PI) {
-        if (BlockToChain[*PI] == &Chain)
-          continue;
-        ++Chain.LoopPredecessors;
+      assert(Chain.LoopPredecessors == 0);
+      for (BlockChain::iterator BCI = Chain.begin(), BCE = Chain.end();
+           BCI != BCE; ++BCI) {
+        assert(BlockToChain[*BCI] == &Chain);
+        for (MachineBasicBlock::pred_iterator PI = (*BCI)->pred_begin(),
+                                              PE = (*BCI)->pred_end();
+             PI != PE; ++PI) {
+          if (BlockToChain[*PI] == &Chain)
+            continue;
+          ++Chain.LoopPredecessors;
+        }
       }
+
+      if (Chain.LoopPredecessors == 0)
+        BlockWorkList.push_back(*Chain.begin());
     }
 
-    if (Chain.LoopPredecessors == 0)
-      BlockWorkList.push_back(*Chain.begin());
+    buildChain(&F.front(), *BlockToChain[&F.front()], BlockWorkList);
   }
 
   BlockChain &FunctionChain = *BlockToChain[&F.front()];
-  buildChain(&F.front(), FunctionChain, BlockWorkList);
 
 #ifndef NDEBUG
   typedef SmallPtrSet<MachineBasicBlock *, 16> FunctionBlockSetType;
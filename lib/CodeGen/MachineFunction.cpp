@@ -599,8 +599,10 @@ MachineFrameInfo::getPristineRegs(const MachineBasicBlock *MBB) const {
   for (const MCPhysReg *CSR = TRI->getCalleeSavedRegs(MF); CSR && *CSR; ++CSR)
     BV.set(*CSR);
 
-  // The entry MBB always has all CSRs pristine.
-  if (MBB == &MF->front())
+  // The entry MBB always has all CSRs pristine. When the spills were shrink-
+  // wrapped, the CSRs are only saved on the paths through the save point, so
+  // conservatively treat them as pristine everywhere.
+  if (MBB == &MF->front() || SavePoint)
     return BV;
 
   // On other MBBs the saved CSRs are not pristine.
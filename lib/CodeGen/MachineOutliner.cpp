@@ -0,0 +1,711 @@
+//===-- MachineOutliner.cpp - Outline repeated instruction sequences ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass replaces repeated sequences of machine instructions with calls to
+// outlined functions, to reduce code size and the instruction cache footprint.
+// It runs after register allocation and frame lowering, right before emission.
+//
+// Each instruction the target allows to be outlined is mapped to an integer,
+// identical instructions to the same one, and the instructions of the function
+// are turned into a string of those integers. Any other instruction, and the
+// end of each block, gets a unique integer, so that no repeat spans it. A
+// suffix tree built over the string finds the substrings that repeat, and the
+// ones that save the most instructions are outlined greedily.
+//
+// Machine functions only live while their function goes through code
+// generation, so the suffix tree covers a single function. Outlined functions
+// are shared across the module though: later functions replace the sequences
+// that match an already outlined body with calls to it. The IR function of an
+// outlined function is created when its body is first outlined, and gets its
+// body from this pass when its own turn for code generation comes, after the
+// rest of the module.
+//
+// When a function has profile data, instructions in blocks executed more often
+// than the function entry are never outlined.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "machine-outliner"
+
+STATISTIC(NumOutlinedFunctions, "Number of functions outlined");
+STATISTIC(NumOutlinedCalls, "Number of sequences replaced by calls");
+STATISTIC(NumReusedCalls,
+          "Number of sequences replaced by calls to earlier outlined bodies");
+
+static cl::opt<unsigned>
+OutlinerMinBenefit("outliner-min-benefit", cl::Hidden, cl::init(1),
+                   cl::desc("Minimum number of instructions outlining a "
+                            "sequence must save"));
+
+namespace {
+/// \brief A suffix tree over a string of integers, built with Ukkonen's
+/// algorithm.
+///
+/// The string must end with an integer that appears nowhere else, so that
+/// every suffix ends at a leaf.
+class SuffixTree {
+public:
+  struct Node {
+    /// \brief The children of the node, by the first integer of their edge.
+    DenseMap<unsigned, Node *> Children;
+
+    /// \brief The substring on the edge into the node is [StartIdx, *EndIdx].
+    unsigned StartIdx;
+    unsigned *EndIdx;
+
+    /// \brief The internal node for the same string without its first
+    /// integer.
+    Node *Link;
+
+    /// \brief Length of the string from the root to the end of the node.
+    unsigned ConcatLen;
+
+    /// \brief For leaves, the start of the suffix ending at the leaf.
+    unsigned SuffixIdx;
+
+    Node(unsigned StartIdx, unsigned *EndIdx, Node *Link)
+      : StartIdx(StartIdx), EndIdx(EndIdx), Link(Link), ConcatLen(0),
+        SuffixIdx(EmptyIdx) {}
+
+    bool isRoot() const { return StartIdx == EmptyIdx; }
+    bool isLeaf() const { return SuffixIdx != EmptyIdx; }
+    unsigned edgeLength() const {
+      return isRoot() ? 0 : *EndIdx - StartIdx + 1;
+    }
+  };
+
+  static const unsigned EmptyIdx = ~0U;
+
+private:
+  ArrayRef<unsigned> Str;
+  SpecificBumpPtrAllocator<Node> NodeAllocator;
+  BumpPtrAllocator EndIdxAllocator;
+  Node *Root;
+
+  /// \brief The end of every leaf edge, which grows with the string.
+  unsigned LeafEndIdx;
+
+  // The active point of Ukkonen's algorithm.
+  Node *ActiveNode;
+  unsigned ActiveIdx;
+  unsigned ActiveLen;
+
+  Node *insertLeaf(Node &Parent, unsigned StartIdx, unsigned Edge) {
+    Node *N = new (NodeAllocator.Allocate()) Node(StartIdx, &LeafEndIdx,
+                                                  nullptr);
+    Parent.Children[Edge] = N;
+    return N;
+  }
+
+  Node *insertInternalNode(Node *Parent, unsigned StartIdx, unsigned EndIdx,
+                           unsigned Edge) {
+    unsigned *E = new (EndIdxAllocator.Allocate<unsigned>()) unsigned(EndIdx);
+    Node *N = new (NodeAllocator.Allocate()) Node(StartIdx, E, Root);
+    if (Parent)
+      Parent->Children[Edge] = N;
+    return N;
+  }
+
+  unsigned extend(unsigned EndIdx, unsigned SuffixesToAdd);
+  void setSuffixIndices();
+
+public:
+  explicit SuffixTree(ArrayRef<unsigned> Str);
+
+  Node *getRoot() const { return Root; }
+
+  /// \brief Return the node below which all the occurrences of Seq end, or
+  /// null if Seq does not occur.
+  Node *find(ArrayRef<unsigned> Seq) const;
+
+  /// \brief Append the starts of the suffixes below N to Starts.
+  static void collectLeaves(Node *N, SmallVectorImpl<unsigned> &Starts);
+};
+}
+
+SuffixTree::SuffixTree(ArrayRef<unsigned> Str) : Str(Str), Root(nullptr) {
+  Root = insertInternalNode(nullptr, EmptyIdx, EmptyIdx, 0);
+  Root->Link = nullptr;
+  ActiveNode = Root;
+  ActiveIdx = 0;
+  ActiveLen = 0;
+
+  unsigned SuffixesToAdd = 0;
+  for (unsigned EndIdx = 0, E = Str.size(); EndIdx != E; ++EndIdx) {
+    ++SuffixesToAdd;
+    LeafEndIdx = EndIdx;
+    SuffixesToAdd = extend(EndIdx, SuffixesToAdd);
+  }
+  assert(SuffixesToAdd == 0 && "String does not end with a unique integer");
+  setSuffixIndices();
+}
+
+/// \brief Add the suffixes still missing after Str[EndIdx] was appended, and
+/// return the number of suffixes left implicit in the tree.
+unsigned SuffixTree::extend(unsigned EndIdx, unsigned SuffixesToAdd) {
+  Node *NeedsLink = nullptr;
+
+  while (SuffixesToAdd > 0) {
+    if (ActiveLen == 0)
+      ActiveIdx = EndIdx;
+    unsigned FirstChar = Str[ActiveIdx];
+
+    DenseMap<unsigned, Node *>::iterator I =
+      ActiveNode->Children.find(FirstChar);
+    if (I == ActiveNode->Children.end()) {
+      insertLeaf(*ActiveNode, EndIdx, FirstChar);
+      if (NeedsLink) {
+        NeedsLink->Link = ActiveNode;
+        NeedsLink = nullptr;
+      }
+    } else {
+      Node *NextNode = I->second;
+      unsigned EdgeLen = NextNode->edgeLength();
+
+      // Walk down to the node the active point is below.
+      if (ActiveLen >= EdgeLen) {
+        ActiveIdx += EdgeLen;
+        ActiveLen -= EdgeLen;
+        ActiveNode = NextNode;
+        continue;
+      }
+
+      // The suffix is already in the tree; it stays implicit until a later
+      // integer sets it apart.
+      unsigned LastChar = Str[EndIdx];
+      if (Str[NextNode->StartIdx + ActiveLen] == LastChar) {
+        if (NeedsLink && !ActiveNode->isRoot()) {
+          NeedsLink->Link = ActiveNode;
+          NeedsLink = nullptr;
+        }
+        ++ActiveLen;
+        break;
+      }
+
+      // Split the edge where the suffix diverges.
+      Node *SplitNode =
+        insertInternalNode(ActiveNode, NextNode->StartIdx,
+                           NextNode->StartIdx + ActiveLen - 1, FirstChar);
+      insertLeaf(*SplitNode, EndIdx, LastChar);
+      NextNode->StartIdx += ActiveLen;
+      SplitNode->Children[Str[NextNode->StartIdx]] = NextNode;
+
+      if (NeedsLink)
+        NeedsLink->Link = SplitNode;
+      NeedsLink = SplitNode;
+    }
+
+    --SuffixesToAdd;
+    if (ActiveNode->isRoot()) {
+      if (ActiveLen > 0) {
+        --ActiveLen;
+        ActiveIdx = EndIdx - SuffixesToAdd + 1;
+      }
+    } else {
+      ActiveNode = ActiveNode->Link;
+    }
+  }
+
+  return SuffixesToAdd;
+}
+
+void SuffixTree::setSuffixIndices() {
+  SmallVector<Node *, 32> Worklist;
+  Worklist.push_back(Root);
+  while (!Worklist.empty()) {
+    Node *N = Worklist.pop_back_val();
+    for (DenseMap<unsigned, Node *>::iterator I = N->Children.begin(),
+         E = N->Children.end(); I != E; ++I) {
+      Node *Child = I->second;
+      Child->ConcatLen = N->ConcatLen + Child->edgeLength();
+      if (Child->Children.empty())
+        Child->SuffixIdx = Str.size() - Child->ConcatLen;
+      else
+        Worklist.push_back(Child);
+    }
+  }
+}
+
+SuffixTree::Node *SuffixTree::find(ArrayRef<unsigned> Seq) const {
+  Node *N = Root;
+  unsigned Matched = 0;
+  while (Matched != Seq.size()) {
+    Node *Child = N->Children.lookup(Seq[Matched]);
+    if (!Child)
+      return nullptr;
+    unsigned Len = std::min<unsigned>(Child->edgeLength(),
+                                      Seq.size() - Matched);
+    for (unsigned i = 0; i != Len; ++i)
+      if (Str[Child->StartIdx + i] != Seq[Matched + i])
+        return nullptr;
+    Matched += Len;
+    N = Child;
+  }
+  return N;
+}
+
+void SuffixTree::collectLeaves(Node *N, SmallVectorImpl<unsigned> &Starts) {
+  SmallVector<Node *, 16> Worklist;
+  Worklist.push_back(N);
+  while (!Worklist.empty()) {
+    Node *Cur = Worklist.pop_back_val();
+    if (Cur->isLeaf()) {
+      Starts.push_back(Cur->SuffixIdx);
+      continue;
+    }
+    for (DenseMap<unsigned, Node *>::iterator I = Cur->Children.begin(),
+         E = Cur->Children.end(); I != E; ++I)
+      Worklist.push_back(I->second);
+  }
+}
+
+namespace {
+  class MachineOutliner : public MachineFunctionPass {
+    /// \brief An instruction of an outlined body, kept after the function it
+    /// came from is gone.
+    struct OutlinedInstr {
+      unsigned Opcode;
+      SmallVector<MachineOperand, 6> Operands;
+    };
+
+    /// \brief An outlined function and its body.
+    struct OutlinedFunction {
+      Function *F;
+      std::vector<unsigned> Body;
+    };
+
+    /// \brief A repeated sequence that may be outlined.
+    struct Candidate {
+      unsigned Len;
+      SmallVector<unsigned, 4> Starts;
+      /// \brief The outlined function whose body the sequence matches, or -1.
+      int Outlined;
+      int Benefit;
+    };
+
+    const TargetInstrInfo *TII;
+    const TargetRegisterInfo *TRI;
+    Module *M;
+
+    /// \brief The instructions of all the outlined bodies; the integer an
+    /// instruction maps to is its index. Instructions of the current function
+    /// that are not in there get the following integers.
+    std::vector<OutlinedInstr> Instrs;
+    DenseMap<unsigned, SmallVector<unsigned, 1> > InstrsByHash;
+
+    /// \brief The outlined functions created so far.
+    std::vector<OutlinedFunction> OutlinedFunctions;
+    DenseMap<const Function *, unsigned> OutlinedFunctionIdx;
+
+    // Mapping of the current function. Its instructions that are not in
+    // Instrs map to LocalBase and up.
+    unsigned LocalBase;
+    std::vector<const MachineInstr *> LocalInstrs;
+    DenseMap<unsigned, SmallVector<unsigned, 1> > LocalInstrsByHash;
+
+    static unsigned hashInstr(unsigned Opcode, ArrayRef<MachineOperand> Ops);
+    static bool isIdenticalInstr(const MachineInstr &MI, unsigned Opcode,
+                                 ArrayRef<MachineOperand> Ops);
+    unsigned mapInstr(const MachineInstr &MI);
+    unsigned persistInstr(unsigned Id, DenseMap<unsigned, unsigned> &Persisted);
+
+    static bool hasHigherBenefit(const Candidate &A, const Candidate &B) {
+      return A.Benefit > B.Benefit;
+    }
+    void collectCandidates(SuffixTree &ST, std::vector<Candidate> &Candidates);
+    void replaceWithCall(ArrayRef<MachineInstr *> Seq, const Function &Callee);
+    Function *createOutlinedFunction();
+    void emitOutlinedBody(MachineFunction &MF, const OutlinedFunction &OF);
+
+  public:
+    static char ID; // Pass identification
+    MachineOutliner() : MachineFunctionPass(ID) {
+      initializeMachineOutlinerPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool doInitialization(Module &Mod) override {
+      M = &Mod;
+      return false;
+    }
+
+    bool runOnMachineFunction(MachineFunction &MF) override;
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.setPreservesCFG();
+      AU.addRequired<MachineBlockFrequencyInfo>();
+      MachineFunctionPass::getAnalysisUsage(AU);
+    }
+  };
+}
+
+char MachineOutliner::ID = 0;
+char &llvm::MachineOutlinerID = MachineOutliner::ID;
+
+INITIALIZE_PASS_BEGIN(MachineOutliner, "machine-outliner",
+                      "Machine Function Outliner", false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
+INITIALIZE_PASS_END(MachineOutliner, "machine-outliner",
+                    "Machine Function Outliner", false, false)
+
+unsigned MachineOutliner::hashInstr(unsigned Opcode,
+                                    ArrayRef<MachineOperand> Ops) {
+  unsigned Hash = hash_combine(Opcode,
+                               hash_combine_range(Ops.begin(), Ops.end()));
+  // DenseMap reserves the two largest keys.
+  return std::min(Hash, ~0U - 2);
+}
+
+bool MachineOutliner::isIdenticalInstr(const MachineInstr &MI,
+                                       unsigned Opcode,
+                                       ArrayRef<MachineOperand> Ops) {
+  if ((unsigned)MI.getOpcode() != Opcode ||
+      MI.getNumOperands() != Ops.size())
+    return false;
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i)
+    if (!MI.getOperand(i).isIdenticalTo(Ops[i]))
+      return false;
+  return true;
+}
+
+static ArrayRef<MachineOperand> getOperands(const MachineInstr &MI) {
+  return ArrayRef<MachineOperand>(MI.operands_begin(), MI.getNumOperands());
+}
+
+/// mapInstr - Return the integer of an instruction that may be outlined.
+unsigned MachineOutliner::mapInstr(const MachineInstr &MI) {
+  unsigned Hash = hashInstr(MI.getOpcode(), getOperands(MI));
+
+  DenseMap<unsigned, SmallVector<unsigned, 1> >::iterator I =
+    InstrsByHash.find(Hash);
+  if (I != InstrsByHash.end())
+    for (unsigned i = 0, e = I->second.size(); i != e; ++i) {
+      const OutlinedInstr &OI = Instrs[I->second[i]];
+      if (isIdenticalInstr(MI, OI.Opcode, OI.Operands))
+        return I->second[i];
+    }
+
+  SmallVectorImpl<unsigned> &Local = LocalInstrsByHash[Hash];
+  for (unsigned i = 0, e = Local.size(); i != e; ++i) {
+    const MachineInstr *Other = LocalInstrs[Local[i] - LocalBase];
+    if (isIdenticalInstr(MI, Other->getOpcode(), getOperands(*Other)))
+      return Local[i];
+  }
+
+  unsigned Id = LocalBase + LocalInstrs.size();
+  LocalInstrs.push_back(&MI);
+  Local.push_back(Id);
+  return Id;
+}
+
+/// persistInstr - Return the index in Instrs of the instruction an integer of
+/// the current function maps to, copying it there if needed. Must only be
+/// called once the whole function has been mapped, since the copies take the
+/// indices of local integers.
+unsigned MachineOutliner::persistInstr(unsigned Id,
+                                       DenseMap<unsigned, unsigned> &Persisted) {
+  if (Id < LocalBase)
+    return Id;
+  std::pair<DenseMap<unsigned, unsigned>::iterator, bool> Ins =
+    Persisted.insert(std::make_pair(Id, 0U));
+  if (!Ins.second)
+    return Ins.first->second;
+
+  const MachineInstr *MI = LocalInstrs[Id - LocalBase];
+  OutlinedInstr OI;
+  OI.Opcode = MI->getOpcode();
+  OI.Operands.append(MI->operands_begin(), MI->operands_end());
+  Ins.first->second = Instrs.size();
+  InstrsByHash[hashInstr(OI.Opcode, OI.Operands)].push_back(Instrs.size());
+  Instrs.push_back(OI);
+  return Ins.first->second;
+}
+
+/// collectCandidates - Find the sequences that match an outlined body, and
+/// those that repeat in the function.
+void MachineOutliner::collectCandidates(SuffixTree &ST,
+                                        std::vector<Candidate> &Candidates) {
+  for (unsigned i = 0, e = OutlinedFunctions.size(); i != e; ++i) {
+    const std::vector<unsigned> &Body = OutlinedFunctions[i].Body;
+    SuffixTree::Node *N = ST.find(Body);
+    if (!N)
+      continue;
+    Candidate C;
+    C.Len = Body.size();
+    C.Outlined = i;
+    SuffixTree::collectLeaves(N, C.Starts);
+    // Each call saves the body, minus the call itself.
+    C.Benefit = C.Starts.size() * (C.Len - 1);
+    Candidates.push_back(C);
+  }
+
+  // A repeated substring ends at an internal node. Only the leaves directly
+  // below it are taken as its occurrences; the others end at deeper internal
+  // nodes, which give longer repeats.
+  SmallVector<SuffixTree::Node *, 32> Worklist;
+  Worklist.push_back(ST.getRoot());
+  while (!Worklist.empty()) {
+    SuffixTree::Node *N = Worklist.pop_back_val();
+    Candidate C;
+    C.Len = N->ConcatLen;
+    C.Outlined = -1;
+    for (DenseMap<unsigned, SuffixTree::Node *>::iterator
+         I = N->Children.begin(), E = N->Children.end(); I != E; ++I) {
+      if (I->second->isLeaf())
+        C.Starts.push_back(I->second->SuffixIdx);
+      else
+        Worklist.push_back(I->second);
+    }
+    if (N->isRoot() || C.Len < 2 || C.Starts.size() < 2)
+      continue;
+    // Each occurrence becomes a call, and the body gets a return.
+    C.Benefit = C.Starts.size() * (C.Len - 1) - (C.Len + 1);
+    if (C.Benefit >= (int)OutlinerMinBenefit)
+      Candidates.push_back(C);
+  }
+}
+
+/// replaceWithCall - Replace Seq with a call to Callee. The call uses the
+/// registers Seq reads before defining them, and defines those it defines.
+void MachineOutliner::replaceWithCall(ArrayRef<MachineInstr *> Seq,
+                                      const Function &Callee) {
+  MachineInstr *First = Seq.front();
+  MachineBasicBlock &MBB = *First->getParent();
+  MachineInstr *Call = TII->insertOutlinedCall(MBB, First, Callee,
+                                               First->getDebugLoc());
+  MachineInstrBuilder MIB(*MBB.getParent(), Call);
+
+  BitVector Defined(TRI->getNumRegs()), Used(TRI->getNumRegs());
+  for (unsigned i = 0, e = Seq.size(); i != e; ++i) {
+    const MachineInstr *MI = Seq[i];
+    for (unsigned j = 0, je = MI->getNumOperands(); j != je; ++j) {
+      const MachineOperand &MO = MI->getOperand(j);
+      if (!MO.isReg() || !MO.getReg() || !MO.readsReg() ||
+          Defined.test(MO.getReg()) || Used.test(MO.getReg()))
+        continue;
+      Used.set(MO.getReg());
+      MIB.addReg(MO.getReg(), RegState::Implicit);
+    }
+    for (unsigned j = 0, je = MI->getNumOperands(); j != je; ++j) {
+      const MachineOperand &MO = MI->getOperand(j);
+      if (!MO.isReg() || !MO.isDef() || !MO.getReg() ||
+          Defined.test(MO.getReg()))
+        continue;
+      for (MCRegAliasIterator AI(MO.getReg(), TRI, true); AI.isValid(); ++AI)
+        Defined.set(*AI);
+      MIB.addReg(MO.getReg(), RegState::Implicit | RegState::Define);
+    }
+  }
+
+  for (unsigned i = 0, e = Seq.size(); i != e; ++i)
+    Seq[i]->eraseFromParent();
+  DEBUG(dbgs() << "  Outlined into " << Callee.getName() << ": " << *Call);
+}
+
+Function *MachineOutliner::createOutlinedFunction() {
+  LLVMContext &Ctx = M->getContext();
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Ctx), false);
+  Function *F = Function::Create(FTy, GlobalValue::InternalLinkage,
+                                 "OUTLINED_FUNCTION_" +
+                                   Twine(OutlinedFunctions.size()), M);
+  F->addFnAttr(Attribute::NoUnwind);
+  F->addFnAttr(Attribute::MinSize);
+  F->addFnAttr(Attribute::OptimizeForSize);
+
+  // Code generation needs a body; the machine one replaces it.
+  BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+  ReturnInst::Create(Ctx, BB);
+  return F;
+}
+
+/// emitOutlinedBody - Replace the code generated for an outlined function with
+/// its body.
+void MachineOutliner::emitOutlinedBody(MachineFunction &MF,
+                                       const OutlinedFunction &OF) {
+  for (MachineFunction::iterator I = MF.begin(), E = MF.end(); I != E; ++I) {
+    while (!I->succ_empty())
+      I->removeSuccessor(I->succ_begin());
+    I->erase(I->begin(), I->end());
+  }
+  while (MF.size() > 1)
+    MF.erase(std::prev(MF.end()));
+  MachineBasicBlock &MBB = MF.front();
+
+  BitVector Defined(TRI->getNumRegs());
+  for (unsigned i = 0, e = OF.Body.size(); i != e; ++i) {
+    const OutlinedInstr &OI = Instrs[OF.Body[i]];
+    MachineInstr *MI =
+      MF.CreateMachineInstr(TII->get(OI.Opcode), DebugLoc(), true);
+    MBB.push_back(MI);
+    for (unsigned j = 0, je = OI.Operands.size(); j != je; ++j)
+      MI->addOperand(MF, OI.Operands[j]);
+
+    for (unsigned j = 0, je = MI->getNumOperands(); j != je; ++j) {
+      const MachineOperand &MO = MI->getOperand(j);
+      if (MO.isReg() && MO.getReg() && MO.readsReg() &&
+          !Defined.test(MO.getReg()) && !MBB.isLiveIn(MO.getReg()))
+        MBB.addLiveIn(MO.getReg());
+    }
+    for (unsigned j = 0, je = MI->getNumOperands(); j != je; ++j) {
+      const MachineOperand &MO = MI->getOperand(j);
+      if (MO.isReg() && MO.isDef() && MO.getReg())
+        for (MCRegAliasIterator AI(MO.getReg(), TRI, true); AI.isValid(); ++AI)
+          Defined.set(*AI);
+    }
+  }
+  TII->insertOutlinedReturn(MBB);
+}
+
+bool MachineOutliner::runOnMachineFunction(MachineFunction &MF) {
+  TII = MF.getTarget().getInstrInfo();
+  TRI = MF.getTarget().getRegisterInfo();
+  const Function *F = MF.getFunction();
+
+  DenseMap<const Function *, unsigned>::iterator OFI =
+    OutlinedFunctionIdx.find(F);
+  if (OFI != OutlinedFunctionIdx.end()) {
+    emitOutlinedBody(MF, OutlinedFunctions[OFI->second]);
+    return true;
+  }
+
+  if (!TII->isFunctionSafeToOutlineFrom(MF))
+    return false;
+
+  DEBUG(dbgs() << "********** MACHINE OUTLINER **********\n"
+               << "********** Function: " << MF.getName() << '\n');
+
+  // With profile data, leave the blocks executed more often than the entry
+  // alone: a call and return there would cost more than the code it saves.
+  bool HasProfile = false;
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    if (BB->getTerminator()->getMetadata(LLVMContext::MD_prof)) {
+      HasProfile = true;
+      break;
+    }
+  MachineBlockFrequencyInfo &MBFI = getAnalysis<MachineBlockFrequencyInfo>();
+  BlockFrequency EntryFreq = MBFI.getBlockFreq(&MF.front());
+
+  // Map the function to a string, ending each block with a unique integer.
+  SmallVector<unsigned, 256> Str;
+  SmallVector<MachineInstr *, 256> StrInstrs;
+  unsigned NextUniqueId = ~0U - 2;
+  LocalBase = Instrs.size();
+  LocalInstrs.clear();
+  LocalInstrsByHash.clear();
+  for (MachineFunction::iterator MBB = MF.begin(), E = MF.end(); MBB != E;
+       ++MBB) {
+    if (!HasProfile || MBFI.getBlockFreq(MBB) <= EntryFreq)
+      for (MachineBasicBlock::iterator MI = MBB->begin(), ME = MBB->end();
+           MI != ME; ++MI) {
+        Str.push_back(TII->isLegalToOutline(*MI) ? mapInstr(*MI)
+                                                 : NextUniqueId--);
+        StrInstrs.push_back(MI);
+      }
+    Str.push_back(NextUniqueId--);
+    StrInstrs.push_back(nullptr);
+  }
+
+  std::vector<Candidate> Candidates;
+  {
+    SuffixTree ST(Str);
+    collectCandidates(ST, Candidates);
+  }
+  std::stable_sort(Candidates.begin(), Candidates.end(), hasHigherBenefit);
+
+  // Greedily take the candidates saving the most, each time dropping the
+  // occurrences that overlap the sequences already taken.
+  BitVector Taken(Str.size());
+  std::vector<Candidate> Chosen;
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    Candidate &C = Candidates[i];
+    std::sort(C.Starts.begin(), C.Starts.end());
+    SmallVector<unsigned, 4> Starts;
+    for (unsigned j = 0, je = C.Starts.size(); j != je; ++j) {
+      unsigned Start = C.Starts[j];
+      if (!Starts.empty() && Start < Starts.back() + C.Len)
+        continue;
+      bool Overlaps = false;
+      for (unsigned k = Start, ke = Start + C.Len; k != ke && !Overlaps; ++k)
+        Overlaps = Taken.test(k);
+      if (!Overlaps)
+        Starts.push_back(Start);
+    }
+
+    int Benefit = Starts.size() * (C.Len - 1);
+    if (C.Outlined < 0)
+      Benefit -= C.Len + 1;
+    if (Starts.empty() || Benefit < (int)OutlinerMinBenefit)
+      continue;
+
+    for (unsigned j = 0, je = Starts.size(); j != je; ++j)
+      Taken.set(Starts[j], Starts[j] + C.Len);
+    C.Starts = Starts;
+    C.Benefit = Benefit;
+    Chosen.push_back(C);
+  }
+
+  if (Chosen.empty())
+    return false;
+
+  // Create the new outlined functions, then replace the sequences.
+  DenseMap<unsigned, unsigned> Persisted;
+  for (unsigned i = 0, e = Chosen.size(); i != e; ++i) {
+    Candidate &C = Chosen[i];
+    if (C.Outlined < 0) {
+      OutlinedFunction OF;
+      OF.F = createOutlinedFunction();
+      for (unsigned j = 0; j != C.Len; ++j)
+        OF.Body.push_back(persistInstr(Str[C.Starts[0] + j], Persisted));
+      C.Outlined = OutlinedFunctions.size();
+      OutlinedFunctionIdx[OF.F] = C.Outlined;
+      OutlinedFunctions.push_back(OF);
+      ++NumOutlinedFunctions;
+      DEBUG(dbgs() << "Outlining " << C.Len << " instructions at "
+                   << C.Starts.size() << " sites into "
+                   << OF.F->getName() << '\n');
+    } else {
+      NumReusedCalls += C.Starts.size();
+    }
+
+    const Function &Callee = *OutlinedFunctions[C.Outlined].F;
+    for (unsigned j = 0, je = C.Starts.size(); j != je; ++j) {
+      ArrayRef<MachineInstr *> Seq(&StrInstrs[C.Starts[j]], C.Len);
+      replaceWithCall(Seq, Callee);
+      ++NumOutlinedCalls;
+    }
+  }
+
+  LocalInstrs.clear();
+  LocalInstrsByHash.clear();
+  return true;
+}
@@ -33,8 +33,15 @@ using namespace llvm;
 namespace llvm {
 extern cl::opt<bool> EnableStackMapLiveness;
 extern cl::opt<bool> EnablePatchPointLiveness;
+cl::opt<bool> EnableIPRA("enable-ipra", cl::Hidden,
+    cl::desc("Enable interprocedural register allocation, compiling callees "
+             "before their callers"));
 }
 
+static cl::opt<bool> EnableMachineOutliner("enable-machine-outliner",
+    cl::Hidden,
+    cl::desc("Replace repeated instruction sequences with calls to outlined "
+             "functions"));
 static cl::opt<bool> DisablePostRA("disable-post-ra", cl::Hidden,
     cl::desc("Disable Post Regalloc"));
 static cl::opt<bool> DisableBranchFold("disable-branch-fold", cl::Hidden,
@@ -497,6 +504,11 @@ void TargetPassConfig::addMachinePasses() {
     insertPass(TID, IID);
   }
 
+  // Give calls to functions that have already been compiled the register
+  // masks recorded for them.
+  if (EnableIPRA)
+    addPass(&RegUsageInfoPropagationID);
+
   // Print the instruction selected machine code...
   printAndVerify("After Instruction Selection");
 
@@ -566,8 +578,17 @@ void TargetPassConfig::addMachinePasses() {
   if (addPreEmitPass())
     printAndVerify("After PreEmit passes");
 
+  // Outlined functions are compiled after the rest of the module, which the
+  // bottom-up order of interprocedural register allocation does not allow.
+  if (EnableMachineOutliner && !EnableIPRA)
+    addPass(&MachineOutlinerID);
+
   if (EnableStackMapLiveness || EnablePatchPointLiveness)
     addPass(&StackMapLivenessID);
+
+  // Record the registers this function clobbers for its callers.
+  if (EnableIPRA)
+    addPass(&RegUsageInfoCollectorID);
 }
 
 /// Add passes that optimize machine instructions in SSA form.
@@ -27,6 +27,7 @@
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/MachinePostDominators.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/RegisterScavenging.h"
 #include "llvm/CodeGen/StackProtector.h"
@@ -39,6 +40,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetFrameLowering.h"
 #include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include <climits>
@@ -55,10 +57,17 @@ WarnStackSize("warn-stack-size", cl::Hidden, cl::init((unsigned)-1),
               cl::desc("Warn for stack size bigger than the given"
                        " number"));
 
+static cl::opt<bool>
+EnableShrinkWrap("enable-shrink-wrap", cl::Hidden, cl::init(false),
+                 cl::desc("Place the prologue and epilogue around the blocks "
+                          "that need the stack frame, rather than in the "
+                          "entry and return blocks"));
+
 INITIALIZE_PASS_BEGIN(PEI, "prologepilog",
                 "Prologue/Epilogue Insertion", false, false)
 INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
 INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(MachinePostDominatorTree)
 INITIALIZE_PASS_DEPENDENCY(StackProtector)
 INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
 INITIALIZE_PASS_END(PEI, "prologepilog",
@@ -68,11 +77,16 @@ INITIALIZE_PASS_END(PEI, "prologepilog",
 STATISTIC(NumScavengedRegs, "Number of frame index regs scavenged");
 STATISTIC(NumBytesStackSpace,
           "Number of bytes used for stack in all functions");
+STATISTIC(NumShrinkWrapped, "Number of functions shrink-wrapped");
 
 void PEI::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesCFG();
+  AU.addRequired<MachineLoopInfo>();
   AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<MachineDominatorTree>();
   AU.addPreserved<MachineDominatorTree>();
+  AU.addRequired<MachinePostDominatorTree>();
+  AU.addPreserved<MachinePostDominatorTree>();
   AU.addRequired<StackProtector>();
   AU.addRequired<TargetPassConfig>();
   MachineFunctionPass::getAnalysisUsage(AU);
@@ -82,24 +96,144 @@ bool PEI::isReturnBlock(MachineBasicBlock* MBB) {
   return (MBB && !MBB->empty() && MBB->back().isReturn());
 }
 
-/// Compute the set of return blocks
+/// usesFrame - Return true if MBB needs the stack frame to be set up: if it
+/// has calls, refers to stack objects, or touches the callee saved registers
+/// in FrameRegs, which also holds the stack and frame pointers.
+bool PEI::usesFrame(const MachineBasicBlock &MBB, const BitVector &FrameRegs) {
+  for (MachineBasicBlock::const_iterator I = MBB.begin(), E = MBB.end();
+       I != E; ++I) {
+    // Returns implicitly use the stack pointer, but it is the epilogue that
+    // has to come before them.
+    if (I->isReturn() || I->isDebugValue())
+      continue;
+    if (I->isCall())
+      return true;
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+      const MachineOperand &MO = I->getOperand(i);
+      if (MO.isFI() || MO.isRegMask())
+        return true;
+      if (MO.isReg() && MO.getReg() && FrameRegs.test(MO.getReg()))
+        return true;
+    }
+  }
+  return false;
+}
+
+/// findShrinkWrapPoints - Find the blocks to put the prologue and epilogue in
+/// so that they only run on the paths that need the stack frame. Save is the
+/// nearest common dominator of the blocks that use the frame and Restore the
+/// nearest common post-dominator, both moved out of loops. Return false if
+/// the function cannot be shrink-wrapped, or if there is nothing to gain.
+bool PEI::findShrinkWrapPoints(MachineFunction &Fn, MachineBasicBlock *&Save,
+                               MachineBasicBlock *&Restore) {
+  const TargetMachine &TM = Fn.getTarget();
+  const TargetFrameLowering *TFI = TM.getFrameLowering();
+  const TargetRegisterInfo *TRI = TM.getRegisterInfo();
+  MachineFrameInfo *MFI = Fn.getFrameInfo();
+
+  if (!EnableShrinkWrap || !TFI->enableShrinkWrapping(Fn))
+    return false;
+
+  // The unwinder, setjmp, stack maps and the target's prologue adjustments
+  // all expect the frame to be set up on entry. Leave functions with variable
+  // sized objects or a realigned stack alone as well.
+  if (Fn.exposesReturnsTwice() || Fn.shouldSplitStack() ||
+      Fn.getFunction()->getCallingConv() == CallingConv::HiPE ||
+      MFI->hasVarSizedObjects() || MFI->hasStackMap() ||
+      MFI->hasPatchPoint() || MFI->hasInlineAsmWithSPAdjust() ||
+      MFI->isFrameAddressTaken() || MFI->isReturnAddressTaken() ||
+      TRI->needsStackRealignment(Fn))
+    return false;
+  for (MachineFunction::iterator MBB = Fn.begin(), E = Fn.end(); MBB != E;
+       ++MBB)
+    if (MBB->isLandingPad())
+      return false;
+
+  BitVector FrameRegs(TRI->getNumRegs());
+  const std::vector<CalleeSavedInfo> &CSI = MFI->getCalleeSavedInfo();
+  for (unsigned i = 0, e = CSI.size(); i != e; ++i)
+    for (MCRegAliasIterator AI(CSI[i].getReg(), TRI, true); AI.isValid(); ++AI)
+      FrameRegs.set(*AI);
+  unsigned FrameRegList[] = {
+    TRI->getFrameRegister(Fn),
+    TM.getTargetLowering()->getStackPointerRegisterToSaveRestore()
+  };
+  for (unsigned i = 0; i != array_lengthof(FrameRegList); ++i)
+    if (FrameRegList[i])
+      for (MCRegAliasIterator AI(FrameRegList[i], TRI, true); AI.isValid();
+           ++AI)
+        FrameRegs.set(*AI);
+
+  MachineDominatorTree &MDT = getAnalysis<MachineDominatorTree>();
+  MachinePostDominatorTree &MPDT = getAnalysis<MachinePostDominatorTree>();
+  MachineLoopInfo &MLI = getAnalysis<MachineLoopInfo>();
+
+  Save = Restore = nullptr;
+  for (MachineFunction::iterator I = Fn.begin(), E = Fn.end(); I != E; ++I) {
+    MachineBasicBlock *MBB = I;
+    // Unreachable blocks never need the frame.
+    if (!MDT.getNode(MBB) || !usesFrame(*MBB, FrameRegs))
+      continue;
+    // Blocks that do not reach a return have no common post-dominator with
+    // the others.
+    if (!MPDT.getNode(MBB))
+      return false;
+    Save = Save ? MDT.findNearestCommonDominator(Save, MBB) : MBB;
+    Restore = Restore ? MPDT.findNearestCommonDominator(Restore, MBB) : MBB;
+    if (!Restore)
+      return false;
+  }
+  if (!Save || Save == &Fn.front())
+    return false;
+
+  // Saving and restoring inside a loop would do it on every iteration.
+  if (MachineLoop *L = MLI.getLoopFor(Save)) {
+    while (L->getParentLoop())
+      L = L->getParentLoop();
+    Save = MDT.getNode(L->getHeader())->getIDom()->getBlock();
+  }
+  while (MLI.getLoopFor(Restore)) {
+    MachineDomTreeNode *IPDom = MPDT.getNode(Restore)->getIDom();
+    Restore = IPDom ? IPDom->getBlock() : nullptr;
+    if (!Restore)
+      return false;
+  }
+
+  // Every path through Save must reach Restore and every path to Restore
+  // must come through Save.
+  if (Save == &Fn.front() || !MDT.dominates(Save, Restore) ||
+      !MPDT.dominates(Restore, Save))
+    return false;
+
+  return TFI->canUseAsPrologue(*Save) && TFI->canUseAsEpilogue(*Restore);
+}
+
+/// calculateSets - Choose the blocks the callee saved register spills and the
+/// prologue go into, and the blocks the restores and the epilogues go into.
 void PEI::calculateSets(MachineFunction &Fn) {
-  // Sets used to compute spill, restore placement sets.
-  const std::vector<CalleeSavedInfo> &CSI =
-    Fn.getFrameInfo()->getCalleeSavedInfo();
+  MachineFrameInfo *MFI = Fn.getFrameInfo();
 
-  // If no CSRs used, we are done.
-  if (CSI.empty())
+  MachineBasicBlock *Save, *Restore;
+  if (findShrinkWrapPoints(Fn, Save, Restore)) {
+    DEBUG(dbgs() << "Shrink-wrapping " << Fn.getName() << ": save in BB#"
+                 << Save->getNumber() << ", restore in BB#"
+                 << Restore->getNumber() << '\n');
+    MFI->setSavePoint(Save);
+    MFI->setRestorePoint(Restore);
+    SaveBlock = Save;
+    RestoreBlocks.push_back(Restore);
+    ++NumShrinkWrapped;
     return;
+  }
 
   // Save refs to entry and return blocks.
-  EntryBlock = Fn.begin();
+  MFI->setSavePoint(nullptr);
+  MFI->setRestorePoint(nullptr);
+  SaveBlock = Fn.begin();
   for (MachineFunction::iterator MBB = Fn.begin(), E = Fn.end();
        MBB != E; ++MBB)
     if (isReturnBlock(MBB))
-      ReturnBlocks.push_back(MBB);
-
-  return;
+      RestoreBlocks.push_back(MBB);
 }
 
 /// StackObjSet - A set of stack object indexes
@@ -131,8 +265,9 @@ bool PEI::runOnMachineFunction(MachineFunction &Fn) {
   // for any callee saved registers that are modified.
   calculateCalleeSavedRegisters(Fn);
 
-  // Determine placement of CSR spill/restore code:
-  // place all spills in the entry block, all restores in return blocks.
+  // Determine placement of CSR spill/restore code and of the prologue and
+  // epilogues: in the entry and return blocks, unless shrink-wrapping finds
+  // a narrower region that needs the stack frame.
   calculateSets(Fn);
 
   // Add the code to save and restore the callee saved registers
@@ -177,7 +312,7 @@ bool PEI::runOnMachineFunction(MachineFunction &Fn) {
   }
 
   delete RS;
-  ReturnBlocks.clear();
+  RestoreBlocks.clear();
   return true;
 }
 
@@ -338,32 +473,28 @@ void PEI::insertCSRSpillsAndRestores(MachineFunction &Fn) {
   MachineBasicBlock::iterator I;
 
   // Spill using target interface.
-  I = EntryBlock->begin();
-  if (!TFI->spillCalleeSavedRegisters(*EntryBlock, I, CSI, TRI)) {
+  I = SaveBlock->begin();
+  if (!TFI->spillCalleeSavedRegisters(*SaveBlock, I, CSI, TRI)) {
     for (unsigned i = 0, e = CSI.size(); i != e; ++i) {
       // Add the callee-saved register as live-in.
       // It's killed at the spill.
-      EntryBlock->addLiveIn(CSI[i].getReg());
+      SaveBlock->addLiveIn(CSI[i].getReg());
 
       // Insert the spill to the stack frame.
       unsigned Reg = CSI[i].getReg();
       const TargetRegisterClass *RC = TRI->getMinimalPhysRegClass(Reg);
-      TII.storeRegToStackSlot(*EntryBlock, I, Reg, true, CSI[i].getFrameIdx(),
+      TII.storeRegToStackSlot(*SaveBlock, I, Reg, true, CSI[i].getFrameIdx(),
                               RC, TRI);
     }
   }
 
   // Restore using target interface.
-  for (unsigned ri = 0, re = ReturnBlocks.size(); ri != re; ++ri) {
-    MachineBasicBlock *MBB = ReturnBlocks[ri];
-    I = MBB->end();
-    --I;
+  for (unsigned ri = 0, re = RestoreBlocks.size(); ri != re; ++ri) {
+    MachineBasicBlock *MBB = RestoreBlocks[ri];
 
     // Skip over all terminator instructions, which are part of the return
-    // sequence.
-    MachineBasicBlock::iterator I2 = I;
-    while (I2 != MBB->begin() && (--I2)->isTerminator())
-      I = I2;
+    // sequence, or of the branch to it when shrink-wrapping.
+    I = MBB->getFirstTerminator();
 
     bool AtStart = I == MBB->begin();
     MachineBasicBlock::iterator BeforeI = I;
@@ -670,12 +801,10 @@ void PEI::insertPrologEpilogCode(MachineFunction &Fn) {
   // Add prologue to the function...
   TFI.emitPrologue(Fn);
 
-  // Add epilogue to restore the callee-save registers in each exiting block
-  for (MachineFunction::iterator I = Fn.begin(), E = Fn.end(); I != E; ++I) {
-    // If last instruction is a return instruction, add an epilogue
-    if (!I->empty() && I->back().isReturn())
-      TFI.emitEpilogue(Fn, *I);
-  }
+  // Add epilogue to restore the callee-save registers in each exiting block,
+  // or in the restore point when shrink-wrapping.
+  for (unsigned i = 0, e = RestoreBlocks.size(); i != e; ++i)
+    TFI.emitEpilogue(Fn, *RestoreBlocks[i]);
 
   // Emit additional code that is required to support segmented stacks, if
   // we've been asked for it.  This, when linked with a runtime with support
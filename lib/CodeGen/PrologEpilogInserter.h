@@ -19,6 +19,7 @@
 #ifndef LLVM_CODEGEN_PEI_H
 #define LLVM_CODEGEN_PEI_H
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SparseBitVector.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
@@ -51,9 +52,11 @@ namespace llvm {
     // stack frame indexes.
     unsigned MinCSFrameIndex, MaxCSFrameIndex;
 
-    // Entry and return blocks of the current function.
-    MachineBasicBlock* EntryBlock;
-    SmallVector<MachineBasicBlock*, 4> ReturnBlocks;
+    // Blocks that get the callee saved register spills and the prologue, and
+    // the restores and the epilogues: the entry and return blocks of the
+    // current function, unless it is shrink-wrapped.
+    MachineBasicBlock* SaveBlock;
+    SmallVector<MachineBasicBlock*, 4> RestoreBlocks;
 
     // Flag to control whether to use the register scavenger to resolve
     // frame index materialization registers. Set according to
@@ -61,6 +64,9 @@ namespace llvm {
     bool FrameIndexVirtualScavenging;
 
     void calculateSets(MachineFunction &Fn);
+    bool usesFrame(const MachineBasicBlock &MBB, const BitVector &FrameRegs);
+    bool findShrinkWrapPoints(MachineFunction &Fn, MachineBasicBlock *&Save,
+                              MachineBasicBlock *&Restore);
     void calculateCallsInformation(MachineFunction &Fn);
     void calculateCalleeSavedRegisters(MachineFunction &Fn);
     void insertCSRSpillsAndRestores(MachineFunction &Fn);
@@ -0,0 +1,397 @@
+//===-- RegAllocLinearScan.cpp - Linear Scan Register Allocator -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a global register
+// allocator for clients that care more about compile time than about the last
+// bit of code quality, such as JITs.
+//
+// Live virtual registers are allocated in order of their start points, like in
+// the classic linear scan algorithm, on top of the LiveRegMatrix interference
+// unions shared with the other RegAllocBase allocators. When no register is
+// free, the allocator either spills the cheapest interfering live ranges, or
+// splits the current live range around the blocks that use it, or spills it.
+// Evicted live ranges are spilled rather than requeued and split products are
+// never split again, so there are no eviction chains and every live range is
+// visited a bounded number of times.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "Spiller.h"
+#include "SplitKit.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervalAnalysis.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStackAnalysis.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineDominators.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include <queue>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "regalloc"
+
+STATISTIC(NumEvictSpills, "Number of interfering live ranges spilled");
+STATISTIC(NumBlockSplits, "Number of live ranges split around blocks");
+
+static RegisterRegAlloc linearScanRegAlloc("linearscan",
+                                           "linear scan register allocator",
+                                           createLinearScanRegisterAllocator);
+
+namespace {
+  /// CompStart - Order live ranges by increasing start point, and by register
+  /// number to keep the allocation deterministic. Empty live ranges, such as
+  /// those of IMPLICIT_DEF registers, have no start point and come first.
+  struct CompStart {
+    bool operator()(const std::pair<SlotIndex, unsigned> &A,
+                    const std::pair<SlotIndex, unsigned> &B) const {
+      if (A.first.isValid() != B.first.isValid())
+        return A.first.isValid();
+      if (A.first != B.first)
+        return A.first > B.first;
+      return A.second > B.second;
+    }
+  };
+}
+
+namespace {
+class RALinearScan : public MachineFunctionPass,
+                     public RegAllocBase,
+                     private LiveRangeEdit::Delegate {
+  // context
+  MachineFunction *MF;
+  LiveDebugVariables *DebugVars;
+
+  // state
+  std::unique_ptr<Spiller> SpillerInstance;
+  std::unique_ptr<SplitAnalysis> SA;
+  std::unique_ptr<SplitEditor> SE;
+  std::priority_queue<std::pair<SlotIndex, unsigned>,
+                      std::vector<std::pair<SlotIndex, unsigned> >,
+                      CompStart> Queue;
+
+  /// Split - Virtual registers created by splitting, which are not split
+  /// again. Indexed by virtual register index.
+  BitVector Split;
+
+public:
+  RALinearScan();
+
+  /// Return the pass name.
+  const char* getPassName() const override {
+    return "Linear Scan Register Allocator";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  void releaseMemory() override;
+
+  Spiller &spiller() override { return *SpillerInstance; }
+
+  void enqueue(LiveInterval *LI) override {
+    Queue.push(std::make_pair(LI->empty() ? SlotIndex() : LI->beginIndex(),
+                              LI->reg));
+  }
+
+  LiveInterval *dequeue() override {
+    if (Queue.empty())
+      return nullptr;
+    LiveInterval *LI = &LIS->getInterval(Queue.top().second);
+    Queue.pop();
+    return LI;
+  }
+
+  unsigned selectOrSplit(LiveInterval &VirtReg,
+                         SmallVectorImpl<unsigned> &NewVRegs) override;
+
+  bool runOnMachineFunction(MachineFunction &mf) override;
+
+  static char ID;
+
+private:
+  bool LRE_CanEraseVirtReg(unsigned) override;
+  void LRE_WillShrinkVirtReg(unsigned) override;
+  void LRE_DidCloneVirtReg(unsigned, unsigned) override;
+
+  bool isSplitProduct(unsigned VirtReg) const {
+    unsigned Idx = TargetRegisterInfo::virtReg2Index(VirtReg);
+    return Idx < Split.size() && Split.test(Idx);
+  }
+  void markSplitProduct(unsigned VirtReg) {
+    unsigned Idx = TargetRegisterInfo::virtReg2Index(VirtReg);
+    if (Idx >= Split.size())
+      Split.resize(MRI->getNumVirtRegs());
+    Split.set(Idx);
+  }
+
+  float getInterferenceWeight(LiveInterval &VirtReg, unsigned PhysReg);
+  void spillInterferences(LiveInterval &VirtReg, unsigned PhysReg,
+                          SmallVectorImpl<unsigned> &NewVRegs);
+  bool trySplit(LiveInterval &VirtReg, SmallVectorImpl<unsigned> &NewVRegs);
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+RALinearScan::RALinearScan(): MachineFunctionPass(ID) {
+  initializeLiveDebugVariablesPass(*PassRegistry::getPassRegistry());
+  initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
+  initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
+  initializeRegisterCoalescerPass(*PassRegistry::getPassRegistry());
+  initializeMachineSchedulerPass(*PassRegistry::getPassRegistry());
+  initializeLiveStacksPass(*PassRegistry::getPassRegistry());
+  initializeMachineDominatorTreePass(*PassRegistry::getPassRegistry());
+  initializeMachineLoopInfoPass(*PassRegistry::getPassRegistry());
+  initializeVirtRegMapPass(*PassRegistry::getPassRegistry());
+  initializeLiveRegMatrixPass(*PassRegistry::getPassRegistry());
+}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AliasAnalysis>();
+  AU.addPreserved<AliasAnalysis>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addRequired<SlotIndexes>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequired<MachineDominatorTree>();
+  AU.addPreserved<MachineDominatorTree>();
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset(nullptr);
+  Split.clear();
+}
+
+//===----------------------------------------------------------------------===//
+//                     LiveRangeEdit delegate methods
+//===----------------------------------------------------------------------===//
+
+bool RALinearScan::LRE_CanEraseVirtReg(unsigned VirtReg) {
+  if (VRM->hasPhys(VirtReg)) {
+    Matrix->unassign(LIS->getInterval(VirtReg));
+    return true;
+  }
+  // Unassigned virtreg is probably in the queue.
+  // RegAllocBase will erase it after dequeueing.
+  return false;
+}
+
+void RALinearScan::LRE_WillShrinkVirtReg(unsigned VirtReg) {
+  if (!VRM->hasPhys(VirtReg))
+    return;
+
+  // Register is assigned, put it back on the queue for reassignment.
+  LiveInterval &LI = LIS->getInterval(VirtReg);
+  Matrix->unassign(LI);
+  enqueue(&LI);
+}
+
+void RALinearScan::LRE_DidCloneVirtReg(unsigned New, unsigned Old) {
+  // Dead code elimination may split a live range into its connected
+  // components. They are no more splittable than the original.
+  if (isSplitProduct(Old))
+    markSplitProduct(New);
+}
+
+//===----------------------------------------------------------------------===//
+//                          Spilling and Splitting
+//===----------------------------------------------------------------------===//
+
+/// getInterferenceWeight - Return the largest spill weight of the live ranges
+/// assigned to PhysReg or an alias that interfere with VirtReg, or infinity
+/// if one of them cannot be spilled.
+float RALinearScan::getInterferenceWeight(LiveInterval &VirtReg,
+                                          unsigned PhysReg) {
+  float MaxWeight = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    if (Q.seenUnspillableVReg())
+      return llvm::huge_valf;
+    for (unsigned i = Q.interferingVRegs().size(); i; --i) {
+      LiveInterval *Intf = Q.interferingVRegs()[i - 1];
+      if (!Intf->isSpillable())
+        return llvm::huge_valf;
+      MaxWeight = std::max(MaxWeight, Intf->weight);
+    }
+  }
+  return MaxWeight;
+}
+
+/// spillInterferences - Spill all live ranges assigned to PhysReg or an alias
+/// that interfere with VirtReg.
+void RALinearScan::spillInterferences(LiveInterval &VirtReg, unsigned PhysReg,
+                                      SmallVectorImpl<unsigned> &NewVRegs) {
+  // Collect the interferences before mutating either the unions or the live
+  // intervals.
+  SmallVector<LiveInterval*, 8> Intfs;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    Intfs.append(Q.interferingVRegs().begin(), Q.interferingVRegs().end());
+  }
+  DEBUG(dbgs() << "spilling " << TRI->getName(PhysReg) <<
+        " interferences with " << VirtReg << "\n");
+
+  for (unsigned i = 0, e = Intfs.size(); i != e; ++i) {
+    LiveInterval &Spill = *Intfs[i];
+
+    // Skip duplicates.
+    if (!VRM->hasPhys(Spill.reg))
+      continue;
+
+    // A LiveInterval instance may not be in a union during modification!
+    Matrix->unassign(Spill);
+    LiveRangeEdit LRE(&Spill, NewVRegs, *MF, *LIS, VRM, this);
+    spiller().spill(LRE);
+    ++NumEvictSpills;
+  }
+}
+
+/// trySplit - Split a live range that crosses blocks into local live ranges
+/// around its uses in each block and a remainder that is usually spilled.
+/// Return false if nothing was split.
+bool RALinearScan::trySplit(LiveInterval &VirtReg,
+                            SmallVectorImpl<unsigned> &NewVRegs) {
+  if (isSplitProduct(VirtReg.reg) || LIS->intervalIsInOneMBB(VirtReg))
+    return false;
+
+  SA->analyze(&VirtReg);
+  bool SingleInstrs =
+    RegClassInfo.isProperSubClass(MRI->getRegClass(VirtReg.reg));
+  LiveRangeEdit LREdit(&VirtReg, NewVRegs, *MF, *LIS, VRM, this);
+  SE->reset(LREdit);
+  ArrayRef<SplitAnalysis::BlockInfo> UseBlocks = SA->getUseBlocks();
+  for (unsigned i = 0; i != UseBlocks.size(); ++i)
+    if (SA->shouldSplitSingleBlock(UseBlocks[i], SingleInstrs))
+      SE->splitSingleBlock(UseBlocks[i]);
+  if (LREdit.empty())
+    return false;
+
+  SE->finish();
+  DebugVars->splitRegister(VirtReg.reg, LREdit.regs(), *LIS);
+  for (unsigned i = 0, e = LREdit.size(); i != e; ++i)
+    markSplitProduct(LREdit.get(i));
+  DEBUG(dbgs() << "split " << VirtReg << " into " << LREdit.size()
+               << " live ranges\n");
+  ++NumBlockSplits;
+  return true;
+}
+
+// Assign the first free register in allocation order. Otherwise spill the
+// cheapest set of interferences if they are all cheaper than VirtReg, split
+// VirtReg, or spill it, in that order of preference.
+unsigned RALinearScan::selectOrSplit(LiveInterval &VirtReg,
+                                     SmallVectorImpl<unsigned> &NewVRegs) {
+  unsigned BestPhysReg = 0;
+  float BestWeight = VirtReg.weight;
+
+  AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo);
+  while (unsigned PhysReg = Order.next()) {
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+
+    case LiveRegMatrix::IK_VirtReg: {
+      float Weight = getInterferenceWeight(VirtReg, PhysReg);
+      if (Weight < BestWeight) {
+        BestWeight = Weight;
+        BestPhysReg = PhysReg;
+      }
+      continue;
+    }
+
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  if (BestPhysReg) {
+    spillInterferences(VirtReg, BestPhysReg, NewVRegs);
+    assert(!Matrix->checkInterference(VirtReg, BestPhysReg) &&
+           "Interference after spill.");
+    return BestPhysReg;
+  }
+
+  if (trySplit(VirtReg, NewVRegs))
+    return 0;
+
+  DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  if (!VirtReg.isSpillable())
+    return ~0u;
+  LiveRangeEdit LRE(&VirtReg, NewVRegs, *MF, *LIS, VRM, this);
+  spiller().spill(LRE);
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+               << "********** Function: "
+               << mf.getName() << '\n');
+
+  MF = &mf;
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+  DebugVars = &getAnalysis<LiveDebugVariables>();
+  MachineLoopInfo &Loops = getAnalysis<MachineLoopInfo>();
+  MachineBlockFrequencyInfo &MBFI = getAnalysis<MachineBlockFrequencyInfo>();
+
+  calculateSpillWeightsAndHints(*LIS, *MF, Loops, MBFI);
+
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM));
+  SA.reset(new SplitAnalysis(*VRM, *LIS, Loops));
+  SE.reset(new SplitEditor(*SA, *LIS, *VRM,
+                           getAnalysis<MachineDominatorTree>(), MBFI));
+  Split.clear();
+
+  allocatePhysRegs();
+
+  // Diagnostic output before rewriting
+  DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass* llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
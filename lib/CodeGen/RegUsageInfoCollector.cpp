@@ -0,0 +1,129 @@
+//===-- RegUsageInfoCollector.cpp - Register Usage Information Collector --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass is the last machine function pass of the code generator when
+// interprocedural register allocation is enabled. It computes the registers
+// the finished function may clobber, from the registers its instructions
+// define and the register masks of the calls it makes, and records the
+// complement as the function's register mask in PhysicalRegisterUsageInfo.
+//
+// Registers the calling convention preserves are always reported as
+// preserved, since the prologue and epilogue restore them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/RegisterUsageInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "ip-regalloc"
+
+STATISTIC(NumRegMasksCollected, "Number of register masks collected");
+
+namespace {
+  class RegUsageInfoCollector : public MachineFunctionPass {
+  public:
+    static char ID;
+    RegUsageInfoCollector() : MachineFunctionPass(ID) {
+      initializeRegUsageInfoCollectorPass(*PassRegistry::getPassRegistry());
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.addRequired<PhysicalRegisterUsageInfo>();
+      AU.setPreservesAll();
+      MachineFunctionPass::getAnalysisUsage(AU);
+    }
+
+    bool runOnMachineFunction(MachineFunction &MF) override;
+  };
+}
+
+char RegUsageInfoCollector::ID = 0;
+char &llvm::RegUsageInfoCollectorID = RegUsageInfoCollector::ID;
+
+INITIALIZE_PASS_BEGIN(RegUsageInfoCollector, "reg-usage-collector",
+                      "Register Usage Information Collector", false, true)
+INITIALIZE_PASS_DEPENDENCY(PhysicalRegisterUsageInfo)
+INITIALIZE_PASS_END(RegUsageInfoCollector, "reg-usage-collector",
+                    "Register Usage Information Collector", false, true)
+
+/// isFinalDefinition - Return true if calls to F are known to reach the code
+/// generated for it here, so that its register usage can be relied on.
+static bool isFinalDefinition(const Function &F, const TargetMachine &TM) {
+  if (F.hasLocalLinkage())
+    return true;
+  // Weak definitions may be replaced at link time, and default visibility
+  // symbols may be preempted when the code ends up in a shared library.
+  return F.hasExternalLinkage() &&
+         (TM.getRelocationModel() != Reloc::PIC_ || !F.hasDefaultVisibility());
+}
+
+bool RegUsageInfoCollector::runOnMachineFunction(MachineFunction &MF) {
+  const Function &F = *MF.getFunction();
+  const TargetMachine &TM = MF.getTarget();
+  const TargetRegisterInfo *TRI = TM.getRegisterInfo();
+
+  // The body of a naked function is inline asm that does not declare what it
+  // clobbers.
+  if (!isFinalDefinition(F, TM) ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+
+  unsigned NumRegs = TRI->getNumRegs();
+  unsigned MaskWords = (NumRegs + 31) / 32;
+  std::vector<uint32_t> Clobbered(MaskWords, 0);
+
+  for (MachineFunction::const_iterator MBB = MF.begin(), E = MF.end();
+       MBB != E; ++MBB)
+    for (MachineBasicBlock::const_instr_iterator I = MBB->instr_begin(),
+         IE = MBB->instr_end(); I != IE; ++I)
+      for (MachineInstr::const_mop_iterator MO = I->operands_begin(),
+           MOE = I->operands_end(); MO != MOE; ++MO) {
+        if (MO->isRegMask()) {
+          const uint32_t *Mask = MO->getRegMask();
+          for (unsigned i = 0; i != MaskWords; ++i)
+            Clobbered[i] |= ~Mask[i];
+          continue;
+        }
+        if (!MO->isReg() || !MO->isDef() || !MO->getReg())
+          continue;
+        for (MCRegAliasIterator AI(MO->getReg(), TRI, true); AI.isValid();
+             ++AI)
+          Clobbered[*AI / 32] |= 1u << *AI % 32;
+      }
+
+  std::vector<uint32_t> RegMask(MaskWords);
+  const uint32_t *CallPreserved = TRI->getCallPreservedMask(F.getCallingConv());
+  for (unsigned i = 0; i != MaskWords; ++i)
+    RegMask[i] = ~Clobbered[i] | (CallPreserved ? CallPreserved[i] : 0);
+  // Keep the bits past the last register clear.
+  if (NumRegs % 32)
+    RegMask.back() &= (1u << NumRegs % 32) - 1;
+
+  DEBUG({
+    dbgs() << "Registers clobbered by " << F.getName() << ':';
+    for (unsigned Reg = 1; Reg != NumRegs; ++Reg)
+      if (MachineOperand::clobbersPhysReg(RegMask.data(), Reg))
+        dbgs() << ' ' << TRI->getName(Reg);
+    dbgs() << '\n';
+  });
+
+  getAnalysis<PhysicalRegisterUsageInfo>().setRegMask(F, RegMask);
+  ++NumRegMasksCollected;
+  return false;
+}
@@ -0,0 +1,107 @@
+//===-- RegUsageInfoPropagate.cpp - Register Usage Information Propagation ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass is the first machine function pass of the code generator when
+// interprocedural register allocation is enabled. For every direct call to a
+// function that has already been compiled, it replaces the calling convention
+// register mask of the call with the mask RegUsageInfoCollector recorded for
+// the callee, so that the register allocator can keep values in the registers
+// the callee does not actually touch.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/RegisterUsageInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "ip-regalloc"
+
+STATISTIC(NumCallsUpdated, "Number of call register masks updated");
+
+namespace {
+  class RegUsageInfoPropagation : public MachineFunctionPass {
+  public:
+    static char ID;
+    RegUsageInfoPropagation() : MachineFunctionPass(ID) {
+      initializeRegUsageInfoPropagationPass(*PassRegistry::getPassRegistry());
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+      AU.addRequired<PhysicalRegisterUsageInfo>();
+      AU.setPreservesAll();
+      MachineFunctionPass::getAnalysisUsage(AU);
+    }
+
+    bool runOnMachineFunction(MachineFunction &MF) override;
+  };
+}
+
+char RegUsageInfoPropagation::ID = 0;
+char &llvm::RegUsageInfoPropagationID = RegUsageInfoPropagation::ID;
+
+INITIALIZE_PASS_BEGIN(RegUsageInfoPropagation, "reg-usage-propagation",
+                      "Register Usage Information Propagation", false, false)
+INITIALIZE_PASS_DEPENDENCY(PhysicalRegisterUsageInfo)
+INITIALIZE_PASS_END(RegUsageInfoPropagation, "reg-usage-propagation",
+                    "Register Usage Information Propagation", false, false)
+
+/// getCalledFunction - Return the function a call instruction calls directly,
+/// or null.
+static const Function *getCalledFunction(const MachineInstr &MI) {
+  for (MachineInstr::const_mop_iterator MO = MI.operands_begin(),
+       E = MI.operands_end(); MO != E; ++MO)
+    if (MO->isGlobal())
+      return dyn_cast<Function>(MO->getGlobal());
+  return nullptr;
+}
+
+bool RegUsageInfoPropagation::runOnMachineFunction(MachineFunction &MF) {
+  const PhysicalRegisterUsageInfo &PRUI =
+    getAnalysis<PhysicalRegisterUsageInfo>();
+  bool Changed = false;
+
+  for (MachineFunction::iterator MBB = MF.begin(), E = MF.end(); MBB != E;
+       ++MBB) {
+    // When the callee unwinds into a landing pad, the registers it does not
+    // touch have been overwritten by the unwinder.
+    bool HasLandingPad = false;
+    for (MachineBasicBlock::succ_iterator SI = MBB->succ_begin(),
+         SE = MBB->succ_end(); SI != SE; ++SI)
+      HasLandingPad |= (*SI)->isLandingPad();
+    if (HasLandingPad)
+      continue;
+
+    for (MachineBasicBlock::iterator MI = MBB->begin(), ME = MBB->end();
+         MI != ME; ++MI) {
+      if (!MI->isCall())
+        continue;
+      const Function *Callee = getCalledFunction(*MI);
+      const uint32_t *RegMask = Callee ? PRUI.getRegMask(*Callee) : nullptr;
+      if (!RegMask)
+        continue;
+      for (MachineInstr::mop_iterator MO = MI->operands_begin(),
+           MOE = MI->operands_end(); MO != MOE; ++MO)
+        if (MO->isRegMask()) {
+          DEBUG(dbgs() << "Using the register mask of " << Callee->getName()
+                       << " for " << *MI);
+          MO->setRegMask(RegMask);
+          ++NumCallsUpdated;
+          Changed = true;
+        }
+    }
+  }
+  return Changed;
+}
@@ -0,0 +1,39 @@
+//===- RegisterUsageInfo.cpp - Register Usage Information Storage ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass keeps the registers preserved by each compiled function for
+// interprocedural register allocation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/RegisterUsageInfo.h"
+#include "llvm/IR/Function.h"
+
+using namespace llvm;
+
+INITIALIZE_PASS(PhysicalRegisterUsageInfo, "reg-usage-info",
+                "Register Usage Information Storage", false, true)
+
+char PhysicalRegisterUsageInfo::ID = 0;
+
+void PhysicalRegisterUsageInfo::anchor() { }
+
+void PhysicalRegisterUsageInfo::setRegMask(const Function &F,
+                                           const std::vector<uint32_t> &Mask) {
+  RegMasks[&F] = Mask;
+}
+
+const uint32_t *
+PhysicalRegisterUsageInfo::getRegMask(const Function &F) const {
+  DenseMap<const Function *, std::vector<uint32_t> >::const_iterator I =
+    RegMasks.find(&F);
+  if (I == RegMasks.end())
+    return nullptr;
+  return I->second.data();
+}
@@ -50,6 +50,11 @@
 #include <cmath>
 using namespace llvm;
 
+static cl::opt<bool>
+DisableCSETable("disable-sdnode-cse-table", cl::Hidden, cl::init(false),
+                cl::desc("Keep all SDNodes in the FoldingSet CSE map, for "
+                         "comparing compile times"));
+
 /// makeVTList - Return an instance of the SDVTList struct initialized with the
 /// specified members.
 static SDVTList makeVTList(const EVT *VTs, unsigned NumVTs) {
@@ -473,6 +478,14 @@ static void AddNodeIDCustom(FoldingSetNodeID &ID, const SDNode *N) {
     ID.AddInteger(ST->getPointerInfo().getAddrSpace());
     break;
   }
+  case ISD::MLOAD:
+  case ISD::MSTORE: {
+    const MaskedLoadStoreSDNode *MN = cast<MaskedLoadStoreSDNode>(N);
+    ID.AddInteger(MN->getMemoryVT().getRawBits());
+    ID.AddInteger(MN->getRawSubclassData());
+    ID.AddInteger(MN->getPointerInfo().getAddrSpace());
+    break;
+  }
   case ISD::ATOMIC_CMP_SWAP:
   case ISD::ATOMIC_SWAP:
   case ISD::ATOMIC_LOAD_ADD:
@@ -551,6 +564,230 @@ encodeMemSDNodeFlags(int ConvType, ISD::MemIndexedMode AM, bool isVolatile,
          (isInvariant << 7);
 }
 
+//===----------------------------------------------------------------------===//
+//                              SDNodeCSETable
+//===----------------------------------------------------------------------===//
+
+/// isPlainCSEOpcode - Return true if nodes with this opcode are identified by
+/// their opcode, value types and operands alone, and so live in the
+/// SelectionDAG's PlainCSEMap rather than in its FoldingSet.
+static bool isPlainCSEOpcode(unsigned short Opcode) {
+  if (DisableCSETable)
+    return false;
+  // Machine opcodes are stored complemented.
+  if (int16_t(Opcode) < 0)
+    return true;
+  if (Opcode >= ISD::FIRST_TARGET_MEMORY_OPCODE)
+    return false;
+
+  switch (Opcode) {
+  default:
+    return true;
+  // Nodes with extra info in AddNodeIDCustom.
+  case ISD::TargetExternalSymbol:
+  case ISD::ExternalSymbol:
+  case ISD::TargetConstant:
+  case ISD::Constant:
+  case ISD::TargetConstantFP:
+  case ISD::ConstantFP:
+  case ISD::TargetGlobalAddress:
+  case ISD::GlobalAddress:
+  case ISD::TargetGlobalTLSAddress:
+  case ISD::GlobalTLSAddress:
+  case ISD::BasicBlock:
+  case ISD::Register:
+  case ISD::RegisterMask:
+  case ISD::SRCVALUE:
+  case ISD::FrameIndex:
+  case ISD::TargetFrameIndex:
+  case ISD::JumpTable:
+  case ISD::TargetJumpTable:
+  case ISD::ConstantPool:
+  case ISD::TargetConstantPool:
+  case ISD::TargetIndex:
+  case ISD::LOAD:
+  case ISD::STORE:
+  case ISD::MLOAD:
+  case ISD::MSTORE:
+  case ISD::ATOMIC_CMP_SWAP:
+  case ISD::ATOMIC_SWAP:
+  case ISD::ATOMIC_LOAD_ADD:
+  case ISD::ATOMIC_LOAD_SUB:
+  case ISD::ATOMIC_LOAD_AND:
+  case ISD::ATOMIC_LOAD_OR:
+  case ISD::ATOMIC_LOAD_XOR:
+  case ISD::ATOMIC_LOAD_NAND:
+  case ISD::ATOMIC_LOAD_MIN:
+  case ISD::ATOMIC_LOAD_MAX:
+  case ISD::ATOMIC_LOAD_UMIN:
+  case ISD::ATOMIC_LOAD_UMAX:
+  case ISD::ATOMIC_LOAD:
+  case ISD::ATOMIC_STORE:
+  case ISD::PREFETCH:
+  case ISD::LIFETIME_START:
+  case ISD::LIFETIME_END:
+  case ISD::VECTOR_SHUFFLE:
+  case ISD::TargetBlockAddress:
+  case ISD::BlockAddress:
+  // Nodes whose getters add extra info, or that carry extra state.
+  case ISD::EH_LABEL:
+  case ISD::ADDRSPACECAST:
+  case ISD::MDNODE_SDNODE:
+  case ISD::CONVERT_RNDSAT:
+  case ISD::INTRINSIC_W_CHAIN:
+  case ISD::INTRINSIC_VOID:
+    return false;
+  }
+}
+
+/// combineCSEHash - Mix Value into Hash.
+static inline unsigned combineCSEHash(unsigned Hash, uint64_t Value) {
+  uint64_t X = ((uint64_t(Hash) << 32) | Hash) ^ Value;
+  X *= 0x9ddfea08eb382d69ULL;
+  X ^= X >> 47;
+  return unsigned(X ^ (X >> 32));
+}
+
+static inline uint64_t getOperandHashValue(const SDNode *N, unsigned ResNo) {
+  // Nodes are far larger than any result number, so this is unique.
+  return uint64_t(uintptr_t(N)) + ResNo;
+}
+
+unsigned SDNodeCSETable::getHash(unsigned short Opcode, SDVTList VTs,
+                                 ArrayRef<SDValue> Ops) {
+  unsigned Hash = combineCSEHash(Opcode, uint64_t(uintptr_t(VTs.VTs)));
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i)
+    Hash = combineCSEHash(Hash, getOperandHashValue(Ops[i].getNode(),
+                                                    Ops[i].getResNo()));
+  return Hash;
+}
+
+unsigned SDNodeCSETable::getHash(const SDNode *N) {
+  unsigned Hash = combineCSEHash((unsigned short)N->getOpcode(),
+                                 uint64_t(uintptr_t(N->getVTList().VTs)));
+  for (SDNode::op_iterator I = N->op_begin(), E = N->op_end(); I != E; ++I)
+    Hash = combineCSEHash(Hash, getOperandHashValue(I->getNode(),
+                                                    I->getResNo()));
+  return Hash;
+}
+
+/// isEqual - Return true if N has exactly these fields.
+static bool isEqual(const SDNode *N, unsigned short Opcode, SDVTList VTs,
+                    ArrayRef<SDValue> Ops) {
+  if ((unsigned short)N->getOpcode() != Opcode ||
+      N->getVTList().VTs != VTs.VTs || N->getNumOperands() != Ops.size())
+    return false;
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i)
+    if (N->getOperand(i) != Ops[i])
+      return false;
+  return true;
+}
+
+/// isEqual - Return true if N and M have the same fields.
+static bool isEqual(const SDNode *N, const SDNode *M) {
+  if (N->getOpcode() != M->getOpcode() ||
+      N->getVTList().VTs != M->getVTList().VTs ||
+      N->getNumOperands() != M->getNumOperands())
+    return false;
+  for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i)
+    if (N->getOperand(i) != M->getOperand(i))
+      return false;
+  return true;
+}
+
+SDNode *SDNodeCSETable::find(unsigned short Opcode, SDVTList VTs,
+                             ArrayRef<SDValue> Ops) const {
+  if (NumEntries == 0)
+    return nullptr;
+  unsigned Hash = getHash(Opcode, VTs, Ops);
+  unsigned Mask = Buckets.size() - 1;
+  for (unsigned i = Hash & Mask; ; i = (i + 1) & Mask) {
+    const Bucket &B = Buckets[i];
+    if (!B.Node)
+      return nullptr;
+    if (B.Hash == Hash && isEqual(B.Node, Opcode, VTs, Ops))
+      return B.Node;
+  }
+}
+
+void SDNodeCSETable::grow() {
+  std::vector<Bucket> OldBuckets;
+  OldBuckets.swap(Buckets);
+  Bucket Empty = { nullptr, 0 };
+  Buckets.assign(std::max<size_t>(64, OldBuckets.size() * 2), Empty);
+
+  unsigned Mask = Buckets.size() - 1;
+  for (unsigned i = 0, e = OldBuckets.size(); i != e; ++i) {
+    if (!OldBuckets[i].Node)
+      continue;
+    unsigned j = OldBuckets[i].Hash & Mask;
+    while (Buckets[j].Node)
+      j = (j + 1) & Mask;
+    Buckets[j] = OldBuckets[i];
+  }
+}
+
+void SDNodeCSETable::insert(SDNode *N) {
+  // Keep the load factor at or below 3/4.
+  if ((NumEntries + 1) * 4 > Buckets.size() * 3)
+    grow();
+
+  unsigned Hash = getHash(N);
+  unsigned Mask = Buckets.size() - 1;
+  unsigned i = Hash & Mask;
+  while (Buckets[i].Node)
+    i = (i + 1) & Mask;
+  Buckets[i].Node = N;
+  Buckets[i].Hash = Hash;
+  ++NumEntries;
+}
+
+bool SDNodeCSETable::remove(SDNode *N) {
+  if (NumEntries == 0)
+    return false;
+  unsigned Hash = getHash(N);
+  unsigned Mask = Buckets.size() - 1;
+  unsigned Hole = Hash & Mask;
+  while (Buckets[Hole].Node != N) {
+    if (!Buckets[Hole].Node)
+      return false;
+    Hole = (Hole + 1) & Mask;
+  }
+
+  // Shift later entries of the probe sequence back into the hole, so that
+  // lookups never need tombstones. An entry can fill the hole unless its home
+  // bucket lies cyclically after the hole.
+  for (unsigned i = (Hole + 1) & Mask; Buckets[i].Node; i = (i + 1) & Mask) {
+    unsigned Home = Buckets[i].Hash & Mask;
+    if (((i - Home) & Mask) >= ((i - Hole) & Mask)) {
+      Buckets[Hole] = Buckets[i];
+      Hole = i;
+    }
+  }
+  Buckets[Hole].Node = nullptr;
+  --NumEntries;
+  return true;
+}
+
+SDNode *SDNodeCSETable::getOrInsert(SDNode *N) {
+  if (NumEntries != 0) {
+    unsigned Hash = getHash(N);
+    unsigned Mask = Buckets.size() - 1;
+    for (unsigned i = Hash & Mask; Buckets[i].Node; i = (i + 1) & Mask)
+      if (Buckets[i].Hash == Hash && isEqual(Buckets[i].Node, N))
+        return Buckets[i].Node;
+  }
+  insert(N);
+  return N;
+}
+
+void SDNodeCSETable::clear() {
+  // Keep the buckets; the next function is likely to need as many.
+  for (unsigned i = 0, e = Buckets.size(); i != e; ++i)
+    Buckets[i].Node = nullptr;
+  NumEntries = 0;
+}
+
 //===----------------------------------------------------------------------===//
 //                              SelectionDAG Class
 //===----------------------------------------------------------------------===//
@@ -646,6 +883,35 @@ void SelectionDAG::DeleteNode(SDNode *N) {
   DeleteNodeNotInCSEMaps(N);
 }
 
+/// createOperands - Give N a recycled operand list holding Vals.
+void SelectionDAG::createOperands(SDNode *N, ArrayRef<SDValue> Vals) {
+  assert(!N->OperandList && "Node already has operands");
+  if (Vals.empty())
+    return;
+
+  SDUse *Ops = OperandRecycler.allocate(
+      ArrayRecycler<SDUse>::Capacity::get(Vals.size()), OperandAllocator);
+  for (unsigned i = 0, e = Vals.size(); i != e; ++i) {
+    Ops[i].setUser(N);
+    Ops[i].setInitial(Vals[i]);
+  }
+  N->NumOperands = Vals.size();
+  N->OperandList = Ops;
+  N->OperandsNeedDelete = true;
+  checkForCycles(N);
+}
+
+/// removeOperands - Forget N's operand list, recycling it if it came from
+/// createOperands. The operands must already have been dropped.
+void SelectionDAG::removeOperands(SDNode *N) {
+  if (N->OperandsNeedDelete)
+    OperandRecycler.deallocate(
+        ArrayRecycler<SDUse>::Capacity::get(N->NumOperands), N->OperandList);
+  N->NumOperands = 0;
+  N->OperandList = nullptr;
+  N->OperandsNeedDelete = false;
+}
+
 void SelectionDAG::DeleteNodeNotInCSEMaps(SDNode *N) {
   assert(N != AllNodes.begin() && "Cannot delete the entry node!");
   assert(N->use_empty() && "Cannot delete a node that is not dead!");
@@ -657,8 +923,7 @@ void SelectionDAG::DeleteNodeNotInCSEMaps(SDNode *N) {
 }
 
 void SelectionDAG::DeallocateNode(SDNode *N) {
-  if (N->OperandsNeedDelete)
-    delete[] N->OperandList;
+  removeOperands(N);
 
   // Set the opcode to DELETED_NODE to help catch bugs when node
   // memory is reallocated.
@@ -710,7 +975,10 @@ bool SelectionDAG::RemoveNodeFromCSEMaps(SDNode *N) {
     // Remove it from the CSE Map.
     assert(N->getOpcode() != ISD::DELETED_NODE && "DELETED_NODE in CSEMap!");
     assert(N->getOpcode() != ISD::EntryToken && "EntryToken in CSEMap!");
-    Erased = CSEMap.RemoveNode(N);
+    if (isPlainCSEOpcode(N->getOpcode()))
+      Erased = PlainCSEMap.remove(N);
+    else
+      Erased = CSEMap.RemoveNode(N);
     break;
   }
 #ifndef NDEBUG
@@ -737,7 +1005,8 @@ SelectionDAG::AddModifiedNodeToCSEMaps(SDNode *N) {
   // For node types that aren't CSE'd, just act as if no identical node
   // already exists.
   if (!doNotCSE(N)) {
-    SDNode *Existing = CSEMap.GetOrInsertNode(N);
+    SDNode *Existing = isPlainCSEOpcode(N->getOpcode()) ?
+      PlainCSEMap.getOrInsert(N) : CSEMap.GetOrInsertNode(N);
     if (Existing != N) {
       // If there was already an existing matching node, use ReplaceAllUsesWith
       // to replace the dead one with the existing one.  This can cause
@@ -757,6 +1026,35 @@ SelectionDAG::AddModifiedNodeToCSEMaps(SDNode *N) {
     DUL->NodeUpdated(N);
 }
 
+/// FindNodeOrInsertPos - Look for a node that is identified by these fields
+/// alone. If there is none, set InsertPos so that InsertNode can add the node
+/// once it has been created.
+SDNode *SelectionDAG::FindNodeOrInsertPos(unsigned short Opcode, SDVTList VTs,
+                                          ArrayRef<SDValue> Ops,
+                                          void *&InsertPos) {
+  if (isPlainCSEOpcode(Opcode)) {
+    // The table needs no position; any non-null value marks the node as
+    // memoizable.
+    InsertPos = &PlainCSEMap;
+    return PlainCSEMap.find(Opcode, VTs, Ops);
+  }
+
+  FoldingSetNodeID ID;
+  AddNodeIDNode(ID, Opcode, VTs, Ops);
+  return CSEMap.FindNodeOrInsertPos(ID, InsertPos);
+}
+
+/// InsertNode - Memoize N at a position found by FindNodeOrInsertPos or
+/// FindModifiedNodeSlot, unless InsertPos is null.
+void SelectionDAG::InsertNode(SDNode *N, void *InsertPos) {
+  if (!InsertPos)
+    return;
+  if (isPlainCSEOpcode(N->getOpcode()))
+    PlainCSEMap.insert(N);
+  else
+    CSEMap.InsertNode(N, InsertPos);
+}
+
 /// FindModifiedNodeSlot - Find a slot for the specified node if its operands
 /// were replaced with those specified.  If this node is never memoized,
 /// return null, otherwise return a pointer to the slot it would take.  If a
@@ -767,6 +1065,9 @@ SDNode *SelectionDAG::FindModifiedNodeSlot(SDNode *N, SDValue Op,
     return nullptr;
 
   SDValue Ops[] = { Op };
+  if (isPlainCSEOpcode(N->getOpcode()))
+    return FindNodeOrInsertPos(N->getOpcode(), N->getVTList(), Ops, InsertPos);
+
   FoldingSetNodeID ID;
   AddNodeIDNode(ID, N->getOpcode(), N->getVTList(), Ops);
   AddNodeIDCustom(ID, N);
@@ -785,6 +1086,9 @@ SDNode *SelectionDAG::FindModifiedNodeSlot(SDNode *N,
     return nullptr;
 
   SDValue Ops[] = { Op1, Op2 };
+  if (isPlainCSEOpcode(N->getOpcode()))
+    return FindNodeOrInsertPos(N->getOpcode(), N->getVTList(), Ops, InsertPos);
+
   FoldingSetNodeID ID;
   AddNodeIDNode(ID, N->getOpcode(), N->getVTList(), Ops);
   AddNodeIDCustom(ID, N);
@@ -802,6 +1106,9 @@ SDNode *SelectionDAG::FindModifiedNodeSlot(SDNode *N, ArrayRef<SDValue> Ops,
   if (doNotCSE(N))
     return nullptr;
 
+  if (isPlainCSEOpcode(N->getOpcode()))
+    return FindNodeOrInsertPos(N->getOpcode(), N->getVTList(), Ops, InsertPos);
+
   FoldingSetNodeID ID;
   AddNodeIDNode(ID, N->getOpcode(), N->getVTList(), Ops);
   AddNodeIDCustom(ID, N);
@@ -916,6 +1223,7 @@ void SelectionDAG::init(MachineFunction &mf, const TargetLowering *tli) {
 SelectionDAG::~SelectionDAG() {
   assert(!UpdateListeners && "Dangling registered DAGUpdateListeners");
   allnodes_clear();
+  OperandRecycler.clear(OperandAllocator);
   delete DbgInfo;
 }
 
@@ -928,8 +1236,10 @@ void SelectionDAG::allnodes_clear() {
 
 void SelectionDAG::clear() {
   allnodes_clear();
+  OperandRecycler.clear(OperandAllocator);
   OperandAllocator.Reset();
   CSEMap.clear();
+  PlainCSEMap.clear();
 
   ExtendedValueTypeNodes.clear();
   ExternalSymbols.clear();
@@ -1488,7 +1798,8 @@ SDValue SelectionDAG::getConvertRndSat(EVT VT, SDLoc dl,
 
   CvtRndSatSDNode *N = new (NodeAllocator) CvtRndSatSDNode(VT, dl.getIROrder(),
                                                            dl.getDebugLoc(),
-                                                           Ops, Code);
+                                                           Code);
+  createOperands(N, Ops);
   CSEMap.InsertNode(N, IP);
   AllNodes.push_back(N);
   return SDValue(N, 0);
@@ -2519,15 +2830,13 @@ bool SelectionDAG::isEqualTo(SDValue A, SDValue B) const {
 /// getNode - Gets or creates the specified node.
 ///
 SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT) {
-  FoldingSetNodeID ID;
-  AddNodeIDNode(ID, Opcode, getVTList(VT), None);
   void *IP = nullptr;
-  if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+  if (SDNode *E = FindNodeOrInsertPos(Opcode, getVTList(VT), None, IP))
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), getVTList(VT));
-  CSEMap.InsertNode(N, IP);
+  InsertNode(N, IP);
 
   AllNodes.push_back(N);
 #ifndef NDEBUG
@@ -2790,16 +3099,14 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL,
   SDNode *N;
   SDVTList VTs = getVTList(VT);
   if (VT != MVT::Glue) { // Don't CSE flag producing nodes
-    FoldingSetNodeID ID;
     SDValue Ops[1] = { Operand };
-    AddNodeIDNode(ID, Opcode, VTs, Ops);
     void *IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTs, Ops, IP))
       return SDValue(E, 0);
 
     N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
                                         DL.getDebugLoc(), VTs, Operand);
-    CSEMap.InsertNode(N, IP);
+    InsertNode(N, IP);
   } else {
     N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
                                         DL.getDebugLoc(), VTs, Operand);
@@ -3377,15 +3684,13 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT, SDValue N1,
   SDVTList VTs = getVTList(VT);
   if (VT != MVT::Glue) {
     SDValue Ops[] = { N1, N2 };
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opcode, VTs, Ops);
     void *IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTs, Ops, IP))
       return SDValue(E, 0);
 
     N = new (NodeAllocator) BinarySDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), VTs, N1, N2);
-    CSEMap.InsertNode(N, IP);
+    InsertNode(N, IP);
   } else {
     N = new (NodeAllocator) BinarySDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), VTs, N1, N2);
@@ -3484,15 +3789,13 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT,
   SDVTList VTs = getVTList(VT);
   if (VT != MVT::Glue) {
     SDValue Ops[] = { N1, N2, N3 };
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opcode, VTs, Ops);
     void *IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTs, Ops, IP))
       return SDValue(E, 0);
 
     N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(),
                                           DL.getDebugLoc(), VTs, N1, N2, N3);
-    CSEMap.InsertNode(N, IP);
+    InsertNode(N, IP);
   } else {
     N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(),
                                           DL.getDebugLoc(), VTs, N1, N2, N3);
@@ -4445,6 +4748,8 @@ SelectionDAG::getMemIntrinsicNode(unsigned Opcode, SDLoc dl, SDVTList VTList,
           (Opcode <= INT_MAX &&
            (int)Opcode >= ISD::FIRST_TARGET_MEMORY_OPCODE)) &&
          "Opcode is not a memory-accessing opcode!");
+  assert(!isPlainCSEOpcode(Opcode) &&
+         "Memory intrinsic nodes must be CSE'd in the FoldingSet!");
 
   // Memoize the node unless it returns a flag.
   MemIntrinsicSDNode *N;
@@ -4459,13 +4764,15 @@ SelectionDAG::getMemIntrinsicNode(unsigned Opcode, SDLoc dl, SDVTList VTList,
     }
 
     N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(),
-                                               dl.getDebugLoc(), VTList, Ops,
+                                               dl.getDebugLoc(), VTList,
                                                MemVT, MMO);
+    createOperands(N, Ops);
     CSEMap.InsertNode(N, IP);
   } else {
     N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(),
-                                               dl.getDebugLoc(), VTList, Ops,
+                                               dl.getDebugLoc(), VTList,
                                                MemVT, MMO);
+    createOperands(N, Ops);
   }
   AllNodes.push_back(N);
   return SDValue(N, 0);
@@ -4790,6 +5097,69 @@ SelectionDAG::getIndexedStore(SDValue OrigStore, SDLoc dl, SDValue Base,
   return SDValue(N, 0);
 }
 
+SDValue SelectionDAG::getMaskedLoad(EVT VT, SDLoc dl, SDValue Chain,
+                                    SDValue Ptr, SDValue Mask, SDValue Src0,
+                                    MachineMemOperand *MMO) {
+  assert(Chain.getValueType() == MVT::Other &&
+        "Invalid chain type");
+  assert(VT == Src0.getValueType() && "Pass-through vector type mismatch");
+  assert(VT.getVectorNumElements() ==
+         Mask.getValueType().getVectorNumElements() &&
+         "Mask and loaded vector have different lengths");
+  SDVTList VTs = getVTList(VT, MVT::Other);
+  SDValue Ops[] = { Chain, Ptr, Mask, Src0 };
+  FoldingSetNodeID ID;
+  AddNodeIDNode(ID, ISD::MLOAD, VTs, Ops);
+  ID.AddInteger(VT.getRawBits());
+  ID.AddInteger(encodeMemSDNodeFlags(ISD::NON_EXTLOAD, ISD::UNINDEXED,
+                                     MMO->isVolatile(),
+                                     MMO->isNonTemporal(),
+                                     MMO->isInvariant()));
+  ID.AddInteger(MMO->getPointerInfo().getAddrSpace());
+  void *IP = nullptr;
+  if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP)) {
+    cast<MaskedLoadSDNode>(E)->refineAlignment(MMO);
+    return SDValue(E, 0);
+  }
+  SDNode *N = new (NodeAllocator) MaskedLoadSDNode(Ops, dl.getIROrder(),
+                                                   dl.getDebugLoc(), VTs, VT,
+                                                   MMO);
+  CSEMap.InsertNode(N, IP);
+  AllNodes.push_back(N);
+  return SDValue(N, 0);
+}
+
+SDValue SelectionDAG::getMaskedStore(SDValue Chain, SDLoc dl, SDValue Val,
+                                     SDValue Ptr, SDValue Mask,
+                                     MachineMemOperand *MMO) {
+  assert(Chain.getValueType() == MVT::Other &&
+        "Invalid chain type");
+  EVT VT = Val.getValueType();
+  assert(VT.getVectorNumElements() ==
+         Mask.getValueType().getVectorNumElements() &&
+         "Mask and stored vector have different lengths");
+  SDVTList VTs = getVTList(MVT::Other);
+  SDValue Ops[] = { Chain, Ptr, Mask, Val };
+  FoldingSetNodeID ID;
+  AddNodeIDNode(ID, ISD::MSTORE, VTs, Ops);
+  ID.AddInteger(VT.getRawBits());
+  ID.AddInteger(encodeMemSDNodeFlags(false, ISD::UNINDEXED, MMO->isVolatile(),
+                                     MMO->isNonTemporal(),
+                                     MMO->isInvariant()));
+  ID.AddInteger(MMO->getPointerInfo().getAddrSpace());
+  void *IP = nullptr;
+  if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP)) {
+    cast<MaskedStoreSDNode>(E)->refineAlignment(MMO);
+    return SDValue(E, 0);
+  }
+  SDNode *N = new (NodeAllocator) MaskedStoreSDNode(Ops, dl.getIROrder(),
+                                                    dl.getDebugLoc(), VTs, VT,
+                                                    MMO);
+  CSEMap.InsertNode(N, IP);
+  AllNodes.push_back(N);
+  return SDValue(N, 0);
+}
+
 SDValue SelectionDAG::getVAArg(EVT VT, SDLoc dl,
                                SDValue Chain, SDValue Ptr,
                                SDValue SV,
@@ -4850,19 +5220,18 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT,
   SDVTList VTs = getVTList(VT);
 
   if (VT != MVT::Glue) {
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opcode, VTs, Ops);
     void *IP = nullptr;
-
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTs, Ops, IP))
       return SDValue(E, 0);
 
     N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
-                                   VTs, Ops);
-    CSEMap.InsertNode(N, IP);
+                                   VTs);
+    createOperands(N, Ops);
+    InsertNode(N, IP);
   } else {
     N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
-                                   VTs, Ops);
+                                   VTs);
+    createOperands(N, Ops);
   }
 
   AllNodes.push_back(N);
@@ -4909,10 +5278,8 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
   SDNode *N;
   unsigned NumOps = Ops.size();
   if (VTList.VTs[VTList.NumVTs-1] != MVT::Glue) {
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opcode, VTList, Ops);
     void *IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTList, Ops, IP))
       return SDValue(E, 0);
 
     if (NumOps == 1) {
@@ -4928,9 +5295,10 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
                                             Ops[1], Ops[2]);
     } else {
       N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
-                                     VTList, Ops);
+                                     VTList);
+      createOperands(N, Ops);
     }
-    CSEMap.InsertNode(N, IP);
+    InsertNode(N, IP);
   } else {
     if (NumOps == 1) {
       N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
@@ -4945,7 +5313,8 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
                                             Ops[1], Ops[2]);
     } else {
       N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
-                                     VTList, Ops);
+                                     VTList);
+      createOperands(N, Ops);
     }
   }
   AllNodes.push_back(N);
@@ -5101,7 +5470,7 @@ SDNode *SelectionDAG::UpdateNodeOperands(SDNode *N, SDValue Op) {
   N->OperandList[0].set(Op);
 
   // If this gets put into a CSE map, add it.
-  if (InsertPos) CSEMap.InsertNode(N, InsertPos);
+  InsertNode(N, InsertPos);
   return N;
 }
 
@@ -5129,7 +5498,7 @@ SDNode *SelectionDAG::UpdateNodeOperands(SDNode *N, SDValue Op1, SDValue Op2) {
     N->OperandList[1].set(Op2);
 
   // If this gets put into a CSE map, add it.
-  if (InsertPos) CSEMap.InsertNode(N, InsertPos);
+  InsertNode(N, InsertPos);
   return N;
 }
 
@@ -5187,7 +5556,7 @@ UpdateNodeOperands(SDNode *N, ArrayRef<SDValue> Ops) {
       N->OperandList[i].set(Ops[i]);
 
   // If this gets put into a CSE map, add it.
-  if (InsertPos) CSEMap.InsertNode(N, InsertPos);
+  InsertNode(N, InsertPos);
   return N;
 }
 
@@ -5344,9 +5713,7 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
   // If an identical node already exists, use it.
   void *IP = nullptr;
   if (VTs.VTs[VTs.NumVTs-1] != MVT::Glue) {
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opc, VTs, Ops);
-    if (SDNode *ON = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *ON = FindNodeOrInsertPos(Opc, VTs, Ops, IP))
       return UpdadeSDLocOnMergedSDNode(ON, SDLoc(N));
   }
 
@@ -5375,8 +5742,7 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
     // If NumOps is larger than the # of operands we can have in a
     // MachineSDNode, reallocate the operand list.
     if (NumOps > MN->NumOperands || !MN->OperandsNeedDelete) {
-      if (MN->OperandsNeedDelete)
-        delete[] MN->OperandList;
+      removeOperands(MN);
       if (NumOps > array_lengthof(MN->LocalOperands))
         // We're creating a final node that will live unmorphed for the
         // remainder of the current SelectionDAG iteration, so we can allocate
@@ -5392,10 +5758,8 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
     // If NumOps is larger than the # of operands we currently have, reallocate
     // the operand list.
     if (NumOps > N->NumOperands) {
-      if (N->OperandsNeedDelete)
-        delete[] N->OperandList;
-      N->InitOperands(new SDUse[NumOps], Ops.data(), NumOps);
-      N->OperandsNeedDelete = true;
+      removeOperands(N);
+      createOperands(N, Ops);
     } else
       N->InitOperands(N->OperandList, Ops.data(), NumOps);
   }
@@ -5411,8 +5775,7 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
     RemoveDeadNodes(DeadNodes);
   }
 
-  if (IP)
-    CSEMap.InsertNode(N, IP);   // Memoize the new node.
+  InsertNode(N, IP);   // Memoize the new node.
   return N;
 }
 
@@ -5550,10 +5913,7 @@ SelectionDAG::getMachineNode(unsigned Opcode, SDLoc DL, SDVTList VTs,
   unsigned NumOps = OpsArray.size();
 
   if (DoCSE) {
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, ~Opcode, VTs, OpsArray);
-    IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP)) {
+    if (SDNode *E = FindNodeOrInsertPos(~Opcode, VTs, OpsArray, IP)) {
       return cast<MachineSDNode>(UpdadeSDLocOnMergedSDNode(E, DL));
     }
   }
@@ -5574,7 +5934,7 @@ SelectionDAG::getMachineNode(unsigned Opcode, SDLoc DL, SDVTList VTs,
   N->OperandsNeedDelete = false;
 
   if (DoCSE)
-    CSEMap.InsertNode(N, IP);
+    InsertNode(N, IP);
 
   AllNodes.push_back(N);
 #ifndef NDEBUG
@@ -5610,10 +5970,8 @@ SelectionDAG::getTargetInsertSubreg(int SRIdx, SDLoc DL, EVT VT,
 SDNode *SelectionDAG::getNodeIfExists(unsigned Opcode, SDVTList VTList,
                                       ArrayRef<SDValue> Ops) {
   if (VTList.VTs[VTList.NumVTs-1] != MVT::Glue) {
-    FoldingSetNodeID ID;
-    AddNodeIDNode(ID, Opcode, VTList, Ops);
     void *IP = nullptr;
-    if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
+    if (SDNode *E = FindNodeOrInsertPos(Opcode, VTList, Ops, IP))
       return E;
   }
   return nullptr;
@@ -6089,16 +6447,6 @@ MemSDNode::MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
   assert(memvt.getStoreSize() == MMO->getSize() && "Size mismatch!");
 }
 
-MemSDNode::MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
-                     ArrayRef<SDValue> Ops, EVT memvt, MachineMemOperand *mmo)
-   : SDNode(Opc, Order, dl, VTs, Ops),
-     MemoryVT(memvt), MMO(mmo) {
-  SubclassData = encodeMemSDNodeFlags(0, ISD::UNINDEXED, MMO->isVolatile(),
-                                      MMO->isNonTemporal(), MMO->isInvariant());
-  assert(isVolatile() == MMO->isVolatile() && "Volatile encoding error!");
-  assert(memvt.getStoreSize() == MMO->getSize() && "Size mismatch!");
-}
-
 /// Profile - Gather unique data for the node.
 ///
 void SDNode::Profile(FoldingSetNodeID &ID) const {
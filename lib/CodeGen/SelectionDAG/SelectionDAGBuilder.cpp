@@ -3716,6 +3716,59 @@ void SelectionDAGBuilder::visitAtomicLoad(const LoadInst &I) {
   DAG.setRoot(OutChain);
 }
 
+void SelectionDAGBuilder::visitMaskedLoad(const CallInst &I) {
+  SDLoc sdl = getCurSDLoc();
+
+  // llvm.masked.load.*(Ptr, Alignment, Mask, Src0)
+  const Value *PtrOperand = I.getArgOperand(0);
+  SDValue Ptr = getValue(PtrOperand);
+  unsigned Alignment = cast<ConstantInt>(I.getArgOperand(1))->getZExtValue();
+  SDValue Mask = getValue(I.getArgOperand(2));
+  SDValue Src0 = getValue(I.getArgOperand(3));
+
+  const TargetLowering *TLI = TM.getTargetLowering();
+  EVT VT = TLI->getValueType(I.getType());
+  if (!Alignment)
+    Alignment = DAG.getEVTAlignment(VT);
+
+  MachineMemOperand *MMO =
+    DAG.getMachineFunction().
+    getMachineMemOperand(MachinePointerInfo(PtrOperand),
+                         MachineMemOperand::MOLoad, VT.getStoreSize(),
+                         Alignment, I.getMetadata(LLVMContext::MD_tbaa));
+
+  // Like an ordinary load, this doesn't need to be ordered against other
+  // loads.
+  SDValue Load = DAG.getMaskedLoad(VT, sdl, DAG.getRoot(), Ptr, Mask, Src0,
+                                   MMO);
+  PendingLoads.push_back(Load.getValue(1));
+  setValue(&I, Load);
+}
+
+void SelectionDAGBuilder::visitMaskedStore(const CallInst &I) {
+  SDLoc sdl = getCurSDLoc();
+
+  // llvm.masked.store.*(Src0, Ptr, Alignment, Mask)
+  const Value *PtrOperand = I.getArgOperand(1);
+  SDValue Src0 = getValue(I.getArgOperand(0));
+  SDValue Ptr = getValue(PtrOperand);
+  unsigned Alignment = cast<ConstantInt>(I.getArgOperand(2))->getZExtValue();
+  SDValue Mask = getValue(I.getArgOperand(3));
+
+  EVT VT = Src0.getValueType();
+  if (!Alignment)
+    Alignment = DAG.getEVTAlignment(VT);
+
+  MachineMemOperand *MMO =
+    DAG.getMachineFunction().
+    getMachineMemOperand(MachinePointerInfo(PtrOperand),
+                         MachineMemOperand::MOStore, VT.getStoreSize(),
+                         Alignment, I.getMetadata(LLVMContext::MD_tbaa));
+
+  SDValue StoreNode = DAG.getMaskedStore(getRoot(), sdl, Src0, Ptr, Mask, MMO);
+  DAG.setRoot(StoreNode);
+}
+
 void SelectionDAGBuilder::visitAtomicStore(const StoreInst &I) {
   SDLoc dl = getCurSDLoc();
 
@@ -5360,6 +5413,12 @@ SelectionDAGBuilder::visitIntrinsicCall(const CallInst &I, unsigned Intrinsic) {
     // Discard region information.
     setValue(&I, DAG.getUNDEF(TLI->getPointerTy()));
     return nullptr;
+  case Intrinsic::masked_load:
+    visitMaskedLoad(I);
+    return nullptr;
+  case Intrinsic::masked_store:
+    visitMaskedStore(I);
+    return nullptr;
   case Intrinsic::invariant_end:
     // Discard region information.
     return nullptr;
@@ -131,6 +131,7 @@ STATISTIC(NumFastIselFailFCmp,"Fast isel fails on FCmp");
 STATISTIC(NumFastIselFailPHI,"Fast isel fails on PHI");
 STATISTIC(NumFastIselFailSelect,"Fast isel fails on Select");
 STATISTIC(NumFastIselFailCall,"Fast isel fails on Call");
+STATISTIC(NumFastIselFailIntrinsicCall,"Fast isel fails on intrinsic Call");
 STATISTIC(NumFastIselFailShl,"Fast isel fails on Shl");
 STATISTIC(NumFastIselFailLShr,"Fast isel fails on LShr");
 STATISTIC(NumFastIselFailAShr,"Fast isel fails on AShr");
@@ -910,10 +911,11 @@ static bool isFoldedOrDeadInstruction(const Instruction *I,
 }
 
 #ifndef NDEBUG
-// Collect per Instruction statistics for fast-isel misses.  Only those
-// instructions that cause the bail are accounted for.  It does not account for
-// instructions higher in the block.  Thus, summing the per instructions stats
-// will not add up to what is reported by NumFastIselFailures.
+// Collect per Instruction statistics for fast-isel misses, under -stats or
+// -fast-isel-verbose2.  Only those instructions that cause the bail are
+// accounted for.  It does not account for instructions higher in the block.
+// Thus, summing the per instructions stats will not add up to what is reported
+// by NumFastIselFailures.
 static void collectFailStats(const Instruction *I) {
   switch (I->getOpcode()) {
   default: assert (0 && "<Invalid operator> ");
@@ -974,7 +976,12 @@ static void collectFailStats(const Instruction *I) {
   case Instruction::FCmp:           NumFastIselFailFCmp++; return;
   case Instruction::PHI:            NumFastIselFailPHI++; return;
   case Instruction::Select:         NumFastIselFailSelect++; return;
-  case Instruction::Call:           NumFastIselFailCall++; return;
+  case Instruction::Call:
+    if (isa<IntrinsicInst>(I))
+      NumFastIselFailIntrinsicCall++;
+    else
+      NumFastIselFailCall++;
+    return;
   case Instruction::Shl:            NumFastIselFailShl++; return;
   case Instruction::LShr:           NumFastIselFailLShr++; return;
   case Instruction::AShr:           NumFastIselFailAShr++; return;
@@ -1109,7 +1116,7 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         }
 
 #ifndef NDEBUG
-        if (EnableFastISelVerbose2)
+        if (EnableFastISelVerbose2 || AreStatisticsEnabled())
           collectFailStats(Inst);
 #endif
 
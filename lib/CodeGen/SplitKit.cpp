@@ -1094,6 +1094,7 @@ void SplitEditor::finish(SmallVectorImpl<unsigned> *LRMap) {
   for (LiveRangeEdit::iterator I = Edit->begin(), E = Edit->end(); I != E; ++I) {
     LiveInterval &LI = LIS.getInterval(*I);
     LI.RenumberValues();
+    LI.compact();
   }
 
   // Provide a reverse mapping from original indices to Edit ranges.
@@ -739,8 +739,13 @@ void TargetLoweringBase::initActions() {
 
     // These operations default to expand for vector types.
     if (VT >= MVT::FIRST_VECTOR_VALUETYPE &&
-        VT <= MVT::LAST_VECTOR_VALUETYPE)
+        VT <= MVT::LAST_VECTOR_VALUETYPE) {
       setOperationAction(ISD::FCOPYSIGN, (MVT::SimpleValueType)VT, Expand);
+      // CodeGenPrepare scalarizes masked loads and stores that the target
+      // cannot select.
+      setOperationAction(ISD::MLOAD, (MVT::SimpleValueType)VT, Expand);
+      setOperationAction(ISD::MSTORE, (MVT::SimpleValueType)VT, Expand);
+    }
   }
 
   // Most targets ignore the @llvm.prefetch intrinsic.
@@ -228,6 +228,19 @@ static const char *getSectionPrefixForGlobal(SectionKind Kind) {
   return ".data.rel.ro.";
 }
 
+/// getTextSectionPrefixForGlobal - Return the prefix of the section that
+/// holds the code of GV. Functions marked hot are packed together in
+/// .text.hot, and functions marked cold are kept out of the way in
+/// .text.unlikely.
+static const char *getTextSectionPrefixForGlobal(const GlobalValue *GV) {
+  if (const Function *F = dyn_cast<Function>(GV)) {
+    if (F->hasFnAttribute(llvm::Attribute::Hot))
+      return ".text.hot.";
+    if (F->hasFnAttribute(llvm::Attribute::Cold))
+      return ".text.unlikely.";
+  }
+  return ".text.";
+}
 
 const MCSection *TargetLoweringObjectFileELF::
 SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
@@ -245,7 +258,10 @@ SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
   if ((GV->isWeakForLinker() || EmitUniquedSection) &&
       !Kind.isCommon()) {
     const char *Prefix;
-    Prefix = getSectionPrefixForGlobal(Kind);
+    if (Kind.isText())
+      Prefix = getTextSectionPrefixForGlobal(GV);
+    else
+      Prefix = getSectionPrefixForGlobal(Kind);
 
     SmallString<128> Name(Prefix, Prefix+strlen(Prefix));
     TM.getNameWithPrefix(Name, GV, Mang, true);
@@ -262,7 +278,14 @@ SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
                                       Flags, Kind, 0, Group);
   }
 
-  if (Kind.isText()) return TextSection;
+  if (Kind.isText()) {
+    StringRef Prefix = getTextSectionPrefixForGlobal(GV);
+    if (Prefix == ".text.")
+      return TextSection;
+    return getContext().getELFSection(Prefix.drop_back(), ELF::SHT_PROGBITS,
+                                      ELF::SHF_EXECINSTR | ELF::SHF_ALLOC,
+                                      SectionKind::getText());
+  }
 
   if (Kind.isMergeable1ByteCString() ||
       Kind.isMergeable2ByteCString() ||
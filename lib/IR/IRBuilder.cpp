@@ -137,6 +137,36 @@ CallInst *IRBuilderBase::CreateLifetimeStart(Value *Ptr, ConstantInt *Size) {
   return createCallHelper(TheFn, Ops, this);
 }
 
+CallInst *IRBuilderBase::CreateMaskedLoad(Value *Ptr, unsigned Align,
+                                          Value *Mask, Value *PassThru,
+                                          const Twine &Name) {
+  Type *DataTy = cast<PointerType>(Ptr->getType())->getElementType();
+  assert(DataTy->isVectorTy() && "masked.load only applies to vectors.");
+  if (!PassThru)
+    PassThru = UndefValue::get(DataTy);
+  Value *Ops[] = { Ptr, getInt32(Align), Mask, PassThru };
+  Type *OverloadedTypes[] = { DataTy, Ptr->getType(), Mask->getType() };
+  Module *M = BB->getParent()->getParent();
+  Value *TheFn = Intrinsic::getDeclaration(M, Intrinsic::masked_load,
+                                           OverloadedTypes);
+  CallInst *CI = createCallHelper(TheFn, Ops, this);
+  CI->setName(Name);
+  return CI;
+}
+
+CallInst *IRBuilderBase::CreateMaskedStore(Value *Val, Value *Ptr,
+                                           unsigned Align, Value *Mask) {
+  assert(Val->getType()->isVectorTy() &&
+         "masked.store only applies to vectors.");
+  Value *Ops[] = { Val, Ptr, getInt32(Align), Mask };
+  Type *OverloadedTypes[] = { Val->getType(), Ptr->getType(),
+                              Mask->getType() };
+  Module *M = BB->getParent()->getParent();
+  Value *TheFn = Intrinsic::getDeclaration(M, Intrinsic::masked_store,
+                                           OverloadedTypes);
+  return createCallHelper(TheFn, Ops, this);
+}
+
 CallInst *IRBuilderBase::CreateLifetimeEnd(Value *Ptr, ConstantInt *Size) {
   assert(isa<PointerType>(Ptr->getType()) &&
          "lifetime.end only applies to pointers.");
@@ -12,12 +12,14 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassCostReport.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -28,9 +30,15 @@
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <map>
+#include <memory>
 using namespace llvm;
 using namespace llvm::legacy;
 
+#define DEBUG_TYPE "pass-manager"
+
+STATISTIC(NumSkippedIdempotentRuns,
+          "Number of idempotent pass runs skipped on unchanged functions");
+
 // See PassManagers.h for Pass Manager infrastructure overview.
 
 //===----------------------------------------------------------------------===//
@@ -83,6 +91,12 @@ PrintAfterAll("print-after-all",
               llvm::cl::desc("Print IR after each pass"),
               cl::init(false));
 
+static cl::opt<bool>
+SkipIdempotentPasses("skip-idempotent-passes", cl::Hidden, cl::init(false),
+                     cl::desc("Don't rerun idempotent function passes on "
+                              "functions that have not changed since they "
+                              "last ran"));
+
 /// This is a helper to determine whether to print IR before or
 /// after a pass.
 
@@ -504,12 +518,33 @@ static TimingInfo *TheTimeInfo;
 // PMTopLevelManager implementation
 
 /// Initialize top level manager. Create first pass manager.
-PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) {
+PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM)
+  : LastEpoch(0), ModuleEpoch(0) {
   PMDM->setTopLevelManager(this);
   addPassManager(PMDM);
   activeStack.push(PMDM);
 }
 
+void PMTopLevelManager::bumpModificationEpoch(const Function *F) {
+  if (F)
+    FunctionEpochs[F] = ++LastEpoch;
+  else
+    ModuleEpoch = ++LastEpoch;
+}
+
+bool PMTopLevelManager::isUnchangedSinceLastRun(const Pass *P,
+                                                const Function *F) const {
+  DenseMap<std::pair<AnalysisID, const Function *>, unsigned>::const_iterator
+    I = IdempotentRunEpochs.find(std::make_pair(P->getPassID(), F));
+  return I != IdempotentRunEpochs.end() &&
+         I->second == getModificationEpoch(F);
+}
+
+void PMTopLevelManager::recordIdempotentRun(const Pass *P, const Function *F) {
+  IdempotentRunEpochs[std::make_pair(P->getPassID(), F)] =
+    getModificationEpoch(F);
+}
+
 /// Set pass P as the last user of the given analysis passes.
 void
 PMTopLevelManager::setLastUser(ArrayRef<Pass*> AnalysisPasses, Pass *P) {
@@ -928,6 +963,28 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
   }
 }
 
+/// Record that P modified F, or any function in the module if F is null.
+void PMDataManager::functionModifiedBy(Pass *P, Function *F) {
+  TPM->bumpModificationEpoch(F);
+
+  // Passes that claim to preserve an immutable pass may still have rewritten
+  // the IR it memoized facts about, so tell all of them.
+  SmallVectorImpl<ImmutablePass *> &ImmutablePasses =
+    TPM->getImmutablePasses();
+  for (SmallVectorImpl<ImmutablePass *>::iterator I = ImmutablePasses.begin(),
+         E = ImmutablePasses.end(); I != E; ++I)
+    (*I)->functionModified(F);
+}
+
+/// Tell the immutable passes that a pass has finished running.
+void PMDataManager::passFinished() {
+  SmallVectorImpl<ImmutablePass *> &ImmutablePasses =
+    TPM->getImmutablePasses();
+  for (SmallVectorImpl<ImmutablePass *>::iterator I = ImmutablePasses.begin(),
+         E = ImmutablePasses.end(); I != E; ++I)
+    (*I)->passFinished();
+}
+
 /// Remove analysis passes that are not used any longer
 void PMDataManager::removeDeadPasses(Pass *P, StringRef Msg,
                                      enum PassDebuggingString DBG_STR) {
@@ -1172,6 +1229,9 @@ void PMDataManager::dumpPassInfo(Pass *P, enum PassDebuggingString S1,
   case FREEING_MSG:
     dbgs() << " Freeing Pass '" << P->getPassName();
     break;
+  case SKIPPING_MSG:
+    dbgs() << "Skipping Unchanged '" << P->getPassName();
+    break;
   default:
     break;
   }
@@ -1317,11 +1377,14 @@ bool BBPassManager::runOnFunction(Function &F) {
 
         F.getContext().notifyPassRun(BP, F.getParent(), &F, &*I);
       }
+      passFinished();
 
       Changed |= LocalChanged;
-      if (LocalChanged)
+      if (LocalChanged) {
         dumpPassInfo(BP, MODIFICATION_MSG, ON_BASICBLOCK_MSG,
                      I->getName());
+        functionModifiedBy(BP, &F);
+      }
       dumpPreservedSet(BP);
 
       verifyPreservedAnalysis(BP);
@@ -1533,6 +1596,16 @@ bool FPPassManager::runOnFunction(Function &F) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
 
+    // Running an idempotent pass again on a function that nothing has touched
+    // since its last run cannot change anything.
+    bool Idempotent = SkipIdempotentPasses && FP->isIdempotent();
+    if (Idempotent && TPM->isUnchangedSinceLastRun(FP, &F)) {
+      ++NumSkippedIdempotentRuns;
+      dumpPassInfo(FP, SKIPPING_MSG, ON_FUNCTION_MSG, F.getName());
+      removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
+      continue;
+    }
+
     dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
     dumpRequiredSet(FP);
 
@@ -1541,13 +1614,22 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      // Nested pass managers report their passes themselves.
+      std::unique_ptr<PassCostRegion> PassCost;
+      if (!FP->getAsPMDataManager())
+        PassCost.reset(new PassCostRegion(FP->getPassName(), F));
 
       LocalChanged |= FP->runOnFunction(F);
     }
+    passFinished();
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+      functionModifiedBy(FP, &F);
+    }
+    if (Idempotent)
+      TPM->recordIdempotentRun(FP, &F);
     dumpPreservedSet(FP);
 
     verifyPreservedAnalysis(FP);
@@ -1621,14 +1703,21 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      // Nested pass managers report their passes themselves.
+      std::unique_ptr<PassCostRegion> PassCost;
+      if (!MP->getAsPMDataManager())
+        PassCost.reset(new PassCostRegion(MP->getPassName(), M));
 
       LocalChanged |= MP->runOnModule(M);
     }
+    passFinished();
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
       dumpPassInfo(MP, MODIFICATION_MSG, ON_MODULE_MSG,
                    M.getModuleIdentifier());
+      functionModifiedBy(MP, nullptr);
+    }
     dumpPreservedSet(MP);
 
     verifyPreservedAnalysis(MP);
@@ -48,6 +48,21 @@ MDNode *MDBuilder::createBranchWeights(ArrayRef<uint32_t> Weights) {
   return MDNode::get(Context, Vals);
 }
 
+MDNode *MDBuilder::createIndirectCallTargets(
+    uint64_t TotalCount, ArrayRef<std::pair<StringRef, uint64_t> > Targets) {
+  SmallVector<Value *, 8> Vals;
+  Vals.push_back(createString("indirect_call_targets"));
+
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  Vals.push_back(ConstantInt::get(Int64Ty, TotalCount));
+  for (unsigned i = 0, e = Targets.size(); i != e; ++i) {
+    Vals.push_back(createString(Targets[i].first));
+    Vals.push_back(ConstantInt::get(Int64Ty, Targets[i].second));
+  }
+
+  return MDNode::get(Context, Vals);
+}
+
 MDNode *MDBuilder::createRange(const APInt &Lo, const APInt &Hi) {
   assert(Lo.getBitWidth() == Hi.getBitWidth() && "Mismatched bitwidths!");
   // If the range is everything then it is useless.
@@ -0,0 +1,205 @@
+//===- PassCostReport.cpp - Per-function, per-pass compile cost -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the -pass-cost-report option.  Only the most expensive
+// (pass, function) pairs are kept, in a bounded heap ordered by wall time, so
+// that the report stays cheap even for very large LTO modules.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/PassCostReport.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+bool llvm::PassCostReportIsEnabled = false;
+static cl::opt<bool, true>
+EnablePassCostReport("pass-cost-report",
+                     cl::location(PassCostReportIsEnabled), cl::Hidden,
+                     cl::desc("Record the cost of every (pass, function) pair "
+                              "and report the most expensive ones on exit"));
+
+static cl::opt<unsigned>
+PassCostReportTop("pass-cost-report-top", cl::Hidden, cl::init(20),
+                  cl::desc("Number of (pass, function) pairs to report"));
+
+static cl::opt<std::string>
+PassCostReportFile("pass-cost-report-file", cl::Hidden, cl::init("-"),
+                   cl::value_desc("filename"),
+                   cl::desc("File to write the pass cost report to "
+                            "(default: stderr)"));
+
+namespace {
+struct CostRecord {
+  std::string PassName;
+  std::string FunctionName;
+  double WallTime;
+  unsigned InstsBefore;
+  unsigned InstsAfter;
+  int64_t MallocBytes;
+
+  /// Order records so that the cheapest one is at the top of the heap.
+  bool operator<(const CostRecord &RHS) const {
+    return WallTime > RHS.WallTime;
+  }
+};
+
+class PassCostReport {
+  sys::SmartMutex<true> Lock;
+  std::vector<CostRecord> Heap;
+  uint64_t NumRecorded;
+
+public:
+  PassCostReport() : NumRecorded(0) {}
+  ~PassCostReport() { print(); }
+
+  void record(CostRecord R);
+  void print();
+  void print(raw_ostream &OS);
+};
+}
+
+static ManagedStatic<PassCostReport> TheReport;
+
+void PassCostReport::record(CostRecord R) {
+  sys::SmartScopedLock<true> Guard(Lock);
+  ++NumRecorded;
+  if (PassCostReportTop == 0)
+    return;
+  if (Heap.size() == PassCostReportTop) {
+    if (!(R < Heap.front()))
+      return;
+    std::pop_heap(Heap.begin(), Heap.end());
+    Heap.pop_back();
+  }
+  Heap.push_back(std::move(R));
+  std::push_heap(Heap.begin(), Heap.end());
+}
+
+/// printCSVField - Print a string field, quoting it if needed.
+static void printCSVField(raw_ostream &OS, StringRef S) {
+  if (S.find_first_of(",\"\n") == StringRef::npos) {
+    OS << S;
+    return;
+  }
+  OS << '"';
+  for (size_t i = 0, e = S.size(); i != e; ++i) {
+    if (S[i] == '"')
+      OS << '"';
+    OS << S[i];
+  }
+  OS << '"';
+}
+
+void PassCostReport::print() {
+  if (NumRecorded == 0)
+    return;
+
+  if (PassCostReportFile == "-") {
+    print(errs());
+    return;
+  }
+
+  std::string Error;
+  raw_fd_ostream OS(PassCostReportFile.c_str(), Error, sys::fs::F_Text);
+  if (!Error.empty()) {
+    errs() << "Error opening pass cost report file '" << PassCostReportFile
+           << "': " << Error << '\n';
+    return;
+  }
+  print(OS);
+}
+
+void PassCostReport::print(raw_ostream &OS) {
+  // Most expensive first.
+  std::sort_heap(Heap.begin(), Heap.end());
+
+  OS << "pass,function,wall_seconds,insts_before,insts_after,malloc_bytes\n";
+  for (std::vector<CostRecord>::const_iterator I = Heap.begin(),
+         E = Heap.end(); I != E; ++I) {
+    printCSVField(OS, I->PassName);
+    OS << ',';
+    printCSVField(OS, I->FunctionName);
+    OS << ',' << format("%.6f", I->WallTime) << ',' << I->InstsBefore << ','
+       << I->InstsAfter << ',' << I->MallocBytes << '\n';
+  }
+  Heap.clear();
+  NumRecorded = 0;
+}
+
+static unsigned countInstructions(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
+static std::string getFunctionName(void *F) {
+  return static_cast<Function *>(F)->getName();
+}
+
+static unsigned countFunctionInstructions(void *F) {
+  return countInstructions(*static_cast<Function *>(F));
+}
+
+static std::string getModuleName(void *M) {
+  return static_cast<Module *>(M)->getModuleIdentifier();
+}
+
+static unsigned countModuleInstructions(void *M) {
+  unsigned Count = 0;
+  Module &Mod = *static_cast<Module *>(M);
+  for (Module::const_iterator F = Mod.begin(), E = Mod.end(); F != E; ++F)
+    Count += countInstructions(*F);
+  return Count;
+}
+
+PassCostRegion::PassCostRegion(StringRef Name, Function &Fn)
+    : PassName(Name), Unit(nullptr) {
+  if (PassCostReportIsEnabled)
+    start(&Fn, getFunctionName, countFunctionInstructions);
+}
+
+PassCostRegion::PassCostRegion(StringRef Name, Module &M)
+    : PassName(Name), Unit(nullptr) {
+  if (PassCostReportIsEnabled)
+    start(&M, getModuleName, countModuleInstructions);
+}
+
+void PassCostRegion::start(void *U, NameFn Name, CountFn Cnt) {
+  Unit = U;
+  Count = Cnt;
+  UnitName = Name(U);
+  InstsBefore = Cnt(U);
+  MallocBefore = sys::Process::GetMallocUsage();
+  WallBefore = TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+void PassCostRegion::finish() {
+  CostRecord R;
+  R.WallTime = TimeRecord::getCurrentTime(false).getWallTime() - WallBefore;
+  R.MallocBytes = int64_t(sys::Process::GetMallocUsage()) -
+                  int64_t(MallocBefore);
+  R.InstsBefore = InstsBefore;
+  R.InstsAfter = Count(Unit);
+  R.PassName = PassName;
+  R.FunctionName = std::move(UnitName);
+  TheReport->record(std::move(R));
+}
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/PassCostReport.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -88,7 +89,11 @@ PreservedAnalyses FunctionPassManager::run(Function *F,
     if (DebugPM)
       dbgs() << "Running function pass: " << Passes[Idx]->name() << "\n";
 
-    PreservedAnalyses PassPA = Passes[Idx]->run(F, AM);
+    PreservedAnalyses PassPA;
+    {
+      PassCostRegion PassCost(Passes[Idx]->name(), *F);
+      PassPA = Passes[Idx]->run(F, AM);
+    }
     if (AM)
       AM->invalidate(F, PassPA);
     PA.intersect(std::move(PassPA));
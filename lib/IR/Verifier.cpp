@@ -727,6 +727,7 @@ void Verifier::VerifyAttributeTypes(AttributeSet Attrs, unsigned Idx,
         I->getKindAsEnum() == Attribute::Builtin ||
         I->getKindAsEnum() == Attribute::NoBuiltin ||
         I->getKindAsEnum() == Attribute::Cold ||
+        I->getKindAsEnum() == Attribute::Hot ||
         I->getKindAsEnum() == Attribute::OptimizeNone) {
       if (!isFunction) {
         CheckFailed("Attribute '" + I->getAsString() +
@@ -882,6 +883,12 @@ void Verifier::VerifyFunctionAttrs(FunctionType *FT, AttributeSet Attrs,
                                Attribute::AlwaysInline)),
           "Attributes 'noinline and alwaysinline' are incompatible!", V);
 
+  Assert1(!(Attrs.hasAttribute(AttributeSet::FunctionIndex,
+                               Attribute::Hot) &&
+            Attrs.hasAttribute(AttributeSet::FunctionIndex,
+                               Attribute::Cold)),
+          "Attributes 'hot and cold' are incompatible!", V);
+
   if (Attrs.hasAttribute(AttributeSet::FunctionIndex, 
                          Attribute::OptimizeNone)) {
     Assert1(Attrs.hasAttribute(AttributeSet::FunctionIndex,
@@ -2464,6 +2471,25 @@ void Verifier::visitIntrinsicFunctionCall(Intrinsic::ID ID, CallInst &CI) {
     Assert1(isa<ConstantInt>(CI.getArgOperand(1)),
             "llvm.invariant.end parameter #2 must be a constant integer", &CI);
     break;
+  case Intrinsic::masked_load:
+  case Intrinsic::masked_store: {
+    bool IsLoad = ID == Intrinsic::masked_load;
+    Type *DataTy = IsLoad ? CI.getType()
+                          : CI.getArgOperand(0)->getType();
+    Value *Ptr = CI.getArgOperand(IsLoad ? 0 : 1);
+    Value *Alignment = CI.getArgOperand(IsLoad ? 1 : 2);
+    Value *Mask = CI.getArgOperand(IsLoad ? 2 : 3);
+    Assert1(cast<PointerType>(Ptr->getType())->getElementType() == DataTy,
+            "masked load/store pointer does not point to the data type", &CI);
+    Assert1(isa<ConstantInt>(Alignment),
+            "masked load/store alignment must be a constant integer", &CI);
+    VectorType *MaskTy = cast<VectorType>(Mask->getType());
+    Assert1(MaskTy->getElementType()->isIntegerTy(1) &&
+            MaskTy->getNumElements() == DataTy->getVectorNumElements(),
+            "masked load/store mask must be a vector of i1 with one element "
+            "per data element", &CI);
+    break;
+  }
   }
 }
 
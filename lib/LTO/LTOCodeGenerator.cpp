@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -38,13 +39,16 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include "llvm/Target/CodeGenCache.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetOptions.h"
@@ -52,8 +56,36 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
 using namespace llvm;
 
+static cl::opt<std::string>
+CodeGenCacheDir("lto-codegen-cache-dir", cl::value_desc("directory"),
+                cl::desc("Reuse object files from previous link-time "
+                         "optimizations of the same merged module, cached in "
+                         "this directory"));
+
+static cl::opt<unsigned>
+CodeGenCacheMaxSize("lto-codegen-cache-max-size", cl::value_desc("megabytes"),
+                    cl::init(0),
+                    cl::desc("Prune the least recently used entries of the "
+                             "LTO codegen cache to stay under this size "
+                             "(default: unlimited)"));
+
+static cl::opt<bool>
+OrderFunctions("lto-order-functions", cl::init(false),
+               cl::desc("Order functions by call affinity and place hot and "
+                        "cold functions in their own sections"));
+
+static cl::opt<unsigned>
+CodeGenPartitions("lto-partitions", cl::init(1),
+                  cl::desc("Split the optimized module into this many "
+                           "partitions and generate an object file for each "
+                           "in parallel"));
+
 const char* LTOCodeGenerator::getVersionString() {
 #ifdef LLVM_VERSION_INFO
   return PACKAGE_NAME " version " PACKAGE_VERSION ", " LLVM_VERSION_INFO;
@@ -200,40 +232,72 @@ bool LTOCodeGenerator::writeMergedModules(const char *path,
   return true;
 }
 
+bool LTOCodeGenerator::compileToFiles(unsigned NumParts,
+                                      bool disableOpt,
+                                      bool disableInline,
+                                      bool disableGVNLoadPRE,
+                                      std::string& errMsg) {
+  // make unique temp .o files to put generated object files
+  std::vector<std::string> Filenames;
+  std::vector<std::unique_ptr<tool_output_file> > ObjFiles;
+  SmallVector<raw_ostream *, 4> Outs;
+  for (unsigned i = 0; i != NumParts; ++i) {
+    SmallString<128> Filename;
+    int FD;
+    error_code EC = sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    Filenames.push_back(Filename.str());
+    ObjFiles.push_back(std::unique_ptr<tool_output_file>(
+        new tool_output_file(Filename.c_str(), FD)));
+    Outs.push_back(&ObjFiles.back()->os());
+  }
+
+  // generate object files; the ones not kept are removed on return
+  bool genResult = generateObjectFiles(Outs, disableOpt, disableInline,
+                                       disableGVNLoadPRE, errMsg);
+  for (unsigned i = 0; i != NumParts; ++i) {
+    ObjFiles[i]->os().close();
+    if (ObjFiles[i]->os().has_error()) {
+      ObjFiles[i]->os().clear_error();
+      return false;
+    }
+  }
+  if (!genResult)
+    return false;
+
+  for (unsigned i = 0; i != NumParts; ++i)
+    ObjFiles[i]->keep();
+  NativeObjectPaths.swap(Filenames);
+  return true;
+}
+
 bool LTOCodeGenerator::compile_to_file(const char** name,
                                        bool disableOpt,
                                        bool disableInline,
                                        bool disableGVNLoadPRE,
                                        std::string& errMsg) {
-  // make unique temp .o file to put generated object file
-  SmallString<128> Filename;
-  int FD;
-  error_code EC = sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
-  if (EC) {
-    errMsg = EC.message();
+  if (!compileToFiles(1, disableOpt, disableInline, disableGVNLoadPRE, errMsg))
     return false;
-  }
 
-  // generate object file
-  tool_output_file objFile(Filename.c_str(), FD);
-
-  bool genResult = generateObjectFile(objFile.os(), disableOpt, disableInline,
-                                      disableGVNLoadPRE, errMsg);
-  objFile.os().close();
-  if (objFile.os().has_error()) {
-    objFile.os().clear_error();
-    sys::fs::remove(Twine(Filename));
-    return false;
-  }
+  *name = NativeObjectPaths[0].c_str();
+  return true;
+}
 
-  objFile.keep();
-  if (!genResult) {
-    sys::fs::remove(Twine(Filename));
+bool LTOCodeGenerator::compile_to_files(std::vector<const char *> &names,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  if (!compileToFiles(std::max(1U, unsigned(CodeGenPartitions)), disableOpt,
+                      disableInline, disableGVNLoadPRE, errMsg))
     return false;
-  }
 
-  NativeObjectPath = Filename.c_str();
-  *name = NativeObjectPath.c_str();
+  names.clear();
+  for (unsigned i = 0, e = NativeObjectPaths.size(); i != e; ++i)
+    names.push_back(NativeObjectPaths[i].c_str());
   return true;
 }
 
@@ -254,13 +318,13 @@ const void* LTOCodeGenerator::compile(size_t* length,
   std::unique_ptr<MemoryBuffer> BuffPtr;
   if (error_code ec = MemoryBuffer::getFile(name, BuffPtr, -1, false)) {
     errMsg = ec.message();
-    sys::fs::remove(NativeObjectPath);
+    sys::fs::remove(name);
     return nullptr;
   }
   NativeObjectFile = BuffPtr.release();
 
   // remove temp files
-  sys::fs::remove(NativeObjectPath);
+  sys::fs::remove(name);
 
   // return buffer, unless error
   if (!NativeObjectFile)
@@ -454,16 +518,119 @@ void LTOCodeGenerator::applyScopeRestrictions() {
   ScopeRestrictionsDone = true;
 }
 
-/// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
+/// Add the passes that generate an object file for \p M to \p OS and run
+/// them.
+static bool emitObjectFile(Module &M, TargetMachine &TM, raw_ostream &OS,
+                           std::string &errMsg) {
+  PassManager codeGenPasses;
+
+  codeGenPasses.add(new DataLayoutPass(&M));
+
+  formatted_raw_ostream Out(OS);
+
+  // If the bitcode files contain ARC code and were compiled with optimization,
+  // the ObjCARCContractPass must be run, so do it unconditionally here.
+  codeGenPasses.add(createObjCARCContractPass());
+
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
+    errMsg = "target file type not supported";
+    return false;
+  }
+
+  // Run the code generator, and write assembly file
+  codeGenPasses.run(M);
+  return true;
+}
+
+namespace {
+/// A partition of the merged module, code generated on its own thread. The
+/// partition is handed over as bitcode and read into a context of its own,
+/// as an LLVMContext may only be used by one thread at a time.
+struct CodeGenPartition {
+  std::string Bitcode;
+  std::unique_ptr<TargetMachine> TM;
+  std::string Object;
+  std::string ErrMsg;
+
+  void run() {
+    LLVMContext Context;
+    std::unique_ptr<MemoryBuffer> Buffer(
+        MemoryBuffer::getMemBuffer(Bitcode, "", false));
+    ErrorOr<Module *> ModuleOrErr = parseBitcodeFile(Buffer.get(), Context);
+    if (error_code EC = ModuleOrErr.getError()) {
+      ErrMsg = EC.message();
+      return;
+    }
+    std::unique_ptr<Module> M(ModuleOrErr.get());
+    raw_string_ostream OS(Object);
+    emitObjectFile(*M, *TM, OS, ErrMsg);
+  }
+};
+}
+
+/// Split the merged module into one partition for each of \p Objects and
+/// generate their object files in parallel.
+bool LTOCodeGenerator::generatePartitions(std::vector<std::string> &Objects,
                                           std::string &errMsg) {
+  std::vector<std::unique_ptr<Module> > Modules;
+  SplitModule(*Linker.getModule(), Objects.size(), Modules);
+
+  std::vector<CodeGenPartition> Parts(Modules.size());
+  for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+    raw_string_ostream OS(Parts[i].Bitcode);
+    WriteBitcodeToFile(Modules[i].get(), OS);
+    OS.flush();
+    Modules[i].reset();
+    Parts[i].TM.reset(TargetMach->getTarget().createTargetMachine(
+        TargetMach->getTargetTriple(), TargetMach->getTargetCPU(),
+        TargetMach->getTargetFeatureString(), Options,
+        TargetMach->getRelocationModel(), TargetMach->getCodeModel(),
+        TargetMach->getOptLevel()));
+  }
+
+  // The linker calls into libLTO from a single thread, so it is safe to
+  // switch LLVM into multithreaded mode here. Without thread support the
+  // partitions are code generated one after the other.
+#if LLVM_ENABLE_THREADS
+  if (llvm_is_multithreaded() || llvm_start_multithreaded()) {
+    std::vector<std::thread> Threads;
+    for (unsigned i = 0, e = Parts.size(); i != e; ++i)
+      Threads.push_back(std::thread(&CodeGenPartition::run, &Parts[i]));
+    for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+      Threads[i].join();
+  } else
+#endif
+  {
+    for (unsigned i = 0, e = Parts.size(); i != e; ++i)
+      Parts[i].run();
+  }
+
+  // Whatever order the threads finished in, the object files are returned in
+  // partition order.
+  for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+    if (!Parts[i].ErrMsg.empty()) {
+      errMsg = Parts[i].ErrMsg;
+      return false;
+    }
+    Objects[i].swap(Parts[i].Object);
+  }
+  return true;
+}
+
+/// Optimize merged modules using various IPO passes, then generate one object
+/// file for each of \p Outs. With more than one, the optimized module is
+/// split into that many partitions, which are code generated in parallel.
+bool LTOCodeGenerator::generateObjectFiles(ArrayRef<raw_ostream *> Outs,
+                                           bool DisableOpt,
+                                           bool DisableInline,
+                                           bool DisableGVNLoadPRE,
+                                           std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
   Module *mergedModule = Linker.getModule();
+  unsigned NumParts = Outs.size();
 
   // Mark which symbols can not be internalized
   this->applyScopeRestrictions();
@@ -479,6 +646,47 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   mergedModule->setDataLayout(TargetMach->getDataLayout());
   passes.add(new DataLayoutPass(mergedModule));
 
+  // The merged module is final at this point, so if an earlier link produced
+  // object files from the same module with the same options, reuse them.
+  // Each partition's object file is a separate cache entry.
+  std::unique_ptr<CodeGenCache> Cache;
+  std::vector<std::unique_ptr<LockFileManager> > CacheLocks(NumParts);
+  std::vector<std::string> CacheKeys;
+  std::vector<bool> IsCached(NumParts);
+  if (!CodeGenCacheDir.empty()) {
+    std::string Bitcode;
+    raw_string_ostream BOS(Bitcode);
+    WriteBitcodeToFile(mergedModule, BOS);
+    BOS.flush();
+
+    std::string ExtraOptions;
+    raw_string_ostream EOS(ExtraOptions);
+    EOS << DisableOpt << DisableInline << DisableGVNLoadPRE
+        << bool(OrderFunctions) << NumParts;
+    for (unsigned i = 1, e = CodegenOptions.size(); i < e; ++i)
+      EOS << '\0' << CodegenOptions[i];
+    EOS.flush();
+
+    Cache.reset(new CodeGenCache(CodeGenCacheDir,
+                                 uint64_t(CodeGenCacheMaxSize) << 20));
+    std::string Key =
+        CodeGenCache::computeKey(Bitcode, mergedModule->getModuleIdentifier(),
+                                 *TargetMach, ExtraOptions);
+    std::vector<std::unique_ptr<MemoryBuffer> > Cached(NumParts);
+    bool AllCached = true;
+    for (unsigned i = 0; i != NumParts; ++i) {
+      CacheKeys.push_back(NumParts == 1 ? Key : Key + "." + utostr(i));
+      Cached[i] = Cache->acquire(CacheKeys[i], CacheLocks[i]);
+      IsCached[i] = bool(Cached[i]);
+      AllCached &= IsCached[i];
+    }
+    if (AllCached) {
+      for (unsigned i = 0; i != NumParts; ++i)
+        *Outs[i] << Cached[i]->getBuffer();
+      return true;
+    }
+  }
+
   // Add appropriate TargetLibraryInfo for this module.
   passes.add(new TargetLibraryInfo(Triple(TargetMach->getTargetTriple())));
 
@@ -493,31 +701,36 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
                                               !DisableInline,
                                               DisableGVNLoadPRE);
 
+  // Lay out the merged module now that the whole call graph is known.
+  if (OrderFunctions)
+    passes.add(createFunctionOrderingPass());
+
   // Make sure everything is still good.
   passes.add(createVerifierPass());
   passes.add(createDebugInfoVerifierPass());
 
-  PassManager codeGenPasses;
-
-  codeGenPasses.add(new DataLayoutPass(mergedModule));
-
-  formatted_raw_ostream Out(out);
-
-  // If the bitcode files contain ARC code and were compiled with optimization,
-  // the ObjCARCContractPass must be run, so do it unconditionally here.
-  codeGenPasses.add(createObjCARCContractPass());
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
-                                      TargetMachine::CGFT_ObjectFile)) {
-    errMsg = "target file type not supported";
+  if (NumParts == 1 && !Cache)
+    return emitObjectFile(*mergedModule, *TargetMach, *Outs[0], errMsg);
+
+  // When caching, generate the object files into memory first so that they
+  // can be added to the cache as well as written out.
+  std::vector<std::string> Objects(NumParts);
+  if (NumParts == 1) {
+    raw_string_ostream OS(Objects[0]);
+    if (!emitObjectFile(*mergedModule, *TargetMach, OS, errMsg))
+      return false;
+  } else if (!generatePartitions(Objects, errMsg)) {
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
-  // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  for (unsigned i = 0; i != NumParts; ++i) {
+    *Outs[i] << Objects[i];
+    if (Cache && !IsCached[i])
+      Cache->store(CacheKeys[i], Objects[i]);
+  }
 
   return true;
 }
@@ -49,6 +49,8 @@ class InstrProfErrorCategoryType : public error_category {
       return "Function count mismatch";
     case instrprof_error::counter_overflow:
       return "Counter overflow";
+    case instrprof_error::value_site_count_mismatch:
+      return "Function indirect call site count mismatch";
     }
     llvm_unreachable("A value of instrprof_error has no message.");
   }
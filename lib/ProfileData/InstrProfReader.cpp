@@ -78,6 +78,18 @@ void InstrProfIterator::Increment() {
     *this = InstrProfIterator();
 }
 
+ArrayRef<InstrProfValueSite> InstrProfValueSiteBuffer::getSites() {
+  // Targets doesn't grow any more, so it is safe to point into it now.
+  Sites.clear();
+  Sites.reserve(SiteSizes.size());
+  const InstrProfValueData *Start = Targets.data();
+  for (unsigned Size : SiteSizes) {
+    Sites.push_back(InstrProfValueSite(Start, Size));
+    Start += Size;
+  }
+  return Sites;
+}
+
 error_code TextInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   // Skip empty lines.
   while (!Line.is_at_end() && Line->empty())
@@ -118,6 +130,42 @@ error_code TextInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   // Give the record a reference to our internal counter storage.
   Record.Counts = Counts;
 
+  return readValueSites(Record);
+}
+
+error_code TextInstrProfReader::readValueSites(InstrProfRecord &Record) {
+  ValueSites.clear();
+  Record.IndirectCallSites = None;
+
+  // The indirect call targets are optional.
+  const StringRef Prefix = "indirect-call-sites:";
+  if (Line.is_at_end() || !Line->startswith(Prefix))
+    return success();
+  uint64_t NumSites;
+  if ((Line++)->substr(Prefix.size()).trim().getAsInteger(10, NumSites))
+    return error(instrprof_error::malformed);
+
+  for (uint64_t I = 0; I < NumSites; ++I) {
+    if (Line.is_at_end())
+      return error(instrprof_error::truncated);
+    uint64_t NumTargets;
+    if ((Line++)->getAsInteger(10, NumTargets))
+      return error(instrprof_error::malformed);
+
+    ValueSites.addSite();
+    for (uint64_t J = 0; J < NumTargets; ++J) {
+      if (Line.is_at_end())
+        return error(instrprof_error::truncated);
+      // Function names may contain ':', so split at the last one.
+      std::pair<StringRef, StringRef> Target = (Line++)->rsplit(':');
+      uint64_t Count;
+      if (Target.first.empty() || Target.second.getAsInteger(10, Count))
+        return error(instrprof_error::malformed);
+      ValueSites.addTarget(Target.first, Count);
+    }
+  }
+  Record.IndirectCallSites = ValueSites.getSites();
+
   return success();
 }
 
@@ -252,6 +300,68 @@ InstrProfLookupTrait::ComputeHash(StringRef K) {
   return IndexedInstrProf::ComputeHash(HashType, K);
 }
 
+InstrProfRecord InstrProfLookupTrait::ReadData(StringRef K,
+                                               const unsigned char *D,
+                                               offset_type N) {
+  using namespace support;
+  const unsigned char *End = D + N;
+  CountBuffer.clear();
+  ValueSiteBuffer.clear();
+  // On corrupt data, return a record with an empty name.
+  InstrProfRecord Corrupt("", 0, CountBuffer);
+
+  if (FormatVersion == 1) {
+    if (N < 2 * sizeof(uint64_t) || N % sizeof(uint64_t))
+      return Corrupt;
+
+    // The first stored value is the hash.
+    uint64_t Hash = endian::readNext<uint64_t, little, unaligned>(D);
+    // Each counter follows.
+    unsigned NumCounters = N / sizeof(uint64_t) - 1;
+    CountBuffer.reserve(NumCounters);
+    for (unsigned I = 0; I < NumCounters; ++I)
+      CountBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
+
+    return InstrProfRecord(K, Hash, CountBuffer);
+  }
+
+  // Starting with version 2, the hash and the counters are followed by the
+  // targets of each indirect call site:
+  //   Hash, NumCounters, Counters[NumCounters], NumSites,
+  //   { NumTargets, { Count, NameLength, Name }[NumTargets] }[NumSites]
+  // The counts are stored as 64 bit values, the names are not padded.
+  auto Remaining = [&]() { return size_t(End - D) / sizeof(uint64_t); };
+  if (Remaining() < 2)
+    return Corrupt;
+  uint64_t Hash = endian::readNext<uint64_t, little, unaligned>(D);
+  uint64_t NumCounters = endian::readNext<uint64_t, little, unaligned>(D);
+  if (Remaining() < NumCounters + 1)
+    return Corrupt;
+  CountBuffer.reserve(NumCounters);
+  for (uint64_t I = 0; I < NumCounters; ++I)
+    CountBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
+
+  uint64_t NumSites = endian::readNext<uint64_t, little, unaligned>(D);
+  for (uint64_t I = 0; I < NumSites; ++I) {
+    if (Remaining() < 1)
+      return Corrupt;
+    uint64_t NumTargets = endian::readNext<uint64_t, little, unaligned>(D);
+    ValueSiteBuffer.addSite();
+    for (uint64_t J = 0; J < NumTargets; ++J) {
+      if (Remaining() < 2)
+        return Corrupt;
+      uint64_t Count = endian::readNext<uint64_t, little, unaligned>(D);
+      uint64_t NameLen = endian::readNext<uint64_t, little, unaligned>(D);
+      if (uint64_t(End - D) < NameLen)
+        return Corrupt;
+      ValueSiteBuffer.addTarget(StringRef((const char *)D, NameLen), Count);
+      D += NameLen;
+    }
+  }
+
+  return InstrProfRecord(K, Hash, CountBuffer, ValueSiteBuffer.getSites());
+}
+
 bool IndexedInstrProfReader::hasFormat(const MemoryBuffer &DataBuffer) {
   if (DataBuffer.getBufferSize() < 8)
     return false;
@@ -275,9 +385,9 @@ error_code IndexedInstrProfReader::readHeader() {
   if (Magic != IndexedInstrProf::Magic)
     return error(instrprof_error::bad_magic);
 
-  // Read the version.
+  // Read the version. Version 1 files have no indirect call targets.
   uint64_t Version = endian::readNext<uint64_t, little, unaligned>(Cur);
-  if (Version != IndexedInstrProf::Version)
+  if (Version < 1 || Version > IndexedInstrProf::Version)
     return error(instrprof_error::unsupported_version);
 
   // Read the maximal function count.
@@ -292,7 +402,8 @@ error_code IndexedInstrProfReader::readHeader() {
 
   // The rest of the file is an on disk hash table.
   Index.reset(InstrProfReaderIndex::Create(Start + HashOffset, Cur, Start,
-                                           InstrProfLookupTrait(HashType)));
+                                           InstrProfLookupTrait(HashType,
+                                                                Version)));
   // Set up our iterator for readNextRecord.
   RecordIterator = Index->data_begin();
 
@@ -314,6 +425,24 @@ error_code IndexedInstrProfReader::getFunctionCounts(
   return success();
 }
 
+error_code IndexedInstrProfReader::getFunctionCounts(
+    StringRef FuncName, uint64_t &FuncHash, std::vector<uint64_t> &Counts,
+    std::vector<std::vector<InstrProfValueData>> &IndirectCallSites) {
+  const auto &Iter = Index->find(FuncName);
+  if (Iter == Index->end())
+    return error(instrprof_error::unknown_function);
+
+  const InstrProfRecord &Record = *Iter;
+  if (Record.Name.empty())
+    return error(instrprof_error::malformed);
+  FuncHash = Record.Hash;
+  Counts = Record.Counts;
+  IndirectCallSites.clear();
+  for (const InstrProfValueSite &Site : Record.IndirectCallSites)
+    IndirectCallSites.push_back(Site);
+  return success();
+}
+
 error_code IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   // Are we out of records?
   if (RecordIterator == Index->data_end())
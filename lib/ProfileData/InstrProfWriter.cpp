@@ -19,6 +19,8 @@
 
 #include "InstrProfIndexed.h"
 
+#include <algorithm>
+
 using namespace llvm;
 
 namespace {
@@ -45,7 +47,13 @@ public:
     offset_type N = K.size();
     LE.write<offset_type>(N);
 
-    offset_type M = (1 + V->Counts.size()) * sizeof(uint64_t);
+    // Hash, NumCounters, Counters and NumSites.
+    offset_type M = (3 + V->Counts.size()) * sizeof(uint64_t);
+    for (const auto &Site : V->IndirectCallSites) {
+      M += sizeof(uint64_t);
+      for (const auto &Target : Site)
+        M += 2 * sizeof(uint64_t) + Target.first.size();
+    }
     LE.write<offset_type>(M);
 
     return std::make_pair(N, M);
@@ -60,21 +68,52 @@ public:
     using namespace llvm::support;
     endian::Writer<little> LE(Out);
     LE.write<uint64_t>(V->Hash);
+    LE.write<uint64_t>(V->Counts.size());
     for (uint64_t I : V->Counts)
       LE.write<uint64_t>(I);
+    LE.write<uint64_t>(V->IndirectCallSites.size());
+    for (const auto &Site : V->IndirectCallSites) {
+      LE.write<uint64_t>(Site.size());
+      for (const auto &Target : Site) {
+        LE.write<uint64_t>(Target.second);
+        LE.write<uint64_t>(Target.first.size());
+        Out << Target.first;
+      }
+    }
   }
 };
 }
 
-error_code InstrProfWriter::addFunctionCounts(StringRef FunctionName,
-                                              uint64_t FunctionHash,
-                                              ArrayRef<uint64_t> Counters) {
+static void addValueSites(std::vector<InstrProfWriter::ValueSiteData> &Sites,
+                          ArrayRef<InstrProfValueSite> NewSites) {
+  Sites.resize(NewSites.size());
+  for (size_t I = 0, E = NewSites.size(); I < E; ++I) {
+    InstrProfWriter::ValueSiteData &Site = Sites[I];
+    for (const InstrProfValueData &Target : NewSites[I]) {
+      auto Where = std::find_if(Site.begin(), Site.end(),
+                                [&](const std::pair<std::string, uint64_t> &P) {
+        return P.first == Target.Name;
+      });
+      if (Where == Site.end())
+        Site.push_back(std::make_pair(Target.Name.str(), Target.Count));
+      else if (Where->second + Target.Count < Where->second)
+        Where->second = UINT64_MAX;
+      else
+        Where->second += Target.Count;
+    }
+  }
+}
+
+error_code InstrProfWriter::addFunctionCounts(
+    StringRef FunctionName, uint64_t FunctionHash, ArrayRef<uint64_t> Counters,
+    ArrayRef<InstrProfValueSite> IndirectCallSites) {
   auto Where = FunctionData.find(FunctionName);
   if (Where == FunctionData.end()) {
     // If this is the first time we've seen this function, just add it.
     auto &Data = FunctionData[FunctionName];
     Data.Hash = FunctionHash;
     Data.Counts = Counters;
+    addValueSites(Data.IndirectCallSites, IndirectCallSites);
     return instrprof_error::success;
   }
 
@@ -85,12 +124,17 @@ error_code InstrProfWriter::addFunctionCounts(StringRef FunctionName,
     return instrprof_error::hash_mismatch;
   if (Data.Counts.size() != Counters.size())
     return instrprof_error::count_mismatch;
+  if (!Data.IndirectCallSites.empty() && !IndirectCallSites.empty() &&
+      Data.IndirectCallSites.size() != IndirectCallSites.size())
+    return instrprof_error::value_site_count_mismatch;
   // These match, add up the counters.
   for (size_t I = 0, E = Counters.size(); I < E; ++I) {
     if (Data.Counts[I] + Counters[I] < Data.Counts[I])
       return instrprof_error::counter_overflow;
     Data.Counts[I] += Counters[I];
   }
+  if (!IndirectCallSites.empty())
+    addValueSites(Data.IndirectCallSites, IndirectCallSites);
   return instrprof_error::success;
 }
 
@@ -98,6 +142,21 @@ void InstrProfWriter::write(raw_fd_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
   uint64_t MaxFunctionCount = 0;
 
+  // Sort the indirect call targets by decreasing count and drop the rare ones.
+  for (auto &I : FunctionData) {
+    for (ValueSiteData &Site : I.getValue().IndirectCallSites) {
+      std::sort(Site.begin(), Site.end(),
+                [](const std::pair<std::string, uint64_t> &L,
+                   const std::pair<std::string, uint64_t> &R) {
+        if (L.second != R.second)
+          return L.second > R.second;
+        return L.first < R.first;
+      });
+      if (MaxTargetsPerSite && Site.size() > MaxTargetsPerSite)
+        Site.resize(MaxTargetsPerSite);
+    }
+  }
+
   // Populate the hash table generator.
   for (const auto &I : FunctionData) {
     Generator.insert(I.getKey(), &I.getValue());
@@ -0,0 +1,95 @@
+//=-- SampleProf.cpp - Sample profiling format support ---------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains common definitions used in the reading and writing of
+// sample profile data.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+class SampleProfErrorCategoryType : public error_category {
+  const char *name() const override { return "llvm.sampleprof"; }
+  std::string message(int IE) const override {
+    sampleprof_error::ErrorType E =
+        static_cast<sampleprof_error::ErrorType>(IE);
+    switch (E) {
+    case sampleprof_error::success:
+      return "Success";
+    case sampleprof_error::bad_magic:
+      return "Invalid file format (bad magic)";
+    case sampleprof_error::unsupported_version:
+      return "Unsupported format version";
+    case sampleprof_error::too_large:
+      return "Too much profile data";
+    case sampleprof_error::truncated:
+      return "Truncated profile data";
+    case sampleprof_error::malformed:
+      return "Malformed profile data";
+    case sampleprof_error::unknown_function:
+      return "No profile data available for function";
+    }
+    llvm_unreachable("A value of sampleprof_error has no message.");
+  }
+  error_condition default_error_condition(int EV) const override {
+    if (EV == sampleprof_error::success)
+      return errc::success;
+    return errc::invalid_argument;
+  }
+};
+}
+
+const error_category &llvm::sampleprof_category() {
+  static SampleProfErrorCategoryType C;
+  return C;
+}
+
+void FunctionSamples::merge(const FunctionSamples &Other) {
+  addTotalSamples(Other.TotalSamples);
+  addHeadSamples(Other.TotalHeadSamples);
+  for (BodySampleMap::const_iterator I = Other.BodySamples.begin(),
+                                     E = Other.BodySamples.end();
+       I != E; ++I)
+    addBodySamples(I->first.LineOffset, I->first.Discriminator, I->second);
+}
+
+static bool compareLines(const std::pair<LineLocation, unsigned> &L,
+                         const std::pair<LineLocation, unsigned> &R) {
+  if (L.first.LineOffset != R.first.LineOffset)
+    return L.first.LineOffset < R.first.LineOffset;
+  return L.first.Discriminator < R.first.Discriminator;
+}
+
+void FunctionSamples::getSortedBodySamples(
+    std::vector<std::pair<LineLocation, unsigned> > &Lines) const {
+  Lines.assign(BodySamples.begin(), BodySamples.end());
+  std::sort(Lines.begin(), Lines.end(), compareLines);
+}
+
+/// \brief Print this function profile on stream \p OS, with the sampled
+/// lines in order.
+void FunctionSamples::print(raw_ostream &OS) const {
+  OS << TotalSamples << ", " << TotalHeadSamples << ", " << BodySamples.size()
+     << " sampled lines\n";
+  std::vector<std::pair<LineLocation, unsigned> > Lines;
+  getSortedBodySamples(Lines);
+  for (unsigned I = 0, E = Lines.size(); I != E; ++I)
+    OS << "\tline offset: " << Lines[I].first.LineOffset
+       << ", discriminator: " << Lines[I].first.Discriminator
+       << ", number of samples: " << Lines[I].second << "\n";
+  OS << "\n";
+}
@@ -0,0 +1,256 @@
+//=-- SampleProfReader.cpp - Sampling profile reader -----------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for reading sample profiles in the text and the
+// indexed binary formats.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Regex.h"
+
+#include <cctype>
+#include <limits>
+
+using namespace llvm;
+
+error_code SampleProfileReader::create(
+    std::string Path, std::unique_ptr<SampleProfileReader> &Result) {
+  std::unique_ptr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFileOrSTDIN(Path, Buffer))
+    return EC;
+  if (Buffer->getBufferSize() > std::numeric_limits<unsigned>::max())
+    return sampleprof_error::too_large;
+
+  if (IndexedSampleProfileReader::hasFormat(*Buffer))
+    Result.reset(new IndexedSampleProfileReader(std::move(Buffer)));
+  else
+    Result.reset(new TextSampleProfileReader(std::move(Buffer)));
+  return Result->read();
+}
+
+error_code SampleProfileReader::parseError(unsigned LineNumber,
+                                           const Twine &Msg) {
+  LastErrorLine = LineNumber;
+  LastErrorMessage = Msg.str();
+  return sampleprof_error::malformed;
+}
+
+error_code TextSampleProfileReader::read() {
+  line_iterator LineIt(*DataBuffer, '#');
+
+  // Read the profile of each function. Since each function may be
+  // mentioned more than once, and we are collecting flat profiles,
+  // accumulate samples as we parse them.
+  Regex HeadRE("^([^0-9].*):([0-9]+):([0-9]+)$");
+  Regex LineSample("^([0-9]+)\\.?([0-9]+)?: ([0-9]+)(.*)$");
+  while (!LineIt.is_at_eof()) {
+    // Read the header of each function.
+    //
+    // Note that for function identifiers we are actually expecting
+    // mangled names, but we may not always get them. This happens when
+    // the compiler decides not to emit the function (e.g., it was inlined
+    // and removed). In this case, the binary will not have the linkage
+    // name for the function, so the profiler will emit the function's
+    // unmangled name, which may contain characters like ':' and '>' in its
+    // name (member functions, templates, etc).
+    //
+    // The only requirement we place on the identifier, then, is that it
+    // should not begin with a number.
+    SmallVector<StringRef, 3> Matches;
+    if (!HeadRE.match(*LineIt, &Matches))
+      return parseError(LineIt.line_number(),
+                        "Expected 'mangled_name:NUM:NUM', found " + *LineIt);
+    assert(Matches.size() == 4);
+    StringRef FName = Matches[1];
+    unsigned NumSamples, NumHeadSamples;
+    Matches[2].getAsInteger(10, NumSamples);
+    Matches[3].getAsInteger(10, NumHeadSamples);
+    FunctionSamples &FProfile = Profiles[FName];
+    FProfile.addTotalSamples(NumSamples);
+    FProfile.addHeadSamples(NumHeadSamples);
+    ++LineIt;
+
+    // Now read the body. The body of the function ends when we reach
+    // EOF or when we see the start of the next function.
+    while (!LineIt.is_at_eof() && isdigit((*LineIt)[0])) {
+      if (!LineSample.match(*LineIt, &Matches))
+        return parseError(
+            LineIt.line_number(),
+            "Expected 'NUM[.NUM]: NUM[ mangled_name:NUM]*', found " + *LineIt);
+      assert(Matches.size() == 5);
+      unsigned LineOffset, NumSamples, Discriminator = 0;
+      Matches[1].getAsInteger(10, LineOffset);
+      if (Matches[2] != "")
+        Matches[2].getAsInteger(10, Discriminator);
+      Matches[3].getAsInteger(10, NumSamples);
+
+      // FIXME: Handle called targets (in Matches[4]).
+
+      // When dealing with instruction weights, we use the value
+      // zero to indicate the absence of a sample. If we read an
+      // actual zero from the profile file, return it as 1 to
+      // avoid the confusion later on.
+      if (NumSamples == 0)
+        NumSamples = 1;
+      FProfile.addBodySamples(LineOffset, Discriminator, NumSamples);
+      ++LineIt;
+    }
+  }
+
+  return sampleprof_error::success;
+}
+
+error_code TextSampleProfileReader::getFunctionSamples(
+    StringRef FName, FunctionSamples &Samples) {
+  StringMap<FunctionSamples>::const_iterator I = Profiles.find(FName);
+  if (I == Profiles.end())
+    return sampleprof_error::unknown_function;
+  Samples = I->getValue();
+  return sampleprof_error::success;
+}
+
+error_code TextSampleProfileReader::getAllFunctionSamples(
+    StringMap<FunctionSamples> &Result) {
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Result[I->getKey()].merge(I->getValue());
+  return sampleprof_error::success;
+}
+
+SampleProfLookupTrait::hash_value_type
+SampleProfLookupTrait::ComputeHash(StringRef K) {
+  MD5 Hash;
+  Hash.update(K);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  // Use the least significant 8 bytes, as the instrumentation profile does.
+  using namespace support;
+  return endian::read<uint64_t, little, unaligned>(Result);
+}
+
+/// Decode a ULEB128 value, without reading past \p End.
+static bool readULEB128(const unsigned char *&D, const unsigned char *End,
+                        unsigned &Value) {
+  uint64_t Result = 0;
+  unsigned Shift = 0;
+  while (D != End) {
+    unsigned char Byte = *D++;
+    if (Shift < 64)
+      Result |= uint64_t(Byte & 0x7f) << Shift;
+    Shift += 7;
+    if (!(Byte & 0x80)) {
+      if (Result > std::numeric_limits<unsigned>::max())
+        return false;
+      Value = unsigned(Result);
+      return true;
+    }
+  }
+  return false;
+}
+
+SampleProfLookupTrait::data_type
+SampleProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
+                                offset_type N) {
+  const unsigned char *End = D + N;
+  data_type Result(false, FunctionSamples());
+  FunctionSamples &Samples = Result.second;
+
+  unsigned TotalSamples, HeadSamples, NumLines;
+  if (!readULEB128(D, End, TotalSamples) ||
+      !readULEB128(D, End, HeadSamples) || !readULEB128(D, End, NumLines))
+    return Result;
+  Samples.addTotalSamples(TotalSamples);
+  Samples.addHeadSamples(HeadSamples);
+
+  for (unsigned I = 0; I < NumLines; ++I) {
+    unsigned LineOffset, Discriminator, NumSamples;
+    if (!readULEB128(D, End, LineOffset) ||
+        !readULEB128(D, End, Discriminator) ||
+        !readULEB128(D, End, NumSamples) ||
+        LineOffset >= unsigned(std::numeric_limits<int>::max()))
+      return data_type(false, FunctionSamples());
+    Samples.addBodySamples(LineOffset, Discriminator, NumSamples);
+  }
+  Result.first = D == End;
+  return Result;
+}
+
+bool IndexedSampleProfileReader::hasFormat(const MemoryBuffer &DataBuffer) {
+  if (DataBuffer.getBufferSize() < 8)
+    return false;
+  using namespace support;
+  uint64_t Magic =
+      endian::read<uint64_t, little, aligned>(DataBuffer.getBufferStart());
+  return Magic == IndexedSampleProf::Magic;
+}
+
+error_code IndexedSampleProfileReader::read() {
+  const unsigned char *Start =
+      (const unsigned char *)DataBuffer->getBufferStart();
+  const unsigned char *BufferEnd =
+      (const unsigned char *)DataBuffer->getBufferEnd();
+  const unsigned char *Cur = Start;
+  if (BufferEnd - Cur < 24)
+    return sampleprof_error::truncated;
+
+  using namespace support;
+
+  // Check the magic number.
+  uint64_t Magic = endian::readNext<uint64_t, little, unaligned>(Cur);
+  if (Magic != IndexedSampleProf::Magic)
+    return sampleprof_error::bad_magic;
+
+  // Read the version.
+  uint64_t Version = endian::readNext<uint64_t, little, unaligned>(Cur);
+  if (Version != IndexedSampleProf::Version)
+    return sampleprof_error::unsupported_version;
+
+  // Read the start offset of the hash table. The buckets must be aligned and
+  // fit in the file, after the header.
+  uint64_t HashOffset = endian::readNext<uint64_t, little, unaligned>(Cur);
+  if (HashOffset < uint64_t(Cur - Start) || HashOffset % 4 ||
+      HashOffset + 2 * sizeof(uint64_t) > uint64_t(BufferEnd - Start))
+    return sampleprof_error::truncated;
+
+  // The rest of the file is an on disk hash table.
+  Index.reset(SampleProfReaderIndex::Create(Start + HashOffset, Cur, Start));
+  return sampleprof_error::success;
+}
+
+error_code IndexedSampleProfileReader::getFunctionSamples(
+    StringRef FName, FunctionSamples &Samples) {
+  SampleProfReaderIndex::iterator I = Index->find(FName);
+  if (I == Index->end())
+    return sampleprof_error::unknown_function;
+
+  SampleProfLookupTrait::data_type Data = *I;
+  if (!Data.first)
+    return sampleprof_error::malformed;
+  Samples = Data.second;
+  return sampleprof_error::success;
+}
+
+error_code IndexedSampleProfileReader::getAllFunctionSamples(
+    StringMap<FunctionSamples> &Profiles) {
+  for (SampleProfReaderIndex::key_iterator I = Index->key_begin(),
+                                           E = Index->key_end();
+       I != E; ++I) {
+    FunctionSamples Samples;
+    if (error_code EC = getFunctionSamples(*I, Samples))
+      return EC;
+    Profiles[*I].merge(Samples);
+  }
+  return sampleprof_error::success;
+}
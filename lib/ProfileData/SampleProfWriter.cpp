@@ -0,0 +1,134 @@
+//=-- SampleProfWriter.cpp - Sampling profile writer -----------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for writing sample profiles in the text and the
+// indexed binary formats.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/OnDiskHashTable.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+class SampleProfRecordTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+
+  typedef const FunctionSamples *const data_type;
+  typedef const FunctionSamples *const data_type_ref;
+
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref K) {
+    return SampleProfLookupTrait::ComputeHash(K);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+
+    offset_type N = K.size();
+    LE.write<offset_type>(N);
+
+    offset_type M = getULEB128Size(V->getTotalSamples()) +
+                    getULEB128Size(V->getHeadSamples()) +
+                    getULEB128Size(V->getBodySamples().size());
+    for (BodySampleMap::const_iterator I = V->getBodySamples().begin(),
+                                       E = V->getBodySamples().end();
+         I != E; ++I)
+      M += getULEB128Size(I->first.LineOffset) +
+           getULEB128Size(I->first.Discriminator) + getULEB128Size(I->second);
+    LE.write<offset_type>(M);
+
+    return std::make_pair(N, M);
+  }
+
+  static void EmitKey(raw_ostream &Out, key_type_ref K, offset_type N) {
+    Out.write(K.data(), N);
+  }
+
+  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V,
+                       offset_type) {
+    std::vector<std::pair<LineLocation, unsigned> > Lines;
+    V->getSortedBodySamples(Lines);
+    encodeULEB128(V->getTotalSamples(), Out);
+    encodeULEB128(V->getHeadSamples(), Out);
+    encodeULEB128(Lines.size(), Out);
+    for (unsigned I = 0, E = Lines.size(); I != E; ++I) {
+      encodeULEB128(Lines[I].first.LineOffset, Out);
+      encodeULEB128(Lines[I].first.Discriminator, Out);
+      encodeULEB128(Lines[I].second, Out);
+    }
+  }
+};
+}
+
+void SampleProfileWriter::addFunctionSamples(StringRef FName,
+                                             const FunctionSamples &Samples) {
+  Profiles[FName].merge(Samples);
+}
+
+void SampleProfileWriter::writeText(raw_ostream &OS) {
+  std::vector<StringRef> Names;
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Names.push_back(I->getKey());
+  std::sort(Names.begin(), Names.end());
+
+  std::vector<std::pair<LineLocation, unsigned> > Lines;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    const FunctionSamples &Samples = Profiles[Names[I]];
+    OS << Names[I] << ':' << Samples.getTotalSamples() << ':'
+       << Samples.getHeadSamples() << '\n';
+    Samples.getSortedBodySamples(Lines);
+    for (unsigned J = 0, JE = Lines.size(); J != JE; ++J) {
+      OS << Lines[J].first.LineOffset;
+      if (Lines[J].first.Discriminator)
+        OS << '.' << Lines[J].first.Discriminator;
+      OS << ": " << Lines[J].second << '\n';
+    }
+  }
+}
+
+void SampleProfileWriter::write(raw_fd_ostream &OS) {
+  OnDiskChainedHashTableGenerator<SampleProfRecordTrait> Generator;
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Generator.insert(I->getKey(), &I->getValue());
+
+  using namespace llvm::support;
+  endian::Writer<little> LE(OS);
+
+  // Write the header.
+  LE.write<uint64_t>(IndexedSampleProf::Magic);
+  LE.write<uint64_t>(IndexedSampleProf::Version);
+
+  // Save a space to write the hash table start location.
+  uint64_t HashTableStartLoc = OS.tell();
+  LE.write<uint64_t>(0);
+  // Write the hash table.
+  uint64_t HashTableStart = Generator.Emit(OS);
+
+  // Go back and fill in the hash table start.
+  OS.seek(HashTableStartLoc);
+  LE.write<uint64_t>(HashTableStart);
+}
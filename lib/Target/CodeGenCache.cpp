@@ -0,0 +1,205 @@
+//===-- CodeGenCache.cpp - On-disk object file cache ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the CodeGenCache class.  Every entry is a single
+// "<key>.o" file in the cache directory.  Entries are written to a temporary
+// file and renamed into place, so readers never see a partial entry.  Their
+// modification time is refreshed on every hit, which lets pruning evict the
+// least recently used entries first.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Target/CodeGenCache.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+CodeGenCache::CodeGenCache(StringRef Dir, uint64_t MaxSize)
+  : CacheDir(Dir), MaxSize(MaxSize) {
+  sys::fs::create_directories(CacheDir.str());
+}
+
+void CodeGenCache::getEntryPath(StringRef Key,
+                                SmallVectorImpl<char> &Path) const {
+  Path.clear();
+  Path.append(CacheDir.begin(), CacheDir.end());
+  sys::path::append(Path, Key + ".o");
+}
+
+/// printMCTargetOptions - Print every field of MCTargetOptions.  Keep this in
+/// sync with operator== in MCTargetOptions.h.
+static void printMCTargetOptions(raw_ostream &OS, const MCTargetOptions &MO) {
+  OS << MO.SanitizeAddress;
+}
+
+std::string CodeGenCache::computeKey(StringRef Bitcode, StringRef ModuleID,
+                                     const TargetMachine &TM,
+                                     StringRef ExtraOptions) {
+  std::string Options;
+  raw_string_ostream OS(Options);
+  const TargetOptions &TO = TM.Options;
+  OS << PACKAGE_VERSION << '\0' << ModuleID << '\0'
+     << TM.getTargetTriple() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0'
+     << TM.getRelocationModel() << ',' << TM.getCodeModel() << ','
+     << TM.getOptLevel() << ','
+     << TO.NoFramePointerElim << TO.LessPreciseFPMADOption
+     << TO.UnsafeFPMath << TO.NoInfsFPMath << TO.NoNaNsFPMath
+     << TO.HonorSignDependentRoundingFPMathOption << TO.UseSoftFloat
+     << TO.NoZerosInBSS << TO.GuaranteedTailCallOpt << TO.DisableTailCalls
+     << TO.EnableFastISel << TO.PositionIndependentExecutable
+     << TO.UseInitArray << TO.DisableIntegratedAS
+     << TO.CompressDebugSections << TO.TrapUnreachable << ','
+     << TO.StackAlignmentOverride << ',' << TO.FloatABIType << ','
+     << TO.AllowFPOpFusion << ',' << TO.TrapFuncName << '\0'
+     << TargetMachine::getFunctionSections()
+     << TargetMachine::getDataSections() << '\0';
+  printMCTargetOptions(OS, TO.MCOptions);
+  OS << '\0';
+  TM.printOutputOptions(OS);
+  OS << '\0' << ExtraOptions;
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(Bitcode);
+  Hash.update(Options);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+std::unique_ptr<MemoryBuffer>
+CodeGenCache::acquire(StringRef Key, std::unique_ptr<LockFileManager> &Lock) {
+  SmallString<128> EntryPath;
+  getEntryPath(Key, EntryPath);
+
+  while (true) {
+    std::unique_ptr<MemoryBuffer> Object;
+    if (!MemoryBuffer::getFile(EntryPath.str(), Object, -1, false)) {
+      // Mark the entry as recently used.
+      int FD;
+      if (!sys::fs::openFileForWrite(EntryPath.str(), FD, sys::fs::F_Append)) {
+        sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+        raw_fd_ostream Closer(FD, /*shouldClose=*/true);
+      }
+      return Object;
+    }
+
+    Lock.reset(new LockFileManager(EntryPath.str()));
+    switch (Lock->getState()) {
+    case LockFileManager::LFS_Owned:
+      // We have to produce this entry ourselves.
+      return nullptr;
+
+    case LockFileManager::LFS_Error:
+      // Don't let a broken cache directory stop compilation.
+      Lock.reset();
+      return nullptr;
+
+    case LockFileManager::LFS_Shared:
+      // Someone else is producing the entry. Wait for them and look again;
+      // if they failed, try to take the lock ourselves.
+      if (Lock->waitForUnlock() == LockFileManager::Res_Timeout) {
+        Lock.reset();
+        return nullptr;
+      }
+      Lock.reset();
+      break;
+    }
+  }
+}
+
+bool CodeGenCache::store(StringRef Key, StringRef Object) {
+  SmallString<128> EntryPath;
+  getEntryPath(Key, EntryPath);
+
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(EntryPath.str() + "-%%%%%%%%.tmp", FD,
+                                TempPath))
+    return false;
+
+  {
+    raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out << Object;
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      sys::fs::remove(TempPath.str());
+      return false;
+    }
+  }
+
+  if (sys::fs::rename(TempPath.str(), EntryPath.str())) {
+    sys::fs::remove(TempPath.str());
+    return false;
+  }
+
+  prune();
+  return true;
+}
+
+namespace {
+struct CacheEntry {
+  std::string Path;
+  uint64_t Size;
+  sys::TimeValue LastUsed;
+
+  bool operator<(const CacheEntry &RHS) const {
+    return LastUsed < RHS.LastUsed;
+  }
+};
+}
+
+void CodeGenCache::prune() {
+  if (!MaxSize)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir.str(), EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (sys::path::extension(I->path()) != ".o")
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status) || !sys::fs::is_regular_file(Status))
+      continue;
+
+    CacheEntry Entry;
+    Entry.Path = I->path();
+    Entry.Size = Status.getSize();
+    Entry.LastUsed = Status.getLastModificationTime();
+    TotalSize += Entry.Size;
+    Entries.push_back(Entry);
+  }
+
+  if (TotalSize <= MaxSize)
+    return;
+
+  std::sort(Entries.begin(), Entries.end());
+  for (std::vector<CacheEntry>::iterator I = Entries.begin(),
+         E = Entries.end(); I != E && TotalSize > MaxSize; ++I)
+    if (!sys::fs::remove(I->Path))
+      TotalSize -= I->Size;
+}
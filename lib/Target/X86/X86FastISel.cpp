@@ -78,7 +78,8 @@ public:
 private:
   bool X86FastEmitCompare(const Value *LHS, const Value *RHS, EVT VT);
 
-  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR);
+  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR,
+                       bool Aligned = false);
 
   bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM,
                         bool Aligned = false);
@@ -114,6 +115,8 @@ private:
   bool X86SelectFPExt(const Instruction *I);
   bool X86SelectFPTrunc(const Instruction *I);
 
+  bool X86SelectBitCast(const Instruction *I);
+
   bool X86VisitIntrinsicCall(const IntrinsicInst &I);
   bool X86SelectCall(const Instruction *I);
 
@@ -180,7 +183,7 @@ bool X86FastISel::isTypeLegal(Type *Ty, MVT &VT, bool AllowI1) {
 /// The address is either pre-computed, i.e. Ptr, or a GlobalAddress, i.e. GV.
 /// Return true and the result register by reference if it is possible.
 bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
-                                  unsigned &ResultReg) {
+                                  unsigned &ResultReg, bool Aligned) {
   // Get opcode and regclass of the output for the given load instruction.
   unsigned Opc = 0;
   const TargetRegisterClass *RC = nullptr;
@@ -225,6 +228,30 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+    if (Aligned)
+      Opc = Subtarget->hasAVX() ? X86::VMOVAPSrm : X86::MOVAPSrm;
+    else
+      Opc = Subtarget->hasAVX() ? X86::VMOVUPSrm : X86::MOVUPSrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v2f64:
+    if (Aligned)
+      Opc = Subtarget->hasAVX() ? X86::VMOVAPDrm : X86::MOVAPDrm;
+    else
+      Opc = Subtarget->hasAVX() ? X86::VMOVUPDrm : X86::MOVUPDrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    if (Aligned)
+      Opc = Subtarget->hasAVX() ? X86::VMOVDQArm : X86::MOVDQArm;
+    else
+      Opc = Subtarget->hasAVX() ? X86::VMOVDQUrm : X86::MOVDQUrm;
+    RC  = &X86::VR128RegClass;
+    break;
   }
 
   ResultReg = createResultReg(RC);
@@ -880,7 +907,7 @@ bool X86FastISel::X86SelectRet(const Instruction *I) {
     unsigned Reg = X86MFInfo->getSRetReturnReg();
     assert(Reg &&
            "SRetReturnReg should have been set in LowerFormalArguments()!");
-    unsigned RetReg = Subtarget->is64Bit() ? X86::RAX : X86::EAX;
+    unsigned RetReg = Subtarget->isTarget64BitLP64() ? X86::RAX : X86::EAX;
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, TII.get(TargetOpcode::COPY),
             RetReg).addReg(Reg);
     RetRegs.push_back(RetReg);
@@ -905,12 +932,16 @@ bool X86FastISel::X86SelectLoad(const Instruction *I)  {
   if (!isTypeLegal(I->getType(), VT, /*AllowI1=*/true))
     return false;
 
+  const LoadInst *LI = cast<LoadInst>(I);
+  unsigned ABIAlignment = DL.getABITypeAlignment(LI->getType());
+  bool Aligned = LI->getAlignment() == 0 || LI->getAlignment() >= ABIAlignment;
+
   X86AddressMode AM;
   if (!X86SelectAddress(I->getOperand(0), AM))
     return false;
 
   unsigned ResultReg = 0;
-  if (X86FastEmitLoad(VT, AM, ResultReg)) {
+  if (X86FastEmitLoad(VT, AM, ResultReg, Aligned)) {
     UpdateValueMap(I, ResultReg);
     return true;
   }
@@ -1562,6 +1593,25 @@ bool X86FastISel::X86SelectFPTrunc(const Instruction *I) {
   return false;
 }
 
+/// X86SelectBitCast - Bitcasts between 128-bit vector types are free: all of
+/// them live in VR128.
+bool X86FastISel::X86SelectBitCast(const Instruction *I) {
+  MVT SrcVT, DstVT;
+  if (!isTypeLegal(I->getOperand(0)->getType(), SrcVT) ||
+      !isTypeLegal(I->getType(), DstVT))
+    return false;
+
+  if (!SrcVT.is128BitVector() || !DstVT.is128BitVector())
+    return false;
+
+  unsigned Reg = getRegForValue(I->getOperand(0));
+  if (Reg == 0)
+    return false;
+
+  UpdateValueMap(I, Reg);
+  return true;
+}
+
 bool X86FastISel::X86SelectTrunc(const Instruction *I) {
   EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
   EVT DstVT = TLI.getValueType(I->getType());
@@ -1726,12 +1776,31 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, TII.get(X86::TRAP));
     return true;
   }
+  case Intrinsic::sqrt: {
+    MVT VT;
+    if (!isTypeLegal(I.getType(), VT) || !isScalarFPTypeInSSEReg(VT))
+      return false;
+
+    unsigned SrcReg = getRegForValue(I.getArgOperand(0));
+    if (SrcReg == 0)
+      return false;
+
+    // This only succeeds where the target has a plain sqrtss/sqrtsd pattern.
+    unsigned ResultReg = FastEmit_r(VT, VT, ISD::FSQRT, SrcReg,
+                                    /*Kill=*/false);
+    if (ResultReg == 0)
+      return false;
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
   case Intrinsic::sadd_with_overflow:
-  case Intrinsic::uadd_with_overflow: {
+  case Intrinsic::uadd_with_overflow:
+  case Intrinsic::ssub_with_overflow:
+  case Intrinsic::usub_with_overflow: {
     // FIXME: Should fold immediates.
 
-    // Replace "add with overflow" intrinsics with an "add" instruction followed
-    // by a seto/setc instruction.
+    // Replace "add/sub with overflow" intrinsics with an "add" or "sub"
+    // instruction followed by a seto/setc instruction.
     const Function *Callee = I.getCalledFunction();
     Type *RetTy =
       cast<StructType>(Callee->getReturnType())->getTypeAtIndex(unsigned(0));
@@ -1749,11 +1818,13 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
       // FIXME: Handle values *not* in registers.
       return false;
 
+    bool IsSub = I.getIntrinsicID() == Intrinsic::ssub_with_overflow ||
+                 I.getIntrinsicID() == Intrinsic::usub_with_overflow;
     unsigned OpC = 0;
     if (VT == MVT::i32)
-      OpC = X86::ADD32rr;
+      OpC = IsSub ? X86::SUB32rr : X86::ADD32rr;
     else if (VT == MVT::i64)
-      OpC = X86::ADD64rr;
+      OpC = IsSub ? X86::SUB64rr : X86::ADD64rr;
     else
       return false;
 
@@ -1764,7 +1835,8 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
       .addReg(Reg1).addReg(Reg2);
 
     unsigned Opc = X86::SETBr;
-    if (I.getIntrinsicID() == Intrinsic::sadd_with_overflow)
+    if (I.getIntrinsicID() == Intrinsic::sadd_with_overflow ||
+        I.getIntrinsicID() == Intrinsic::ssub_with_overflow)
       Opc = X86::SETOr;
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, TII.get(Opc),
             ResultReg + 1);
@@ -1793,19 +1865,24 @@ bool X86FastISel::FastLowerArguments() {
   if (!Subtarget->is64Bit())
     return false;
   
-  // Only handle simple cases. i.e. Up to 6 i32/i64 scalar arguments.
+  // Only handle simple cases. i.e. Up to 6 i32/i64 scalar arguments, and up
+  // to 8 f32/f64 arguments when they are passed in SSE registers.
+  unsigned GPRCnt = 0;
+  unsigned FPRCnt = 0;
   unsigned Idx = 1;
   for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end();
        I != E; ++I, ++Idx) {
-    if (Idx > 6)
-      return false;
-
     if (F->getAttributes().hasAttribute(Idx, Attribute::ByVal) ||
         F->getAttributes().hasAttribute(Idx, Attribute::InReg) ||
-        F->getAttributes().hasAttribute(Idx, Attribute::StructRet) ||
         F->getAttributes().hasAttribute(Idx, Attribute::Nest))
       return false;
 
+    // The sret pointer is copied into %rax on return, which needs a 64-bit
+    // pointer.  Leave x32 to SelectionDAG.
+    if (F->getAttributes().hasAttribute(Idx, Attribute::StructRet) &&
+        !Subtarget->isTarget64BitLP64())
+      return false;
+
     Type *ArgTy = I->getType();
     if (ArgTy->isStructTy() || ArgTy->isArrayTy() || ArgTy->isVectorTy())
       return false;
@@ -1815,10 +1892,20 @@ bool X86FastISel::FastLowerArguments() {
     switch (ArgVT.getSimpleVT().SimpleTy) {
     case MVT::i32:
     case MVT::i64:
+      ++GPRCnt;
+      break;
+    case MVT::f32:
+    case MVT::f64:
+      if (!isScalarFPTypeInSSEReg(ArgVT))
+        return false;
+      ++FPRCnt;
       break;
     default:
       return false;
     }
+
+    if (GPRCnt > 6 || FPRCnt > 8)
+      return false;
   }
 
   static const MCPhysReg GPR32ArgRegs[] = {
@@ -1827,15 +1914,26 @@ bool X86FastISel::FastLowerArguments() {
   static const MCPhysReg GPR64ArgRegs[] = {
     X86::RDI, X86::RSI, X86::RDX, X86::RCX, X86::R8 , X86::R9
   };
+  static const MCPhysReg XMMArgRegs[] = {
+    X86::XMM0, X86::XMM1, X86::XMM2, X86::XMM3,
+    X86::XMM4, X86::XMM5, X86::XMM6, X86::XMM7
+  };
 
-  Idx = 0;
-  const TargetRegisterClass *RC32 = TLI.getRegClassFor(MVT::i32);
-  const TargetRegisterClass *RC64 = TLI.getRegClassFor(MVT::i64);
+  GPRCnt = 0;
+  FPRCnt = 0;
+  Idx = 1;
   for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end();
        I != E; ++I, ++Idx) {
-    bool is32Bit = TLI.getValueType(I->getType()) == MVT::i32;
-    const TargetRegisterClass *RC = is32Bit ? RC32 : RC64;
-    unsigned SrcReg = is32Bit ? GPR32ArgRegs[Idx] : GPR64ArgRegs[Idx];
+    MVT VT = TLI.getSimpleValueType(I->getType());
+    const TargetRegisterClass *RC = TLI.getRegClassFor(VT);
+    unsigned SrcReg;
+    switch (VT.SimpleTy) {
+    default: llvm_unreachable("Unexpected value type.");
+    case MVT::i32: SrcReg = GPR32ArgRegs[GPRCnt++]; break;
+    case MVT::i64: SrcReg = GPR64ArgRegs[GPRCnt++]; break;
+    case MVT::f32: // fall-through
+    case MVT::f64: SrcReg = XMMArgRegs[FPRCnt++]; break;
+    }
     unsigned DstReg = FuncInfo.MF->addLiveIn(SrcReg, RC);
     // FIXME: Unfortunately it's necessary to emit a copy from the livein copy.
     // Without this, EmitLiveInCopies may eliminate the livein if its only
@@ -1845,6 +1943,12 @@ bool X86FastISel::FastLowerArguments() {
             TII.get(TargetOpcode::COPY),
             ResultReg).addReg(DstReg, getKillRegState(true));
     UpdateValueMap(I, ResultReg);
+
+    // The sret pointer has to be returned in %rax; X86SelectRet copies it
+    // from here.
+    if (F->getAttributes().hasAttribute(Idx, Attribute::StructRet))
+      FuncInfo.MF->getInfo<X86MachineFunctionInfo>()->setSRetReturnReg(
+          ResultReg);
   }
   return true;
 }
@@ -2358,6 +2462,8 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectFPExt(I);
   case Instruction::FPTrunc:
     return X86SelectFPTrunc(I);
+  case Instruction::BitCast:
+    return X86SelectBitCast(I);
   case Instruction::IntToPtr: // Deliberate fall-through.
   case Instruction::PtrToInt: {
     EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
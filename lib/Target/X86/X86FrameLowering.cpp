@@ -396,9 +396,11 @@ static bool usesTheStack(const MachineFunction &MF) {
 /// space for local variables. Also emit labels used by the exception handler to
 /// generate the exception handling frames.
 void X86FrameLowering::emitPrologue(MachineFunction &MF) const {
-  MachineBasicBlock &MBB = MF.front(); // Prologue goes in entry BB.
-  MachineBasicBlock::iterator MBBI = MBB.begin();
   MachineFrameInfo *MFI = MF.getFrameInfo();
+  // Prologue goes in entry BB, unless the function was shrink-wrapped.
+  MachineBasicBlock &MBB = MFI->getSavePoint() ? *MFI->getSavePoint()
+                                               : MF.front();
+  MachineBasicBlock::iterator MBBI = MBB.begin();
   const Function *Fn = MF.getFunction();
   const X86RegisterInfo *RegInfo = TM.getRegisterInfo();
   const X86InstrInfo &TII = *TM.getInstrInfo();
@@ -452,6 +454,7 @@ void X86FrameLowering::emitPrologue(MachineFunction &MF) const {
       !MF.shouldSplitStack()) {                         // Regular stack
     uint64_t MinSize = X86FI->getCalleeSavedFrameSize();
     if (HasFP) MinSize += SlotSize;
+    X86FI->setUsesRedZone(MinSize > 0 || StackSize > 0);
     StackSize = std::max(MinSize, StackSize > 128 ? StackSize - 128 : 0);
     MFI->setStackSize(StackSize);
   }
@@ -543,10 +546,10 @@ void X86FrameLowering::emitPrologue(MachineFunction &MF) const {
           .addCFIIndex(CFIIndex);
     }
 
-    // Mark the FramePtr as live-in in every block except the entry.
-    for (MachineFunction::iterator I = std::next(MF.begin()), E = MF.end();
-         I != E; ++I)
-      I->addLiveIn(FramePtr);
+    // Mark the FramePtr as live-in in every block except the prologue block.
+    for (MachineFunction::iterator I = MF.begin(), E = MF.end(); I != E; ++I)
+      if (&*I != &MBB)
+        I->addLiveIn(FramePtr);
   } else {
     NumBytes = StackSize - X86FI->getCalleeSavedFrameSize();
   }
@@ -722,9 +725,21 @@ void X86FrameLowering::emitEpilogue(MachineFunction &MF,
   const X86RegisterInfo *RegInfo = TM.getRegisterInfo();
   const X86InstrInfo &TII = *TM.getInstrInfo();
   MachineBasicBlock::iterator MBBI = MBB.getLastNonDebugInstr();
-  assert(MBBI != MBB.end() && "Returning block has no instructions");
-  unsigned RetOpcode = MBBI->getOpcode();
-  DebugLoc DL = MBBI->getDebugLoc();
+  // A shrink-wrapped epilogue may go in a block that falls through or
+  // branches to the return instead of returning itself.
+  bool IsReturn = MBBI != MBB.end() && MBBI->isReturn();
+  unsigned RetOpcode = 0;
+  DebugLoc DL;
+  if (IsReturn) {
+    RetOpcode = MBBI->getOpcode();
+    DL = MBBI->getDebugLoc();
+  } else {
+    assert(&MBB == MFI->getRestorePoint() &&
+           "Can only insert epilog into returning blocks");
+    MBBI = MBB.getFirstTerminator();
+    if (MBBI != MBB.end())
+      DL = MBBI->getDebugLoc();
+  }
   bool Is64Bit = STI.is64Bit();
   bool IsLP64 = STI.isTarget64BitLP64();
   bool UseLEA = STI.useLeaForSP();
@@ -733,22 +748,24 @@ void X86FrameLowering::emitEpilogue(MachineFunction &MF,
   unsigned FramePtr = RegInfo->getFrameRegister(MF);
   unsigned StackPtr = RegInfo->getStackRegister();
 
-  switch (RetOpcode) {
-  default:
-    llvm_unreachable("Can only insert epilog into returning blocks");
-  case X86::RETQ:
-  case X86::RETL:
-  case X86::RETIL:
-  case X86::RETIQ:
-  case X86::TCRETURNdi:
-  case X86::TCRETURNri:
-  case X86::TCRETURNmi:
-  case X86::TCRETURNdi64:
-  case X86::TCRETURNri64:
-  case X86::TCRETURNmi64:
-  case X86::EH_RETURN:
-  case X86::EH_RETURN64:
-    break;  // These are ok
+  if (IsReturn) {
+    switch (RetOpcode) {
+    default:
+      llvm_unreachable("Can only insert epilog into returning blocks");
+    case X86::RETQ:
+    case X86::RETL:
+    case X86::RETIL:
+    case X86::RETIQ:
+    case X86::TCRETURNdi:
+    case X86::TCRETURNri:
+    case X86::TCRETURNmi:
+    case X86::TCRETURNdi64:
+    case X86::TCRETURNri64:
+    case X86::TCRETURNmi64:
+    case X86::EH_RETURN:
+    case X86::EH_RETURN64:
+      break;  // These are ok
+    }
   }
 
   // Get the number of bytes to allocate from the FrameInfo.
@@ -800,7 +817,8 @@ void X86FrameLowering::emitEpilogue(MachineFunction &MF,
   }
   MachineBasicBlock::iterator FirstCSPop = MBBI;
 
-  DL = MBBI->getDebugLoc();
+  if (MBBI != MBB.end())
+    DL = MBBI->getDebugLoc();
 
   // If there is an ADD32ri or SUB32ri of ESP immediately before this
   // instruction, merge the two instructions.
@@ -1492,6 +1510,41 @@ void X86FrameLowering::adjustForHiPEPrologue(MachineFunction &MF) const {
 #endif
 }
 
+bool X86FrameLowering::enableShrinkWrapping(const MachineFunction &MF) const {
+  // Compact unwind and Win64 unwind info describe a prologue at the start of
+  // the function, and the tail call return address area is set up by the
+  // prologue for every return.
+  if (STI.isTargetMacho() || STI.isOSWindows() ||
+      MF.getInfo<X86MachineFunctionInfo>()->getTCReturnAddrDelta() != 0)
+    return false;
+
+  // CFI directives apply in address order, but nothing resets them after an
+  // epilogue that falls through to more code, nor on the blocks laid out
+  // after the prologue that skip it. Leave functions that get them alone.
+  return !MF.getMMI().hasDebugInfo() &&
+         !MF.getFunction()->needsUnwindTableEntry();
+}
+
+bool X86FrameLowering::canUseAsPrologue(const MachineBasicBlock &MBB) const {
+  // The stack adjustment clobbers EFLAGS.
+  return !MBB.isLiveIn(X86::EFLAGS);
+}
+
+bool X86FrameLowering::canUseAsEpilogue(const MachineBasicBlock &MBB) const {
+  // The stack adjustment clobbers EFLAGS, so it cannot go between a compare
+  // and a conditional branch, nor before a block that reads the flags.
+  for (MachineBasicBlock::const_succ_iterator SI = MBB.succ_begin(),
+       SE = MBB.succ_end(); SI != SE; ++SI)
+    if ((*SI)->isLiveIn(X86::EFLAGS))
+      return false;
+  for (MachineBasicBlock::const_iterator I = MBB.getFirstTerminator(),
+       E = MBB.end(); I != E; ++I)
+    if (!I->isReturn() && (!I->isUnconditionalBranch() ||
+                           I->isIndirectBranch()))
+      return false;
+  return true;
+}
+
 void X86FrameLowering::
 eliminateCallFramePseudoInstr(MachineFunction &MF, MachineBasicBlock &MBB,
                               MachineBasicBlock::iterator I) const {
@@ -46,6 +46,10 @@ public:
 
   void adjustForHiPEPrologue(MachineFunction &MF) const override;
 
+  bool enableShrinkWrapping(const MachineFunction &MF) const override;
+  bool canUseAsPrologue(const MachineBasicBlock &MBB) const override;
+  bool canUseAsEpilogue(const MachineBasicBlock &MBB) const override;
+
   void processFunctionBeforeCalleeSavedScan(MachineFunction &MF,
                                      RegScavenger *RS = nullptr) const override;
 
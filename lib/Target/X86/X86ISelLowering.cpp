@@ -1234,6 +1234,21 @@ void X86TargetLowering::resetOperationActions() {
       setOperationAction(ISD::MULHS,           MVT::v16i16, Legal);
 
       setOperationAction(ISD::VSELECT,         MVT::v32i8, Legal);
+
+      // VMASKMOV/VPMASKMOV. With AVX-512 the masks of 8-element vectors are
+      // legal v8i1 values, which these instructions can't take, so they are
+      // sign extended by LowerMLOAD/LowerMSTORE.
+      static const MVT MaskedVTs[] = {
+        MVT::v4i32, MVT::v4f32, MVT::v2i64, MVT::v2f64,
+        MVT::v8i32, MVT::v8f32, MVT::v4i64, MVT::v4f64
+      };
+      for (unsigned i = 0; i != array_lengthof(MaskedVTs); ++i) {
+        LegalizeAction Action =
+            Subtarget->hasAVX512() && MaskedVTs[i].getVectorNumElements() == 8
+                ? Custom : Legal;
+        setOperationAction(ISD::MLOAD,         MaskedVTs[i], Action);
+        setOperationAction(ISD::MSTORE,        MaskedVTs[i], Action);
+      }
     } else {
       setOperationAction(ISD::ADD,             MVT::v4i64, Custom);
       setOperationAction(ISD::ADD,             MVT::v8i32, Custom);
@@ -1326,6 +1341,14 @@ void X86TargetLowering::resetOperationActions() {
     setOperationAction(ISD::LOAD,               MVT::v8i64, Legal);
     setOperationAction(ISD::LOAD,               MVT::v16i32, Legal);
     setOperationAction(ISD::LOAD,               MVT::v16i1, Legal);
+    setOperationAction(ISD::MLOAD,              MVT::v16f32, Legal);
+    setOperationAction(ISD::MLOAD,              MVT::v16i32, Legal);
+    setOperationAction(ISD::MLOAD,              MVT::v8f64, Legal);
+    setOperationAction(ISD::MLOAD,              MVT::v8i64, Legal);
+    setOperationAction(ISD::MSTORE,             MVT::v16f32, Legal);
+    setOperationAction(ISD::MSTORE,             MVT::v16i32, Legal);
+    setOperationAction(ISD::MSTORE,             MVT::v8f64, Legal);
+    setOperationAction(ISD::MSTORE,             MVT::v8i64, Legal);
 
     setOperationAction(ISD::FADD,               MVT::v16f32, Legal);
     setOperationAction(ISD::FSUB,               MVT::v16f32, Legal);
@@ -10911,6 +10934,37 @@ static SDValue LowerSIGN_EXTEND_AVX512(SDValue Op, SelectionDAG &DAG) {
   return DAG.getNode(X86ISD::VTRUNC, dl, VT, Brcst);
 }
 
+/// getVectorMask - Sign extend the v8i1 mask of a 256-bit masked load or
+/// store to the vector mask that VMASKMOV/VPMASKMOV take.  Returns a null
+/// value if the mask is already a vector.
+static SDValue getVectorMask(MaskedLoadStoreSDNode *N, EVT VT,
+                             SelectionDAG &DAG) {
+  SDValue Mask = N->getMask();
+  if (Mask.getValueType().getVectorElementType() != MVT::i1)
+    return SDValue();
+  return DAG.getNode(ISD::SIGN_EXTEND, SDLoc(N),
+                     VT.changeVectorElementTypeToInteger(), Mask);
+}
+
+static SDValue LowerMLOAD(SDValue Op, SelectionDAG &DAG) {
+  MaskedLoadSDNode *N = cast<MaskedLoadSDNode>(Op.getNode());
+  SDValue Mask = getVectorMask(N, Op.getValueType(), DAG);
+  if (!Mask.getNode())
+    return SDValue();
+  return DAG.getMaskedLoad(Op.getValueType(), SDLoc(Op), N->getChain(),
+                           N->getBasePtr(), Mask, N->getSrc0(),
+                           N->getMemOperand());
+}
+
+static SDValue LowerMSTORE(SDValue Op, SelectionDAG &DAG) {
+  MaskedStoreSDNode *N = cast<MaskedStoreSDNode>(Op.getNode());
+  SDValue Mask = getVectorMask(N, N->getValue().getValueType(), DAG);
+  if (!Mask.getNode())
+    return SDValue();
+  return DAG.getMaskedStore(N->getChain(), SDLoc(Op), N->getValue(),
+                            N->getBasePtr(), Mask, N->getMemOperand());
+}
+
 static SDValue LowerSIGN_EXTEND(SDValue Op, const X86Subtarget *Subtarget,
                                 SelectionDAG &DAG) {
   MVT VT = Op->getSimpleValueType(0);
@@ -14184,6 +14238,8 @@ SDValue X86TargetLowering::LowerOperation(SDValue Op, SelectionDAG &DAG) const {
   case ISD::TRUNCATE:           return LowerTRUNCATE(Op, DAG);
   case ISD::ZERO_EXTEND:        return LowerZERO_EXTEND(Op, Subtarget, DAG);
   case ISD::SIGN_EXTEND:        return LowerSIGN_EXTEND(Op, Subtarget, DAG);
+  case ISD::MLOAD:              return LowerMLOAD(Op, DAG);
+  case ISD::MSTORE:             return LowerMSTORE(Op, DAG);
   case ISD::ANY_EXTEND:         return LowerANY_EXTEND(Op, Subtarget, DAG);
   case ISD::FP_TO_SINT:         return LowerFP_TO_SINT(Op, DAG);
   case ISD::FP_TO_UINT:         return LowerFP_TO_UINT(Op, DAG);
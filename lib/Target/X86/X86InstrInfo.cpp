@@ -4272,6 +4272,51 @@ breakPartialRegDependency(MachineBasicBlock::iterator MI, unsigned OpNum,
   MI->addRegisterKilled(Reg, TRI, true);
 }
 
+bool
+X86InstrInfo::isFunctionSafeToOutlineFrom(const MachineFunction &MF) const {
+  // Outlined functions are called with a 32-bit pc-relative call.
+  if (!TM.getSubtarget<X86Subtarget>().is64Bit() ||
+      TM.getCodeModel() == CodeModel::Large)
+    return false;
+  // The return address pushed by the call would overwrite the red zone.
+  return !MF.getInfo<X86MachineFunctionInfo>()->getUsesRedZone();
+}
+
+bool X86InstrInfo::isLegalToOutline(const MachineInstr &MI) const {
+  if (MI.isTerminator() || MI.isCall() || MI.isReturn() || MI.isPosition() ||
+      MI.isDebugValue() || MI.isInlineAsm() || MI.isKill() ||
+      MI.isImplicitDef() || MI.hasUnmodeledSideEffects())
+    return false;
+
+  // The call moves the stack pointer, so anything relative to it would be off
+  // by the size of the return address.
+  if (MI.readsRegister(X86::RSP, &RI) || MI.modifiesRegister(X86::RSP, &RI))
+    return false;
+
+  // Blocks, frame indices, constant pools, jump tables and symbol names
+  // belong to the function the instruction is in.
+  for (unsigned i = 0, e = MI.getNumOperands(); i != e; ++i) {
+    const MachineOperand &MO = MI.getOperand(i);
+    if (MO.isMBB() || MO.isFI() || MO.isCPI() || MO.isJTI() ||
+        MO.isTargetIndex() || MO.isBlockAddress() || MO.isMCSymbol() ||
+        MO.isSymbol())
+      return false;
+  }
+  return true;
+}
+
+MachineInstr *
+X86InstrInfo::insertOutlinedCall(MachineBasicBlock &MBB,
+                                 MachineBasicBlock::iterator InsertPt,
+                                 const Function &Callee, DebugLoc DL) const {
+  return BuildMI(MBB, InsertPt, DL, get(X86::CALL64pcrel32))
+    .addGlobalAddress(&Callee);
+}
+
+void X86InstrInfo::insertOutlinedReturn(MachineBasicBlock &MBB) const {
+  BuildMI(MBB, MBB.end(), DebugLoc(), get(X86::RETQ));
+}
+
 MachineInstr*
 X86InstrInfo::foldMemoryOperandImpl(MachineFunction &MF, MachineInstr *MI,
                                     const SmallVectorImpl<unsigned> &Ops,
@@ -383,6 +383,14 @@ public:
   void breakPartialRegDependency(MachineBasicBlock::iterator MI, unsigned OpNum,
                                  const TargetRegisterInfo *TRI) const override;
 
+  bool isFunctionSafeToOutlineFrom(const MachineFunction &MF) const override;
+  bool isLegalToOutline(const MachineInstr &MI) const override;
+  MachineInstr *insertOutlinedCall(MachineBasicBlock &MBB,
+                                   MachineBasicBlock::iterator InsertPt,
+                                   const Function &Callee,
+                                   DebugLoc DL) const override;
+  void insertOutlinedReturn(MachineBasicBlock &MBB) const override;
+
   MachineInstr* foldMemoryOperandImpl(MachineFunction &MF,
                                       MachineInstr* MI,
                                       unsigned OpNum,
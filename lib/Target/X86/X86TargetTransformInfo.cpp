@@ -90,6 +90,9 @@ public:
   PopcntSupportKind getPopcntSupport(unsigned TyWidth) const override;
   void getUnrollingPreferences(Loop *L,
                                UnrollingPreferences &UP) const override;
+  unsigned getCacheLineSize() const override;
+  unsigned getCacheMissLatency() const override;
+  unsigned getMinPrefetchStride() const override;
 
   /// @}
 
@@ -99,6 +102,8 @@ public:
   unsigned getNumberOfRegisters(bool Vector) const override;
   unsigned getRegisterBitWidth(bool Vector) const override;
   unsigned getMaximumUnrollFactor() const override;
+  bool isLegalMaskedLoad(Type *DataType) const override;
+  bool isLegalMaskedStore(Type *DataType) const override;
   unsigned getArithmeticInstrCost(unsigned Opcode, Type *Ty, OperandValueKind,
                                   OperandValueKind) const override;
   unsigned getShuffleCost(ShuffleKind Kind, Type *Tp,
@@ -111,6 +116,12 @@ public:
                               unsigned Index) const override;
   unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
                            unsigned AddressSpace) const override;
+  unsigned getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                 unsigned Alignment,
+                                 unsigned AddressSpace) const override;
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor, unsigned Alignment,
+                                      unsigned AddressSpace) const override;
 
   unsigned getAddressComputationCost(Type *PtrTy,
                                      bool IsComplex) const override;
@@ -241,6 +252,21 @@ void X86TTI::getUnrollingPreferences(Loop *L, UnrollingPreferences &UP) const {
     UP.MaxCount = (MaxBranches-1)/(MaxDepth-1);
 }
 
+unsigned X86TTI::getCacheLineSize() const {
+  return 64;
+}
+
+unsigned X86TTI::getCacheMissLatency() const {
+  // A miss to memory costs a few hundred cycles on current cores.
+  return 200;
+}
+
+unsigned X86TTI::getMinPrefetchStride() const {
+  // The stride prefetchers track strides of up to 2KB; beyond that they
+  // cannot follow the stream.
+  return 2048;
+}
+
 unsigned X86TTI::getNumberOfRegisters(bool Vector) const {
   if (Vector && !ST->hasSSE1())
     return 0;
@@ -275,6 +301,28 @@ unsigned X86TTI::getMaximumUnrollFactor() const {
   return 2;
 }
 
+/// For a scalar \p DataType, check whether a vector of it as wide as the
+/// vector registers the vectorizer uses can be masked.
+static EVT getMaskedDataVT(const TargetLoweringBase *TLI, unsigned VecBits,
+                           Type *DataType) {
+  if (DataType->isVectorTy())
+    return TLI->getValueType(DataType, true);
+  unsigned EltBits = DataType->getPrimitiveSizeInBits();
+  if (EltBits == 0 || EltBits > VecBits)
+    return MVT::Other;
+  return TLI->getValueType(VectorType::get(DataType, VecBits / EltBits), true);
+}
+
+bool X86TTI::isLegalMaskedLoad(Type *DataType) const {
+  EVT VT = getMaskedDataVT(TLI, getRegisterBitWidth(true), DataType);
+  return VT.isVector() && TLI->isOperationLegalOrCustom(ISD::MLOAD, VT);
+}
+
+bool X86TTI::isLegalMaskedStore(Type *DataType) const {
+  EVT VT = getMaskedDataVT(TLI, getRegisterBitWidth(true), DataType);
+  return VT.isVector() && TLI->isOperationLegalOrCustom(ISD::MSTORE, VT);
+}
+
 unsigned X86TTI::getArithmeticInstrCost(unsigned Opcode, Type *Ty,
                                         OperandValueKind Op1Info,
                                         OperandValueKind Op2Info) const {
@@ -818,6 +866,40 @@ unsigned X86TTI::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
   return Cost;
 }
 
+unsigned X86TTI::getMaskedMemoryOpCost(unsigned Opcode, Type *Src,
+                                       unsigned Alignment,
+                                       unsigned AddressSpace) const {
+  bool IsLoad = Opcode == Instruction::Load;
+  if (IsLoad ? isLegalMaskedLoad(Src) : isLegalMaskedStore(Src))
+    return getMemoryOpCost(Opcode, Src, Alignment, AddressSpace);
+
+  // Otherwise CodeGenPrepare expands the operation into a conditional branch
+  // around a scalar access for every element.
+  unsigned NumElem = Src->getVectorNumElements();
+  unsigned ScalarCost = getMemoryOpCost(Opcode, Src->getScalarType(),
+                                        Alignment, AddressSpace) +
+                        getCFInstrCost(Instruction::Br);
+  return NumElem * ScalarCost + getScalarizationOverhead(Src, IsLoad, !IsLoad);
+}
+
+unsigned X86TTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  // Pairs and quads of 32 and 64 bit elements are split apart or merged with
+  // one shufps/unpck style shuffle per member and legal register.
+  if (ST->hasSSE2() && (Factor == 2 || Factor == 4) &&
+      VecTy->getScalarSizeInBits() >= 32) {
+    std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(VecTy);
+    return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+           Factor * LT.first;
+  }
+
+  return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy, Factor,
+                                                         Alignment,
+                                                         AddressSpace);
+}
+
 unsigned X86TTI::getAddressComputationCost(Type *Ty, bool IsComplex) const {
   // Address computations in vectorized code with non-consecutive addresses will
   // likely result in more instructions compared to scalar code where the
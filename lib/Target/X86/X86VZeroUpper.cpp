@@ -153,6 +153,18 @@ static bool callClobbersAnyYmmReg(MachineInstr *MI) {
   return false;
 }
 
+/// callClobbersAllYmmRegs() - Check if every YMM register is clobbered by this
+/// call.
+static bool callClobbersAllYmmRegs(MachineInstr *MI) {
+  assert(MI->isCall() && "Can only be called on call instructions.");
+  for (unsigned i = 0, e = MI->getNumOperands(); i != e; ++i) {
+    const MachineOperand &MO = MI->getOperand(i);
+    if (MO.isRegMask() && !clobbersAllYmmRegs(MO))
+      return false;
+  }
+  return true;
+}
+
 // Insert a vzeroupper instruction before I.
 void VZeroUpperInserter::insertVZeroUpper(MachineBasicBlock::iterator I,
                                               MachineBasicBlock &MBB) {
@@ -207,6 +219,12 @@ void VZeroUpperInserter::processBasicBlock(MachineBasicBlock &MBB) {
     if (MI->isCall() && !callClobbersAnyYmmReg(MI))
       continue;
 
+    // A call that preserves some YMM registers, such as one whose register
+    // mask was tightened by interprocedural register allocation, may have YMM
+    // values live across it, which a VZEROUPPER would corrupt.
+    if (MI->isCall() && !callClobbersAllYmmRegs(MI))
+      continue;
+
     // The VZEROUPPER instruction resets the upper 128 bits of all Intel AVX
     // registers. This instruction has zero latency. In addition, the processor
     // changes back to Clean state, after which execution of Intel SSE
@@ -0,0 +1,339 @@
+//===- FunctionOrdering.cpp - Profile driven function layout --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass reorders the functions of a module so that functions which call
+// each other often end up next to each other, and marks the functions that
+// run often 'hot' and the ones that almost never run 'cold'. The code
+// generator puts them in .text.hot and .text.unlikely, so the hot code of a
+// program is packed into as few pages as possible.
+//
+// The number of times each function is entered is estimated by walking the
+// call graph top-down: functions that can be called from outside the module
+// are entered once, and every call site adds the count of its caller scaled
+// by the frequency of the call relative to the caller's entry. The block
+// frequencies take the branch weights from profiles into account, so with a
+// profile the estimates follow the training run.
+//
+// The ordering is the one from "Profile Guided Code Positioning" by Pettis
+// and Hansen: every function starts in a chain of its own, and the chains
+// at the two ends of the heaviest remaining call edge are merged, reversing
+// them if needed to bring the caller and the callee closer together.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+#define DEBUG_TYPE "function-order"
+
+STATISTIC(NumHotFunctions, "Number of functions marked hot");
+STATISTIC(NumColdFunctions, "Number of functions marked cold");
+STATISTIC(NumChainsMerged, "Number of function chains merged");
+
+static cl::opt<unsigned>
+HotCallCount("function-order-hot-calls", cl::init(100), cl::Hidden,
+             cl::desc("A function is hot if it is estimated to be called "
+                      "at least this many times per entry into the module"));
+
+static cl::opt<unsigned>
+ColdCallRatio("function-order-cold-ratio", cl::init(1000), cl::Hidden,
+              cl::desc("A function is cold if it is estimated to be called "
+                       "at most once per this many entries into the module"));
+
+namespace {
+/// A direct call from one function of the module to another, weighted by
+/// the estimated number of times it runs.
+struct CallEdge {
+  unsigned Caller, Callee;
+  /// The number of times the call runs per entry into the caller.
+  double Frequency;
+  /// The estimated number of times the call runs, once the caller's count
+  /// is known.
+  double Weight;
+
+  CallEdge(unsigned Caller, unsigned Callee, double Frequency)
+      : Caller(Caller), Callee(Callee), Frequency(Frequency), Weight(0) {}
+};
+
+class FunctionOrdering : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  FunctionOrdering() : ModulePass(ID) {
+    initializeFunctionOrderingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.addRequired<CallGraphWrapperPass>();
+  }
+
+private:
+  /// The functions defined in the module, in their original order.
+  std::vector<Function *> Functions;
+  DenseMap<const Function *, unsigned> FunctionIndex;
+  /// The estimated size and entry count of each function.
+  std::vector<unsigned> Sizes;
+  std::vector<double> Counts;
+  std::vector<CallEdge> Edges;
+
+  void collectCallEdges(Function &F);
+  void estimateCounts(CallGraph &CG);
+  bool markHotAndColdFunctions();
+  void orderFunctions(std::vector<Function *> &Order);
+};
+}
+
+char FunctionOrdering::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionOrdering, "function-order",
+                      "Profile driven function ordering", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
+INITIALIZE_PASS_END(FunctionOrdering, "function-order",
+                    "Profile driven function ordering", false, false)
+
+ModulePass *llvm::createFunctionOrderingPass() {
+  return new FunctionOrdering();
+}
+
+/// Record the size of \p F and the direct calls it makes to the functions
+/// defined in the module.
+void FunctionOrdering::collectCallEdges(Function &F) {
+  unsigned Caller = FunctionIndex[&F];
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  double EntryFreq = BFI.getEntryFreq();
+
+  // Merge the calls to the same callee.
+  DenseMap<unsigned, double> CalleeFrequency;
+  unsigned Size = 0;
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    double Freq = BFI.getBlockFreq(BB).getFrequency() / EntryFreq;
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      ++Size;
+      CallSite CS(I);
+      if (!CS)
+        continue;
+      Function *Callee = CS.getCalledFunction();
+      if (!Callee)
+        continue;
+      DenseMap<const Function *, unsigned>::iterator It =
+          FunctionIndex.find(Callee);
+      if (It != FunctionIndex.end())
+        CalleeFrequency[It->second] += Freq;
+    }
+  }
+  Sizes[Caller] = Size;
+
+  for (DenseMap<unsigned, double>::iterator I = CalleeFrequency.begin(),
+                                            E = CalleeFrequency.end();
+       I != E; ++I)
+    Edges.push_back(CallEdge(Caller, I->first, I->second));
+}
+
+/// Estimate the number of times each function is entered, per entry into
+/// the module, visiting callers before their callees. Calls within a cycle
+/// of the call graph do not add to the counts of the functions in it.
+void FunctionOrdering::estimateCounts(CallGraph &CG) {
+  std::vector<std::vector<unsigned> > SCCs;
+  std::vector<unsigned> SCCOf(Functions.size());
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    std::vector<unsigned> SCC;
+    const std::vector<CallGraphNode *> &Nodes = *I;
+    for (unsigned i = 0, e = Nodes.size(); i != e; ++i) {
+      DenseMap<const Function *, unsigned>::iterator It =
+          FunctionIndex.find(Nodes[i]->getFunction());
+      if (It == FunctionIndex.end())
+        continue;
+      SCCOf[It->second] = SCCs.size();
+      SCC.push_back(It->second);
+    }
+    SCCs.push_back(SCC);
+  }
+
+  std::vector<std::vector<unsigned> > Incoming(Functions.size());
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i)
+    Incoming[Edges[i].Callee].push_back(i);
+
+  // The SCCs come out of the iterator callees first.
+  for (unsigned S = SCCs.size(); S-- != 0;) {
+    const std::vector<unsigned> &SCC = SCCs[S];
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+      unsigned Idx = SCC[i];
+      Function *F = Functions[Idx];
+      double Count = 0;
+      if (!F->hasLocalLinkage() || F->hasAddressTaken())
+        Count = 1;
+      for (unsigned j = 0, je = Incoming[Idx].size(); j != je; ++j) {
+        const CallEdge &Edge = Edges[Incoming[Idx][j]];
+        if (SCCOf[Edge.Caller] != S)
+          Count += Counts[Edge.Caller] * Edge.Frequency;
+      }
+      Counts[Idx] = Count;
+    }
+  }
+
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i)
+    Edges[i].Weight = Counts[Edges[i].Caller] * Edges[i].Frequency;
+}
+
+bool FunctionOrdering::markHotAndColdFunctions() {
+  bool Changed = false;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    Function *F = Functions[i];
+    if (F->hasFnAttribute(Attribute::Hot) ||
+        F->hasFnAttribute(Attribute::Cold))
+      continue;
+    if (Counts[i] >= HotCallCount) {
+      F->addFnAttr(Attribute::Hot);
+      ++NumHotFunctions;
+      Changed = true;
+    } else if (Counts[i] * ColdCallRatio <= 1) {
+      F->addFnAttr(Attribute::Cold);
+      ++NumColdFunctions;
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+static bool compareEdgeWeights(const CallEdge &L, const CallEdge &R) {
+  return L.Weight > R.Weight;
+}
+
+/// Compute the new order of the functions with the Pettis-Hansen
+/// algorithm. Cold functions are not merged into chains and are placed
+/// last, in their original order.
+void FunctionOrdering::orderFunctions(std::vector<Function *> &Order) {
+  std::vector<std::vector<unsigned> > Chains(Functions.size());
+  std::vector<unsigned> ChainOf(Functions.size());
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    Chains[i].push_back(i);
+    ChainOf[i] = i;
+  }
+
+  std::stable_sort(Edges.begin(), Edges.end(), compareEdgeWeights);
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i) {
+    const CallEdge &Edge = Edges[i];
+    if (Edge.Weight <= 0)
+      break;
+    unsigned A = ChainOf[Edge.Caller], B = ChainOf[Edge.Callee];
+    if (A == B || Functions[Edge.Caller]->hasFnAttribute(Attribute::Cold) ||
+        Functions[Edge.Callee]->hasFnAttribute(Attribute::Cold))
+      continue;
+
+    // Measure how far the caller is from each end of its chain, and the
+    // callee from each end of its own, and pick the orientation of the two
+    // chains that puts the fewest instructions between them.
+    unsigned ABefore = 0, AAfter = 0, BBefore = 0, BAfter = 0;
+    bool Seen = false;
+    for (unsigned j = 0, je = Chains[A].size(); j != je; ++j) {
+      unsigned Idx = Chains[A][j];
+      if (Idx == Edge.Caller)
+        Seen = true;
+      else
+        (Seen ? AAfter : ABefore) += Sizes[Idx];
+    }
+    Seen = false;
+    for (unsigned j = 0, je = Chains[B].size(); j != je; ++j) {
+      unsigned Idx = Chains[B][j];
+      if (Idx == Edge.Callee)
+        Seen = true;
+      else
+        (Seen ? BAfter : BBefore) += Sizes[Idx];
+    }
+    bool ReverseA = ABefore < AAfter;
+    bool ReverseB = BAfter < BBefore;
+    if (ReverseA)
+      std::reverse(Chains[A].begin(), Chains[A].end());
+    if (ReverseB)
+      std::reverse(Chains[B].begin(), Chains[B].end());
+
+    for (unsigned j = 0, je = Chains[B].size(); j != je; ++j)
+      ChainOf[Chains[B][j]] = A;
+    Chains[A].insert(Chains[A].end(), Chains[B].begin(), Chains[B].end());
+    Chains[B].clear();
+    ++NumChainsMerged;
+  }
+
+  // Order the chains by their hottest function; the chains are numbered
+  // by the original position of their first function, which breaks ties.
+  std::vector<std::pair<double, unsigned> > ChainOrder;
+  for (unsigned i = 0, e = Chains.size(); i != e; ++i) {
+    if (Chains[i].empty())
+      continue;
+    double MaxCount = 0;
+    for (unsigned j = 0, je = Chains[i].size(); j != je; ++j)
+      MaxCount = std::max(MaxCount, Counts[Chains[i][j]]);
+    if (Chains[i].size() == 1 &&
+        Functions[Chains[i][0]]->hasFnAttribute(Attribute::Cold))
+      MaxCount = -1;
+    ChainOrder.push_back(std::make_pair(-MaxCount, i));
+  }
+  std::sort(ChainOrder.begin(), ChainOrder.end());
+
+  for (unsigned i = 0, e = ChainOrder.size(); i != e; ++i) {
+    const std::vector<unsigned> &Chain = Chains[ChainOrder[i].second];
+    for (unsigned j = 0, je = Chain.size(); j != je; ++j)
+      Order.push_back(Functions[Chain[j]]);
+  }
+}
+
+bool FunctionOrdering::runOnModule(Module &M) {
+  Functions.clear();
+  FunctionIndex.clear();
+  Edges.clear();
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      FunctionIndex[F] = Functions.size();
+      Functions.push_back(F);
+    }
+  if (Functions.empty())
+    return false;
+
+  Sizes.assign(Functions.size(), 0);
+  Counts.assign(Functions.size(), 0);
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    collectCallEdges(*Functions[i]);
+  estimateCounts(getAnalysis<CallGraphWrapperPass>().getCallGraph());
+  bool Changed = markHotAndColdFunctions();
+
+  std::vector<Function *> Order;
+  orderFunctions(Order);
+  DEBUG(dbgs() << "FunctionOrdering: new order:\n";
+        for (unsigned i = 0, e = Order.size(); i != e; ++i)
+          dbgs() << "  " << Order[i]->getName() << " ("
+                 << Counts[FunctionIndex[Order[i]]] << ")\n");
+
+  // Move the functions to the end of the module in their new order.
+  Module::FunctionListType &FL = M.getFunctionList();
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    if (Order[i] != Functions[i])
+      Changed = true;
+    FL.splice(FL.end(), FL, Order[i]);
+  }
+  return Changed;
+}
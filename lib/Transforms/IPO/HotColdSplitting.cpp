@@ -0,0 +1,227 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines the cold regions of functions into separate functions,
+// so that the hot code left behind is denser in the instruction cache and
+// the iTLB. A block is cold if its frequency, which takes branch weight
+// metadata from profiles into account, is a small fraction of the function's
+// entry frequency, or if it calls a function marked 'cold' or ends in
+// 'unreachable'.
+//
+// Cold blocks are grouped into single-entry regions, each headed by a cold
+// block and made of cold blocks it dominates, and large enough regions are
+// extracted with the CodeExtractor. The outlined functions are marked 'cold'
+// and 'noinline'; the code generator places cold functions in .text.unlikely
+// on ELF targets.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+STATISTIC(NumColdBlocksOutlined, "Number of cold blocks outlined");
+
+static cl::opt<unsigned>
+ColdFrequencyRatio("hotcoldsplit-cold-ratio", cl::init(1000), cl::Hidden,
+                   cl::desc("A block is cold if the function's entry is at "
+                            "least this many times more frequent"));
+
+static cl::opt<unsigned>
+MinOutlineSize("hotcoldsplit-min-size", cl::init(8), cl::Hidden,
+               cl::desc("Minimum number of instructions in a cold region "
+                        "for it to be outlined"));
+
+namespace {
+class HotColdSplitting : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  HotColdSplitting() : ModulePass(ID) {
+    initializeHotColdSplittingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfo>();
+  }
+
+private:
+  typedef SmallVector<BasicBlock *, 16> Region;
+
+  bool isColdBlock(BasicBlock &BB, BlockFrequencyInfo &BFI,
+                   uint64_t EntryFreq);
+  void findColdRegions(Function &F, const SmallPtrSet<BasicBlock *, 32> &Cold,
+                       SmallVectorImpl<Region> &Regions);
+  bool splitFunction(Function &F);
+};
+}
+
+char HotColdSplitting::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplitting, "hotcoldsplit",
+                      "Hot/cold function splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(HotColdSplitting, "hotcoldsplit",
+                    "Hot/cold function splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplitting();
+}
+
+bool HotColdSplitting::isColdBlock(BasicBlock &BB, BlockFrequencyInfo &BFI,
+                                   uint64_t EntryFreq) {
+  if (isa<UnreachableInst>(BB.getTerminator()))
+    return true;
+
+  for (BasicBlock::iterator I = BB.begin(), E = BB.end(); I != E; ++I)
+    if (CallInst *CI = dyn_cast<CallInst>(I))
+      if (CI->hasFnAttr(Attribute::Cold))
+        return true;
+
+  uint64_t Freq = BFI.getBlockFreq(&BB).getFrequency();
+  if (Freq > UINT64_MAX / ColdFrequencyRatio)
+    return false;
+  return Freq * ColdFrequencyRatio <= EntryFreq;
+}
+
+/// Group the cold blocks of \p F into single-entry regions. Each region is
+/// headed by a cold block that is not in another region, and contains the
+/// cold blocks it dominates that can be reached from it through cold blocks.
+void HotColdSplitting::findColdRegions(
+    Function &F, const SmallPtrSet<BasicBlock *, 32> &Cold,
+    SmallVectorImpl<Region> &Regions) {
+  DominatorTree DT;
+  DT.recalculate(F);
+
+  SmallPtrSet<BasicBlock *, 32> Assigned;
+  // Visit headers before the blocks they dominate.
+  for (df_iterator<DomTreeNode *> DI = df_begin(DT.getRootNode()),
+                                  DE = df_end(DT.getRootNode());
+       DI != DE; ++DI) {
+    BasicBlock *Header = DI->getBlock();
+    if (!Cold.count(Header) || Assigned.count(Header))
+      continue;
+
+    // Collect the cold blocks dominated by the header that are reachable
+    // from it through cold blocks.
+    SetVector<BasicBlock *> Blocks;
+    SmallVector<BasicBlock *, 16> Worklist;
+    Blocks.insert(Header);
+    Worklist.push_back(Header);
+    while (!Worklist.empty()) {
+      BasicBlock *BB = Worklist.pop_back_val();
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI)
+        if (Cold.count(*SI) && !Assigned.count(*SI) &&
+            DT.dominates(Header, *SI) && Blocks.insert(*SI))
+          Worklist.push_back(*SI);
+    }
+
+    // Drop the blocks that can be entered from outside the region until it
+    // has a single entry.
+    bool Changed;
+    do {
+      Changed = false;
+      for (unsigned i = 1; i < Blocks.size(); ++i) {
+        BasicBlock *BB = Blocks[i];
+        for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE;
+             ++PI)
+          if (!Blocks.count(*PI)) {
+            Blocks.remove(BB);
+            Changed = true;
+            --i;
+            break;
+          }
+      }
+    } while (Changed);
+
+    unsigned Size = 0;
+    for (unsigned i = 0, e = Blocks.size(); i != e; ++i)
+      for (BasicBlock::iterator I = Blocks[i]->begin(), E = Blocks[i]->end();
+           I != E; ++I)
+        if (!isa<DbgInfoIntrinsic>(I))
+          ++Size;
+    if (Size < MinOutlineSize)
+      continue;
+
+    Assigned.insert(Blocks.begin(), Blocks.end());
+    Regions.push_back(Region(Blocks.begin(), Blocks.end()));
+  }
+}
+
+bool HotColdSplitting::splitFunction(Function &F) {
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  uint64_t EntryFreq = BFI.getEntryFreq();
+
+  // The entry block cannot be outlined, and the CodeExtractor rejects some
+  // blocks, like landing pads and blocks with allocas or invokes.
+  SmallPtrSet<BasicBlock *, 32> Cold;
+  for (Function::iterator BB = std::next(F.begin()), E = F.end(); BB != E;
+       ++BB)
+    if (isColdBlock(*BB, BFI, EntryFreq) && CodeExtractor(BB).isEligible())
+      Cold.insert(BB);
+  if (Cold.empty())
+    return false;
+
+  SmallVector<Region, 4> Regions;
+  findColdRegions(F, Cold, Regions);
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Regions.size(); i != e; ++i) {
+    unsigned NumBlocks = Regions[i].size();
+    Function *Outlined = CodeExtractor(Regions[i]).extractCodeRegion();
+    if (!Outlined)
+      continue;
+
+    Outlined->setName(F.getName() + ".cold." + Twine(i + 1));
+    Outlined->addFnAttr(Attribute::Cold);
+    Outlined->addFnAttr(Attribute::NoInline);
+    Outlined->addFnAttr(Attribute::OptimizeForSize);
+    DEBUG(dbgs() << "HotColdSplitting: Outlined " << NumBlocks
+                 << " blocks of " << F.getName() << " into "
+                 << Outlined->getName() << '\n');
+    ++NumColdRegionsOutlined;
+    NumColdBlocksOutlined += NumBlocks;
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool HotColdSplitting::runOnModule(Module &M) {
+  // Outlining adds functions to the module; only visit the original ones.
+  SmallVector<Function *, 32> Worklist;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration() && !F->hasFnAttribute(Attribute::Cold) &&
+        !F->hasFnAttribute(Attribute::OptimizeNone) &&
+        !F->hasFnAttribute(Attribute::Naked))
+      Worklist.push_back(F);
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Worklist.size(); i != e; ++i)
+    Changed |= splitFunction(*Worklist[i]);
+  return Changed;
+}
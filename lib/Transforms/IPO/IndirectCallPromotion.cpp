@@ -0,0 +1,231 @@
+//===- IndirectCallPromotion.cpp - Promote hot indirect call targets ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass uses the value profile of indirect call sites, attached by the
+// frontend as "indirect_call_targets" prof metadata, to turn
+//
+//   %r = call i32 %fp(i32 %x)
+//
+// into
+//
+//   %cmp = icmp eq i32 (i32)* %fp, @hot_target
+//   br i1 %cmp, label %direct, label %indirect
+// direct:
+//   %r1 = call i32 @hot_target(i32 %x)
+//   br label %end
+// indirect:
+//   %r2 = call i32 %fp(i32 %x)
+//   br label %end
+// end:
+//   %r = phi i32 [ %r1, %direct ], [ %r2, %indirect ]
+//
+// for the targets that account for most of the calls. The direct calls can
+// then be inlined. Invokes and musttail calls are not promoted.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "icall-promotion"
+
+STATISTIC(NumPromoted, "Number of indirect call targets promoted");
+STATISTIC(NumSitesPromoted, "Number of indirect call sites promoted");
+
+static cl::opt<unsigned>
+ICPMaxTargets("icp-max-targets", cl::init(2), cl::Hidden,
+              cl::desc("Maximum number of targets to promote at each "
+                       "indirect call site"));
+
+static cl::opt<unsigned>
+ICPMinPercent("icp-min-percent", cl::init(30), cl::Hidden,
+              cl::desc("Minimum percentage of the remaining calls at a site "
+                       "that a target needs to be promoted"));
+
+static cl::opt<unsigned long long>
+ICPMinCount("icp-min-count", cl::init(1000), cl::Hidden,
+            cl::desc("Minimum number of calls to a target for it to be "
+                     "promoted"));
+
+namespace {
+struct IndirectCallTarget {
+  StringRef Name;
+  uint64_t Count;
+};
+
+class IndirectCallPromotion : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  IndirectCallPromotion() : ModulePass(ID) {
+    initializeIndirectCallPromotionPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool promoteCallSite(Module &M, CallInst *Call);
+  CallInst *promoteTarget(CallInst *Call, Function *Target, uint64_t Count,
+                          uint64_t TotalCount);
+};
+}
+
+char IndirectCallPromotion::ID = 0;
+INITIALIZE_PASS(IndirectCallPromotion, "icall-promotion",
+                "Promote hot indirect call targets to direct calls",
+                false, false)
+
+ModulePass *llvm::createIndirectCallPromotionPass() {
+  return new IndirectCallPromotion();
+}
+
+/// Read the total count and the targets from "indirect_call_targets" prof
+/// metadata. Returns false if there is no such metadata.
+static bool
+getIndirectCallTargets(const Instruction *I, uint64_t &TotalCount,
+                       SmallVectorImpl<IndirectCallTarget> &Targets) {
+  MDNode *MD = I->getMetadata(LLVMContext::MD_prof);
+  if (!MD || MD->getNumOperands() < 2 || MD->getNumOperands() % 2)
+    return false;
+  MDString *Kind = dyn_cast<MDString>(MD->getOperand(0));
+  if (!Kind || Kind->getString() != "indirect_call_targets")
+    return false;
+  ConstantInt *Total = dyn_cast<ConstantInt>(MD->getOperand(1));
+  if (!Total)
+    return false;
+  TotalCount = Total->getZExtValue();
+
+  for (unsigned i = 2, e = MD->getNumOperands(); i != e; i += 2) {
+    MDString *Name = dyn_cast<MDString>(MD->getOperand(i));
+    ConstantInt *Count = dyn_cast<ConstantInt>(MD->getOperand(i + 1));
+    if (!Name || !Count)
+      return false;
+    IndirectCallTarget T = { Name->getString(), Count->getZExtValue() };
+    Targets.push_back(T);
+  }
+  return true;
+}
+
+/// Scale a pair of 64-bit counts down to 32-bit branch weights.
+static MDNode *createScaledBranchWeights(LLVMContext &Ctx, uint64_t TrueCount,
+                                         uint64_t FalseCount) {
+  uint64_t Max = std::max(TrueCount, FalseCount);
+  uint64_t Scale = Max > UINT32_MAX ? Max / UINT32_MAX + 1 : 1;
+  return MDBuilder(Ctx).createBranchWeights(uint32_t(TrueCount / Scale),
+                                            uint32_t(FalseCount / Scale));
+}
+
+CallInst *IndirectCallPromotion::promoteTarget(CallInst *Call,
+                                               Function *Target,
+                                               uint64_t Count,
+                                               uint64_t TotalCount) {
+  Value *Callee = Call->getCalledValue();
+  IRBuilder<> Builder(Call);
+  Value *Cond = Builder.CreateICmpEQ(
+      Callee, Builder.CreateBitCast(Target, Callee->getType()), "icp.cmp");
+
+  TerminatorInst *ThenTerm, *ElseTerm;
+  SplitBlockAndInsertIfThenElse(
+      Cond, Call, &ThenTerm, &ElseTerm,
+      createScaledBranchWeights(Call->getContext(), Count, TotalCount - Count));
+  BasicBlock *DirectBB = ThenTerm->getParent();
+  BasicBlock *IndirectBB = ElseTerm->getParent();
+  BasicBlock *MergeBB = Call->getParent();
+  DirectBB->setName("if.true.direct_targ");
+  IndirectBB->setName("if.false.orig_indirect");
+  MergeBB->setName("if.end.icp");
+
+  CallInst *DirectCall = cast<CallInst>(Call->clone());
+  DirectCall->setCalledFunction(Target);
+  DirectCall->setMetadata(LLVMContext::MD_prof, nullptr);
+  DirectCall->insertBefore(ThenTerm);
+  Call->moveBefore(ElseTerm);
+
+  if (!Call->getType()->isVoidTy() && !Call->use_empty()) {
+    PHINode *PN = PHINode::Create(Call->getType(), 2, "", MergeBB->begin());
+    Call->replaceAllUsesWith(PN);
+    PN->addIncoming(DirectCall, DirectBB);
+    PN->addIncoming(Call, IndirectBB);
+    PN->takeName(Call);
+  }
+  return DirectCall;
+}
+
+bool IndirectCallPromotion::promoteCallSite(Module &M, CallInst *Call) {
+  uint64_t TotalCount;
+  SmallVector<IndirectCallTarget, 4> Targets;
+  if (!getIndirectCallTargets(Call, TotalCount, Targets))
+    return false;
+
+  unsigned NumTargetsPromoted = 0;
+  for (unsigned i = 0, e = Targets.size(); i != e; ++i) {
+    const IndirectCallTarget &T = Targets[i];
+    if (NumTargetsPromoted == ICPMaxTargets || T.Count < ICPMinCount ||
+        T.Count > TotalCount || T.Count * 100 < TotalCount * ICPMinPercent)
+      break;
+
+    // The target must be a function of the same type as the call, or the
+    // direct call would not be valid IR.
+    Function *Target = M.getFunction(T.Name);
+    if (!Target || Target->getType() != Call->getCalledValue()->getType()) {
+      DEBUG(dbgs() << "ICP: Not promoting " << T.Name << " at " << *Call
+                   << ": no matching function\n");
+      break;
+    }
+
+    DEBUG(dbgs() << "ICP: Promoting " << T.Name << " (" << T.Count << " of "
+                 << TotalCount << " calls) at " << *Call << '\n');
+    promoteTarget(Call, Target, T.Count, TotalCount);
+    TotalCount -= T.Count;
+    ++NumTargetsPromoted;
+    ++NumPromoted;
+  }
+  if (!NumTargetsPromoted)
+    return false;
+  ++NumSitesPromoted;
+
+  // Only the calls that did not go to a promoted target remain.
+  SmallVector<std::pair<StringRef, uint64_t>, 4> Remaining;
+  for (unsigned i = NumTargetsPromoted, e = Targets.size(); i != e; ++i)
+    Remaining.push_back(std::make_pair(Targets[i].Name, Targets[i].Count));
+  Call->setMetadata(LLVMContext::MD_prof,
+                    MDBuilder(Call->getContext())
+                        .createIndirectCallTargets(TotalCount, Remaining));
+  return true;
+}
+
+bool IndirectCallPromotion::runOnModule(Module &M) {
+  // Collect the candidates first, promotion splits their blocks.
+  SmallVector<CallInst *, 16> Calls;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        if (CallInst *Call = dyn_cast<CallInst>(I))
+          if (!Call->getCalledFunction() && !Call->isInlineAsm() &&
+              !Call->isMustTailCall() &&
+              Call->getMetadata(LLVMContext::MD_prof))
+            Calls.push_back(Call);
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i)
+    Changed |= promoteCallSite(M, Calls[i]);
+  return Changed;
+}
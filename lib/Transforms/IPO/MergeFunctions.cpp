@@ -9,13 +9,15 @@
 //
 // This pass looks for equivalent functions that are mergable and folds them.
 //
-// A hash is computed from the function, based on its type and number of
-// basic blocks.
+// A structural hash is computed from the function, based on its type, the
+// opcodes of its instructions and the shape of its CFG. Functions whose hash
+// is unique in the module are never looked at again.
 //
-// Once all hashes are computed, we perform an expensive equality comparison
-// on each function pair. This takes n^2/2 comparisons per bucket, so it's
-// important that the hash function be high quality. The equality comparison
-// iterates through each instruction in each basic block.
+// The remaining functions are kept in a binary tree, ordered by hash first and
+// then by the FunctionComparator, which defines a total order on functions.
+// Inserting a function into the tree either finds the function it is equal
+// to or places it at its unique position, using O(log n) comparisons. Each
+// comparison iterates through each instruction in each basic block.
 //
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
@@ -31,9 +33,6 @@
 // the object they belong to. However, as long as it's only used for a lookup
 // and call, this is irrelevant, and we'd like to fold such functions.
 //
-// * switch from n^2 pair-wise comparisons to an n-way comparison for each
-// bucket.
-//
 // * be smarter about bitcasts.
 //
 // In order to fold functions, we will sometimes add either bitcast instructions
@@ -44,8 +43,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO.h"
-#include "llvm/ADT/DenseSet.h"
-#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
@@ -63,6 +62,8 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <set>
 #include <vector>
 using namespace llvm;
 
@@ -72,6 +73,8 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumUniqueHashes,
+          "Number of functions skipped because their hash is unique");
 
 /// Returns the type id for a type to be hashed. We turn pointer types into
 /// integers here because the actual compare logic below considers pointers and
@@ -82,79 +85,45 @@ static Type::TypeID getTypeIDForHash(Type *Ty) {
   return Ty->getTypeID();
 }
 
-/// Creates a hash-code for the function which is the same for any two
-/// functions that will compare equal, without looking at the instructions
-/// inside the function.
-static unsigned profileFunction(const Function *F) {
-  FunctionType *FTy = F->getFunctionType();
-
-  FoldingSetNodeID ID;
-  ID.AddInteger(F->size());
-  ID.AddInteger(F->getCallingConv());
-  ID.AddBoolean(F->hasGC());
-  ID.AddBoolean(FTy->isVarArg());
-  ID.AddInteger(getTypeIDForHash(FTy->getReturnType()));
+/// Creates a structural hash-code for the function which is the same for any
+/// two functions that will compare equal. It covers the signature, the
+/// opcodes and result type kinds of the instructions and the shape of the CFG,
+/// visiting the blocks in the same order as FunctionComparator::compare, so
+/// unreachable blocks are ignored here too. Types are only hashed by kind,
+/// since the comparator treats some pointers and integers as equal.
+static uint64_t functionHash(const Function &F) {
+  FunctionType *FTy = F.getFunctionType();
+
+  hash_code H = hash_combine(F.getCallingConv(), F.hasGC(), FTy->isVarArg(),
+                             getTypeIDForHash(FTy->getReturnType()));
   for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
-    ID.AddInteger(getTypeIDForHash(FTy->getParamType(i)));
-  return ID.ComputeHash();
-}
-
-namespace {
-
-/// ComparableFunction - A struct that pairs together functions with a
-/// DataLayout so that we can keep them together as elements in the DenseSet.
-class ComparableFunction {
-public:
-  static const ComparableFunction EmptyKey;
-  static const ComparableFunction TombstoneKey;
-  static DataLayout * const LookupOnly;
-
-  ComparableFunction(Function *Func, const DataLayout *DL)
-    : Func(Func), Hash(profileFunction(Func)), DL(DL) {}
-
-  Function *getFunc() const { return Func; }
-  unsigned getHash() const { return Hash; }
-  const DataLayout *getDataLayout() const { return DL; }
+    H = hash_combine(H, getTypeIDForHash(FTy->getParamType(i)));
+
+  SmallVector<const BasicBlock *, 8> BBs;
+  SmallSet<const BasicBlock *, 16> VisitedBBs;
+  BBs.push_back(&F.getEntryBlock());
+  VisitedBBs.insert(BBs[0]);
+  while (!BBs.empty()) {
+    const BasicBlock *BB = BBs.pop_back_val();
+    // This random value acts as a block header, as otherwise the partition of
+    // opcodes into BBs wouldn't affect the hash, only the order of the
+    // opcodes.
+    H = hash_combine(H, 45798);
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I) {
+      // GEPs with different indices compare equal when they compute the same
+      // offset, so their operand count must not be hashed.
+      unsigned NumOperands = isa<GetElementPtrInst>(I) ? 0 : I->getNumOperands();
+      H = hash_combine(H, I->getOpcode(), NumOperands,
+                       getTypeIDForHash(I->getType()));
+    }
 
-  // Drops AssertingVH reference to the function. Outside of debug mode, this
-  // does nothing.
-  void release() {
-    assert(Func &&
-           "Attempted to release function twice, or release empty/tombstone!");
-    Func = nullptr;
+    const TerminatorInst *Term = BB->getTerminator();
+    for (unsigned i = 0, e = Term->getNumSuccessors(); i != e; ++i)
+      if (VisitedBBs.insert(Term->getSuccessor(i)))
+        BBs.push_back(Term->getSuccessor(i));
   }
-
-private:
-  explicit ComparableFunction(unsigned Hash)
-    : Func(nullptr), Hash(Hash), DL(nullptr) {}
-
-  AssertingVH<Function> Func;
-  unsigned Hash;
-  const DataLayout *DL;
-};
-
-const ComparableFunction ComparableFunction::EmptyKey = ComparableFunction(0);
-const ComparableFunction ComparableFunction::TombstoneKey =
-    ComparableFunction(1);
-DataLayout *const ComparableFunction::LookupOnly = (DataLayout*)(-1);
-
-}
-
-namespace llvm {
-  template <>
-  struct DenseMapInfo<ComparableFunction> {
-    static ComparableFunction getEmptyKey() {
-      return ComparableFunction::EmptyKey;
-    }
-    static ComparableFunction getTombstoneKey() {
-      return ComparableFunction::TombstoneKey;
-    }
-    static unsigned getHashValue(const ComparableFunction &CF) {
-      return CF.getHash();
-    }
-    static bool isEqual(const ComparableFunction &LHS,
-                        const ComparableFunction &RHS);
-  };
+  return H;
 }
 
 namespace {
@@ -163,35 +132,46 @@ namespace {
 /// they will generate machine code with the same behaviour. DataLayout is
 /// used if available. The comparator always fails conservatively (erring on the
 /// side of claiming that two functions are different).
+///
+/// Every cmp* method defines a total ordering: it returns 0 if the two things
+/// are equivalent, -1 if the left one is less than the right one and 1
+/// otherwise. Ordering by structure first and identity last keeps the results
+/// consistent between calls, so that functions can be kept in a sorted tree
+/// and each new function needs only O(log n) comparisons.
 class FunctionComparator {
 public:
   FunctionComparator(const DataLayout *DL, const Function *F1,
                      const Function *F2)
     : F1(F1), F2(F2), DL(DL) {}
 
-  /// Test whether the two functions have equivalent behaviour.
-  bool compare();
+  /// Test whether the two functions have equivalent behaviour, and order them
+  /// otherwise.
+  int compare();
 
 private:
   /// Test whether two basic blocks have equivalent behaviour.
-  bool compare(const BasicBlock *BB1, const BasicBlock *BB2);
+  int compare(const BasicBlock *BB1, const BasicBlock *BB2);
+
+  /// Assign or look up previously assigned serial numbers for the two values,
+  /// and compare the numbers. Numbers are assigned in the order visited, so
+  /// two values compare equal iff they are first used at the same point of
+  /// the two functions. Constants, inline asm and references to the functions
+  /// being compared are compared by content instead.
+  int cmpValues(const Value *V1, const Value *V2);
 
-  /// Assign or look up previously assigned numbers for the two values, and
-  /// return whether the numbers are equal. Numbers are assigned in the order
-  /// visited.
-  bool enumerate(const Value *V1, const Value *V2);
+  /// Compare two constants. Constants of different types are only equal if
+  /// the types are losslessly bitcastable and the bit patterns match.
+  int cmpConstants(const Constant *C1, const Constant *C2);
 
   /// Compare two Instructions for equivalence, similar to
   /// Instruction::isSameOperationAs but with modifications to the type
   /// comparison.
-  bool isEquivalentOperation(const Instruction *I1,
-                             const Instruction *I2) const;
+  int cmpOperation(const Instruction *I1, const Instruction *I2) const;
 
   /// Compare two GEPs for equivalent pointer arithmetic.
-  bool isEquivalentGEP(const GEPOperator *GEP1, const GEPOperator *GEP2);
-  bool isEquivalentGEP(const GetElementPtrInst *GEP1,
-                       const GetElementPtrInst *GEP2) {
-    return isEquivalentGEP(cast<GEPOperator>(GEP1), cast<GEPOperator>(GEP2));
+  int cmpGEP(const GEPOperator *GEP1, const GEPOperator *GEP2);
+  int cmpGEP(const GetElementPtrInst *GEP1, const GetElementPtrInst *GEP2) {
+    return cmpGEP(cast<GEPOperator>(GEP1), cast<GEPOperator>(GEP2));
   }
 
   /// cmpType - compares two types,
@@ -236,19 +216,20 @@ private:
   /// 6. For all other cases put llvm_unreachable.
   int cmpType(Type *TyL, Type *TyR) const;
 
-  bool isEquivalentType(Type *Ty1, Type *Ty2) const {
-    return cmpType(Ty1, Ty2) == 0;
-  }
-
   int cmpNumbers(uint64_t L, uint64_t R) const;
+  int cmpAPInts(const APInt &L, const APInt &R) const;
+  int cmpAPFloats(const APFloat &L, const APFloat &R) const;
+  int cmpStrings(StringRef L, StringRef R) const;
+  int cmpAttrs(const AttributeSet L, const AttributeSet R) const;
+  int cmpIndices(ArrayRef<unsigned> L, ArrayRef<unsigned> R) const;
 
   // The two functions undergoing comparison.
   const Function *F1, *F2;
 
   const DataLayout *DL;
 
-  DenseMap<const Value *, const Value *> id_map;
-  DenseSet<const Value *> seen_values;
+  /// Serial numbers assigned by cmpValues to the values of each function.
+  DenseMap<const Value *, unsigned> sn_map1, sn_map2;
 };
 
 }
@@ -259,6 +240,65 @@ int FunctionComparator::cmpNumbers(uint64_t L, uint64_t R) const {
   return 0;
 }
 
+int FunctionComparator::cmpAPInts(const APInt &L, const APInt &R) const {
+  if (int Res = cmpNumbers(L.getBitWidth(), R.getBitWidth()))
+    return Res;
+  if (L.ugt(R)) return 1;
+  if (R.ugt(L)) return -1;
+  return 0;
+}
+
+int FunctionComparator::cmpAPFloats(const APFloat &L, const APFloat &R) const {
+  if (int Res = cmpNumbers((uint64_t)&L.getSemantics(),
+                           (uint64_t)&R.getSemantics()))
+    return Res;
+  return cmpAPInts(L.bitcastToAPInt(), R.bitcastToAPInt());
+}
+
+int FunctionComparator::cmpStrings(StringRef L, StringRef R) const {
+  // Prevent heavy comparison, compare sizes first.
+  if (int Res = cmpNumbers(L.size(), R.size()))
+    return Res;
+  return L.compare(R);
+}
+
+int FunctionComparator::cmpAttrs(const AttributeSet L,
+                                 const AttributeSet R) const {
+  if (int Res = cmpNumbers(L.getNumSlots(), R.getNumSlots()))
+    return Res;
+
+  for (unsigned i = 0, e = L.getNumSlots(); i != e; ++i) {
+    if (int Res = cmpNumbers(L.getSlotIndex(i), R.getSlotIndex(i)))
+      return Res;
+
+    AttributeSet::iterator LI = L.begin(i), LE = L.end(i), RI = R.begin(i),
+                           RE = R.end(i);
+    for (; LI != LE && RI != RE; ++LI, ++RI) {
+      Attribute LA = *LI;
+      Attribute RA = *RI;
+      if (LA < RA)
+        return -1;
+      if (RA < LA)
+        return 1;
+    }
+    if (LI != LE)
+      return 1;
+    if (RI != RE)
+      return -1;
+  }
+  return 0;
+}
+
+int FunctionComparator::cmpIndices(ArrayRef<unsigned> L,
+                                   ArrayRef<unsigned> R) const {
+  if (int Res = cmpNumbers(L.size(), R.size()))
+    return Res;
+  for (size_t i = 0, e = L.size(); i != e; ++i)
+    if (int Res = cmpNumbers(L[i], R[i]))
+      return Res;
+  return 0;
+}
+
 /// cmpType - compares two types,
 /// defines total ordering among the types set.
 /// See method declaration comments for more details.
@@ -351,216 +391,338 @@ int FunctionComparator::cmpType(Type *TyL, Type *TyR) const {
 // Determine whether the two operations are the same except that pointer-to-A
 // and pointer-to-B are equivalent. This should be kept in sync with
 // Instruction::isSameOperationAs.
-bool FunctionComparator::isEquivalentOperation(const Instruction *I1,
-                                               const Instruction *I2) const {
+int FunctionComparator::cmpOperation(const Instruction *I1,
+                                     const Instruction *I2) const {
   // Differences from Instruction::isSameOperationAs:
-  //  * replace type comparison with calls to isEquivalentType.
+  //  * replace type comparison with calls to cmpType.
   //  * we test for I->hasSameSubclassOptionalData (nuw/nsw/tail) at the top
   //  * because of the above, we don't test for the tail bit on calls later on
-  if (I1->getOpcode() != I2->getOpcode() ||
-      I1->getNumOperands() != I2->getNumOperands() ||
-      !isEquivalentType(I1->getType(), I2->getType()) ||
-      !I1->hasSameSubclassOptionalData(I2))
-    return false;
+  if (int Res = cmpNumbers(I1->getOpcode(), I2->getOpcode()))
+    return Res;
+
+  if (int Res = cmpNumbers(I1->getNumOperands(), I2->getNumOperands()))
+    return Res;
+
+  if (int Res = cmpType(I1->getType(), I2->getType()))
+    return Res;
+
+  if (int Res = cmpNumbers(I1->getRawSubclassOptionalData(),
+                           I2->getRawSubclassOptionalData()))
+    return Res;
 
   // We have two instructions of identical opcode and #operands.  Check to see
   // if all operands are the same type
   for (unsigned i = 0, e = I1->getNumOperands(); i != e; ++i)
-    if (!isEquivalentType(I1->getOperand(i)->getType(),
+    if (int Res = cmpType(I1->getOperand(i)->getType(),
                           I2->getOperand(i)->getType()))
-      return false;
+      return Res;
 
   // Check special state that is a part of some instructions.
-  if (const LoadInst *LI = dyn_cast<LoadInst>(I1))
-    return LI->isVolatile() == cast<LoadInst>(I2)->isVolatile() &&
-           LI->getAlignment() == cast<LoadInst>(I2)->getAlignment() &&
-           LI->getOrdering() == cast<LoadInst>(I2)->getOrdering() &&
-           LI->getSynchScope() == cast<LoadInst>(I2)->getSynchScope();
-  if (const StoreInst *SI = dyn_cast<StoreInst>(I1))
-    return SI->isVolatile() == cast<StoreInst>(I2)->isVolatile() &&
-           SI->getAlignment() == cast<StoreInst>(I2)->getAlignment() &&
-           SI->getOrdering() == cast<StoreInst>(I2)->getOrdering() &&
-           SI->getSynchScope() == cast<StoreInst>(I2)->getSynchScope();
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I1)) {
+    const LoadInst *LI2 = cast<LoadInst>(I2);
+    if (int Res = cmpNumbers(LI->isVolatile(), LI2->isVolatile()))
+      return Res;
+    if (int Res = cmpNumbers(LI->getAlignment(), LI2->getAlignment()))
+      return Res;
+    if (int Res = cmpNumbers(LI->getOrdering(), LI2->getOrdering()))
+      return Res;
+    return cmpNumbers(LI->getSynchScope(), LI2->getSynchScope());
+  }
+  if (const StoreInst *SI = dyn_cast<StoreInst>(I1)) {
+    const StoreInst *SI2 = cast<StoreInst>(I2);
+    if (int Res = cmpNumbers(SI->isVolatile(), SI2->isVolatile()))
+      return Res;
+    if (int Res = cmpNumbers(SI->getAlignment(), SI2->getAlignment()))
+      return Res;
+    if (int Res = cmpNumbers(SI->getOrdering(), SI2->getOrdering()))
+      return Res;
+    return cmpNumbers(SI->getSynchScope(), SI2->getSynchScope());
+  }
   if (const CmpInst *CI = dyn_cast<CmpInst>(I1))
-    return CI->getPredicate() == cast<CmpInst>(I2)->getPredicate();
-  if (const CallInst *CI = dyn_cast<CallInst>(I1))
-    return CI->getCallingConv() == cast<CallInst>(I2)->getCallingConv() &&
-           CI->getAttributes() == cast<CallInst>(I2)->getAttributes();
-  if (const InvokeInst *CI = dyn_cast<InvokeInst>(I1))
-    return CI->getCallingConv() == cast<InvokeInst>(I2)->getCallingConv() &&
-           CI->getAttributes() == cast<InvokeInst>(I2)->getAttributes();
+    return cmpNumbers(CI->getPredicate(), cast<CmpInst>(I2)->getPredicate());
+  if (const CallInst *CI = dyn_cast<CallInst>(I1)) {
+    const CallInst *CI2 = cast<CallInst>(I2);
+    if (int Res = cmpNumbers(CI->getCallingConv(), CI2->getCallingConv()))
+      return Res;
+    return cmpAttrs(CI->getAttributes(), CI2->getAttributes());
+  }
+  if (const InvokeInst *II = dyn_cast<InvokeInst>(I1)) {
+    const InvokeInst *II2 = cast<InvokeInst>(I2);
+    if (int Res = cmpNumbers(II->getCallingConv(), II2->getCallingConv()))
+      return Res;
+    return cmpAttrs(II->getAttributes(), II2->getAttributes());
+  }
   if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(I1))
-    return IVI->getIndices() == cast<InsertValueInst>(I2)->getIndices();
+    return cmpIndices(IVI->getIndices(),
+                      cast<InsertValueInst>(I2)->getIndices());
   if (const ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(I1))
-    return EVI->getIndices() == cast<ExtractValueInst>(I2)->getIndices();
-  if (const FenceInst *FI = dyn_cast<FenceInst>(I1))
-    return FI->getOrdering() == cast<FenceInst>(I2)->getOrdering() &&
-           FI->getSynchScope() == cast<FenceInst>(I2)->getSynchScope();
-  if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(I1))
-    return CXI->isVolatile() == cast<AtomicCmpXchgInst>(I2)->isVolatile() &&
-           CXI->getSuccessOrdering() ==
-               cast<AtomicCmpXchgInst>(I2)->getSuccessOrdering() &&
-           CXI->getFailureOrdering() ==
-               cast<AtomicCmpXchgInst>(I2)->getFailureOrdering() &&
-           CXI->getSynchScope() == cast<AtomicCmpXchgInst>(I2)->getSynchScope();
-  if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(I1))
-    return RMWI->getOperation() == cast<AtomicRMWInst>(I2)->getOperation() &&
-           RMWI->isVolatile() == cast<AtomicRMWInst>(I2)->isVolatile() &&
-           RMWI->getOrdering() == cast<AtomicRMWInst>(I2)->getOrdering() &&
-           RMWI->getSynchScope() == cast<AtomicRMWInst>(I2)->getSynchScope();
+    return cmpIndices(EVI->getIndices(),
+                      cast<ExtractValueInst>(I2)->getIndices());
+  if (const FenceInst *FI = dyn_cast<FenceInst>(I1)) {
+    const FenceInst *FI2 = cast<FenceInst>(I2);
+    if (int Res = cmpNumbers(FI->getOrdering(), FI2->getOrdering()))
+      return Res;
+    return cmpNumbers(FI->getSynchScope(), FI2->getSynchScope());
+  }
+  if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(I1)) {
+    const AtomicCmpXchgInst *CXI2 = cast<AtomicCmpXchgInst>(I2);
+    if (int Res = cmpNumbers(CXI->isVolatile(), CXI2->isVolatile()))
+      return Res;
+    if (int Res = cmpNumbers(CXI->getSuccessOrdering(),
+                             CXI2->getSuccessOrdering()))
+      return Res;
+    if (int Res = cmpNumbers(CXI->getFailureOrdering(),
+                             CXI2->getFailureOrdering()))
+      return Res;
+    return cmpNumbers(CXI->getSynchScope(), CXI2->getSynchScope());
+  }
+  if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(I1)) {
+    const AtomicRMWInst *RMWI2 = cast<AtomicRMWInst>(I2);
+    if (int Res = cmpNumbers(RMWI->getOperation(), RMWI2->getOperation()))
+      return Res;
+    if (int Res = cmpNumbers(RMWI->isVolatile(), RMWI2->isVolatile()))
+      return Res;
+    if (int Res = cmpNumbers(RMWI->getOrdering(), RMWI2->getOrdering()))
+      return Res;
+    return cmpNumbers(RMWI->getSynchScope(), RMWI2->getSynchScope());
+  }
 
-  return true;
+  return 0;
 }
 
 // Determine whether two GEP operations perform the same underlying arithmetic.
-bool FunctionComparator::isEquivalentGEP(const GEPOperator *GEP1,
-                                         const GEPOperator *GEP2) {
+int FunctionComparator::cmpGEP(const GEPOperator *GEP1,
+                               const GEPOperator *GEP2) {
   unsigned AS = GEP1->getPointerAddressSpace();
-  if (AS != GEP2->getPointerAddressSpace())
-    return false;
+  if (int Res = cmpNumbers(AS, GEP2->getPointerAddressSpace()))
+    return Res;
 
   if (DL) {
     // When we have target data, we can reduce the GEP down to the value in bytes
-    // added to the address.
-    unsigned BitWidth = DL ? DL->getPointerSizeInBits(AS) : 1;
+    // added to the address. GEPs with a constant offset come first, so that
+    // every pair is ordered by the same keys.
+    unsigned BitWidth = DL->getPointerSizeInBits(AS);
     APInt Offset1(BitWidth, 0), Offset2(BitWidth, 0);
-    if (GEP1->accumulateConstantOffset(*DL, Offset1) &&
-        GEP2->accumulateConstantOffset(*DL, Offset2)) {
-      return Offset1 == Offset2;
-    }
+    bool Const1 = GEP1->accumulateConstantOffset(*DL, Offset1);
+    bool Const2 = GEP2->accumulateConstantOffset(*DL, Offset2);
+    if (int Res = cmpNumbers(Const2, Const1))
+      return Res;
+    if (Const1)
+      return cmpAPInts(Offset1, Offset2);
   }
 
-  if (GEP1->getPointerOperand()->getType() !=
-      GEP2->getPointerOperand()->getType())
-    return false;
+  // The operand types only tell pointers apart by address space, but the
+  // pointee type scales the indices.
+  if (int Res = cmpType(
+          GEP1->getPointerOperandType()->getScalarType()
+              ->getPointerElementType(),
+          GEP2->getPointerOperandType()->getScalarType()
+              ->getPointerElementType()))
+    return Res;
 
-  if (GEP1->getNumOperands() != GEP2->getNumOperands())
-    return false;
+  if (int Res = cmpNumbers(GEP1->getNumOperands(), GEP2->getNumOperands()))
+    return Res;
 
   for (unsigned i = 0, e = GEP1->getNumOperands(); i != e; ++i) {
-    if (!enumerate(GEP1->getOperand(i), GEP2->getOperand(i)))
-      return false;
+    if (int Res = cmpValues(GEP1->getOperand(i), GEP2->getOperand(i)))
+      return Res;
   }
 
-  return true;
+  return 0;
+}
+
+int FunctionComparator::cmpConstants(const Constant *C1, const Constant *C2) {
+  Type *Ty1 = C1->getType();
+  Type *Ty2 = C2->getType();
+  int TypesRes = cmpType(Ty1, Ty2);
+  if (TypesRes != 0) {
+    // Types are different, but the constants may still have equal bit
+    // patterns if the types are losslessly bitcastable: first class vectors
+    // of the same width, or pointers in the same address space.
+    if (!Ty1->isFirstClassType() || !Ty2->isFirstClassType())
+      return TypesRes;
+
+    unsigned Width1 = 0, Width2 = 0;
+    if (const VectorType *VecTy1 = dyn_cast<VectorType>(Ty1))
+      Width1 = VecTy1->getBitWidth();
+    if (const VectorType *VecTy2 = dyn_cast<VectorType>(Ty2))
+      Width2 = VecTy2->getBitWidth();
+    if (int Res = cmpNumbers(Width1, Width2))
+      return Res;
+
+    // Zero bit-width means neither type is a vector.
+    if (!Width1) {
+      PointerType *PTy1 = dyn_cast<PointerType>(Ty1);
+      PointerType *PTy2 = dyn_cast<PointerType>(Ty2);
+      if (!PTy1 || !PTy2)
+        return TypesRes;
+      if (int Res = cmpNumbers(PTy1->getAddressSpace(),
+                               PTy2->getAddressSpace()))
+        return Res;
+    }
+  }
+
+  // The types are equal or bitcastable, now check the constant contents.
+  if (C1->isNullValue() && C2->isNullValue())
+    return TypesRes;
+  if (int Res = cmpNumbers(C2->isNullValue(), C1->isNullValue()))
+    return Res;
+
+  if (int Res = cmpNumbers(C1->getValueID(), C2->getValueID()))
+    return Res;
+
+  switch (C1->getValueID()) {
+  case Value::UndefValueVal:
+    return TypesRes;
+  case Value::ConstantIntVal:
+    return cmpAPInts(cast<ConstantInt>(C1)->getValue(),
+                     cast<ConstantInt>(C2)->getValue());
+  case Value::ConstantFPVal:
+    return cmpAPFloats(cast<ConstantFP>(C1)->getValueAPF(),
+                       cast<ConstantFP>(C2)->getValueAPF());
+  case Value::ConstantArrayVal:
+  case Value::ConstantStructVal:
+  case Value::ConstantVectorVal: {
+    if (int Res = cmpNumbers(C1->getNumOperands(), C2->getNumOperands()))
+      return Res;
+    for (unsigned i = 0, e = C1->getNumOperands(); i != e; ++i)
+      if (int Res = cmpConstants(cast<Constant>(C1->getOperand(i)),
+                                 cast<Constant>(C2->getOperand(i))))
+        return Res;
+    return 0;
+  }
+  default:
+    // Everything else, including globals and constant expressions, is only
+    // equal to itself, looking through pointer casts so that a pointer bitcast
+    // to the type the other function uses matches. Equality and order use the
+    // same key, which keeps the comparison a strict weak ordering.
+    return cmpNumbers((uint64_t)C1->stripPointerCasts(),
+                      (uint64_t)C2->stripPointerCasts());
+  }
 }
 
 // Compare two values used by the two functions under pair-wise comparison. If
-// this is the first time the values are seen, they're added to the mapping so
+// this is the first time the values are seen, they're given serial numbers so
 // that we will detect mismatches on next use.
-bool FunctionComparator::enumerate(const Value *V1, const Value *V2) {
+int FunctionComparator::cmpValues(const Value *V1, const Value *V2) {
   // Check for function @f1 referring to itself and function @f2 referring to
-  // itself, or referring to each other, or both referring to either of them.
-  // They're all equivalent if the two functions are otherwise equivalent.
-  if (V1 == F1 && V2 == F2)
-    return true;
-  if (V1 == F2 && V2 == F1)
-    return true;
-
-  if (const Constant *C1 = dyn_cast<Constant>(V1)) {
-    if (V1 == V2) return true;
-    const Constant *C2 = dyn_cast<Constant>(V2);
-    if (!C2) return false;
-    // TODO: constant expressions with GEP or references to F1 or F2.
-    if (C1->isNullValue() && C2->isNullValue() &&
-        isEquivalentType(C1->getType(), C2->getType()))
-      return true;
-    // Try bitcasting C2 to C1's type. If the bitcast is legal and returns C1
-    // then they must have equal bit patterns.
-    return C1->getType()->canLosslesslyBitCastTo(C2->getType()) &&
-      C1 == ConstantExpr::getBitCast(const_cast<Constant*>(C2), C1->getType());
-  }
-
-  if (isa<InlineAsm>(V1) || isa<InlineAsm>(V2))
-    return V1 == V2;
-
-  // Check that V1 maps to V2. If we find a value that V1 maps to then we simply
-  // check whether it's equal to V2. When there is no mapping then we need to
-  // ensure that V2 isn't already equivalent to something else. For this
-  // purpose, we track the V2 values in a set.
-
-  const Value *&map_elem = id_map[V1];
-  if (map_elem)
-    return map_elem == V2;
-  if (!seen_values.insert(V2).second)
-    return false;
-  map_elem = V2;
-  return true;
+  // itself. They're equivalent if the two functions are otherwise equivalent.
+  if (V1 == F1) {
+    if (V2 == F2)
+      return 0;
+    return -1;
+  }
+  if (V2 == F2)
+    return 1;
+
+  const Constant *C1 = dyn_cast<Constant>(V1);
+  const Constant *C2 = dyn_cast<Constant>(V2);
+  if (C1 && C2)
+    return cmpConstants(C1, C2);
+  if (C1)
+    return -1;
+  if (C2)
+    return 1;
+
+  const InlineAsm *IA1 = dyn_cast<InlineAsm>(V1);
+  const InlineAsm *IA2 = dyn_cast<InlineAsm>(V2);
+  if (IA1 && IA2)
+    return cmpNumbers((uint64_t)IA1, (uint64_t)IA2);
+  if (IA1)
+    return -1;
+  if (IA2)
+    return 1;
+
+  // Values that are first seen at the same point of the two functions get the
+  // same serial number.
+  std::pair<DenseMap<const Value *, unsigned>::iterator, bool>
+    SN1 = sn_map1.insert(std::make_pair(V1, sn_map1.size())),
+    SN2 = sn_map2.insert(std::make_pair(V2, sn_map2.size()));
+  return cmpNumbers(SN1.first->second, SN2.first->second);
 }
 
 // Test whether two basic blocks have equivalent behaviour.
-bool FunctionComparator::compare(const BasicBlock *BB1, const BasicBlock *BB2) {
+int FunctionComparator::compare(const BasicBlock *BB1, const BasicBlock *BB2) {
   BasicBlock::const_iterator F1I = BB1->begin(), F1E = BB1->end();
   BasicBlock::const_iterator F2I = BB2->begin(), F2E = BB2->end();
 
   do {
-    if (!enumerate(F1I, F2I))
-      return false;
-
-    if (const GetElementPtrInst *GEP1 = dyn_cast<GetElementPtrInst>(F1I)) {
-      const GetElementPtrInst *GEP2 = dyn_cast<GetElementPtrInst>(F2I);
-      if (!GEP2)
-        return false;
+    if (int Res = cmpValues(F1I, F2I))
+      return Res;
 
-      if (!enumerate(GEP1->getPointerOperand(), GEP2->getPointerOperand()))
-        return false;
+    const GetElementPtrInst *GEP1 = dyn_cast<GetElementPtrInst>(F1I);
+    const GetElementPtrInst *GEP2 = dyn_cast<GetElementPtrInst>(F2I);
+    if (GEP1 && GEP2) {
+      if (int Res = cmpValues(GEP1->getPointerOperand(),
+                              GEP2->getPointerOperand()))
+        return Res;
 
-      if (!isEquivalentGEP(GEP1, GEP2))
-        return false;
+      if (int Res = cmpGEP(GEP1, GEP2))
+        return Res;
     } else {
-      if (!isEquivalentOperation(F1I, F2I))
-        return false;
+      if (int Res = cmpOperation(F1I, F2I))
+        return Res;
 
       assert(F1I->getNumOperands() == F2I->getNumOperands());
       for (unsigned i = 0, e = F1I->getNumOperands(); i != e; ++i) {
         Value *OpF1 = F1I->getOperand(i);
         Value *OpF2 = F2I->getOperand(i);
 
-        if (!enumerate(OpF1, OpF2))
-          return false;
+        if (int Res = cmpValues(OpF1, OpF2))
+          return Res;
+
+        if (int Res = cmpNumbers(OpF1->getValueID(), OpF2->getValueID()))
+          return Res;
 
-        if (OpF1->getValueID() != OpF2->getValueID() ||
-            !isEquivalentType(OpF1->getType(), OpF2->getType()))
-          return false;
+        if (int Res = cmpType(OpF1->getType(), OpF2->getType()))
+          return Res;
       }
     }
 
     ++F1I, ++F2I;
   } while (F1I != F1E && F2I != F2E);
 
-  return F1I == F1E && F2I == F2E;
+  if (F1I != F1E)
+    return 1;
+  if (F2I != F2E)
+    return -1;
+  return 0;
 }
 
 // Test whether the two functions have equivalent behaviour.
-bool FunctionComparator::compare() {
-  // We need to recheck everything, but check the things that weren't included
-  // in the hash first.
+int FunctionComparator::compare() {
+  sn_map1.clear();
+  sn_map2.clear();
 
-  if (F1->getAttributes() != F2->getAttributes())
-    return false;
+  if (int Res = cmpAttrs(F1->getAttributes(), F2->getAttributes()))
+    return Res;
 
-  if (F1->hasGC() != F2->hasGC())
-    return false;
+  if (int Res = cmpNumbers(F1->hasGC(), F2->hasGC()))
+    return Res;
 
-  if (F1->hasGC() && F1->getGC() != F2->getGC())
-    return false;
+  if (F1->hasGC()) {
+    if (int Res = cmpStrings(F1->getGC(), F2->getGC()))
+      return Res;
+  }
 
-  if (F1->hasSection() != F2->hasSection())
-    return false;
+  if (int Res = cmpNumbers(F1->hasSection(), F2->hasSection()))
+    return Res;
 
-  if (F1->hasSection() && F1->getSection() != F2->getSection())
-    return false;
+  if (F1->hasSection()) {
+    if (int Res = cmpStrings(F1->getSection(), F2->getSection()))
+      return Res;
+  }
 
-  if (F1->isVarArg() != F2->isVarArg())
-    return false;
+  if (int Res = cmpNumbers(F1->isVarArg(), F2->isVarArg()))
+    return Res;
 
   // TODO: if it's internal and only used in direct calls, we could handle this
   // case too.
-  if (F1->getCallingConv() != F2->getCallingConv())
-    return false;
+  if (int Res = cmpNumbers(F1->getCallingConv(), F2->getCallingConv()))
+    return Res;
 
-  if (!isEquivalentType(F1->getFunctionType(), F2->getFunctionType()))
-    return false;
+  if (int Res = cmpType(F1->getFunctionType(), F2->getFunctionType()))
+    return Res;
 
   assert(F1->arg_size() == F2->arg_size() &&
          "Identically typed functions have different numbers of args!");
@@ -569,7 +731,7 @@ bool FunctionComparator::compare() {
   // passed in.
   for (Function::const_arg_iterator f1i = F1->arg_begin(),
          f2i = F2->arg_begin(), f1e = F1->arg_end(); f1i != f1e; ++f1i, ++f2i) {
-    if (!enumerate(f1i, f2i))
+    if (cmpValues(f1i, f2i))
       llvm_unreachable("Arguments repeat!");
   }
 
@@ -588,8 +750,11 @@ bool FunctionComparator::compare() {
     const BasicBlock *F1BB = F1BBs.pop_back_val();
     const BasicBlock *F2BB = F2BBs.pop_back_val();
 
-    if (!enumerate(F1BB, F2BB) || !compare(F1BB, F2BB))
-      return false;
+    if (int Res = cmpValues(F1BB, F2BB))
+      return Res;
+
+    if (int Res = compare(F1BB, F2BB))
+      return Res;
 
     const TerminatorInst *F1TI = F1BB->getTerminator();
     const TerminatorInst *F2TI = F2BB->getTerminator();
@@ -603,11 +768,40 @@ bool FunctionComparator::compare() {
       F2BBs.push_back(F2TI->getSuccessor(i));
     }
   }
-  return true;
+  return 0;
 }
 
 namespace {
 
+/// FunctionNode - An entry in the tree of distinct functions. Pairs the
+/// function with its structural hash and the DataLayout to compare it with.
+class FunctionNode {
+  AssertingVH<Function> F;
+  uint64_t Hash;
+  const DataLayout *DL;
+
+public:
+  FunctionNode(Function *F, uint64_t Hash, const DataLayout *DL)
+    : F(F), Hash(Hash), DL(DL) {}
+
+  Function *getFunc() const { return F; }
+  uint64_t getHash() const { return Hash; }
+  const DataLayout *getDataLayout() const { return DL; }
+};
+
+/// FunctionNodeCmp - Orders FunctionNodes by hash, then with the total order
+/// defined by FunctionComparator.
+struct FunctionNodeCmp {
+  bool operator()(const FunctionNode &LHS, const FunctionNode &RHS) const {
+    if (LHS.getHash() != RHS.getHash())
+      return LHS.getHash() < RHS.getHash();
+    assert(LHS.getDataLayout() == RHS.getDataLayout() &&
+           "Comparing functions for different targets");
+    return FunctionComparator(LHS.getDataLayout(), LHS.getFunc(),
+                              RHS.getFunc()).compare() == -1;
+  }
+};
+
 /// MergeFunctions finds functions which will generate identical machine code,
 /// by considering all pointer types to be equivalent. Once identified,
 /// MergeFunctions will fold them by replacing a call to one to a call to a
@@ -624,21 +818,21 @@ public:
   bool runOnModule(Module &M) override;
 
 private:
-  typedef DenseSet<ComparableFunction> FnSetType;
+  typedef std::set<FunctionNode, FunctionNodeCmp> FnTreeType;
 
   /// A work queue of functions that may have been modified and should be
   /// analyzed again.
   std::vector<WeakVH> Deferred;
 
-  /// Insert a ComparableFunction into the FnSet, or merge it away if it's
-  /// equal to one that's already present.
-  bool insert(ComparableFunction &NewF);
+  /// Insert a Function into the FnTree, or merge it away if it's equal to one
+  /// that's already present.
+  bool insert(Function *NewFunction);
 
-  /// Remove a Function from the FnSet and queue it up for a second sweep of
+  /// Remove a Function from the FnTree and queue it up for a second sweep of
   /// analysis.
   void remove(Function *F);
 
-  /// Find the functions that use this Value and remove them from FnSet and
+  /// Find the functions that use this Value and remove them from FnTree and
   /// queue the functions.
   void removeUsers(Value *V);
 
@@ -662,8 +856,13 @@ private:
   void writeAlias(Function *F, Function *G);
 
   /// The set of all distinct functions. Use the insert() and remove() methods
-  /// to modify it.
-  FnSetType FnSet;
+  /// to modify it. Functions must be removed before they are modified, as
+  /// that may change their position in the order.
+  FnTreeType FnTree;
+
+  /// The node of each function in FnTree, so that a function can be removed
+  /// without comparing it against other functions.
+  DenseMap<Function *, FnTreeType::iterator> FNodesInTree;
 
   /// DataLayout for more accurate GEP comparisons. May be NULL.
   const DataLayout *DL;
@@ -686,11 +885,25 @@ bool MergeFunctions::runOnModule(Module &M) {
   DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
   DL = DLP ? &DLP->getDataLayout() : nullptr;
 
+  // All functions in the module, ordered by hash. Functions with a unique hash
+  // value are easily eliminated.
+  std::vector<std::pair<uint64_t, Function *> > HashedFuncs;
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
     if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
-      Deferred.push_back(WeakVH(I));
+      HashedFuncs.push_back(std::make_pair(functionHash(*I), I));
+  }
+
+  std::stable_sort(HashedFuncs.begin(), HashedFuncs.end(), less_first());
+
+  for (unsigned i = 0, e = HashedFuncs.size(); i != e; ++i) {
+    // If the hash value matches the previous value or the next one, we must
+    // consider merging it. Otherwise it is dropped and never considered again.
+    if ((i != 0 && HashedFuncs[i - 1].first == HashedFuncs[i].first) ||
+        (i + 1 != e && HashedFuncs[i + 1].first == HashedFuncs[i].first))
+      Deferred.push_back(WeakVH(HashedFuncs[i].second));
+    else
+      ++NumUniqueHashes;
   }
-  FnSet.resize(Deferred.size());
 
   do {
     std::vector<WeakVH> Worklist;
@@ -706,10 +919,8 @@ bool MergeFunctions::runOnModule(Module &M) {
       if (!*I) continue;
       Function *F = cast<Function>(*I);
       if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage() &&
-          !F->mayBeOverridden()) {
-        ComparableFunction CF = ComparableFunction(F, DL);
-        Changed |= insert(CF);
-      }
+          !F->mayBeOverridden())
+        Changed |= insert(F);
     }
 
     // Insert only weak functions and merge them. By doing these second we
@@ -721,39 +932,18 @@ bool MergeFunctions::runOnModule(Module &M) {
       if (!*I) continue;
       Function *F = cast<Function>(*I);
       if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage() &&
-          F->mayBeOverridden()) {
-        ComparableFunction CF = ComparableFunction(F, DL);
-        Changed |= insert(CF);
-      }
+          F->mayBeOverridden())
+        Changed |= insert(F);
     }
-    DEBUG(dbgs() << "size of FnSet: " << FnSet.size() << '\n');
+    DEBUG(dbgs() << "size of FnTree: " << FnTree.size() << '\n');
   } while (!Deferred.empty());
 
-  FnSet.clear();
+  FnTree.clear();
+  FNodesInTree.clear();
 
   return Changed;
 }
 
-bool DenseMapInfo<ComparableFunction>::isEqual(const ComparableFunction &LHS,
-                                               const ComparableFunction &RHS) {
-  if (LHS.getFunc() == RHS.getFunc() &&
-      LHS.getHash() == RHS.getHash())
-    return true;
-  if (!LHS.getFunc() || !RHS.getFunc())
-    return false;
-
-  // One of these is a special "underlying pointer comparison only" object.
-  if (LHS.getDataLayout() == ComparableFunction::LookupOnly ||
-      RHS.getDataLayout() == ComparableFunction::LookupOnly)
-    return false;
-
-  assert(LHS.getDataLayout() == RHS.getDataLayout() &&
-         "Comparing functions for different targets");
-
-  return FunctionComparator(LHS.getDataLayout(), LHS.getFunc(),
-                            RHS.getFunc()).compare();
-}
-
 // Replace direct callers of Old with New.
 void MergeFunctions::replaceDirectCallers(Function *Old, Function *New) {
   Constant *BitcastNew = ConstantExpr::getBitCast(New, Old->getType());
@@ -908,54 +1098,52 @@ void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
   ++NumFunctionsMerged;
 }
 
-// Insert a ComparableFunction into the FnSet, or merge it away if equal to one
-// that was already inserted.
-bool MergeFunctions::insert(ComparableFunction &NewF) {
-  std::pair<FnSetType::iterator, bool> Result = FnSet.insert(NewF);
+// Insert a Function into the FnTree, or merge it away if equal to one that was
+// already inserted.
+bool MergeFunctions::insert(Function *NewFunction) {
+  std::pair<FnTreeType::iterator, bool> Result = FnTree.insert(
+      FunctionNode(NewFunction, functionHash(*NewFunction), DL));
   if (Result.second) {
-    DEBUG(dbgs() << "Inserting as unique: " << NewF.getFunc()->getName() << '\n');
+    FNodesInTree[NewFunction] = Result.first;
+    DEBUG(dbgs() << "Inserting as unique: " << NewFunction->getName() << '\n');
     return false;
   }
 
-  const ComparableFunction &OldF = *Result.first;
+  Function *OldFunction = Result.first->getFunc();
 
   // Don't merge tiny functions, since it can just end up making the function
   // larger.
   // FIXME: Should still merge them if they are unnamed_addr and produce an
   // alias.
-  if (NewF.getFunc()->size() == 1) {
-    if (NewF.getFunc()->front().size() <= 2) {
-      DEBUG(dbgs() << NewF.getFunc()->getName()
+  if (NewFunction->size() == 1) {
+    if (NewFunction->front().size() <= 2) {
+      DEBUG(dbgs() << NewFunction->getName()
             << " is to small to bother merging\n");
       return false;
     }
   }
 
   // Never thunk a strong function to a weak function.
-  assert(!OldF.getFunc()->mayBeOverridden() ||
-         NewF.getFunc()->mayBeOverridden());
+  assert(!OldFunction->mayBeOverridden() || NewFunction->mayBeOverridden());
 
-  DEBUG(dbgs() << "  " << OldF.getFunc()->getName() << " == "
-               << NewF.getFunc()->getName() << '\n');
+  DEBUG(dbgs() << "  " << OldFunction->getName() << " == "
+               << NewFunction->getName() << '\n');
 
-  Function *DeleteF = NewF.getFunc();
-  NewF.release();
-  mergeTwoFunctions(OldF.getFunc(), DeleteF);
+  mergeTwoFunctions(OldFunction, NewFunction);
   return true;
 }
 
-// Remove a function from FnSet. If it was already in FnSet, add it to Deferred
-// so that we'll look at it in the next round.
+// Remove a function from FnTree. If it was already in FnTree, add it to
+// Deferred so that we'll look at it in the next round.
 void MergeFunctions::remove(Function *F) {
   // We need to make sure we remove F, not a function "equal" to F per the
-  // function equality comparator.
-  //
-  // The special "lookup only" ComparableFunction bypasses the expensive
-  // function comparison in favour of a pointer comparison on the underlying
-  // Function*'s.
-  ComparableFunction CF = ComparableFunction(F, ComparableFunction::LookupOnly);
-  if (FnSet.erase(CF)) {
+  // function equality comparator, so look up its node directly.
+  DenseMap<Function *, FnTreeType::iterator>::iterator I =
+      FNodesInTree.find(F);
+  if (I != FNodesInTree.end()) {
     DEBUG(dbgs() << "Removed " << F->getName() << " from set and deferred it.\n");
+    FnTree.erase(I->second);
+    FNodesInTree.erase(I);
     Deferred.push_back(F);
   }
 }
@@ -53,6 +53,32 @@ static cl::opt<bool>
 RunLoopRerolling("reroll-loops", cl::Hidden,
                  cl::desc("Run the loop rerolling pass"));
 
+static cl::opt<bool>
+UseAACache("enable-aa-cache", cl::init(false), cl::Hidden,
+           cl::desc("Memoize alias analysis queries across passes"));
+
+static cl::opt<bool>
+RunIndirectCallPromotion("enable-indirect-call-promotion", cl::init(false),
+                         cl::Hidden,
+                         cl::desc("Promote indirect calls with hot profiled "
+                                  "targets to guarded direct calls"));
+
+static cl::opt<bool>
+RunLoopDataPrefetch("prefetch-loops", cl::init(false), cl::Hidden,
+                    cl::desc("Insert software prefetches in loops"));
+
+static cl::opt<bool>
+RunLoopInterchange("enable-loop-interchange", cl::init(false), cl::Hidden,
+                   cl::desc("Run the loop interchange pass"));
+
+static cl::opt<bool>
+RunLoopDistribute("enable-loop-distribute", cl::init(false), cl::Hidden,
+                  cl::desc("Run the loop distribution pass"));
+
+static cl::opt<bool>
+RunHotColdSplitting("hot-cold-split", cl::init(false), cl::Hidden,
+                    cl::desc("Outline the cold regions of functions"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -103,6 +129,9 @@ PassManagerBuilder::addInitialAliasAnalysisPasses(PassManagerBase &PM) const {
   // support "obvious" type-punning idioms.
   PM.add(createTypeBasedAliasAnalysisPass());
   PM.add(createBasicAliasAnalysisPass());
+  // The cache must be added last so that it sits on top of the chain.
+  if (UseAACache)
+    PM.add(createAliasAnalysisCachePass());
 }
 
 void PassManagerBuilder::populateFunctionPassManager(FunctionPassManager &FPM) {
@@ -155,6 +184,8 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
 
     MPM.add(createIPSCCPPass());              // IP SCCP
     MPM.add(createDeadArgEliminationPass());  // Dead argument elimination
+    if (RunIndirectCallPromotion)
+      MPM.add(createIndirectCallPromotionPass()); // Promote profiled icalls
 
     MPM.add(createInstructionCombiningPass());// Clean up after IPCP & DAE
     MPM.add(createCFGSimplificationPass());   // Clean up after IPCP & DAE
@@ -195,6 +226,8 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
   MPM.add(createIndVarSimplifyPass());        // Canonicalize indvars
   MPM.add(createLoopIdiomPass());             // Recognize idioms like memset.
   MPM.add(createLoopDeletionPass());          // Delete dead loops
+  if (RunLoopInterchange)
+    MPM.add(createLoopInterchangePass());     // Interchange loop nests
 
   if (!DisableUnrollLoops)
     MPM.add(createSimpleLoopUnrollPass());    // Unroll small loops
@@ -240,6 +273,9 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
   // pass manager that we are specifically trying to avoid. To prevent this
   // we must insert a no-op module pass to reset the pass manager.
   MPM.add(createBarrierNoopPass());
+  // Split the cycles off the loops the vectorizer would otherwise give up on.
+  if (RunLoopDistribute)
+    MPM.add(createLoopDistributePass());
   MPM.add(createLoopVectorizePass(DisableUnrollLoops, LoopVectorize));
   // FIXME: Because of #pragma vectorize enable, the passes below are always
   // inserted in the pipeline, even when the vectorizer doesn't run (ex. when
@@ -252,7 +288,16 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
   if (!DisableUnrollLoops)
     MPM.add(createLoopUnrollPass());    // Unroll small loops
 
+  // Prefetch once unrolling has settled the size of the loop bodies.
+  if (RunLoopDataPrefetch)
+    MPM.add(createLoopDataPrefetchPass());
+
   if (!DisableUnitAtATime) {
+    // Move the cold regions that the function passes have left out of the
+    // hot code.
+    if (RunHotColdSplitting)
+      MPM.add(createHotColdSplittingPass());
+
     // FIXME: We shouldn't bother with this anymore.
     MPM.add(createStripDeadPrototypesPass()); // Get rid of dead prototypes
 
@@ -106,6 +106,9 @@ public:
 public:
   bool runOnFunction(Function &F) override;
 
+  /// InstCombine iterates until it reaches a fixed point.
+  bool isIdempotent() const override { return true; }
+
   bool DoOneIteration(Function &F, unsigned ItNum);
 
   void getAnalysisUsage(AnalysisUsage &AU) const override;
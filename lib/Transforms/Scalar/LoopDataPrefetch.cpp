@@ -0,0 +1,215 @@
+//===-------- LoopDataPrefetch.cpp - Loop Data Prefetching Pass -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass inserts software prefetches for the loads of innermost loops that
+// the hardware prefetchers are not expected to cover: loads whose address
+// advances by a large constant stride, and loads whose stride is only known
+// at run time, like the column walks of a row-major matrix.
+//
+// The prefetches are issued far enough ahead to hide the target's cache miss
+// latency, assuming each instruction of the loop body takes about a cycle.
+// Loops that the block frequencies, and so the profile, say run for fewer
+// iterations than that distance are left alone.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-data-prefetch"
+
+STATISTIC(NumPrefetches, "Number of prefetches inserted");
+
+static cl::opt<unsigned>
+PrefetchDistance("prefetch-distance", cl::init(0), cl::Hidden,
+                 cl::desc("Number of cycles to prefetch ahead (default: the "
+                          "target's cache miss latency)"));
+
+static cl::opt<unsigned>
+MaxPrefetchItersAhead("max-prefetch-iters-ahead", cl::init(64), cl::Hidden,
+                      cl::desc("Maximum number of iterations to prefetch "
+                               "ahead"));
+
+namespace {
+class LoopDataPrefetch : public LoopPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  LoopDataPrefetch() : LoopPass(ID) {
+    initializeLoopDataPrefetchPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnLoop(Loop *L, LPPassManager &LPM) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.addRequired<LoopInfo>();
+    AU.addPreserved<LoopInfo>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.addPreserved<ScalarEvolution>();
+    AU.addRequired<TargetTransformInfo>();
+  }
+
+private:
+  ScalarEvolution *SE;
+  const TargetTransformInfo *TTI;
+
+  unsigned getItersAhead(Loop *L);
+};
+}
+
+char LoopDataPrefetch::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopDataPrefetch, "loop-data-prefetch",
+                      "Loop Data Prefetch", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_END(LoopDataPrefetch, "loop-data-prefetch",
+                    "Loop Data Prefetch", false, false)
+
+Pass *llvm::createLoopDataPrefetchPass() { return new LoopDataPrefetch(); }
+
+/// Return the number of iterations of \p L to prefetch ahead, or zero if the
+/// loop does not run long enough for prefetches to pay off.
+unsigned LoopDataPrefetch::getItersAhead(Loop *L) {
+  unsigned Distance = PrefetchDistance;
+  if (!Distance)
+    Distance = TTI->getCacheMissLatency();
+  if (!Distance)
+    return 0;
+
+  unsigned LoopSize = 0;
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I)
+      if (!isa<PHINode>(I) && !isa<DbgInfoIntrinsic>(I))
+        ++LoopSize;
+  unsigned ItersAhead = (Distance + LoopSize - 1) / LoopSize;
+  ItersAhead = std::min(ItersAhead, unsigned(MaxPrefetchItersAhead));
+
+  // The header runs once per iteration and the preheader once per entry into
+  // the loop, so their ratio is the average trip count.
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>();
+  uint64_t HeaderFreq = BFI.getBlockFreq(L->getHeader()).getFrequency();
+  uint64_t PreheaderFreq =
+      BFI.getBlockFreq(L->getLoopPreheader()).getFrequency();
+  if (HeaderFreq <= PreheaderFreq * ItersAhead) {
+    DEBUG(dbgs() << "LoopDataPrefetch: loop at depth " << L->getLoopDepth()
+                 << " runs too few iterations to prefetch "
+                 << ItersAhead << " ahead\n");
+    return 0;
+  }
+  return ItersAhead;
+}
+
+bool LoopDataPrefetch::runOnLoop(Loop *L, LPPassManager &LPM) {
+  if (skipOptnoneFunction(L))
+    return false;
+
+  // Only prefetch in innermost loops, where the loads run most often.
+  if (!L->empty() || !L->getLoopPreheader())
+    return false;
+
+  Function *F = L->getHeader()->getParent();
+  if (F->hasFnAttribute(Attribute::OptimizeForSize) ||
+      F->hasFnAttribute(Attribute::MinSize))
+    return false;
+
+  TTI = &getAnalysis<TargetTransformInfo>();
+  unsigned LineSize = TTI->getCacheLineSize();
+  if (!LineSize)
+    return false;
+  unsigned MinStride = TTI->getMinPrefetchStride();
+
+  SE = &getAnalysis<ScalarEvolution>();
+  unsigned ItersAhead = getItersAhead(L);
+  if (!ItersAhead)
+    return false;
+
+  // Collect the loads to prefetch first, so the code the expander inserts is
+  // not visited. Loads whose addresses are within a cache line of one that
+  // is already prefetched are covered by its prefetch.
+  SmallVector<std::pair<LoadInst *, const SCEVAddRecExpr *>, 8> Candidates;
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I) {
+      LoadInst *Load = dyn_cast<LoadInst>(I);
+      if (!Load || !Load->isSimple())
+        continue;
+      Value *Ptr = Load->getPointerOperand();
+      if (Ptr->getType()->getPointerAddressSpace() != 0 ||
+          L->isLoopInvariant(Ptr))
+        continue;
+
+      const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+      if (!AR || AR->getLoop() != L || !AR->isAffine())
+        continue;
+
+      // The hardware prefetchers follow small constant strides on their own.
+      const SCEV *Step = AR->getStepRecurrence(*SE);
+      if (const SCEVConstant *C = dyn_cast<SCEVConstant>(Step))
+        if (C->getValue()->getValue().abs().ult(MinStride))
+          continue;
+
+      bool Covered = false;
+      for (unsigned i = 0, e = Candidates.size(); i != e && !Covered; ++i) {
+        const SCEVConstant *Dist =
+            dyn_cast<SCEVConstant>(SE->getMinusSCEV(AR, Candidates[i].second));
+        Covered = Dist && Dist->getValue()->getValue().abs().ult(LineSize);
+      }
+      if (!Covered)
+        Candidates.push_back(std::make_pair(Load, AR));
+    }
+
+  Module *M = F->getParent();
+  bool Changed = false;
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    LoadInst *Load = Candidates[i].first;
+    const SCEVAddRecExpr *AR = Candidates[i].second;
+    const SCEV *Step = AR->getStepRecurrence(*SE);
+    const SCEV *NextAddr = SE->getAddExpr(
+        AR, SE->getMulExpr(SE->getConstant(Step->getType(), ItersAhead), Step));
+    if (!isSafeToExpand(NextAddr, *SE))
+      continue;
+
+    SCEVExpander Expander(*SE, "prefaddr");
+    Type *I8Ptr = Type::getInt8PtrTy(F->getContext());
+    Value *Addr = Expander.expandCodeFor(NextAddr, I8Ptr, Load);
+
+    // Read prefetch, keep in all levels of the cache, data cache.
+    IRBuilder<> Builder(Load);
+    Builder.CreateCall4(Intrinsic::getDeclaration(M, Intrinsic::prefetch),
+                        Addr, Builder.getInt32(0), Builder.getInt32(3),
+                        Builder.getInt32(1));
+    DEBUG(dbgs() << "LoopDataPrefetch: prefetching " << ItersAhead
+                 << " iterations ahead for " << *Load << '\n');
+    ++NumPrefetches;
+    Changed = true;
+  }
+  return Changed;
+}
@@ -0,0 +1,537 @@
+//===- LoopDistribute.cpp - Distribute loops into separate loops ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass splits a loop into a sequence of loops over the same iteration
+// space, so that the statements that form a dependence cycle end up in loops
+// of their own and the rest of the original loop can be vectorized.
+//
+// The statements of the loop are the nodes of a graph whose edges are the
+// def-use chains and the memory dependences that DependenceAnalysis finds
+// between them. The strongly connected components of the graph are visited
+// in topological order and grouped into partitions, keeping components with
+// and without a cycle apart. Each partition but the last gets a copy of the
+// loop; the original loop becomes the last partition.
+//
+// The loop control is copied into every partition. Values computed in one
+// partition and used in a later one are recomputed there, which is only done
+// for computations that do not depend on a cycle or on memory the loop writes.
+//
+// Only innermost loops made of a single block are distributed.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-distribute"
+
+STATISTIC(NumLoopsDistributed, "Number of loops distributed");
+
+namespace {
+/// The dependence graph of the statements of a loop body.
+struct DepGraph {
+  SmallVector<Instruction *, 32> Nodes;
+  DenseMap<Instruction *, unsigned> NodeIdx;
+  std::vector<SmallVector<unsigned, 4> > Succs;
+  /// Nodes with a dependence on themselves carried by the loop.
+  SmallVector<bool, 32> SelfCycle;
+  /// Nodes that touch memory another statement of the loop also touches.
+  SmallVector<bool, 32> HasMemDep;
+
+  void addNode(Instruction *I) {
+    NodeIdx[I] = Nodes.size();
+    Nodes.push_back(I);
+    Succs.push_back(SmallVector<unsigned, 4>());
+    SelfCycle.push_back(false);
+    HasMemDep.push_back(false);
+  }
+  void addEdge(unsigned From, unsigned To) { Succs[From].push_back(To); }
+};
+
+/// Tarjan's algorithm over a DepGraph.
+class SCCFinder {
+  const DepGraph &G;
+  SmallVector<unsigned, 32> Index, LowLink;
+  SmallVector<bool, 32> OnStack;
+  SmallVector<unsigned, 32> Stack;
+  unsigned NextIndex;
+
+  void visit(unsigned N);
+
+public:
+  /// The component of every node, numbered in reverse topological order.
+  SmallVector<unsigned, 32> SCCOf;
+  unsigned NumSCCs;
+
+  explicit SCCFinder(const DepGraph &G);
+};
+
+class LoopDistribute : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  LoopDistribute() : FunctionPass(ID) {
+    initializeLoopDistributePass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DependenceAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfo>();
+    AU.addPreserved<LoopInfo>();
+    AU.addRequired<ScalarEvolution>();
+  }
+
+private:
+  DependenceAnalysis *DA;
+  DominatorTree *DT;
+  LoopInfo *LI;
+  ScalarEvolution *SE;
+
+  typedef SmallPtrSet<Instruction *, 32> InstSet;
+
+  bool buildGraph(Loop *L, const InstSet &Control, DepGraph &G);
+  bool formPartitions(const DepGraph &G, SmallVectorImpl<InstSet> &Parts);
+  void distribute(Loop *L, const DepGraph &G,
+                  SmallVectorImpl<InstSet> &Parts);
+  bool processLoop(Loop *L);
+};
+}
+
+SCCFinder::SCCFinder(const DepGraph &G)
+    : G(G), Index(G.Nodes.size(), ~0U), LowLink(G.Nodes.size(), 0),
+      OnStack(G.Nodes.size(), false), NextIndex(0),
+      SCCOf(G.Nodes.size(), 0), NumSCCs(0) {
+  for (unsigned N = 0, E = G.Nodes.size(); N != E; ++N)
+    if (Index[N] == ~0U)
+      visit(N);
+}
+
+void SCCFinder::visit(unsigned N) {
+  Index[N] = LowLink[N] = NextIndex++;
+  Stack.push_back(N);
+  OnStack[N] = true;
+  for (unsigned i = 0, e = G.Succs[N].size(); i != e; ++i) {
+    unsigned S = G.Succs[N][i];
+    if (Index[S] == ~0U) {
+      visit(S);
+      LowLink[N] = std::min(LowLink[N], LowLink[S]);
+    } else if (OnStack[S]) {
+      LowLink[N] = std::min(LowLink[N], Index[S]);
+    }
+  }
+  if (LowLink[N] != Index[N])
+    return;
+
+  unsigned M;
+  do {
+    M = Stack.pop_back_val();
+    OnStack[M] = false;
+    SCCOf[M] = NumSCCs;
+  } while (M != N);
+  ++NumSCCs;
+}
+
+char LoopDistribute::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopDistribute, "loop-distribute",
+                      "Distribute loops", false, false)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_END(LoopDistribute, "loop-distribute",
+                    "Distribute loops", false, false)
+
+FunctionPass *llvm::createLoopDistributePass() { return new LoopDistribute(); }
+
+/// Add the def-use and memory dependence edges between the statements of
+/// \p L, which are its instructions other than the loop control.
+bool LoopDistribute::buildGraph(Loop *L, const InstSet &Control,
+                                DepGraph &G) {
+  BasicBlock *Header = L->getHeader();
+  SmallVector<unsigned, 16> MemNodes;
+  for (BasicBlock::iterator II = Header->begin(), E = Header->end(); II != E;
+       ++II) {
+    Instruction *I = II;
+    if (Control.count(I))
+      continue;
+    if (I->mayReadOrWriteMemory()) {
+      if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+        if (!Load->isSimple())
+          return false;
+      } else if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+        if (!Store->isSimple())
+          return false;
+      } else
+        return false;
+      MemNodes.push_back(G.Nodes.size());
+    } else if (I->mayHaveSideEffects()) {
+      return false;
+    }
+    G.addNode(I);
+  }
+
+  // Def-use edges, including the values that flow around the backedge into
+  // the PHIs of the header.
+  for (unsigned N = 0, E = G.Nodes.size(); N != E; ++N)
+    for (User::op_iterator OI = G.Nodes[N]->op_begin(),
+                           OE = G.Nodes[N]->op_end();
+         OI != OE; ++OI) {
+      Instruction *Op = dyn_cast<Instruction>(*OI);
+      if (!Op)
+        continue;
+      DenseMap<Instruction *, unsigned>::iterator It = G.NodeIdx.find(Op);
+      if (It == G.NodeIdx.end())
+        continue;
+      if (It->second == N)
+        G.SelfCycle[N] = true;
+      else
+        G.addEdge(It->second, N);
+    }
+
+  // Memory edges. The body is a single block, so a dependence from an
+  // earlier to a later statement runs forward within an iteration or into a
+  // later one, and only a '>' direction runs backward.
+  unsigned Level = L->getLoopDepth();
+  for (unsigned i = 0, e = MemNodes.size(); i != e; ++i)
+    for (unsigned j = i; j != e; ++j) {
+      unsigned A = MemNodes[i], B = MemNodes[j];
+      if (isa<LoadInst>(G.Nodes[A]) && isa<LoadInst>(G.Nodes[B]))
+        continue;
+      std::unique_ptr<Dependence> D(
+          DA->depends(G.Nodes[A], G.Nodes[B], true));
+      if (!D)
+        continue;
+      G.HasMemDep[A] = G.HasMemDep[B] = true;
+
+      unsigned Dir = Dependence::DVEntry::ALL;
+      if (!D->isConfused() && D->getLevels() >= Level) {
+        // A dependence carried by an enclosing loop is preserved no matter
+        // how the statements are distributed.
+        bool CarriedOutside = false;
+        for (unsigned Outer = 1; Outer < Level; ++Outer)
+          if (!(D->getDirection(Outer) & Dependence::DVEntry::EQ))
+            CarriedOutside = true;
+        if (CarriedOutside)
+          continue;
+        Dir = D->getDirection(Level);
+      }
+
+      if (A == B) {
+        if (Dir & (Dependence::DVEntry::LT | Dependence::DVEntry::GT))
+          G.SelfCycle[A] = true;
+        continue;
+      }
+      if (Dir & (Dependence::DVEntry::LT | Dependence::DVEntry::EQ))
+        G.addEdge(A, B);
+      if (Dir & Dependence::DVEntry::GT)
+        G.addEdge(B, A);
+    }
+  return true;
+}
+
+/// Group the components of \p G into partitions of components that all have
+/// a cycle or all have none, in an order that respects the dependences.
+/// Return true if distributing the loop into those partitions is worth it.
+bool LoopDistribute::formPartitions(const DepGraph &G,
+                                    SmallVectorImpl<InstSet> &Parts) {
+  SCCFinder SCCs(G);
+  unsigned NumSCCs = SCCs.NumSCCs;
+
+  SmallVector<bool, 16> Cyclic(NumSCCs, false);
+  SmallVector<unsigned, 16> SCCSize(NumSCCs, 0);
+  SmallVector<unsigned, 16> FirstNode(NumSCCs, ~0U);
+  SmallVector<bool, 16> HasStore(NumSCCs, false);
+  SmallVector<unsigned, 16> InDegree(NumSCCs, 0);
+  std::vector<SmallVector<unsigned, 4> > SCCSuccs(NumSCCs);
+  for (unsigned N = 0, E = G.Nodes.size(); N != E; ++N) {
+    unsigned S = SCCs.SCCOf[N];
+    ++SCCSize[S];
+    FirstNode[S] = std::min(FirstNode[S], N);
+    if (G.SelfCycle[N])
+      Cyclic[S] = true;
+    if (isa<StoreInst>(G.Nodes[N]))
+      HasStore[S] = true;
+    for (unsigned i = 0, e = G.Succs[N].size(); i != e; ++i) {
+      unsigned T = SCCs.SCCOf[G.Succs[N][i]];
+      if (T == S)
+        continue;
+      SCCSuccs[S].push_back(T);
+      ++InDegree[T];
+    }
+  }
+  for (unsigned S = 0; S != NumSCCs; ++S)
+    if (SCCSize[S] > 1)
+      Cyclic[S] = true;
+
+  // Visit the components in topological order, staying with components of
+  // the current kind as long as there are any ready, and start a new
+  // partition whenever the kind changes. Among ready components, prefer the
+  // one whose statements come first in the loop.
+  SmallVector<unsigned, 16> Ready;
+  for (unsigned S = 0; S != NumSCCs; ++S)
+    if (!InDegree[S])
+      Ready.push_back(S);
+
+  SmallVector<unsigned, 16> PartOf(NumSCCs, 0);
+  SmallVector<bool, 8> PartCyclic, PartHasStore;
+  while (!Ready.empty()) {
+    unsigned Best = Ready.size();
+    for (unsigned i = 0, e = Ready.size(); i != e; ++i) {
+      bool SameKind =
+          !PartCyclic.empty() && Cyclic[Ready[i]] == PartCyclic.back();
+      bool BestSameKind = Best != Ready.size() && !PartCyclic.empty() &&
+                          Cyclic[Ready[Best]] == PartCyclic.back();
+      if (Best == Ready.size() || (SameKind && !BestSameKind) ||
+          (SameKind == BestSameKind &&
+           FirstNode[Ready[i]] < FirstNode[Ready[Best]]))
+        Best = i;
+    }
+    unsigned S = Ready[Best];
+    Ready.erase(Ready.begin() + Best);
+
+    if (PartCyclic.empty() || PartCyclic.back() != Cyclic[S]) {
+      PartCyclic.push_back(Cyclic[S]);
+      PartHasStore.push_back(false);
+    }
+    PartOf[S] = PartCyclic.size() - 1;
+    PartHasStore.back() = PartHasStore.back() || HasStore[S];
+
+    for (unsigned i = 0, e = SCCSuccs[S].size(); i != e; ++i)
+      if (!--InDegree[SCCSuccs[S][i]])
+        Ready.push_back(SCCSuccs[S][i]);
+  }
+
+  // Distribution pays off when it separates a cycle from statements that
+  // store without one, since those can then be vectorized.
+  bool HasCyclic = false, HasAcyclicStore = false;
+  for (unsigned P = 0, E = PartCyclic.size(); P != E; ++P) {
+    HasCyclic |= PartCyclic[P];
+    HasAcyclicStore |= !PartCyclic[P] && PartHasStore[P];
+  }
+  if (!HasCyclic || !HasAcyclicStore)
+    return false;
+
+  // Statements that can be recomputed anywhere, which neither belong to a
+  // cycle nor touch memory another statement touches, go to the partitions
+  // that use them. Every other statement stays in its partition, and may
+  // only be used there.
+  SmallVector<bool, 32> Recomputable(G.Nodes.size(), false);
+  for (unsigned N = 0, E = G.Nodes.size(); N != E; ++N) {
+    Instruction *I = G.Nodes[N];
+    Recomputable[N] = !isa<PHINode>(I) && !Cyclic[SCCs.SCCOf[N]] &&
+                      !G.HasMemDep[N] && !I->mayWriteToMemory();
+  }
+
+  for (unsigned P = 0, E = PartCyclic.size(); P != E; ++P) {
+    InstSet Part;
+    SmallVector<Instruction *, 16> Worklist;
+    for (unsigned N = 0, NE = G.Nodes.size(); N != NE; ++N)
+      if (PartOf[SCCs.SCCOf[N]] == P && !Recomputable[N]) {
+        Part.insert(G.Nodes[N]);
+        Worklist.push_back(G.Nodes[N]);
+      }
+
+    while (!Worklist.empty()) {
+      Instruction *I = Worklist.pop_back_val();
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI) {
+        Instruction *Op = dyn_cast<Instruction>(*OI);
+        if (!Op)
+          continue;
+        DenseMap<Instruction *, unsigned>::const_iterator It =
+            G.NodeIdx.find(Op);
+        if (It == G.NodeIdx.end() || Part.count(Op))
+          continue;
+        if (!Recomputable[It->second]) {
+          DEBUG(dbgs() << "LoopDistribute: " << *Op
+                       << " is used by a later partition\n");
+          return false;
+        }
+        Part.insert(Op);
+        Worklist.push_back(Op);
+      }
+    }
+
+    // A partition of recomputable statements only computes values for the
+    // partitions that recompute them.
+    if (!Part.empty())
+      Parts.push_back(Part);
+  }
+  return true;
+}
+
+/// Replace \p L by one copy of the loop per partition, each of which only
+/// keeps the loop control and the statements of its partition.
+void LoopDistribute::distribute(Loop *L, const DepGraph &G,
+                                SmallVectorImpl<InstSet> &Parts) {
+  SE->forgetLoop(L);
+
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Exit = L->getExitBlock();
+  Function *F = Header->getParent();
+  Loop *ParentLoop = L->getParentLoop();
+
+  SmallVector<Instruction *, 32> Dead;
+  BasicBlock *Prev = Preheader;
+  for (unsigned P = 0, E = Parts.size() - 1; P != E; ++P) {
+    ValueToValueMapTy VMap;
+    BasicBlock *NewHeader =
+        CloneBasicBlock(Header, VMap, ".ldist" + Twine(P + 1));
+    F->getBasicBlockList().insert(Header, NewHeader);
+    VMap[Header] = NewHeader;
+    for (BasicBlock::iterator I = NewHeader->begin(), IE = NewHeader->end();
+         I != IE; ++I)
+      RemapInstruction(I, VMap, RF_IgnoreMissingEntries);
+
+    // The copy is entered from the block before it and exits to a new block
+    // that enters the next copy.
+    BasicBlock *Middle = BasicBlock::Create(
+        F->getContext(), Header->getName() + ".ldist.exit" + Twine(P + 1), F,
+        Header);
+    BranchInst::Create(Header, Middle);
+    for (BasicBlock::iterator I = NewHeader->begin(); isa<PHINode>(I); ++I) {
+      PHINode *PN = cast<PHINode>(I);
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), Prev);
+    }
+    TerminatorInst *TI = NewHeader->getTerminator();
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+      if (TI->getSuccessor(i) == Exit)
+        TI->setSuccessor(i, Middle);
+    Prev->getTerminator()->replaceUsesOfWith(Header, NewHeader);
+
+    for (BasicBlock::iterator I = Header->begin(), IE = Header->end();
+         I != IE; ++I)
+      if (G.NodeIdx.count(I) && !Parts[P].count(I))
+        Dead.push_back(cast<Instruction>(VMap[I]));
+
+    Loop *NewLoop = new Loop();
+    if (ParentLoop)
+      ParentLoop->addChildLoop(NewLoop);
+    else
+      LI->addTopLevelLoop(NewLoop);
+    NewLoop->addBasicBlockToLoop(NewHeader, LI->getBase());
+    if (ParentLoop)
+      ParentLoop->addBasicBlockToLoop(Middle, LI->getBase());
+
+    DT->addNewBlock(NewHeader, Prev);
+    DT->addNewBlock(Middle, NewHeader);
+    Prev = Middle;
+  }
+
+  // The original loop runs the last partition.
+  for (BasicBlock::iterator I = Header->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), Prev);
+  }
+  DT->changeImmediateDominator(Header, Prev);
+  for (BasicBlock::iterator I = Header->begin(), IE = Header->end(); I != IE;
+       ++I)
+    if (G.NodeIdx.count(I) && !Parts.back().count(I))
+      Dead.push_back(I);
+
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->dropAllReferences();
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->eraseFromParent();
+}
+
+bool LoopDistribute::processLoop(Loop *L) {
+  BasicBlock *Header = L->getHeader();
+  if (L->getNumBlocks() != 1 || !L->getLoopPreheader() || !L->getExitBlock())
+    return false;
+  BranchInst *BI = dyn_cast<BranchInst>(Header->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+
+  // The loop control is everything the exit test depends on in the loop. It
+  // is copied into every partition, so it may not touch memory.
+  InstSet Control;
+  SmallVector<Instruction *, 8> Worklist;
+  Control.insert(BI);
+  Worklist.push_back(BI);
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI) {
+      Instruction *Op = dyn_cast<Instruction>(*OI);
+      if (Op && L->contains(Op) && Control.insert(Op)) {
+        if (Op->mayReadOrWriteMemory() || Op->mayHaveSideEffects())
+          return false;
+        Worklist.push_back(Op);
+      }
+    }
+  }
+
+  for (BasicBlock::iterator II = Header->begin(), E = Header->end(); II != E;
+       ++II) {
+    Instruction *I = II;
+    // Values of the loop used after it would need to be taken from the
+    // partition that computes them.
+    for (User *U : I->users())
+      if (!L->contains(cast<Instruction>(U)))
+        return false;
+    if (isa<DbgInfoIntrinsic>(I))
+      Control.insert(I);
+  }
+
+  DepGraph G;
+  if (!buildGraph(L, Control, G))
+    return false;
+  SmallVector<InstSet, 4> Parts;
+  if (!formPartitions(G, Parts))
+    return false;
+
+  DEBUG(dbgs() << "LoopDistribute: distributing the loop headed by "
+               << Header->getName() << " into " << Parts.size()
+               << " loops\n");
+  distribute(L, G, Parts);
+  ++NumLoopsDistributed;
+  return true;
+}
+
+bool LoopDistribute::runOnFunction(Function &F) {
+  LI = &getAnalysis<LoopInfo>();
+  DA = &getAnalysis<DependenceAnalysis>();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  SE = &getAnalysis<ScalarEvolution>();
+
+  // Collect the innermost loops first; distribution adds new ones.
+  SmallVector<Loop *, 8> Worklist(LI->begin(), LI->end());
+  SmallVector<Loop *, 8> Innermost;
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    if (L->empty())
+      Innermost.push_back(L);
+    Worklist.append(L->begin(), L->end());
+  }
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Innermost.size(); i != e; ++i)
+    Changed |= processLoop(Innermost[i]);
+  return Changed;
+}
@@ -0,0 +1,390 @@
+//===- LoopInterchange.cpp - Interchange perfectly nested loops -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass interchanges the two innermost loops of a perfect loop nest when
+// that makes the innermost loop walk memory with a smaller stride, such as a
+// column-major traversal of a row-major array.
+//
+// The nest must be made of two counted loops whose bounds do not depend on
+// each other, and the outer loop may contain nothing but the inner loop and
+// its own loop control. The interchange then keeps the CFG as it is and swaps
+// the iteration spaces of the two loops: the outer loop takes over the start,
+// step and bound of the inner one and vice versa, and the body uses the
+// outer induction variable where it used the inner one and vice versa.
+//
+// The interchange is legal if DependenceAnalysis finds no dependence with a
+// (<, >) direction on the two loops, which the interchange would reverse.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-interchange"
+
+STATISTIC(NumInterchanged, "Number of loop nests interchanged");
+
+namespace {
+/// The loop control of a counted loop: the induction variable, its increment
+/// by a constant step, and the compare that decides whether the latch exits.
+struct LoopControl {
+  PHINode *IV;
+  BinaryOperator *Inc;
+  ICmpInst *Cmp;
+  /// True if the latch exits when the compare is true.
+  bool ExitOnTrue;
+  /// True if the compare tests the incremented induction variable.
+  bool CmpUsesInc;
+};
+
+class LoopInterchange : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  LoopInterchange() : FunctionPass(ID) {
+    initializeLoopInterchangePass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<DependenceAnalysis>();
+    AU.addRequired<LoopInfo>();
+    AU.addPreserved<LoopInfo>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.addRequired<TargetTransformInfo>();
+  }
+
+private:
+  DependenceAnalysis *DA;
+  ScalarEvolution *SE;
+  const TargetTransformInfo *TTI;
+
+  bool analyzeLoopControl(Loop *L, Loop *Outer, LoopControl &C);
+  bool isPerfectNest(Loop *Outer, Loop *Inner, const LoopControl &OC,
+                     const LoopControl &IC);
+  bool isLegal(Loop *Outer, Loop *Inner,
+               const SmallVectorImpl<Instruction *> &MemInsts);
+  bool isProfitable(Loop *Outer, Loop *Inner,
+                    const SmallVectorImpl<Instruction *> &MemInsts);
+  void interchange(Loop *Outer, Loop *Inner, LoopControl &OC,
+                   LoopControl &IC);
+  bool processNest(Loop *Outer);
+};
+}
+
+char LoopInterchange::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopInterchange, "loop-interchange",
+                      "Interchange perfectly nested loops", false, false)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_END(LoopInterchange, "loop-interchange",
+                    "Interchange perfectly nested loops", false, false)
+
+FunctionPass *llvm::createLoopInterchangePass() {
+  return new LoopInterchange();
+}
+
+/// Match the loop control of \p L. Its start, step and bound must not
+/// depend on anything computed in \p Outer, so that the loop can be moved
+/// anywhere in the nest.
+bool LoopInterchange::analyzeLoopControl(Loop *L, Loop *Outer,
+                                         LoopControl &C) {
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Latch = L->getLoopLatch();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Latch || !Preheader || L->getExitingBlock() != Latch)
+    return false;
+
+  BranchInst *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+  C.Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+  if (!C.Cmp || !C.Cmp->hasOneUse())
+    return false;
+  C.ExitOnTrue = !L->contains(BI->getSuccessor(0));
+
+  // The induction variable must be the only PHI of the header; other PHIs
+  // carry values from one iteration to the next in the order of this loop.
+  C.IV = dyn_cast<PHINode>(Header->begin());
+  if (!C.IV || isa<PHINode>(std::next(BasicBlock::iterator(C.IV))) ||
+      C.IV->getNumIncomingValues() != 2)
+    return false;
+  C.Inc = dyn_cast<BinaryOperator>(C.IV->getIncomingValueForBlock(Latch));
+  if (!C.Inc || C.Inc->getOpcode() != Instruction::Add ||
+      C.Inc->getOperand(0) != C.IV || !isa<ConstantInt>(C.Inc->getOperand(1)))
+    return false;
+
+  Value *Tested = C.Cmp->getOperand(0);
+  if (Tested != C.Inc && Tested != C.IV)
+    return false;
+  C.CmpUsesInc = Tested == C.Inc;
+
+  // The increment may only feed the loop control.
+  for (User *U : C.Inc->users())
+    if (U != C.IV && U != C.Cmp)
+      return false;
+
+  return Outer->isLoopInvariant(C.Cmp->getOperand(1)) &&
+         Outer->isLoopInvariant(C.IV->getIncomingValueForBlock(Preheader));
+}
+
+/// Return true if everything in \p Outer that is not in \p Inner is loop
+/// control, and the values computed in the nest are not used elsewhere.
+bool LoopInterchange::isPerfectNest(Loop *Outer, Loop *Inner,
+                                    const LoopControl &OC,
+                                    const LoopControl &IC) {
+  if (OC.IV->getType() != IC.IV->getType() ||
+      OC.ExitOnTrue != IC.ExitOnTrue || OC.CmpUsesInc != IC.CmpUsesInc)
+    return false;
+
+  for (Loop::block_iterator BI = Outer->block_begin(),
+                            BE = Outer->block_end();
+       BI != BE; ++BI) {
+    bool InInner = Inner->contains(*BI);
+    for (BasicBlock::iterator II = (*BI)->begin(), E = (*BI)->end(); II != E;
+         ++II) {
+      Instruction *I = II;
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+
+      // Values computed in the nest stay in the nest.
+      for (User *U : I->users())
+        if (!Outer->contains(cast<Instruction>(U)))
+          return false;
+
+      if (InInner) {
+        // Only loads and stores may touch memory; the dependence analysis
+        // knows nothing about calls.
+        if (I->mayReadOrWriteMemory()) {
+          if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+            if (!LI->isSimple())
+              return false;
+          } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+            if (!SI->isSimple())
+              return false;
+          } else
+            return false;
+        }
+        continue;
+      }
+
+      if (I == OC.IV || I == OC.Inc || I == OC.Cmp)
+        continue;
+      if (BranchInst *BrI = dyn_cast<BranchInst>(I))
+        if (BrI->isUnconditional() || BrI->getCondition() == OC.Cmp)
+          continue;
+      return false;
+    }
+  }
+
+  // The outer induction variable may only be used by its loop control and
+  // by the body of the inner loop.
+  for (User *U : OC.IV->users()) {
+    Instruction *UserInst = cast<Instruction>(U);
+    if (UserInst != OC.Inc && UserInst != OC.Cmp &&
+        (!Inner->contains(UserInst) || UserInst == IC.Cmp))
+      return false;
+  }
+  return true;
+}
+
+/// Return true if no dependence between the memory accesses of the inner
+/// loop has a (<, >) or a (>, <) direction on the two loops of the nest.
+bool LoopInterchange::isLegal(Loop *Outer, Loop *Inner,
+                              const SmallVectorImpl<Instruction *> &MemInsts) {
+  unsigned OuterLevel = Outer->getLoopDepth();
+  unsigned InnerLevel = Inner->getLoopDepth();
+  for (unsigned i = 0, e = MemInsts.size(); i != e; ++i)
+    for (unsigned j = i; j != e; ++j) {
+      if (isa<LoadInst>(MemInsts[i]) && isa<LoadInst>(MemInsts[j]))
+        continue;
+      std::unique_ptr<Dependence> D(
+          DA->depends(MemInsts[i], MemInsts[j], true));
+      if (!D)
+        continue;
+      if (D->isConfused() || D->getLevels() < InnerLevel) {
+        DEBUG(dbgs() << "LoopInterchange: unknown dependence between "
+                     << *MemInsts[i] << " and " << *MemInsts[j] << '\n');
+        return false;
+      }
+
+      // A dependence carried by a loop around the nest is not affected.
+      bool CarriedOutside = false;
+      for (unsigned Level = 1; Level < OuterLevel; ++Level)
+        if (!(D->getDirection(Level) & Dependence::DVEntry::EQ))
+          CarriedOutside = true;
+      if (CarriedOutside)
+        continue;
+
+      unsigned OuterDir = D->getDirection(OuterLevel);
+      unsigned InnerDir = D->getDirection(InnerLevel);
+      if (((OuterDir & Dependence::DVEntry::LT) &&
+           (InnerDir & Dependence::DVEntry::GT)) ||
+          ((OuterDir & Dependence::DVEntry::GT) &&
+           (InnerDir & Dependence::DVEntry::LT))) {
+        DEBUG(dbgs() << "LoopInterchange: interchange would reverse the "
+                     << "dependence between " << *MemInsts[i] << " and "
+                     << *MemInsts[j] << '\n');
+        return false;
+      }
+    }
+  return true;
+}
+
+/// Return true if consecutive iterations of \p L access memory through the
+/// address \p S within a cache line of each other.
+static bool hasSpatialLocality(ScalarEvolution *SE, const SCEV *S,
+                               const Loop *L, unsigned LineSize) {
+  // The recurrences of enclosing loops are in the starts of the inner ones.
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(S);
+  while (AR && AR->getLoop() != L)
+    AR = dyn_cast<SCEVAddRecExpr>(AR->getStart());
+  if (!AR)
+    return SE->isLoopInvariant(S, L);
+  const SCEVConstant *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  return Step && Step->getValue()->getValue().abs().ult(LineSize);
+}
+
+/// Return true if fewer accesses of the nest miss spatial locality in its
+/// innermost loop once the loops are interchanged.
+bool LoopInterchange::isProfitable(
+    Loop *Outer, Loop *Inner, const SmallVectorImpl<Instruction *> &MemInsts) {
+  unsigned LineSize = TTI->getCacheLineSize();
+  if (!LineSize)
+    LineSize = 64;
+
+  unsigned InnerMisses = 0, OuterMisses = 0;
+  for (unsigned i = 0, e = MemInsts.size(); i != e; ++i) {
+    Value *Ptr = isa<LoadInst>(MemInsts[i])
+                     ? cast<LoadInst>(MemInsts[i])->getPointerOperand()
+                     : cast<StoreInst>(MemInsts[i])->getPointerOperand();
+    const SCEV *S = SE->getSCEV(Ptr);
+    if (!hasSpatialLocality(SE, S, Inner, LineSize))
+      ++InnerMisses;
+    if (!hasSpatialLocality(SE, S, Outer, LineSize))
+      ++OuterMisses;
+  }
+  DEBUG(dbgs() << "LoopInterchange: " << InnerMisses
+               << " accesses without locality in the inner loop, "
+               << OuterMisses << " after interchange\n");
+  return OuterMisses < InnerMisses;
+}
+
+/// Swap the iteration spaces of the two loops.
+void LoopInterchange::interchange(Loop *Outer, Loop *Inner, LoopControl &OC,
+                                  LoopControl &IC) {
+  SE->forgetLoop(Outer);
+
+  // Collect the uses of the two induction variables in the body before
+  // rewriting either of them.
+  SmallVector<Use *, 8> OuterUses, InnerUses;
+  for (Use &U : OC.IV->uses())
+    if (Inner->contains(cast<Instruction>(U.getUser())))
+      OuterUses.push_back(&U);
+  for (Use &U : IC.IV->uses())
+    if (U.getUser() != IC.Inc && U.getUser() != IC.Cmp)
+      InnerUses.push_back(&U);
+  for (unsigned i = 0, e = OuterUses.size(); i != e; ++i)
+    OuterUses[i]->set(IC.IV);
+  for (unsigned i = 0, e = InnerUses.size(); i != e; ++i)
+    InnerUses[i]->set(OC.IV);
+
+  // Swap the starts, the steps with their wrap flags, and the exit tests.
+  unsigned OuterIdx = OC.IV->getBasicBlockIndex(Outer->getLoopPreheader());
+  unsigned InnerIdx = IC.IV->getBasicBlockIndex(Inner->getLoopPreheader());
+  Value *OuterStart = OC.IV->getIncomingValue(OuterIdx);
+  OC.IV->setIncomingValue(OuterIdx, IC.IV->getIncomingValue(InnerIdx));
+  IC.IV->setIncomingValue(InnerIdx, OuterStart);
+
+  Value *OuterStep = OC.Inc->getOperand(1);
+  bool OuterNSW = OC.Inc->hasNoSignedWrap();
+  bool OuterNUW = OC.Inc->hasNoUnsignedWrap();
+  OC.Inc->setOperand(1, IC.Inc->getOperand(1));
+  OC.Inc->setHasNoSignedWrap(IC.Inc->hasNoSignedWrap());
+  OC.Inc->setHasNoUnsignedWrap(IC.Inc->hasNoUnsignedWrap());
+  IC.Inc->setOperand(1, OuterStep);
+  IC.Inc->setHasNoSignedWrap(OuterNSW);
+  IC.Inc->setHasNoUnsignedWrap(OuterNUW);
+
+  CmpInst::Predicate OuterPred = OC.Cmp->getPredicate();
+  Value *OuterBound = OC.Cmp->getOperand(1);
+  OC.Cmp->setPredicate(IC.Cmp->getPredicate());
+  OC.Cmp->setOperand(1, IC.Cmp->getOperand(1));
+  IC.Cmp->setPredicate(OuterPred);
+  IC.Cmp->setOperand(1, OuterBound);
+}
+
+bool LoopInterchange::processNest(Loop *Outer) {
+  if (Outer->getSubLoops().size() != 1)
+    return false;
+  Loop *Inner = Outer->getSubLoops()[0];
+  if (!Inner->empty())
+    return false;
+
+  LoopControl OC, IC;
+  if (!analyzeLoopControl(Outer, Outer, OC) ||
+      !analyzeLoopControl(Inner, Outer, IC) ||
+      !isPerfectNest(Outer, Inner, OC, IC))
+    return false;
+
+  SmallVector<Instruction *, 16> MemInsts;
+  for (Loop::block_iterator BI = Inner->block_begin(),
+                            BE = Inner->block_end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I)
+      if (isa<LoadInst>(I) || isa<StoreInst>(I))
+        MemInsts.push_back(I);
+  if (MemInsts.empty())
+    return false;
+
+  if (!isProfitable(Outer, Inner, MemInsts) ||
+      !isLegal(Outer, Inner, MemInsts))
+    return false;
+
+  DEBUG(dbgs() << "LoopInterchange: interchanging the loops headed by "
+               << Outer->getHeader()->getName() << " and "
+               << Inner->getHeader()->getName() << '\n');
+  interchange(Outer, Inner, OC, IC);
+  ++NumInterchanged;
+  return true;
+}
+
+bool LoopInterchange::runOnFunction(Function &F) {
+  LoopInfo &LI = getAnalysis<LoopInfo>();
+  DA = &getAnalysis<DependenceAnalysis>();
+  SE = &getAnalysis<ScalarEvolution>();
+  TTI = &getAnalysis<TargetTransformInfo>();
+
+  SmallVector<Loop *, 8> Worklist(LI.begin(), LI.end());
+  bool Changed = false;
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    Worklist.append(L->begin(), L->end());
+    Changed |= processNest(L);
+  }
+  return Changed;
+}
@@ -49,6 +49,10 @@ struct CFGSimplifyPass : public FunctionPass {
   }
   bool runOnFunction(Function &F) override;
 
+  /// Return blocks are merged and the CFG simplified until a fixed point is
+  /// reached.
+  bool isIdempotent() const override { return true; }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<TargetTransformInfo>();
   }
@@ -182,18 +186,20 @@ bool CFGSimplifyPass::runOnFunction(Function &F) {
   // If neither pass changed anything, we're done.
   if (!EverChanged) return false;
 
-  // iterativelySimplifyCFG can (rarely) make some loops dead.  If this happens,
-  // removeUnreachableBlocks is needed to nuke them, which means we should
-  // iterate between the two optimizations.  We structure the code like this to
-  // avoid reruning iterativelySimplifyCFG if the second pass of
-  // removeUnreachableBlocks doesn't do anything.
-  if (!removeUnreachableBlocks(F))
-    return true;
-
-  do {
-    EverChanged = iterativelySimplifyCFG(F, TTI, DL);
-    EverChanged |= removeUnreachableBlocks(F);
-  } while (EverChanged);
+  // iterativelySimplifyCFG can (rarely) make some loops dead, and can leave
+  // behind new empty return blocks, for instance by hoisting the code common
+  // to two successors.  If this happens, removeUnreachableBlocks and
+  // mergeEmptyReturnBlocks are needed to clean up, which means we should
+  // iterate between the three optimizations until none of them changes
+  // anything, so that running the pass again would not either.  We structure
+  // the code like this to avoid reruning iterativelySimplifyCFG if the other
+  // two don't do anything.
+  for (;;) {
+    bool LocalChange = removeUnreachableBlocks(F);
+    LocalChange |= mergeEmptyReturnBlocks(F);
+    if (!LocalChange || !iterativelySimplifyCFG(F, TTI, DL))
+      break;
+  }
 
   return true;
 }
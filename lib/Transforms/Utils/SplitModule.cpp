@@ -0,0 +1,301 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+// The definitions of the module are grouped into clusters that must end up in
+// the same partition, and the clusters are assigned to partitions largest
+// first, each to the partition that defines the fewest instructions so far.
+// Every partition is then a copy of the module in which the definitions of
+// the other partitions are turned into declarations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include <algorithm>
+
+using namespace llvm;
+
+typedef SmallPtrSet<const GlobalValue *, 16> GlobalRefSet;
+
+/// Add the global values that \p C refers to, directly or through other
+/// constants, to \p Refs.
+static void addReferencedGlobals(const Constant *C, GlobalRefSet &Refs,
+                                 SmallPtrSet<const Constant *, 32> &Visited) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+    Refs.insert(GV);
+    return;
+  }
+  if (!Visited.insert(C))
+    return;
+  // Block addresses also have a basic block operand, which is not a constant.
+  for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end(); OI != OE;
+       ++OI)
+    if (const Constant *Op = dyn_cast<Constant>(*OI))
+      addReferencedGlobals(Op, Refs, Visited);
+}
+
+/// Collect the global values that the definition of \p GV refers to.
+static void collectReferencedGlobals(const GlobalValue *GV,
+                                     GlobalRefSet &Refs) {
+  SmallPtrSet<const Constant *, 32> Visited;
+  if (const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+    addReferencedGlobals(Var->getInitializer(), Refs, Visited);
+    return;
+  }
+  if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+    addReferencedGlobals(GA->getAliasee(), Refs, Visited);
+    return;
+  }
+
+  const Function *F = cast<Function>(GV);
+  if (F->hasPrefixData())
+    addReferencedGlobals(F->getPrefixData(), Refs, Visited);
+  for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+       ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I)
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        if (const Constant *C = dyn_cast<Constant>(*OI))
+          addReferencedGlobals(C, Refs, Visited);
+}
+
+/// The cost of code generating \p GV, in instructions.
+static unsigned getWeight(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F)
+    return 1;
+  unsigned Weight = 0;
+  for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+       ++BB)
+    Weight += BB->size();
+  return Weight;
+}
+
+/// Replace the alias \p GA, which is defined in another partition, with a
+/// declaration of the same symbol.
+static GlobalValue *replaceWithDeclaration(GlobalAlias *GA) {
+  Module *M = GA->getParent();
+  PointerType *PTy = GA->getType();
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType())) {
+    Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", M);
+  } else {
+    GlobalVariable::ThreadLocalMode TLM = GlobalVariable::NotThreadLocal;
+    if (const GlobalVariable *Base =
+            dyn_cast_or_null<GlobalVariable>(GA->getAliasedGlobal()))
+      TLM = Base->getThreadLocalMode();
+    Decl = new GlobalVariable(*M, PTy->getElementType(), false,
+                              GlobalValue::ExternalLinkage, nullptr, "",
+                              nullptr, TLM, PTy->getAddressSpace());
+  }
+  Decl->takeName(GA);
+  Decl->setVisibility(GA->getVisibility());
+  GA->replaceAllUsesWith(Decl);
+  GA->eraseFromParent();
+  return Decl;
+}
+
+void llvm::SplitModule(Module &M, unsigned N,
+                       std::vector<std::unique_ptr<Module>> &Partitions) {
+  assert(N > 0 && "Cannot split a module into zero partitions!");
+
+  // The definitions of the module, in module order.
+  SmallVector<GlobalValue *, 64> Defs;
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (!I->isDeclaration())
+      Defs.push_back(I);
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Defs.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    Defs.push_back(I);
+
+  EquivalenceClasses<const GlobalValue *> Clusters;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i)
+    Clusters.insert(Defs[i]);
+
+  // Keep the functions of each call graph SCC together, so that the calls
+  // between them stay within one object file.
+  CallGraph CG(M);
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    const std::vector<CallGraphNode *> &SCC = *I;
+    const Function *First = nullptr;
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+      const Function *F = SCC[i]->getFunction();
+      if (!F || F->isDeclaration())
+        continue;
+      if (First)
+        Clusters.unionSets(First, F);
+      else
+        First = F;
+    }
+  }
+
+  // An alias is emitted next to its aliasee, so the object file that defines
+  // one must define the other.
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    if (const GlobalValue *Aliasee = I->getAliasedGlobal())
+      if (!Aliasee->isDeclaration())
+        Clusters.unionSets(I, Aliasee);
+
+  // Place each local variable with the first function that refers to it.
+  // Most are only used by one function, or by a few related ones.
+  SmallPtrSet<const GlobalValue *, 16> Placed;
+  GlobalRefSet Refs;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    if (!isa<Function>(Defs[i]))
+      continue;
+    Refs.clear();
+    collectReferencedGlobals(Defs[i], Refs);
+    for (GlobalRefSet::iterator RI = Refs.begin(), RE = Refs.end(); RI != RE;
+         ++RI)
+      if (isa<GlobalVariable>(*RI) && (*RI)->hasLocalLinkage() &&
+          Placed.insert(*RI))
+        Clusters.unionSets(Defs[i], *RI);
+  }
+
+  // Module level inline asm is only emitted into the first partition. It may
+  // refer to the values in llvm.used and llvm.compiler.used by name, so keep
+  // them, and the other llvm.* globals, in the first partition as well.
+  SmallPtrSet<GlobalValue *, 8> Used;
+  collectUsedGlobalVariables(M, Used, /*CompilerUsed=*/false);
+  collectUsedGlobalVariables(M, Used, /*CompilerUsed=*/true);
+  const GlobalValue *Pinned = nullptr;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    if (!Defs[i]->getName().startswith("llvm.") && !Used.count(Defs[i]))
+      continue;
+    if (Pinned)
+      Clusters.unionSets(Pinned, Defs[i]);
+    else
+      Pinned = Defs[i];
+  }
+
+  // Weigh the clusters, identified by their leaders, and order them by the
+  // first of their members in the module.
+  SmallVector<const GlobalValue *, 32> Leaders;
+  DenseMap<const GlobalValue *, uint64_t> Weights;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    const GlobalValue *Leader = Clusters.getLeaderValue(Defs[i]);
+    if (Weights.insert(std::make_pair(Leader, 0)).second)
+      Leaders.push_back(Leader);
+    Weights[Leader] += getWeight(Defs[i]);
+  }
+  std::stable_sort(Leaders.begin(), Leaders.end(),
+                   [&](const GlobalValue *A, const GlobalValue *B) {
+    return Weights[A] > Weights[B];
+  });
+
+  // Assign the clusters to partitions, largest first, each to the partition
+  // with the least code so far. Ties go to the lowest numbered partition.
+  DenseMap<const GlobalValue *, unsigned> LeaderPartition;
+  std::vector<uint64_t> Load(N);
+  if (Pinned) {
+    const GlobalValue *Leader = Clusters.getLeaderValue(Pinned);
+    LeaderPartition[Leader] = 0;
+    Load[0] += Weights[Leader];
+  }
+  for (unsigned i = 0, e = Leaders.size(); i != e; ++i) {
+    if (LeaderPartition.count(Leaders[i]))
+      continue;
+    unsigned P = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    LeaderPartition[Leaders[i]] = P;
+    Load[P] += Weights[Leaders[i]];
+  }
+  DenseMap<const GlobalValue *, unsigned> PartitionOf;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i)
+    PartitionOf[Defs[i]] = LeaderPartition[Clusters.getLeaderValue(Defs[i])];
+
+  // Local values referenced from another partition must become visible to
+  // it. They are given hidden visibility, so they are not exported from the
+  // linked image, and a new name, so they do not clash with other symbols
+  // of the link. The values that inline asm may refer to keep their names.
+  SmallPtrSet<const GlobalValue *, 16> Exported;
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    Refs.clear();
+    collectReferencedGlobals(Defs[i], Refs);
+    unsigned P = PartitionOf[Defs[i]];
+    for (GlobalRefSet::iterator RI = Refs.begin(), RE = Refs.end(); RI != RE;
+         ++RI)
+      if ((*RI)->hasLocalLinkage() && PartitionOf[*RI] != P)
+        Exported.insert(*RI);
+  }
+  // Rename in module order, so that name collisions resolve the same way
+  // every time.
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    GlobalValue *GV = Defs[i];
+    if (!Exported.count(GV))
+      continue;
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+    if (!Used.count(GV))
+      GV->setName(GV->getName() + ".lto_priv");
+  }
+
+  for (unsigned P = 0; P != N; ++P) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(CloneModule(&M, VMap));
+    if (P != 0)
+      MPart->setModuleInlineAsm("");
+
+    // Turn the definitions of the other partitions into declarations.
+    SmallVector<GlobalValue *, 64> Stripped;
+    SmallVector<GlobalAlias *, 8> Aliases;
+    for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+      if (PartitionOf[Defs[i]] == P)
+        continue;
+      GlobalValue *NewGV = cast<GlobalValue>(VMap[Defs[i]]);
+      if (NewGV->hasAppendingLinkage()) {
+        NewGV->eraseFromParent();
+        continue;
+      }
+      if (Function *F = dyn_cast<Function>(NewGV)) {
+        F->deleteBody();
+      } else if (GlobalVariable *Var = dyn_cast<GlobalVariable>(NewGV)) {
+        Var->setInitializer(nullptr);
+        Var->setLinkage(GlobalValue::ExternalLinkage);
+      } else {
+        Aliases.push_back(cast<GlobalAlias>(NewGV));
+        continue;
+      }
+      Stripped.push_back(NewGV);
+    }
+    for (unsigned i = 0, e = Aliases.size(); i != e; ++i)
+      Stripped.push_back(replaceWithDeclaration(Aliases[i]));
+
+    // Drop the declarations that nothing in this partition refers to.
+    for (unsigned i = 0, e = Stripped.size(); i != e; ++i) {
+      Stripped[i]->removeDeadConstantUsers();
+      if (Stripped[i]->use_empty())
+        Stripped[i]->eraseFromParent();
+    }
+
+    Partitions.push_back(std::move(MPart));
+  }
+}
@@ -204,6 +204,33 @@ static cl::opt<bool> EnableCondStoresVectorization(
     "enable-cond-stores-vec", cl::init(false), cl::Hidden,
     cl::desc("Enable if predication of stores during vectorization."));
 
+/// This enables vectorizing groups of strided accesses that together touch
+/// every element of an array of structures, such as
+///   for (i = 0; i < N; ++i) {
+///     Re[i] = A[2 * i];
+///     Im[i] = A[2 * i + 1];
+///   }
+/// with one wide load of A and a shuffle per member, instead of scalarizing
+/// every access. By default this is left to the target, and no target turns
+/// it on yet.
+static cl::opt<bool> EnableInterleavedMemAccesses(
+    "enable-interleaved-mem-accesses", cl::init(false), cl::Hidden,
+    cl::desc("Enable vectorization of interleaved groups of strided memory "
+             "accesses"));
+
+/// Return true if interleaved groups should be formed for this target.
+static bool useInterleavedMemAccesses(const TargetTransformInfo &TTI) {
+  if (EnableInterleavedMemAccesses.getNumOccurrences() > 0)
+    return EnableInterleavedMemAccesses;
+  return TTI.enableInterleavedAccessVectorization();
+}
+
+/// The largest number of members an interleaved group can have.
+static cl::opt<unsigned> MaxInterleaveGroupFactor(
+    "max-interleave-group-factor", cl::init(4), cl::Hidden,
+    cl::desc("Maximum stride, in elements, of an interleaved group of memory "
+             "accesses"));
+
 namespace {
 
 // Forward declarations.
@@ -317,6 +344,11 @@ protected:
   /// Vectorize Load and Store instructions,
   virtual void vectorizeMemoryInstruction(Instruction *Instr);
 
+  /// Vectorize the interleaved group that \p Instr belongs to with a single
+  /// wide load or store. Does nothing unless \p Instr is the position at which
+  /// the group is emitted.
+  void vectorizeInterleaveGroup(Instruction *Instr);
+
   /// Create a broadcast instruction. This method generates a broadcast
   /// instruction (shuffle) for loop invariant values and for the induction
   /// value. If this is the induction variable then we extend it to N, N+1, ...
@@ -520,9 +552,10 @@ public:
   unsigned NumPredStores;
 
   LoopVectorizationLegality(Loop *L, ScalarEvolution *SE, const DataLayout *DL,
-                            DominatorTree *DT, TargetLibraryInfo *TLI)
+                            DominatorTree *DT, TargetLibraryInfo *TLI,
+                            const TargetTransformInfo *TTI)
       : NumLoads(0), NumStores(0), NumPredStores(0), TheLoop(L), SE(SE), DL(DL),
-        DT(DT), TLI(TLI), Induction(nullptr), WidestIndTy(nullptr),
+        DT(DT), TLI(TLI), TTI(TTI), Induction(nullptr), WidestIndTy(nullptr),
         HasFunNoNaNAttr(false), MaxSafeDepDistBytes(-1U) {}
 
   /// This enum represents the kinds of reductions that we support.
@@ -630,6 +663,31 @@ public:
     SmallVector<unsigned, 2> DependencySetId;
   };
 
+  /// This struct describes a group of loads or stores with the same constant
+  /// stride that together access every element of a structure in each
+  /// iteration, e.g. A[3 * i], A[3 * i + 1] and A[3 * i + 2].
+  struct InterleaveGroup {
+    InterleaveGroup() : Factor(0), InsertPos(nullptr), Alignment(0) {}
+
+    /// The stride in elements, which is also the number of members.
+    unsigned Factor;
+    /// The members ordered by their offset from the start of the structure.
+    SmallVector<Instruction *, 4> Members;
+    /// The member at which the group is vectorized: the first one in program
+    /// order for loads and the last one for stores.
+    Instruction *InsertPos;
+    /// The alignment of the access to the start of the structure.
+    unsigned Alignment;
+
+    /// Returns the offset of \p I from the start of the structure.
+    unsigned getIndex(Instruction *I) const {
+      for (unsigned i = 0; i < Factor; ++i)
+        if (Members[i] == I)
+          return i;
+      llvm_unreachable("Not a member of this group");
+    }
+  };
+
   /// A struct for saving information about induction variables.
   struct InductionInfo {
     InductionInfo(Value *Start, InductionKind K) : StartValue(Start), IK(K) {}
@@ -685,9 +743,29 @@ public:
   /// Returns true if the value V is uniform within the loop.
   bool isUniform(Value *V);
 
+  /// Find the groups of strided loads and stores that can be vectorized as a
+  /// single wide access. Must be called after canVectorize().
+  void analyzeInterleaving();
+
+  /// Returns the interleaved group that \p I is a member of, or null.
+  const InterleaveGroup *getInterleaveGroup(Instruction *I) {
+    DenseMap<Instruction *, unsigned>::iterator It = InterleaveGroupIdx.find(I);
+    if (It == InterleaveGroupIdx.end())
+      return nullptr;
+    return &InterleaveGroups[It->second];
+  }
+
   /// Returns true if this instruction will remain scalar after vectorization.
   bool isUniformAfterVectorization(Instruction* I) { return Uniforms.count(I); }
 
+  /// Returns true if the conditional load or store \p I is vectorized as a
+  /// masked vector access.
+  bool isMaskRequired(const Instruction *I) { return MaskedOp.count(I); }
+
+  /// Returns true if some loads or stores must be vectorized as masked
+  /// accesses.
+  bool hasMaskedOps() const { return !MaskedOp.empty(); }
+
   /// Returns the information that we collected about runtime memory check.
   RuntimePointerCheck *getRuntimePointerCheck() { return &PtrRtCheck; }
 
@@ -720,6 +798,11 @@ private:
   /// transformation.
   bool canVectorizeWithIfConvert();
 
+  /// Return true if all of the accesses that need a mask are consecutive, so
+  /// that they can be widened into masked vector accesses. Must be called
+  /// after the induction variables are known.
+  bool canVectorizeMaskedOps();
+
   /// Collect the variables that need to stay uniform after vectorization.
   void collectLoopUniforms();
 
@@ -752,6 +835,9 @@ private:
   /// invariant.
   void collectStridedAcccess(Value *LoadOrStoreInst);
 
+  /// Find the interleaved groups among the accesses in \p BB.
+  void analyzeInterleaving(BasicBlock *BB);
+
   /// The loop that we evaluate.
   Loop *TheLoop;
   /// Scev analysis.
@@ -762,6 +848,8 @@ private:
   DominatorTree *DT;
   /// Target Library Info.
   TargetLibraryInfo *TLI;
+  /// Target Transform Info.
+  const TargetTransformInfo *TTI;
 
   //  ---  vectorization state --- //
 
@@ -793,6 +881,15 @@ private:
 
   ValueToValueMap Strides;
   SmallPtrSet<Value *, 8> StrideSet;
+
+  /// Holds the interleaved groups, and the index of the group of each
+  /// member.
+  SmallVector<InterleaveGroup, 4> InterleaveGroups;
+  DenseMap<Instruction *, unsigned> InterleaveGroupIdx;
+
+  /// The conditional loads and stores that are vectorized as masked vector
+  /// accesses instead of being hoisted or scalarized.
+  SmallPtrSet<const Instruction *, 8> MaskedOp;
 };
 
 /// LoopVectorizationCostModel - estimates the expected speedups due to
@@ -1152,12 +1249,16 @@ struct LoopVectorize : public FunctionPass {
     }
 
     // Check if it is legal to vectorize the loop.
-    LoopVectorizationLegality LVL(L, SE, DL, DT, TLI);
+    LoopVectorizationLegality LVL(L, SE, DL, DT, TLI, TTI);
     if (!LVL.canVectorize()) {
       DEBUG(dbgs() << "LV: Not vectorizing: Cannot prove legality.\n");
       return false;
     }
 
+    // Look for strided accesses that can be combined into wide ones.
+    if (useInterleavedMemAccesses(*TTI))
+      LVL.analyzeInterleaving();
+
     // Use the cost model.
     LoopVectorizationCostModel CM(L, SE, LI, &LVL, *TTI, DL, TLI);
 
@@ -1476,6 +1577,168 @@ int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
   return 0;
 }
 
+namespace {
+/// A load or store whose address advances by a constant number of bytes in
+/// every iteration of the loop.
+struct StridedAccess {
+  Instruction *I;
+  Value *Ptr;
+  Type *Ty;
+  const SCEV *Start;
+  int64_t Stride;
+  unsigned Size;
+};
+}
+
+/// Returns true and fills in \p A if \p I is a simple load or store that could
+/// be a member of an interleaved group.
+static bool getStridedAccess(Instruction *I, Loop *L, ScalarEvolution *SE,
+                             const DataLayout *DL, StridedAccess &A) {
+  LoadInst *LI = dyn_cast<LoadInst>(I);
+  StoreInst *SI = dyn_cast<StoreInst>(I);
+  if ((!LI || !LI->isSimple()) && (!SI || !SI->isSimple()))
+    return false;
+
+  A.I = I;
+  A.Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+  A.Ty = LI ? LI->getType() : SI->getValueOperand()->getType();
+  if (A.Ty->isAggregateType() || A.Ty->isVectorTy())
+    return false;
+
+  // The members are packed into one vector, so they can't have padding.
+  A.Size = DL->getTypeAllocSize(A.Ty);
+  if (!A.Size || DL->getTypeSizeInBits(A.Ty) != A.Size * 8)
+    return false;
+
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(A.Ptr));
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return false;
+  const SCEVConstant *Step =
+      dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step)
+    return false;
+
+  A.Start = AR->getStart();
+  A.Stride = Step->getValue()->getSExtValue();
+  // Consecutive accesses are widened on their own.
+  return A.Stride > (int64_t)A.Size && A.Stride % A.Size == 0 &&
+         A.Stride / A.Size <= MaxInterleaveGroupFactor;
+}
+
+void LoopVectorizationLegality::analyzeInterleaving() {
+  for (Loop::block_iterator BI = TheLoop->block_begin(),
+         BE = TheLoop->block_end(); BI != BE; ++BI)
+    // The members of a group are executed together, so they must not be
+    // conditional.
+    if (!blockNeedsPredication(*BI))
+      analyzeInterleaving(*BI);
+}
+
+void LoopVectorizationLegality::analyzeInterleaving(BasicBlock *BB) {
+  SmallVector<StridedAccess, 16> Accesses;
+  DenseMap<Instruction *, unsigned> Order;
+  unsigned Pos = 0;
+  for (BasicBlock::iterator it = BB->begin(), e = BB->end(); it != e; ++it) {
+    Order[it] = Pos++;
+    StridedAccess A;
+    if (getStridedAccess(it, TheLoop, SE, DL, A))
+      Accesses.push_back(A);
+  }
+
+  for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+    StridedAccess &Leader = Accesses[i];
+    if (InterleaveGroupIdx.count(Leader.I))
+      continue;
+
+    int64_t Factor = Leader.Stride / Leader.Size;
+    // The members found so far, keyed on their offset in elements from the
+    // leader.
+    SmallVector<std::pair<int64_t, Instruction *>, 4> Members;
+    Members.push_back(std::make_pair(0, Leader.I));
+    int64_t MinOffset = 0, MaxOffset = 0;
+
+    for (unsigned j = i + 1; j != e; ++j) {
+      StridedAccess &A = Accesses[j];
+      if (InterleaveGroupIdx.count(A.I) ||
+          A.I->getOpcode() != Leader.I->getOpcode() || A.Ty != Leader.Ty ||
+          A.Ptr->getType() != Leader.Ptr->getType() ||
+          A.Stride != Leader.Stride)
+        continue;
+
+      const SCEVConstant *Dist =
+          dyn_cast<SCEVConstant>(SE->getMinusSCEV(A.Start, Leader.Start));
+      if (!Dist)
+        continue;
+      int64_t Offset = Dist->getValue()->getSExtValue();
+      if (Offset % Leader.Size)
+        continue;
+      Offset /= Leader.Size;
+      if (std::max(MaxOffset, Offset) - std::min(MinOffset, Offset) >= Factor)
+        continue;
+
+      bool Duplicate = false;
+      for (unsigned k = 0, ke = Members.size(); k != ke; ++k)
+        Duplicate |= Members[k].first == Offset;
+      if (Duplicate)
+        continue;
+
+      Members.push_back(std::make_pair(Offset, A.I));
+      MinOffset = std::min(MinOffset, Offset);
+      MaxOffset = std::max(MaxOffset, Offset);
+    }
+
+    // Gaps would make the wide access touch memory the loop never accessed.
+    if ((int64_t)Members.size() != Factor)
+      continue;
+
+    std::sort(Members.begin(), Members.end());
+    Instruction *First = Members[0].second, *Last = Members[0].second;
+    for (unsigned k = 1; k != Members.size(); ++k) {
+      Instruction *M = Members[k].second;
+      if (Order[M] < Order[First])
+        First = M;
+      if (Order[M] > Order[Last])
+        Last = M;
+    }
+
+    // Loads are hoisted to the first member and stores are sunk to the last
+    // one, so nothing in between may access memory in a conflicting way.
+    bool IsLoad = isa<LoadInst>(Leader.I);
+    SmallPtrSet<Instruction *, 4> IsMember;
+    for (unsigned k = 0; k != Members.size(); ++k)
+      IsMember.insert(Members[k].second);
+    bool Conflict = false;
+    for (BasicBlock::iterator it = First, e = Last; it != e && !Conflict;
+         ++it)
+      if (!IsMember.count(it))
+        Conflict = IsLoad ? it->mayWriteToMemory()
+                          : it->mayReadOrWriteMemory();
+    if (Conflict) {
+      DEBUG(dbgs() << "LV: Not interleaving accesses across " << *Last
+                   << "\n");
+      continue;
+    }
+
+    InterleaveGroup G;
+    G.Factor = Factor;
+    for (unsigned k = 0; k != Members.size(); ++k)
+      G.Members.push_back(Members[k].second);
+    G.InsertPos = IsLoad ? First : Last;
+    Instruction *Front = G.Members[0];
+    G.Alignment = isa<LoadInst>(Front) ? cast<LoadInst>(Front)->getAlignment()
+                                       : cast<StoreInst>(Front)->getAlignment();
+    if (!G.Alignment)
+      G.Alignment = DL->getABITypeAlignment(Leader.Ty);
+
+    DEBUG(dbgs() << "LV: Found an interleaved group of " << Factor
+                 << (IsLoad ? " loads" : " stores") << " at " << *G.InsertPos
+                 << "\n");
+    for (unsigned k = 0; k != Members.size(); ++k)
+      InterleaveGroupIdx[G.Members[k]] = InterleaveGroups.size();
+    InterleaveGroups.push_back(G);
+  }
+}
+
 bool LoopVectorizationLegality::isUniform(Value *V) {
   return (SE->isLoopInvariant(SE->getSCEV(V), TheLoop));
 }
@@ -1529,9 +1792,13 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
   unsigned ScalarAllocatedSize = DL->getTypeAllocSize(ScalarDataTy);
   unsigned VectorElementSize = DL->getTypeStoreSize(DataTy)/VF;
 
-  if (SI && Legal->blockNeedsPredication(SI->getParent()))
+  if (SI && Legal->blockNeedsPredication(SI->getParent()) &&
+      !Legal->isMaskRequired(SI))
     return scalarizeInstruction(Instr, true);
 
+  if (Legal->getInterleaveGroup(Instr))
+    return vectorizeInterleaveGroup(Instr);
+
   if (ScalarAllocatedSize != VectorElementSize)
     return scalarizeInstruction(Instr);
 
@@ -1598,6 +1865,15 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
     Ptr = Builder.CreateExtractElement(PtrVal[0], Zero);
   }
 
+  // Conditional accesses use the mask of their block.
+  VectorParts Mask;
+  if (Legal->isMaskRequired(Instr)) {
+    Mask = createBlockInMask(Instr->getParent());
+    if (Reverse)
+      for (unsigned Part = 0; Part < UF; ++Part)
+        Mask[Part] = reverseVector(Mask[Part]);
+  }
+
   // Handle Stores:
   if (SI) {
     assert(!Legal->isUniform(SI->getPointerOperand()) &&
@@ -1623,7 +1899,11 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
 
       Value *VecPtr = Builder.CreateBitCast(PartPtr,
                                             DataTy->getPointerTo(AddressSpace));
-      Builder.CreateStore(StoredVal[Part], VecPtr)->setAlignment(Alignment);
+      if (!Mask.empty())
+        Builder.CreateMaskedStore(StoredVal[Part], VecPtr, Alignment,
+                                  Mask[Part]);
+      else
+        Builder.CreateStore(StoredVal[Part], VecPtr)->setAlignment(Alignment);
     }
     return;
   }
@@ -1644,12 +1924,129 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
 
     Value *VecPtr = Builder.CreateBitCast(PartPtr,
                                           DataTy->getPointerTo(AddressSpace));
-    Value *LI = Builder.CreateLoad(VecPtr, "wide.load");
-    cast<LoadInst>(LI)->setAlignment(Alignment);
+    Value *LI;
+    if (!Mask.empty()) {
+      LI = Builder.CreateMaskedLoad(VecPtr, Alignment, Mask[Part],
+                                    UndefValue::get(DataTy),
+                                    "wide.masked.load");
+    } else {
+      LI = Builder.CreateLoad(VecPtr, "wide.load");
+      cast<LoadInst>(LI)->setAlignment(Alignment);
+    }
     Entry[Part] = Reverse ? reverseVector(LI) :  LI;
   }
 }
 
+/// Concatenate two vectors with the same element type. The second one may be
+/// shorter than the first, in which case it is padded with undef first.
+static Value *concatenateTwoVectors(IRBuilder<> &Builder, Value *V1,
+                                    Value *V2) {
+  unsigned NumElts1 = V1->getType()->getVectorNumElements();
+  unsigned NumElts2 = V2->getType()->getVectorNumElements();
+  assert(NumElts1 >= NumElts2 && "Unexpected vector lengths");
+
+  if (NumElts1 > NumElts2) {
+    SmallVector<Constant *, 16> ExtMask;
+    for (unsigned i = 0; i < NumElts1; ++i)
+      ExtMask.push_back(i < NumElts2
+                            ? cast<Constant>(Builder.getInt32(i))
+                            : UndefValue::get(Builder.getInt32Ty()));
+    V2 = Builder.CreateShuffleVector(V2, UndefValue::get(V2->getType()),
+                                     ConstantVector::get(ExtMask));
+  }
+
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < NumElts1 + NumElts2; ++i)
+    Mask.push_back(Builder.getInt32(i));
+  return Builder.CreateShuffleVector(V1, V2, ConstantVector::get(Mask));
+}
+
+/// Concatenate a list of vectors with the same type into one vector.
+static Value *concatenateVectors(IRBuilder<> &Builder,
+                                 ArrayRef<Value *> Vecs) {
+  SmallVector<Value *, 8> List(Vecs.begin(), Vecs.end());
+  while (List.size() > 1) {
+    SmallVector<Value *, 8> Next;
+    for (unsigned i = 0; i + 1 < List.size(); i += 2)
+      Next.push_back(concatenateTwoVectors(Builder, List[i], List[i + 1]));
+    if (List.size() % 2)
+      Next.push_back(List.back());
+    List.swap(Next);
+  }
+  return List[0];
+}
+
+void InnerLoopVectorizer::vectorizeInterleaveGroup(Instruction *Instr) {
+  const LoopVectorizationLegality::InterleaveGroup *Group =
+      Legal->getInterleaveGroup(Instr);
+  // The other members are vectorized along with the insert position.
+  if (Instr != Group->InsertPos)
+    return;
+
+  LoadInst *LI = dyn_cast<LoadInst>(Instr);
+  StoreInst *SI = dyn_cast<StoreInst>(Instr);
+  Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+  Type *ScalarDataTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+  unsigned Factor = Group->Factor;
+  unsigned Index = Group->getIndex(Instr);
+  Type *WideTy = VectorType::get(ScalarDataTy, VF * Factor);
+  unsigned AddressSpace = Ptr->getType()->getPointerAddressSpace();
+  Constant *Zero = Builder.getInt32(0);
+
+  // The wide access starts at the first member of the structure accessed by
+  // the first lane of each part.
+  setDebugLocFromInst(Builder, Ptr);
+  VectorParts &PtrParts = getVectorValue(Ptr);
+  SmallVector<Value *, 2> WidePtrs;
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    Value *NewPtr = Builder.CreateExtractElement(PtrParts[Part], Zero);
+    if (Index)
+      NewPtr = Builder.CreateGEP(NewPtr, Builder.getInt32(-(int)Index));
+    WidePtrs.push_back(
+        Builder.CreateBitCast(NewPtr, WideTy->getPointerTo(AddressSpace)));
+  }
+
+  // Handle loads: member i is made of elements i, i + Factor, etc.
+  if (LI) {
+    setDebugLocFromInst(Builder, LI);
+    for (unsigned Part = 0; Part < UF; ++Part) {
+      LoadInst *WideLoad = Builder.CreateLoad(WidePtrs[Part], "wide.vec");
+      WideLoad->setAlignment(Group->Alignment);
+
+      for (unsigned i = 0; i < Factor; ++i) {
+        SmallVector<Constant *, 16> Mask;
+        for (unsigned j = 0; j < VF; ++j)
+          Mask.push_back(Builder.getInt32(j * Factor + i));
+        WidenMap.get(Group->Members[i])[Part] = Builder.CreateShuffleVector(
+            WideLoad, UndefValue::get(WideTy), ConstantVector::get(Mask),
+            "strided.vec");
+      }
+    }
+    return;
+  }
+
+  // Handle stores: concatenate the stored vectors and interleave them.
+  setDebugLocFromInst(Builder, SI);
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    SmallVector<Value *, 4> StoredVecs;
+    for (unsigned i = 0; i < Factor; ++i) {
+      StoreInst *Member = cast<StoreInst>(Group->Members[i]);
+      StoredVecs.push_back(getVectorValue(Member->getValueOperand())[Part]);
+    }
+    Value *Concat = concatenateVectors(Builder, StoredVecs);
+
+    SmallVector<Constant *, 16> Mask;
+    for (unsigned j = 0; j < VF; ++j)
+      for (unsigned i = 0; i < Factor; ++i)
+        Mask.push_back(Builder.getInt32(i * VF + j));
+    Value *Interleaved = Builder.CreateShuffleVector(
+        Concat, UndefValue::get(WideTy), ConstantVector::get(Mask),
+        "interleaved.vec");
+    Builder.CreateStore(Interleaved, WidePtrs[Part])
+        ->setAlignment(Group->Alignment);
+  }
+}
+
 void InnerLoopVectorizer::scalarizeInstruction(Instruction *Instr, bool IfPredicateStore) {
   assert(!Instr->getType()->isAggregateType() && "Can't handle vectors");
   // Holds vector parameters or scalars, in case of uniform vals.
@@ -3305,6 +3702,22 @@ bool LoopVectorizationLegality::canVectorizeWithIfConvert() {
   return true;
 }
 
+bool LoopVectorizationLegality::canVectorizeMaskedOps() {
+  for (SmallPtrSet<const Instruction *, 8>::iterator I = MaskedOp.begin(),
+         E = MaskedOp.end(); I != E; ++I) {
+    LoadInst *LI = dyn_cast<LoadInst>(const_cast<Instruction *>(*I));
+    StoreInst *SI = dyn_cast<StoreInst>(const_cast<Instruction *>(*I));
+    Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+    Type *DataTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+    if (!isConsecutivePtr(Ptr) || isUniform(Ptr))
+      return false;
+    // Vector elements must be laid out like the scalars in memory.
+    if (DL->getTypeAllocSizeInBits(DataTy) != DataTy->getPrimitiveSizeInBits())
+      return false;
+  }
+  return true;
+}
+
 bool LoopVectorizationLegality::canVectorize() {
   // We must have a loop in canonical form. Loops with indirectbr in them cannot
   // be canonicalized.
@@ -3347,6 +3760,11 @@ bool LoopVectorizationLegality::canVectorize() {
     return false;
   }
 
+  if (!canVectorizeMaskedOps()) {
+    DEBUG(dbgs() << "LV: Can't widen the conditional memory accesses\n");
+    return false;
+  }
+
   // Go over each instruction and look at memory deps.
   if (!canVectorizeMemory()) {
     DEBUG(dbgs() << "LV: Can't vectorize due to memory conflicts\n");
@@ -4068,9 +4486,10 @@ public:
   typedef PointerIntPair<Value *, 1, bool> MemAccessInfo;
   typedef SmallPtrSet<MemAccessInfo, 8> MemAccessInfoSet;
 
-  MemoryDepChecker(ScalarEvolution *Se, const DataLayout *Dl, const Loop *L)
+  MemoryDepChecker(ScalarEvolution *Se, const DataLayout *Dl, const Loop *L,
+                   bool StridedGroups)
       : SE(Se), DL(Dl), InnermostLoop(L), AccessIdx(0),
-        ShouldRetryWithRuntimeCheck(false) {}
+        ShouldRetryWithRuntimeCheck(false), AllowStridedGroups(StridedGroups) {}
 
   /// \brief Register the location (instructions are given increasing numbers)
   /// of a write access.
@@ -4125,6 +4544,11 @@ private:
   /// vectorize this loop with runtime checks.
   bool ShouldRetryWithRuntimeCheck;
 
+  /// \brief Whether accesses with the same constant stride that never touch
+  /// the same element, such as the members of an interleaved group, may be
+  /// treated as independent.
+  bool AllowStridedGroups;
+
   /// \brief Check whether there is a plausible dependence between the two
   /// accesses.
   ///
@@ -4272,6 +4696,48 @@ bool MemoryDepChecker::couldPreventStoreLoadForward(unsigned Distance,
   return false;
 }
 
+/// \brief Check whether two accesses that advance by the same constant number
+/// of bytes per iteration never touch the same element, such as the members
+/// of an interleaved group: A[2*i] and A[2*i+1] are independent.
+static bool areStridedAccessesIndependent(ScalarEvolution *SE,
+                                          const DataLayout *DL, const Loop *L,
+                                          Value *APtr, const SCEV *AScev,
+                                          Value *BPtr, const SCEV *BScev) {
+  // Inbounds GEPs can't wrap around the address space and meet again.
+  GetElementPtrInst *AGEP = dyn_cast<GetElementPtrInst>(APtr);
+  GetElementPtrInst *BGEP = dyn_cast<GetElementPtrInst>(BPtr);
+  if (!AGEP || !BGEP || !AGEP->isInBounds() || !BGEP->isInBounds())
+    return false;
+
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(AScev);
+  const SCEVAddRecExpr *BR = dyn_cast<SCEVAddRecExpr>(BScev);
+  if (!AR || !BR || AR->getLoop() != L || BR->getLoop() != L ||
+      !AR->isAffine() || !BR->isAffine())
+    return false;
+  const SCEVConstant *Step =
+      dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step || Step != BR->getStepRecurrence(*SE))
+    return false;
+  const SCEVConstant *Dist =
+      dyn_cast<SCEVConstant>(SE->getMinusSCEV(BScev, AScev));
+  if (!Dist || Step->getValue()->getBitWidth() > 64)
+    return false;
+
+  int64_t Size = DL->getTypeAllocSize(APtr->getType()->getPointerElementType());
+  if (!Size ||
+      Size != (int64_t)DL->getTypeAllocSize(
+                  BPtr->getType()->getPointerElementType()))
+    return false;
+
+  // Both accesses cover whole elements of the same size, so they are disjoint
+  // unless their distance is a multiple of the step.
+  int64_t StepVal = Step->getValue()->getSExtValue();
+  int64_t DistVal = Dist->getValue()->getSExtValue();
+  if (!StepVal || StepVal % Size || DistVal % Size)
+    return false;
+  return DistVal % StepVal != 0;
+}
+
 bool MemoryDepChecker::isDependent(const MemAccessInfo &A, unsigned AIdx,
                                    const MemAccessInfo &B, unsigned BIdx,
                                    ValueToValueMap &Strides) {
@@ -4318,6 +4784,12 @@ bool MemoryDepChecker::isDependent(const MemAccessInfo &A, unsigned AIdx,
   // "A[B[i]] += ..." and similar code or pointer arithmetic that could wrap in
   // the address space.
   if (!StrideAPtr || !StrideBPtr || StrideAPtr != StrideBPtr){
+    if (AllowStridedGroups &&
+        areStridedAccessesIndependent(SE, DL, InnermostLoop, APtr, Src, BPtr,
+                                      Sink)) {
+      DEBUG(dbgs() << "LV: Strided accesses never overlap: NoDep\n");
+      return false;
+    }
     DEBUG(dbgs() << "Non-consecutive pointer access\n");
     return true;
   }
@@ -4451,7 +4923,8 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
   PtrRtCheck.Need = false;
 
   const bool IsAnnotatedParallel = TheLoop->isAnnotatedParallel();
-  MemoryDepChecker DepChecker(SE, DL, TheLoop);
+  MemoryDepChecker DepChecker(SE, DL, TheLoop,
+                              useInterleavedMemAccesses(*TTI));
 
   // For each block.
   for (Loop::block_iterator bb = TheLoop->block_begin(),
@@ -4995,21 +5468,33 @@ bool LoopVectorizationLegality::blockNeedsPredication(BasicBlock *BB)  {
 bool LoopVectorizationLegality::blockCanBePredicated(BasicBlock *BB,
                                             SmallPtrSet<Value *, 8>& SafePtrs) {
   for (BasicBlock::iterator it = BB->begin(), e = BB->end(); it != e; ++it) {
-    // We might be able to hoist the load.
+    // We might be able to hoist the load. Otherwise it has to be a masked
+    // load.
     if (it->mayReadFromMemory()) {
       LoadInst *LI = dyn_cast<LoadInst>(it);
-      if (!LI || !SafePtrs.count(LI->getPointerOperand()))
+      if (!LI)
         return false;
+      if (!SafePtrs.count(LI->getPointerOperand())) {
+        if (!LI->isSimple() || !TTI->isLegalMaskedLoad(LI->getType()))
+          return false;
+        MaskedOp.insert(LI);
+      }
     }
 
-    // We don't predicate stores at the moment.
+    // Stores are either masked vector stores, if the target has them, or
+    // scalarized behind a branch each.
     if (it->mayWriteToMemory()) {
       StoreInst *SI = dyn_cast<StoreInst>(it);
+      if (!SI)
+        return false;
+      if (SI->isSimple() &&
+          TTI->isLegalMaskedStore(SI->getValueOperand()->getType()))
+        MaskedOp.insert(SI);
       // We only support predication of stores in basic blocks with one
       // predecessor.
-      if (!SI || ++NumPredStores > NumberOfStoresToPredicate ||
-          !SafePtrs.count(SI->getPointerOperand()) ||
-          !SI->getParent()->getSinglePredecessor())
+      else if (++NumPredStores > NumberOfStoresToPredicate ||
+               !SafePtrs.count(SI->getPointerOperand()) ||
+               !SI->getParent()->getSinglePredecessor())
         return false;
     }
     if (it->mayThrow())
@@ -5189,6 +5674,11 @@ LoopVectorizationCostModel::selectUnrollFactor(bool OptForSize,
                                                unsigned VF,
                                                unsigned LoopCost) {
 
+  // Without vectorization the unroller would have to execute the conditional
+  // accesses that need a mask unconditionally.
+  if (VF == 1 && Legal->hasMaskedOps())
+    return 1;
+
   // -- The unroll heuristics --
   // We unroll the loop in order to expose ILP and reduce the loop overhead.
   // There are many micro-architectural considerations that we can't predict
@@ -5628,6 +6118,18 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
       return TTI.getAddressComputationCost(VectorTy) +
         TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
+    // Interleaved groups are costed as a whole at their insert position.
+    if (const LoopVectorizationLegality::InterleaveGroup *Group =
+            Legal->getInterleaveGroup(I)) {
+      if (I != Group->InsertPos)
+        return 0;
+      Type *WideTy = VectorType::get(ValTy, VF * Group->Factor);
+      return TTI.getAddressComputationCost(WideTy) +
+             TTI.getInterleavedMemoryOpCost(I->getOpcode(), WideTy,
+                                            Group->Factor, Group->Alignment,
+                                            AS);
+    }
+
     // Scalarized loads/stores.
     int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
     bool Reverse = ConsecutiveStride < 0;
@@ -5659,7 +6161,11 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
 
     // Wide load/stores.
     unsigned Cost = TTI.getAddressComputationCost(VectorTy);
-    Cost += TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
+    if (Legal->isMaskRequired(I))
+      Cost += TTI.getMaskedMemoryOpCost(I->getOpcode(), VectorTy, Alignment,
+                                        AS);
+    else
+      Cost += TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
     if (Reverse)
       Cost += TTI.getShuffleCost(TargetTransformInfo::SK_Reverse,
@@ -0,0 +1,21 @@
+; RUN: opt < %s -basicaa -aa-cache -aa-eval -gvn -aa-eval -print-all-alias-modref-info -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; GVN claims to preserve alias analysis, but it still rewrites the function
+; and deletes the redundant load, so the cache must be dropped before the
+; second evaluation.
+
+define i32 @f(i32* noalias %a, i32* %b) {
+  %x = load i32* %a
+  store i32 %x, i32* %b
+  %y = load i32* %a
+  %s = add i32 %x, %y
+  ret i32 %s
+}
+
+; CHECK: Function: f: 2 pointers, 0 call sites
+; CHECK: NoAlias: i32* %a, i32* %b
+; CHECK: Function: f: 2 pointers, 0 call sites
+; CHECK: NoAlias: i32* %a, i32* %b
+
+; CHECK: {{[1-9][0-9]*}} aa-cache - Number of times the alias query cache was dropped
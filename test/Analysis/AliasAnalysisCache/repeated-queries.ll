@@ -0,0 +1,27 @@
+; RUN: opt < %s -basicaa -aa-cache -aa-eval -print-alias-sets -print-all-alias-modref-info -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; The alias set tracker asks one of its questions twice, and the second one
+; is answered from the cache, with the same results.  The answers the evaluator
+; got are not reused by the alias set tracker, as the cache does not outlive
+; the pass that filled it.
+
+define void @f(i32* noalias %a, i32* noalias %b) {
+  %a1 = getelementptr i32* %a, i64 1
+  store i32 0, i32* %a
+  store i32 0, i32* %a1
+  store i32 0, i32* %b
+  ret void
+}
+
+; CHECK: Function: f: 3 pointers, 0 call sites
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+; CHECK-DAG: MayAlias: i32* %a, i32* %a1
+; CHECK-DAG: NoAlias: i32* %a1, i32* %b
+; CHECK: Alias Set Tracker: 2 alias sets for 3 pointer values.
+; CHECK-DAG: may alias, Mod Pointers: (i32* %a, {{[0-9]+}}), (i32* %a1, {{[0-9]+}})
+; CHECK-DAG: must alias, Mod Pointers: (i32* %b, {{[0-9]+}})
+
+; CHECK: 1 aa-cache - Number of alias queries answered from the cache
+; CHECK: 6 aa-cache - Number of alias queries forwarded down the AA chain
+; CHECK: 2 aa-cache - Number of times the alias query cache was dropped
@@ -0,0 +1,23 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-expr-depth=2 | FileCheck %s -check-prefix=LIMIT
+
+; Values nested deeper than the limit are treated as SCEVUnknown.
+; The use block is laid out first so that it is analyzed before its operands.
+
+define i32 @f(i32 %n) {
+entry:
+  br label %def
+
+use:
+  %r = add i32 %b, 1
+; CHECK: %r = add i32 %b, 1
+; CHECK-NEXT: -->  (7 + (3 * %n))
+; LIMIT: %r = add i32 %b, 1
+; LIMIT-NEXT: -->  (1 + (3 * %a))
+  ret i32 %r
+
+def:
+  %a = add i32 %n, 2
+  %b = mul i32 %a, 3
+  br label %use
+}
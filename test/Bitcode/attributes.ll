@@ -203,7 +203,7 @@ define void @f34()
 ; CHECK: define void @f34()
 {
         call void @nobuiltin() nobuiltin
-; CHECK: call void @nobuiltin() #24
+; CHECK: call void @nobuiltin() #25
         ret void;
 }
 
@@ -218,6 +218,12 @@ define void @f36(i8* inalloca) {
         ret void
 }
 
+define void @f37() hot
+; CHECK: define void @f37() #24
+{
+        ret void
+}
+
 ; CHECK: attributes #0 = { noreturn }
 ; CHECK: attributes #1 = { nounwind }
 ; CHECK: attributes #2 = { readnone }
@@ -242,5 +248,6 @@ define void @f36(i8* inalloca) {
 ; CHECK: attributes #21 = { sspstrong }
 ; CHECK: attributes #22 = { minsize }
 ; CHECK: attributes #23 = { noinline optnone }
-; CHECK: attributes #24 = { nobuiltin }
+; CHECK: attributes #24 = { hot }
+; CHECK: attributes #25 = { nobuiltin }
 
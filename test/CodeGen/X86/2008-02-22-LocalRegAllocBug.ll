@@ -1,4 +1,5 @@
 ; RUN: llc < %s -regalloc=fast -optimize-regalloc=0 -march=x86 -mattr=+mmx | grep esi
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs -o /dev/null
 ; PR2082
 ; Local register allocator was refusing to use ESI, EDI, and EBP so it ran out of
 ; registers.
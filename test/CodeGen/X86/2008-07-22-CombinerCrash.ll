@@ -1,4 +1,5 @@
 ; RUN: llc < %s -march=x86 -mattr=+sse2
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs -o /dev/null
 ; PR2566
 
 external global i16		; <i16*>:0 [#uses=1]
@@ -1,5 +1,6 @@
 ; REQUIRES: asserts
 ; RUN: llc < %s -mtriple=i386-apple-darwin -mattr=+sse2 -stats 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs -o /dev/null
 ; Now this test spills one register. But a reload in the loop is cheaper than
 ; the divsd so it's a win.
 
@@ -3,6 +3,7 @@
 ; RUN: not grep spill %t
 ; RUN: not grep "%rsp" %t
 ; RUN: not grep "%rbp" %t
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs -o /dev/null
 
 ; The register-pressure scheduler should be able to schedule this in a
 ; way that does not require spills.
@@ -1,4 +1,5 @@
 ; RUN: llc < %s -march=x86-64
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs -o /dev/null
 ; <rdar://problem/7499313>
 target triple = "i686-apple-darwin8"
 
@@ -0,0 +1,69 @@
+; RUN: llc -mtriple=x86_64-linux -ext-tsp-block-placement=always < %s | FileCheck %s
+; RUN: llc -mtriple=x86_64-linux -stats < %s 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+declare void @error(i32)
+
+; The rarely taken block goes after the loop, so that the hot path of the loop
+; body falls through into the latch.
+define void @hot_loop(i32 %n, i32* %a) {
+; CHECK-LABEL: hot_loop:
+; CHECK: %loop
+; CHECK-NOT: %cold
+; CHECK: %latch
+; CHECK: %cold
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %gep = getelementptr i32* %a, i32 %i
+  %v = load i32* %gep
+  %c = icmp eq i32 %v, 0
+  br i1 %c, label %cold, label %latch, !prof !1
+
+cold:
+  call void @error(i32 %i)
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !0
+
+exit:
+  ret void
+}
+
+; Only the function that asks for ext-TSP through its attribute uses it by
+; default.
+define void @with_attr(i32 %n, i32* %a) #0 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %gep = getelementptr i32* %a, i32 %i
+  %v = load i32* %gep
+  %c = icmp eq i32 %v, 0
+  br i1 %c, label %cold, label %latch, !prof !1
+
+cold:
+  call void @error(i32 %i)
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !0
+
+exit:
+  ret void
+}
+
+; STATS: 1 block-placement2 - Number of functions laid out by ext-TSP
+
+attributes #0 = { "block-placement"="ext-tsp" }
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
+!1 = metadata !{metadata !"branch_weights", i32 1, i32 100000}
@@ -61,3 +61,28 @@ define i32 @test5(i32 %a, i32* nocapture %b, i32 %x, i32 %y) {
 ; CHECK: cmov
 ; CHECK: cmov
 }
+
+; Profile data says the select almost always picks %x, use a branch.
+define i32 @test6(i32 %a, i32 %b, i32 %x, i32 %y) {
+  %cmp = icmp ult i32 %a, %b
+  %cond = select i1 %cmp, i32 %x, i32 %y, !prof !0
+  ret i32 %cond
+; CHECK-LABEL: test6:
+; CHECK: cmpl
+; CHECK-NOT: cmov
+; CHECK: j
+; CHECK-NOT: cmov
+}
+
+; Unbiased profile data, keep the cmov.
+define i32 @test7(i32 %a, i32 %b, i32 %x, i32 %y) {
+  %cmp = icmp ult i32 %a, %b
+  %cond = select i1 %cmp, i32 %x, i32 %y, !prof !1
+  ret i32 %cond
+; CHECK-LABEL: test7:
+; CHECK: cmpl
+; CHECK: cmov
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 2000, i32 1}
+!1 = metadata !{metadata !"branch_weights", i32 60, i32 40}
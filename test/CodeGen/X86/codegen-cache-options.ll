@@ -0,0 +1,31 @@
+; The module name, the asm printing options and the other command line
+; options are not in the bitcode, but they change the output, so they must be
+; part of the cache key.
+
+; RUN: rm -rf %t.cache %t.dir && mkdir %t.dir
+; RUN: cp %s %t.dir/a.ll && cp %s %t.dir/b.ll
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     %t.dir/a.ll -o - | FileCheck %s --check-prefix=A
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     %t.dir/b.ll -o - | FileCheck %s --check-prefix=B
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     -asm-verbose=false %t.dir/a.ll -o - | FileCheck %s --check-prefix=QUIET
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     -show-mc-encoding %t.dir/a.ll -o - | FileCheck %s --check-prefix=ENC
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     -x86-asm-syntax=intel %t.dir/a.ll -o - | FileCheck %s --check-prefix=INTEL
+; RUN: llc -mtriple=x86_64-unknown-unknown -codegen-cache-dir=%t.cache \
+; RUN:     -x86-asm-syntax=intel %t.dir/a.ll -o %t.s
+; RUN: FileCheck %s --check-prefix=INTEL < %t.s
+; RUN: ls %t.cache | count 5
+
+; A: .file "{{.*}}a.ll"
+; B: .file "{{.*}}b.ll"
+; QUIET-NOT: BB#0
+; ENC: encoding: [
+; INTEL: lea eax, dword ptr [rdi + rsi]
+
+define i32 @f(i32 %a, i32 %b) {
+  %c = add i32 %a, %b
+  ret i32 %c
+}
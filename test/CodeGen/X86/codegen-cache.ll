@@ -0,0 +1,18 @@
+; RUN: rm -rf %t.cache
+; RUN: llc -mtriple=x86_64-unknown-unknown -filetype=obj \
+; RUN:     -codegen-cache-dir=%t.cache %s -o %t1.o
+; RUN: ls %t.cache | count 1
+; RUN: llc -mtriple=x86_64-unknown-unknown -filetype=obj \
+; RUN:     -codegen-cache-dir=%t.cache %s -o %t2.o
+; RUN: ls %t.cache | count 1
+; RUN: cmp %t1.o %t2.o
+
+; Different options must not share an entry.
+; RUN: llc -mtriple=x86_64-unknown-unknown -filetype=obj -O0 \
+; RUN:     -codegen-cache-dir=%t.cache %s -o %t3.o
+; RUN: ls %t.cache | count 2
+
+define i32 @f(i32 %a, i32 %b) {
+  %c = add i32 %a, %b
+  ret i32 %c
+}
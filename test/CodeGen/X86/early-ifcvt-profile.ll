@@ -0,0 +1,50 @@
+; RUN: llc < %s -x86-early-ifcvt -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+target triple = "x86_64-apple-macosx10.8.0"
+
+; Profile data says if.then is almost never executed. A predicted branch is
+; cheaper than waiting for the compare, so don't if-convert.
+; CHECK-LABEL: biased:
+; CHECK: cmpl
+; CHECK-NOT: cmov
+; CHECK: j
+; CHECK-NOT: cmov
+; CHECK: ret
+define i32 @biased(i32 %a, i32 %b, i32 %c) nounwind {
+entry:
+  %cmp = icmp sgt i32 %a, %b
+  br i1 %cmp, label %if.then, label %if.end, !prof !0
+
+if.then:
+  %add = add i32 %c, %a
+  br label %if.end
+
+if.end:
+  %r = phi i32 [ %add, %if.then ], [ %c, %entry ]
+  ret i32 %r
+}
+
+; The weights describe the whole condition, but the block that ends with the
+; branch on %cmp2 only tests half of it, so the weights are not used there.
+; CHECK-LABEL: split:
+; CHECK: cmov
+; CHECK: ret
+define i32 @split(i32 %a, i32 %b, i32 %c, i32 %d) nounwind {
+entry:
+  %cmp1 = icmp sgt i32 %a, %b
+  %cmp2 = icmp sgt i32 %c, %d
+  %and = and i1 %cmp1, %cmp2
+  br i1 %and, label %if.then, label %if.end, !prof !0
+
+if.then:
+  %add = add i32 %c, %a
+  br label %if.end
+
+if.end:
+  %r = phi i32 [ %add, %if.then ], [ %c, %entry ]
+  ret i32 %r
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
+
+; CHECK: 1 early-ifcvt - Number of profiled branches kept as branches
@@ -1,6 +1,7 @@
 ; RUN: llc < %s -fast-isel -verify-machineinstrs -mtriple=x86_64-apple-darwin10
 ; RUN: llc < %s -fast-isel -verify-machineinstrs -mtriple=x86_64-pc-win32 | FileCheck %s -check-prefix=WIN32
 ; RUN: llc < %s -fast-isel -verify-machineinstrs -mtriple=x86_64-pc-win64 | FileCheck %s -check-prefix=WIN64
+; RUN: llc < %s -fast-isel -verify-machineinstrs -mtriple=x86_64-linux-gnux32 | FileCheck %s -check-prefix=X32
 ; REQUIRES: asserts
 
 ; Previously, this would cause an assert.
@@ -21,3 +22,18 @@ entry:
   %0 = load i32* %p, align 4
   ret i32 %0
 }
+
+; The sret pointer is returned in %eax, not %rax, on x32.
+%struct.S = type { i32, i32 }
+
+define void @sret(%struct.S* noalias sret %agg.result, i32 %a) {
+entry:
+; X32: sret
+; X32: movl %esi, (%edi)
+; X32: movl %edi, %eax
+; X32-NOT: %rax
+; X32: retq
+  %p = getelementptr inbounds %struct.S* %agg.result, i32 0, i32 0
+  store i32 %a, i32* %p, align 4
+  ret void
+}
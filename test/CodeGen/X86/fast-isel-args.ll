@@ -23,3 +23,19 @@ entry:
   %add2 = add nsw i64 %add, %conv1
   ret i64 %add2
 }
+
+define double @t4(double %a, float %b, i32 %c) {
+entry:
+  %conv = fpext float %b to double
+  %add = fadd double %a, %conv
+  ret double %add
+}
+
+%struct.S = type { i64, i64 }
+
+define void @t5(%struct.S* noalias sret %agg.result, i64 %a) {
+entry:
+  %p = getelementptr inbounds %struct.S* %agg.result, i64 0, i32 0
+  store i64 %a, i64* %p, align 8
+  ret void
+}
@@ -0,0 +1,64 @@
+; RUN: llc < %s -O0 -fast-isel-abort -verify-machineinstrs -mtriple=x86_64-apple-darwin10 -mattr=+sse2,-avx | FileCheck %s
+
+; Vector loads, vector bitcasts and a few intrinsics used to make fast-isel
+; fall back to SelectionDAG.
+
+define <4 x i32> @load_bitcast(<4 x float>* %p) nounwind {
+; CHECK-LABEL: load_bitcast:
+; CHECK: movaps (%rdi), %xmm0
+  %v = load <4 x float>* %p, align 16
+  %c = bitcast <4 x float> %v to <4 x i32>
+  ret <4 x i32> %c
+}
+
+define <2 x double> @load_unaligned(<2 x double>* %p) nounwind {
+; CHECK-LABEL: load_unaligned:
+; CHECK: movupd (%rdi), %xmm0
+  %v = load <2 x double>* %p, align 1
+  ret <2 x double> %v
+}
+
+define <2 x i64> @load_int(<2 x i64>* %p) nounwind {
+; CHECK-LABEL: load_int:
+; CHECK: movdqa (%rdi), %xmm0
+  %v = load <2 x i64>* %p, align 16
+  ret <2 x i64> %v
+}
+
+define double @sqrt(double* %p) nounwind {
+; CHECK-LABEL: sqrt:
+; CHECK: sqrtsd
+  %x = load double* %p
+  %r = call double @llvm.sqrt.f64(double %x)
+  ret double %r
+}
+
+define i32 @usub(i32* %p, i32* %q, i1* %o) nounwind {
+; CHECK-LABEL: usub:
+; CHECK: subl
+; CHECK: setb
+  %a = load i32* %p
+  %b = load i32* %q
+  %r = call { i32, i1 } @llvm.usub.with.overflow.i32(i32 %a, i32 %b)
+  %v = extractvalue { i32, i1 } %r, 0
+  %f = extractvalue { i32, i1 } %r, 1
+  store i1 %f, i1* %o
+  ret i32 %v
+}
+
+define i64 @ssub(i64* %p, i64* %q, i1* %o) nounwind {
+; CHECK-LABEL: ssub:
+; CHECK: subq
+; CHECK: seto
+  %a = load i64* %p
+  %b = load i64* %q
+  %r = call { i64, i1 } @llvm.ssub.with.overflow.i64(i64 %a, i64 %b)
+  %v = extractvalue { i64, i1 } %r, 0
+  %f = extractvalue { i64, i1 } %r, 1
+  store i1 %f, i1* %o
+  ret i64 %v
+}
+
+declare double @llvm.sqrt.f64(double)
+declare { i32, i1 } @llvm.usub.with.overflow.i32(i32, i32)
+declare { i64, i1 } @llvm.ssub.with.overflow.i64(i64, i64)
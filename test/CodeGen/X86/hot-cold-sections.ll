@@ -0,0 +1,39 @@
+; RUN: llc < %s -mtriple=x86_64-pc-linux | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-pc-linux -ffunction-sections | FileCheck %s -check-prefix=FSECT
+
+; Functions marked hot are placed in .text.hot and functions marked cold in
+; .text.unlikely on ELF targets.
+
+; CHECK: .text
+; CHECK-LABEL: f_plain:
+; CHECK: .section .text.hot,"ax",@progbits
+; CHECK-LABEL: f_hot:
+; CHECK: .section .text.unlikely,"ax",@progbits
+; CHECK-LABEL: f_cold:
+; CHECK: .section .text.unlikely.f_weak,"axG",@progbits,f_weak,comdat
+; CHECK-LABEL: f_weak:
+
+; FSECT: .section .text.f_plain,"ax",@progbits
+; FSECT-LABEL: f_plain:
+; FSECT: .section .text.hot.f_hot,"ax",@progbits
+; FSECT-LABEL: f_hot:
+; FSECT: .section .text.unlikely.f_cold,"ax",@progbits
+; FSECT-LABEL: f_cold:
+; FSECT: .section .text.unlikely.f_weak,"axG",@progbits,f_weak,comdat
+; FSECT-LABEL: f_weak:
+
+define void @f_plain() {
+  ret void
+}
+
+define void @f_hot() hot {
+  ret void
+}
+
+define void @f_cold() cold {
+  ret void
+}
+
+define linkonce_odr void @f_weak() cold {
+  ret void
+}
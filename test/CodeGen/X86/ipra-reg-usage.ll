@@ -0,0 +1,48 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -enable-ipra | FileCheck %s --check-prefix=IPRA
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s --check-prefix=NOIPRA
+
+; @leaf only clobbers %eax, so with interprocedural register allocation %b
+; can stay in its argument register across the call instead of being copied
+; to a callee saved register.
+
+; IPRA-LABEL: leaf:
+; IPRA-LABEL: caller:
+; IPRA-NOT: %rbx
+; IPRA: callq leaf
+; IPRA-NOT: %rbx
+; IPRA: retq
+
+; NOIPRA-LABEL: caller:
+; NOIPRA: pushq %rbx
+; NOIPRA: callq leaf
+; NOIPRA: popq %rbx
+
+define internal i32 @leaf(i32 %a) noinline {
+  %b = add i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @caller(i32 %a, i32 %b) {
+  %c = call i32 @leaf(i32 %a)
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+; A linkonce definition may be replaced at link time, so calls to it keep the
+; calling convention register mask.
+
+; IPRA-LABEL: caller_odr:
+; IPRA: pushq %rbx
+; IPRA: callq leaf_odr
+; IPRA: popq %rbx
+
+define linkonce_odr i32 @leaf_odr(i32 %a) noinline {
+  %b = add i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @caller_odr(i32 %a, i32 %b) {
+  %c = call i32 @leaf_odr(i32 %a)
+  %d = add i32 %c, %b
+  ret i32 %d
+}
@@ -0,0 +1,65 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -regalloc=linearscan -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -regalloc=linearscan -stats 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The values live across the calls in the loop do not fit in the callee saved
+; registers. The ones loaded first are evicted and spilled by heavier ones. %q
+; is cheaper than every range holding a register when it is reached, so it is
+; split around the blocks that use it and spilled in between.
+
+; CHECK-LABEL: pressure:
+; CHECK: callq g
+; CHECK: retq
+
+; STATS: live ranges split around blocks
+
+define i32 @pressure(i32* %p, i32 %n) {
+entry:
+  %a0 = load i32* %p
+  %p1 = getelementptr i32* %p, i64 1
+  %a1 = load i32* %p1
+  %p2 = getelementptr i32* %p, i64 2
+  %a2 = load i32* %p2
+  %p3 = getelementptr i32* %p, i64 3
+  %a3 = load i32* %p3
+  %p4 = getelementptr i32* %p, i64 4
+  %a4 = load i32* %p4
+  %p5 = getelementptr i32* %p, i64 5
+  %a5 = load i32* %p5
+  %p6 = getelementptr i32* %p, i64 6
+  %a6 = load i32* %p6
+  %p7 = getelementptr i32* %p, i64 7
+  %a7 = load i32* %p7
+  %q = load volatile i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  %c = icmp slt i32 %i, %a0
+  br i1 %c, label %call, label %latch
+
+call:
+  %r = call i32 @g(i32 %i)
+  %t0 = add i32 %r, %a1
+  %t1 = add i32 %t0, %a2
+  %t2 = add i32 %t1, %a3
+  br label %latch
+
+latch:
+  %v = phi i32 [ %t2, %call ], [ %a4, %loop ]
+  %u0 = add i32 %s, %v
+  %u1 = xor i32 %u0, %a5
+  %u2 = add i32 %u1, %a6
+  %s.next = mul i32 %u2, %a7
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %x = add i32 %s.next, %q
+  %y = mul i32 %x, %q
+  ret i32 %y
+}
+
+declare i32 @g(i32)
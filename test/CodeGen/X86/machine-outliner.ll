@@ -0,0 +1,74 @@
+; RUN: llc -mtriple=x86_64-linux -enable-machine-outliner < %s | FileCheck %s
+
+@a = global i32 0
+@b = global i32 0
+@c = global i32 0
+@d = global i32 0
+
+declare void @h()
+
+; The two copies of the stores are outlined into a new function.
+define void @f() {
+; CHECK-LABEL: f:
+; CHECK: callq OUTLINED_FUNCTION_0
+; CHECK-NEXT: callq h
+; CHECK-NEXT: callq OUTLINED_FUNCTION_0
+; CHECK-NEXT: callq h
+entry:
+  store i32 1, i32* @a
+  store i32 2, i32* @b
+  store i32 3, i32* @c
+  store i32 4, i32* @d
+  call void @h()
+  store i32 1, i32* @a
+  store i32 2, i32* @b
+  store i32 3, i32* @c
+  store i32 4, i32* @d
+  call void @h()
+  ret void
+}
+
+; A single copy of an outlined body is replaced with a call to it.
+define void @g() {
+; CHECK-LABEL: g:
+; CHECK: callq OUTLINED_FUNCTION_0
+; CHECK-NEXT: retq
+entry:
+  store i32 1, i32* @a
+  store i32 2, i32* @b
+  store i32 3, i32* @c
+  store i32 4, i32* @d
+  ret void
+}
+
+; Hot blocks of functions with profile data are left alone.
+define void @hot_loop(i32 %n) {
+; CHECK-LABEL: hot_loop:
+; CHECK-NOT: OUTLINED_FUNCTION
+; CHECK: retq
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store i32 1, i32* @a
+  store i32 2, i32* @b
+  store i32 3, i32* @c
+  store i32 4, i32* @d
+  call void @h()
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !0
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: OUTLINED_FUNCTION_0:
+; CHECK: movl $1, a(%rip)
+; CHECK-NEXT: movl $2, b(%rip)
+; CHECK-NEXT: movl $3, c(%rip)
+; CHECK-NEXT: movl $4, d(%rip)
+; CHECK-NEXT: retq
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
@@ -0,0 +1,122 @@
+; RUN: llc -mtriple=x86_64-apple-darwin -mcpu=core-avx2 < %s | FileCheck %s -check-prefix=AVX2
+; RUN: llc -mtriple=x86_64-apple-darwin -mcpu=knl < %s | FileCheck %s -check-prefix=AVX512
+; RUN: llc -mtriple=x86_64-apple-darwin -mcpu=corei7 < %s | FileCheck %s -check-prefix=SSE
+
+; The v8i1 mask of a 256-bit access is widened for VPMASKMOVD.
+; AVX512-LABEL: test1b:
+; AVX512: vpcmpeqd %zmm{{.*}}, %k1
+; AVX512: vpmovqd %zmm{{.*}}, %ymm
+; AVX512-NOT: j
+; AVX512: vpmaskmovd (%rdi)
+; AVX512: ret
+
+; AVX512-LABEL: test1:
+; AVX512: vpcmpeqd %zmm{{.*}}, %k1
+; AVX512: vmovdqu32 (%rdi), %zmm0 {%k1} {z}
+
+; AVX2-LABEL: test1b:
+; AVX2: vpmaskmovd (%rdi)
+; AVX2-NOT: blend
+; AVX2: ret
+
+define <8 x i32> @test1b(<8 x i32> %trigger, <8 x i32>* %addr) {
+  %mask = icmp eq <8 x i32> %trigger, zeroinitializer
+  %res = call <8 x i32> @llvm.masked.load.v8i32.p0v8i32.v8i1(<8 x i32>* %addr, i32 4, <8 x i1> %mask, <8 x i32> undef)
+  ret <8 x i32> %res
+}
+
+define <16 x i32> @test1(<16 x i32> %trigger, <16 x i32>* %addr) {
+  %mask = icmp eq <16 x i32> %trigger, zeroinitializer
+  %res = call <16 x i32> @llvm.masked.load.v16i32.p0v16i32.v16i1(<16 x i32>* %addr, i32 4, <16 x i1> %mask, <16 x i32> undef)
+  ret <16 x i32> %res
+}
+
+; AVX2-LABEL: test2:
+; AVX2: vmaskmovps (%rdi)
+; AVX2: vblendvps
+; AVX2: ret
+
+; AVX512-LABEL: test2:
+; AVX512-NOT: j
+; AVX512: vmaskmovps (%rdi)
+; AVX512: vblendvps
+; AVX512: ret
+
+; SSE-LABEL: test2:
+; SSE-NOT: maskmov
+; SSE: ret
+
+define <8 x float> @test2(<8 x i32> %trigger, <8 x float>* %addr, <8 x float> %dst) {
+  %mask = icmp eq <8 x i32> %trigger, zeroinitializer
+  %res = call <8 x float> @llvm.masked.load.v8f32.p0v8f32.v8i1(<8 x float>* %addr, i32 4, <8 x i1> %mask, <8 x float> %dst)
+  ret <8 x float> %res
+}
+
+; AVX2-LABEL: test3:
+; AVX2: vmaskmovpd %ymm{{.*}}, (%rdi)
+; AVX2: ret
+
+; AVX512-LABEL: test3:
+; AVX512-NOT: j
+; AVX512: vmaskmovpd %ymm{{.*}}, (%rdi)
+; AVX512: ret
+
+define void @test3(<4 x i64> %trigger, <4 x double>* %addr, <4 x double> %val) {
+  %mask = icmp eq <4 x i64> %trigger, zeroinitializer
+  call void @llvm.masked.store.v4f64.p0v4f64.v4i1(<4 x double> %val, <4 x double>* %addr, i32 4, <4 x i1> %mask)
+  ret void
+}
+
+; AVX512-LABEL: test4:
+; AVX512: vcmpeqps
+; AVX512: vmovups %zmm{{.*}}, (%rdi) {%k1}
+
+define void @test4(<16 x float> %trigger, <16 x float>* %addr, <16 x float> %val) {
+  %mask = fcmp oeq <16 x float> %trigger, zeroinitializer
+  call void @llvm.masked.store.v16f32.p0v16f32.v16i1(<16 x float> %val, <16 x float>* %addr, i32 4, <16 x i1> %mask)
+  ret void
+}
+
+; Without a masked move instruction, every element is stored behind a branch.
+; SSE-LABEL: test5:
+; SSE: je
+; SSE: movd %xmm1, (%rdi)
+; SSE: je
+; SSE: pextrd $1, %xmm1, 4(%rdi)
+; SSE: je
+; SSE: pextrd $2, %xmm1, 8(%rdi)
+; SSE: je
+; SSE: pextrd $3, %xmm1, 12(%rdi)
+; SSE: ret
+
+define void @test5(<4 x i32> %trigger, <4 x i32>* %addr, <4 x i32> %val) {
+  %mask = icmp eq <4 x i32> %trigger, zeroinitializer
+  call void @llvm.masked.store.v4i32.p0v4i32.v4i1(<4 x i32> %val, <4 x i32>* %addr, i32 4, <4 x i1> %mask)
+  ret void
+}
+
+; The store's v8i1 mask is widened the same way as a load's.
+; AVX512-LABEL: test6:
+; AVX512: vpcmpeqd %zmm{{.*}}, %k1
+; AVX512: vpmovqd %zmm{{.*}}, %ymm
+; AVX512-NOT: j
+; AVX512: vpmaskmovd %ymm{{.*}}, (%rdi)
+; AVX512: ret
+
+; AVX2-LABEL: test6:
+; AVX2: vpmaskmovd %ymm{{.*}}, (%rdi)
+; AVX2: ret
+
+define void @test6(<8 x i32> %trigger, <8 x i32>* %addr, <8 x i32> %val) {
+  %mask = icmp eq <8 x i32> %trigger, zeroinitializer
+  call void @llvm.masked.store.v8i32.p0v8i32.v8i1(<8 x i32> %val, <8 x i32>* %addr, i32 4, <8 x i1> %mask)
+  ret void
+}
+
+declare <16 x i32> @llvm.masked.load.v16i32.p0v16i32.v16i1(<16 x i32>*, i32, <16 x i1>, <16 x i32>)
+declare <8 x i32> @llvm.masked.load.v8i32.p0v8i32.v8i1(<8 x i32>*, i32, <8 x i1>, <8 x i32>)
+declare <8 x float> @llvm.masked.load.v8f32.p0v8f32.v8i1(<8 x float>*, i32, <8 x i1>, <8 x float>)
+declare void @llvm.masked.store.v4f64.p0v4f64.v4i1(<4 x double>, <4 x double>*, i32, <4 x i1>)
+declare void @llvm.masked.store.v16f32.p0v16f32.v16i1(<16 x float>, <16 x float>*, i32, <16 x i1>)
+declare void @llvm.masked.store.v4i32.p0v4i32.v4i1(<4 x i32>, <4 x i32>*, i32, <4 x i1>)
+declare void @llvm.masked.store.v8i32.p0v8i32.v8i1(<8 x i32>, <8 x i32>*, i32, <8 x i1>)
@@ -0,0 +1,141 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -enable-shrink-wrap | FileCheck %s --check-prefix=ENABLE
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s --check-prefix=DISABLE
+
+; The early exit does not need the stack frame, so with shrink-wrapping the
+; callee saved register is only saved and restored on the path with the calls.
+
+; ENABLE-LABEL: foo:
+; ENABLE-NOT: push
+; ENABLE: cmpl
+; ENABLE-NEXT: j{{[a-z]+}} [[EXIT:.LBB[0-9_]+]]
+; ENABLE: pushq %rbx
+; ENABLE: callq bar
+; ENABLE: callq bar
+; ENABLE: popq %rbx
+; ENABLE: [[EXIT]]:
+; ENABLE-NOT: pop
+; ENABLE: retq
+
+; DISABLE-LABEL: foo:
+; DISABLE: pushq %rbx
+; DISABLE: cmpl
+; DISABLE: popq %rbx
+; DISABLE-NEXT: retq
+
+define i32 @foo(i32 %a, i32 %b) nounwind {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %slow, label %exit
+
+slow:
+  %x = mul i32 %a, 7
+  %c = call i32 @bar(i32 %a)
+  %d = call i32 @bar(i32 %c)
+  %s = add i32 %d, %x
+  br label %exit
+
+exit:
+  %r = phi i32 [ %s, %slow ], [ 0, %entry ]
+  ret i32 %r
+}
+
+declare i32 @bar(i32)
+
+; The frame is only used on the paths through %work, %left and %right. They
+; meet again in %join, which is not a return block, so the callee saved
+; register is restored there and the return block stays frame free.
+
+; ENABLE-LABEL: join:
+; ENABLE-NOT: .cfi
+; ENABLE-NOT: push
+; ENABLE: cmpl
+; ENABLE-NEXT: j{{[a-z]+}} [[EXIT:.LBB[0-9_]+]]
+; ENABLE: pushq %rbx
+; ENABLE: callq bar
+; ENABLE: # %join
+; ENABLE-NEXT: callq bar
+; ENABLE-NEXT: addl
+; ENABLE-NEXT: popq %rbx
+; ENABLE-NEXT: [[EXIT]]:
+; ENABLE-NOT: pop
+; ENABLE: retq
+
+; DISABLE-LABEL: join:
+; DISABLE: pushq %rbx
+; DISABLE: cmpl
+; DISABLE: # %join
+; DISABLE-NOT: pop
+; DISABLE: # %exit
+; DISABLE: popq %rbx
+; DISABLE-NEXT: retq
+
+define i32 @join(i32 %a, i32 %b) nounwind {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %work, label %exit
+
+work:
+  %x = call i32 @bar(i32 %a)
+  %cmp2 = icmp sgt i32 %x, 0
+  br i1 %cmp2, label %left, label %right
+
+left:
+  %l = call i32 @bar(i32 %x)
+  br label %join
+
+right:
+  %r = call i32 @bar(i32 7)
+  br label %join
+
+join:
+  %p = phi i32 [ %l, %left ], [ %r, %right ]
+  %s = add i32 %p, %x
+  br label %exit
+
+exit:
+  %res = phi i32 [ %s, %join ], [ %b, %entry ]
+  %m = mul i32 %res, %res
+  ret i32 %m
+}
+
+; Without nounwind the function needs CFI, which would still describe the
+; frame after the restore in %join, so it is not shrink-wrapped.
+
+; ENABLE-LABEL: unwind:
+; ENABLE: pushq %rbx
+; ENABLE-NEXT: .Ltmp{{[0-9]+}}:
+; ENABLE-NEXT: .cfi_def_cfa_offset 16
+; ENABLE: .cfi_offset %rbx, -16
+; ENABLE: cmpl
+; ENABLE: # %exit
+; ENABLE: popq %rbx
+; ENABLE-NEXT: retq
+
+define i32 @unwind(i32 %a, i32 %b) {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %work, label %exit
+
+work:
+  %x = call i32 @bar(i32 %a)
+  %cmp2 = icmp sgt i32 %x, 0
+  br i1 %cmp2, label %left, label %right
+
+left:
+  %l = call i32 @bar(i32 %x)
+  br label %join
+
+right:
+  %r = call i32 @bar(i32 7)
+  br label %join
+
+join:
+  %p = phi i32 [ %l, %left ], [ %r, %right ]
+  %s = add i32 %p, %x
+  br label %exit
+
+exit:
+  %res = phi i32 [ %s, %join ], [ %b, %entry ]
+  %m = mul i32 %res, %res
+  ret i32 %m
+}
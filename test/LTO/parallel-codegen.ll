@@ -0,0 +1,53 @@
+; RUN: llvm-as < %s >%t1
+; RUN: llvm-lto -o %t2 -lto-partitions=2 %t1 -disable-opt -exported-symbol=foo -exported-symbol=bar
+; RUN: llvm-nm %t2.0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t2.1 | FileCheck --check-prefix=CHECK1 %s
+
+; The output does not depend on how the partitions are scheduled.
+; RUN: llvm-lto -o %t3 -lto-partitions=2 %t1 -disable-opt -exported-symbol=foo -exported-symbol=bar
+; RUN: cmp %t2.0 %t3.0
+; RUN: cmp %t2.1 %t3.1
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; @bump is called from both partitions, so it is exported under a new name.
+; @counter stays local to the partition of @bump, its only user.
+
+; CHECK0-NOT: bar
+; CHECK0: U bump.lto_priv
+; CHECK0-NOT: counter
+; CHECK0: T foo
+
+; CHECK1: T bar
+; CHECK1: T bump.lto_priv
+; CHECK1: b counter
+; CHECK1-NOT: foo
+
+@counter = internal global i32 0
+
+define internal void @bump() noinline {
+  %v = load i32* @counter
+  %n = add i32 %v, 1
+  store i32 %n, i32* @counter
+  ret void
+}
+
+define i32 @foo(i32 %a) {
+  call void @bump()
+  %b = mul i32 %a, %a
+  %c = add i32 %b, 7
+  %d = mul i32 %c, %a
+  %e = sub i32 %d, %b
+  %f = xor i32 %e, %c
+  %g = add i32 %f, %a
+  ret i32 %g
+}
+
+define i32 @bar(i32 %a) {
+  call void @bump()
+  %b = add i32 %a, 1
+  %c = mul i32 %b, %a
+  %d = sub i32 %c, 3
+  ret i32 %d
+}
@@ -0,0 +1,37 @@
+; RUN: opt < %s -inline -licm -globaldce -pass-cost-report -pass-cost-report-top=1000 -disable-output 2>&1 | FileCheck %s
+
+; Call graph SCC passes are attributed to the functions of the SCC, loop passes
+; to the function containing the loop and module passes to the module.  The
+; pass managers nested inside other pass managers are not reported themselves.
+
+; CHECK: pass,function,wall_seconds,insts_before,insts_after,malloc_bytes
+; CHECK-NOT: Pass Manager
+; CHECK-DAG: Function Integration/Inlining,callee,{{[0-9.]+}},2,2,
+; CHECK-DAG: Function Integration/Inlining,caller,{{[0-9.]+}},11,11,
+; CHECK-DAG: Loop Invariant Code Motion,caller,{{[0-9.]+}},12,12,
+; CHECK-DAG: Dead Global Elimination,<stdin>,{{[0-9.]+}},12,12,
+; CHECK-NOT: Pass Manager
+
+define internal i32 @callee(i32* %p) {
+  %v = load i32* %p
+  ret i32 %v
+}
+
+define i32 @caller(i32* %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %a = add i32 %n, 7
+  %c = call i32 @callee(i32* %p)
+  %t = add i32 %a, %c
+  %s.next = add i32 %s, %t
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
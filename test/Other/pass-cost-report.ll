@@ -0,0 +1,33 @@
+; RUN: opt < %s -instcombine -pass-cost-report -pass-cost-report-top=2 -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -passes='function(no-op-function)' -pass-cost-report -disable-output 2>&1 | FileCheck %s --check-prefix=NEWPM
+; RUN: opt < %s -instcombine -pass-cost-report -pass-cost-report-file=%t -disable-output
+; RUN: FileCheck %s --check-prefix=FILE < %t
+
+; Only the requested number of (pass, function) pairs is reported, and
+; instruction counts are taken before and after each pass. Which pairs are the
+; most expensive depends on timing, and the verifier is a function pass too.
+
+; CHECK: pass,function,wall_seconds,insts_before,insts_after,malloc_bytes
+; CHECK-NEXT: {{[^,]+}},{{foo|bar}},{{[0-9.]+}},{{[0-9]+}},{{[0-9]+}},{{-?[0-9]+}}
+; CHECK-NEXT: {{[^,]+}},{{foo|bar}},{{[0-9.]+}},{{[0-9]+}},{{[0-9]+}},{{-?[0-9]+}}
+; CHECK-NOT: ,{{foo|bar}},
+
+; NEWPM: pass,function,wall_seconds,insts_before,insts_after,malloc_bytes
+; NEWPM-DAG: NoOpFunctionPass,foo,{{[0-9.]+}},3,3,
+; NEWPM-DAG: NoOpFunctionPass,bar,{{[0-9.]+}},1,1,
+
+; FILE: pass,function,wall_seconds,insts_before,insts_after,malloc_bytes
+; FILE-DAG: Combine redundant instructions,foo,{{[0-9.]+}},3,2,
+; FILE-DAG: Combine redundant instructions,bar,{{[0-9.]+}},1,1,
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 1
+  %b = add i32 %a, 1
+  ret i32 %b
+}
+
+define void @bar() {
+  ret void
+}
+
+declare void @baz()
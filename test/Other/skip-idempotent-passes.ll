@@ -0,0 +1,33 @@
+; RUN: opt < %s -instcombine -simplifycfg -instcombine -skip-idempotent-passes -debug-pass=Executions -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -instcombine -simplifycfg -instcombine -debug-pass=Executions -disable-output 2>&1 | FileCheck %s --check-prefix=NOSKIP
+; RUN: opt < %s -early-cse -early-cse -skip-idempotent-passes -debug-pass=Executions -disable-output 2>&1 | FileCheck %s --check-prefix=EARLYCSE
+
+; SimplifyCFG leaves @f alone, so the second InstCombine run is skipped on it.
+; It folds the branch in @g, so InstCombine has to run on @g again.
+
+; CHECK: Executing Pass 'Combine redundant instructions' on Function 'f'
+; CHECK: Executing Pass 'Simplify the CFG' on Function 'f'
+; CHECK: Skipping Unchanged 'Combine redundant instructions' on Function 'f'
+; CHECK: Executing Pass 'Combine redundant instructions' on Function 'g'
+; CHECK: Executing Pass 'Simplify the CFG' on Function 'g'
+; CHECK: Made Modification 'Simplify the CFG' on Function 'g'
+; CHECK: Executing Pass 'Combine redundant instructions' on Function 'g'
+
+; NOSKIP-NOT: Skipping Unchanged
+
+; EarlyCSE does not reach a fixed point, so it always runs again.
+; EARLYCSE-NOT: Skipping Unchanged
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 1
+  %b = add i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @g(i32 %x) {
+entry:
+  br label %next
+
+next:
+  ret i32 %x
+}
@@ -0,0 +1,54 @@
+; RUN: opt < %s -function-order -S | FileCheck %s
+
+; @error is only called on a path the profile says is almost never taken,
+; and @work runs in a hot loop, so @work follows @main and @error goes last.
+
+; CHECK: define i32 @main(
+; CHECK: define internal void @work() #[[HOT:[0-9]+]]
+; CHECK: define void @other()
+; CHECK: define internal void @error() #[[COLD:[0-9]+]]
+; CHECK: attributes #[[HOT]] = { hot }
+; CHECK: attributes #[[COLD]] = { cold }
+
+declare void @sink()
+
+define internal void @error() {
+entry:
+  call void @sink()
+  ret void
+}
+
+define void @other() {
+entry:
+  call void @sink()
+  ret void
+}
+
+define internal void @work() {
+entry:
+  call void @sink()
+  ret void
+}
+
+define i32 @main(i32 %n) {
+entry:
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %fail, label %loop, !prof !0
+
+fail:
+  call void @error()
+  ret i32 1
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @work()
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !1
+
+exit:
+  ret i32 0
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 100000}
+!1 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
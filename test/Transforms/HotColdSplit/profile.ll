@@ -0,0 +1,89 @@
+; RUN: opt < %s -hotcoldsplit -S | FileCheck %s
+; RUN: opt < %s -hotcoldsplit -hotcoldsplit-min-size=1 -S | FileCheck %s -check-prefix=SMALL
+
+declare void @sink(i32)
+declare void @log(i32) cold
+
+; The error path is almost never taken according to the profile, so it is
+; moved out of the function.
+; CHECK-LABEL: define i32 @profiled(
+; CHECK: call void @profiled.cold.1(i32 %x)
+; CHECK-NOT: call void @sink
+; CHECK: ret i32 %x
+define i32 @profiled(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %error, label %exit, !prof !0
+
+error:
+  br label %error.body
+
+error.body:
+  %a = add i32 %x, 1
+  call void @sink(i32 %a)
+  %b = mul i32 %a, 3
+  call void @sink(i32 %b)
+  %d = xor i32 %b, 7
+  call void @sink(i32 %d)
+  %e = sub i32 %d, %x
+  call void @sink(i32 %e)
+  br label %exit
+
+exit:
+  ret i32 %x
+}
+
+; Both sides of the branch run, so nothing is cold.
+; CHECK-LABEL: define i32 @balanced(
+; CHECK-NOT: cold
+; CHECK: ret i32
+define i32 @balanced(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %then, label %exit, !prof !1
+
+then:
+  %a = add i32 %x, 1
+  call void @sink(i32 %a)
+  %b = mul i32 %a, 3
+  call void @sink(i32 %b)
+  %d = xor i32 %b, 7
+  call void @sink(i32 %d)
+  %e = sub i32 %d, %x
+  call void @sink(i32 %e)
+  br label %exit
+
+exit:
+  ret i32 %x
+}
+
+; Without a profile, calls to cold functions mark their blocks as cold.
+; Small regions are left alone unless asked for.
+; CHECK-LABEL: define void @cold_call(
+; CHECK: call void @log(i32 %x)
+; SMALL-LABEL: define void @cold_call(
+; SMALL: call void @cold_call.cold.1(i32 %x)
+define void @cold_call(i32 %x) {
+entry:
+  %c = icmp slt i32 %x, 0
+  br i1 %c, label %if.then, label %exit
+
+if.then:
+  call void @log(i32 %x)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; CHECK: define internal void @profiled.cold.1(i32 %x) #[[ATTR:[0-9]+]]
+; CHECK: call void @sink(i32 %a)
+; CHECK: call void @sink(i32 %e)
+; CHECK-NOT: define internal void @cold_call.cold.1
+; CHECK: attributes #[[ATTR]] = { cold noinline optsize }
+
+; SMALL: define internal void @cold_call.cold.1(i32 %x) #[[ATTR:[0-9]+]]
+; SMALL: attributes #[[ATTR]] = { cold noinline optsize }
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 100000}
+!1 = metadata !{metadata !"branch_weights", i32 50, i32 50}
@@ -0,0 +1,101 @@
+; RUN: opt < %s -icall-promotion -icp-min-count=100 -S | FileCheck %s
+
+define i32 @hot(i32 %x) {
+  ret i32 %x
+}
+
+define i32 @warm(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @cold(i32 %x) {
+  %r = add i32 %x, 2
+  ret i32 %r
+}
+
+define i64 @other_type(i64 %x) {
+  ret i64 %x
+}
+
+; The two hot targets are promoted, the cold one stays in the metadata.
+
+; CHECK-LABEL: @promote(
+; CHECK: %icp.cmp = icmp eq i32 (i32)* %fp, @hot
+; CHECK: br i1 %icp.cmp, label %if.true.direct_targ, label %if.false.orig_indirect, !prof [[HOT:![0-9]+]]
+; CHECK: if.true.direct_targ:
+; CHECK-NEXT: [[R1:%[0-9]+]] = call i32 @hot(i32 %x)
+; CHECK: if.false.orig_indirect:
+; CHECK: %icp.cmp1 = icmp eq i32 (i32)* %fp, @warm
+; CHECK: br i1 %icp.cmp1, {{.*}}, !prof [[WARM:![0-9]+]]
+; CHECK: call i32 @warm(i32 %x)
+; CHECK: call i32 %fp(i32 %x), !prof [[REST:![0-9]+]]
+; CHECK: phi i32
+; CHECK: %r = phi i32 [ [[R1]], %if.true.direct_targ ]
+; CHECK: ret i32 %r
+
+define i32 @promote(i32 (i32)* %fp, i32 %x) {
+entry:
+  %r = call i32 %fp(i32 %x), !prof !0
+  ret i32 %r
+}
+
+; A target whose type does not match the call is not promoted.
+
+; CHECK-LABEL: @type_mismatch(
+; CHECK-NOT: icmp
+; CHECK: call i32 %fp(i32 %x), !prof [[MISMATCH:![0-9]+]]
+; CHECK: ret
+
+define i32 @type_mismatch(i32 (i32)* %fp, i32 %x) {
+entry:
+  %r = call i32 %fp(i32 %x), !prof !1
+  ret i32 %r
+}
+
+; Nothing is promoted when no target is hot enough.
+
+; CHECK-LABEL: @too_cold(
+; CHECK-NOT: icmp
+; CHECK: call void %fp(), !prof [[TOOCOLD:![0-9]+]]
+; CHECK: ret
+
+define void @too_cold(void ()* %fp) {
+entry:
+  call void %fp(), !prof !2
+  ret void
+}
+
+; Invokes are not promoted.
+
+; CHECK-LABEL: @invoke(
+; CHECK-NOT: icmp
+; CHECK: invoke i32 %fp(i32 %x)
+; CHECK-NEXT: to label %cont unwind label %lpad, !prof [[INVOKE:![0-9]+]]
+
+define i32 @invoke(i32 (i32)* %fp, i32 %x) {
+entry:
+  %r = invoke i32 %fp(i32 %x)
+          to label %cont unwind label %lpad, !prof !0
+
+cont:
+  ret i32 %r
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  ret i32 0
+}
+
+declare i32 @__gxx_personality_v0(...)
+
+; CHECK-DAG: [[HOT]] = metadata !{metadata !"branch_weights", i32 600, i32 400}
+; CHECK-DAG: [[WARM]] = metadata !{metadata !"branch_weights", i32 300, i32 100}
+; CHECK-DAG: [[REST]] = metadata !{metadata !"indirect_call_targets", i64 100, metadata !"cold", i64 100}
+; CHECK-DAG: [[MISMATCH]] = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"other_type", i64 1000}
+; CHECK-DAG: [[INVOKE]] = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"hot", i64 600, metadata !"warm", i64 300, metadata !"cold", i64 100}
+; CHECK-DAG: [[TOOCOLD]] = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"missing", i64 50}
+
+!0 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"hot", i64 600, metadata !"warm", i64 300, metadata !"cold", i64 100}
+!1 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"other_type", i64 1000}
+!2 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"missing", i64 50}
@@ -0,0 +1,214 @@
+; REQUIRES: asserts
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -disable-inline-cost-summaries -S | FileCheck %s
+; RUN: opt < %s -inline -stats -disable-output 2>&1 | FileCheck %s -check-prefix=STATS
+
+; The call sites of @helper and @big pass no arguments the inline cost
+; analysis can simplify, so their cost comes from a summary of the callee
+; that is computed once. The walk of @big stops at the threshold, which the
+; summary cannot tell the cost at, so @big is walked at every call site.
+; Either way, the decisions are the same as without summaries.
+
+; STATS-DAG: 2 inline-cost - Number of call sites analyzed from a callee summary
+; STATS-DAG: 2 inline-cost - Number of callee summaries computed
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@g = global i32 0
+
+define i32 @helper(i32* %p, i32 %x) {
+entry:
+  %v = load i32* %p
+  %add = add nsw i32 %v, %x
+  store i32 %add, i32* %p
+  ret i32 %add
+}
+
+define i32 @big(i32 %x) {
+entry:
+  %l1 = load volatile i32* @g
+  %s1 = add i32 %x, %l1
+  %l2 = load volatile i32* @g
+  %s2 = add i32 %s1, %l2
+  %l3 = load volatile i32* @g
+  %s3 = add i32 %s2, %l3
+  %l4 = load volatile i32* @g
+  %s4 = add i32 %s3, %l4
+  %l5 = load volatile i32* @g
+  %s5 = add i32 %s4, %l5
+  %l6 = load volatile i32* @g
+  %s6 = add i32 %s5, %l6
+  %l7 = load volatile i32* @g
+  %s7 = add i32 %s6, %l7
+  %l8 = load volatile i32* @g
+  %s8 = add i32 %s7, %l8
+  %l9 = load volatile i32* @g
+  %s9 = add i32 %s8, %l9
+  %l10 = load volatile i32* @g
+  %s10 = add i32 %s9, %l10
+  %l11 = load volatile i32* @g
+  %s11 = add i32 %s10, %l11
+  %l12 = load volatile i32* @g
+  %s12 = add i32 %s11, %l12
+  %l13 = load volatile i32* @g
+  %s13 = add i32 %s12, %l13
+  %l14 = load volatile i32* @g
+  %s14 = add i32 %s13, %l14
+  %l15 = load volatile i32* @g
+  %s15 = add i32 %s14, %l15
+  %l16 = load volatile i32* @g
+  %s16 = add i32 %s15, %l16
+  %l17 = load volatile i32* @g
+  %s17 = add i32 %s16, %l17
+  %l18 = load volatile i32* @g
+  %s18 = add i32 %s17, %l18
+  %l19 = load volatile i32* @g
+  %s19 = add i32 %s18, %l19
+  %l20 = load volatile i32* @g
+  %s20 = add i32 %s19, %l20
+  %l21 = load volatile i32* @g
+  %s21 = add i32 %s20, %l21
+  %l22 = load volatile i32* @g
+  %s22 = add i32 %s21, %l22
+  %l23 = load volatile i32* @g
+  %s23 = add i32 %s22, %l23
+  %l24 = load volatile i32* @g
+  %s24 = add i32 %s23, %l24
+  %l25 = load volatile i32* @g
+  %s25 = add i32 %s24, %l25
+  %l26 = load volatile i32* @g
+  %s26 = add i32 %s25, %l26
+  %l27 = load volatile i32* @g
+  %s27 = add i32 %s26, %l27
+  %l28 = load volatile i32* @g
+  %s28 = add i32 %s27, %l28
+  %l29 = load volatile i32* @g
+  %s29 = add i32 %s28, %l29
+  %l30 = load volatile i32* @g
+  %s30 = add i32 %s29, %l30
+  %l31 = load volatile i32* @g
+  %s31 = add i32 %s30, %l31
+  %l32 = load volatile i32* @g
+  %s32 = add i32 %s31, %l32
+  %l33 = load volatile i32* @g
+  %s33 = add i32 %s32, %l33
+  %l34 = load volatile i32* @g
+  %s34 = add i32 %s33, %l34
+  %l35 = load volatile i32* @g
+  %s35 = add i32 %s34, %l35
+  %l36 = load volatile i32* @g
+  %s36 = add i32 %s35, %l36
+  %l37 = load volatile i32* @g
+  %s37 = add i32 %s36, %l37
+  %l38 = load volatile i32* @g
+  %s38 = add i32 %s37, %l38
+  %l39 = load volatile i32* @g
+  %s39 = add i32 %s38, %l39
+  %l40 = load volatile i32* @g
+  %s40 = add i32 %s39, %l40
+  %l41 = load volatile i32* @g
+  %s41 = add i32 %s40, %l41
+  %l42 = load volatile i32* @g
+  %s42 = add i32 %s41, %l42
+  %l43 = load volatile i32* @g
+  %s43 = add i32 %s42, %l43
+  %l44 = load volatile i32* @g
+  %s44 = add i32 %s43, %l44
+  %l45 = load volatile i32* @g
+  %s45 = add i32 %s44, %l45
+  %l46 = load volatile i32* @g
+  %s46 = add i32 %s45, %l46
+  %l47 = load volatile i32* @g
+  %s47 = add i32 %s46, %l47
+  %l48 = load volatile i32* @g
+  %s48 = add i32 %s47, %l48
+  %l49 = load volatile i32* @g
+  %s49 = add i32 %s48, %l49
+  %l50 = load volatile i32* @g
+  %s50 = add i32 %s49, %l50
+  %l51 = load volatile i32* @g
+  %s51 = add i32 %s50, %l51
+  %l52 = load volatile i32* @g
+  %s52 = add i32 %s51, %l52
+  %l53 = load volatile i32* @g
+  %s53 = add i32 %s52, %l53
+  %l54 = load volatile i32* @g
+  %s54 = add i32 %s53, %l54
+  %l55 = load volatile i32* @g
+  %s55 = add i32 %s54, %l55
+  %l56 = load volatile i32* @g
+  %s56 = add i32 %s55, %l56
+  %l57 = load volatile i32* @g
+  %s57 = add i32 %s56, %l57
+  %l58 = load volatile i32* @g
+  %s58 = add i32 %s57, %l58
+  %l59 = load volatile i32* @g
+  %s59 = add i32 %s58, %l59
+  %l60 = load volatile i32* @g
+  %s60 = add i32 %s59, %l60
+  %l61 = load volatile i32* @g
+  %s61 = add i32 %s60, %l61
+  %l62 = load volatile i32* @g
+  %s62 = add i32 %s61, %l62
+  %l63 = load volatile i32* @g
+  %s63 = add i32 %s62, %l63
+  %l64 = load volatile i32* @g
+  %s64 = add i32 %s63, %l64
+  %l65 = load volatile i32* @g
+  %s65 = add i32 %s64, %l65
+  %l66 = load volatile i32* @g
+  %s66 = add i32 %s65, %l66
+  %l67 = load volatile i32* @g
+  %s67 = add i32 %s66, %l67
+  %l68 = load volatile i32* @g
+  %s68 = add i32 %s67, %l68
+  %l69 = load volatile i32* @g
+  %s69 = add i32 %s68, %l69
+  %l70 = load volatile i32* @g
+  %s70 = add i32 %s69, %l70
+  %l71 = load volatile i32* @g
+  %s71 = add i32 %s70, %l71
+  %l72 = load volatile i32* @g
+  %s72 = add i32 %s71, %l72
+  %l73 = load volatile i32* @g
+  %s73 = add i32 %s72, %l73
+  %l74 = load volatile i32* @g
+  %s74 = add i32 %s73, %l74
+  %l75 = load volatile i32* @g
+  %s75 = add i32 %s74, %l75
+  %l76 = load volatile i32* @g
+  %s76 = add i32 %s75, %l76
+  %l77 = load volatile i32* @g
+  %s77 = add i32 %s76, %l77
+  %l78 = load volatile i32* @g
+  %s78 = add i32 %s77, %l78
+  %l79 = load volatile i32* @g
+  %s79 = add i32 %s78, %l79
+  %l80 = load volatile i32* @g
+  %s80 = add i32 %s79, %l80
+  ret i32 %s80
+}
+
+; CHECK-LABEL: @caller1(
+; CHECK-NOT: call i32 @helper
+; CHECK: call i32 @big(i32 %x)
+; CHECK: ret i32
+define i32 @caller1(i32* %p, i32 %x) {
+entry:
+  %a = call i32 @helper(i32* %p, i32 %x)
+  %b = call i32 @big(i32 %x)
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK-LABEL: @caller2(
+; CHECK-NOT: call i32 @helper
+; CHECK: call i32 @big(i32 %y)
+; CHECK: ret i32
+define i32 @caller2(i32* %q, i32 %y) {
+entry:
+  %a = call i32 @helper(i32* %q, i32 %y)
+  %b = call i32 @big(i32 %y)
+  %r = add i32 %a, %b
+  ret i32 %r
+}
@@ -0,0 +1,68 @@
+; RUN: opt < %s -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The loads of %a advance by 8KB and the loads of %c by a stride only known
+; at run time, so both get prefetches. The hardware prefetchers cover the
+; unit stride loads of %b.
+
+; CHECK-LABEL: @sum(
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; CHECK-NEXT: %va = load double* %pa
+; CHECK-NOT: @llvm.prefetch
+; CHECK: %vb = load double* %pb
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; CHECK-NEXT: %vc = load double* %pc
+; CHECK: ret double
+define double @sum(double* %a, double* %b, double* %c, i64 %n, i64 %stride) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi double [ 0.0, %entry ], [ %s.3, %loop ]
+  %big = mul nsw i64 %i, 1024
+  %pa = getelementptr inbounds double* %a, i64 %big
+  %va = load double* %pa, align 8
+  %pb = getelementptr inbounds double* %b, i64 %i
+  %vb = load double* %pb, align 8
+  %col = mul nsw i64 %i, %stride
+  %pc = getelementptr inbounds double* %c, i64 %col
+  %vc = load double* %pc, align 8
+  %s.1 = fadd double %s, %va
+  %s.2 = fadd double %s.1, %vb
+  %s.3 = fadd double %s.2, %vc
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret double %s.3
+}
+
+; The profile says this loop runs about twice per entry, which is too short
+; for prefetches to arrive in time.
+
+; CHECK-LABEL: @short_loop(
+; CHECK-NOT: @llvm.prefetch
+; CHECK: ret double
+define double @short_loop(double* %a, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi double [ 0.0, %entry ], [ %s.1, %loop ]
+  %big = mul nsw i64 %i, 1024
+  %pa = getelementptr inbounds double* %a, i64 %big
+  %va = load double* %pa, align 8
+  %s.1 = fadd double %s, %va
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop, !prof !0
+
+exit:
+  ret double %s.1
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1}
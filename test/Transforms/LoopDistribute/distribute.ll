@@ -0,0 +1,89 @@
+; RUN: opt < %s -basicaa -loop-distribute -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [101 x i32] zeroinitializer, align 16
+@B = common global [100 x i32] zeroinitializer, align 16
+@C = common global [100 x i32] zeroinitializer, align 16
+@D = common global [100 x i32] zeroinitializer, align 16
+
+; The recurrence on @A keeps the loop from being vectorized. Distribution
+; moves the independent statement on @C into a loop of its own, which comes
+; first, and leaves the recurrence in the original loop.
+;
+;   for (i = 0; i < 100; ++i) {
+;     A[i + 1] = A[i] + B[i];
+;     C[i] = D[i] * 3;
+;   }
+
+; CHECK-LABEL: @recurrence(
+; CHECK: for.body.ldist1:
+; CHECK-NEXT: %i.ldist1 = phi i64 [ 0, %entry ], [ %i.next.ldist1, %for.body.ldist1 ]
+; CHECK-NOT: @A
+; CHECK-NOT: @B
+; CHECK: store i32 %mul.ldist1, i32* %c.ldist1
+; CHECK: br i1 %exitcond.ldist1, label %for.body.ldist.exit1, label %for.body.ldist1
+; CHECK: for.body.ldist.exit1:
+; CHECK-NEXT: br label %for.body
+; CHECK: for.body:
+; CHECK-NEXT: %i = phi i64 [ 0, %for.body.ldist.exit1 ], [ %i.next, %for.body ]
+; CHECK-NOT: @C
+; CHECK-NOT: @D
+; CHECK: store i32 %add, i32* %a.next
+; CHECK-NOT: @C
+; CHECK-NOT: @D
+; CHECK: br i1 %exitcond, label %exit, label %for.body
+
+define void @recurrence() {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %a = getelementptr inbounds [101 x i32]* @A, i64 0, i64 %i
+  %va = load i32* %a, align 4
+  %b = getelementptr inbounds [100 x i32]* @B, i64 0, i64 %i
+  %vb = load i32* %b, align 4
+  %add = add nsw i32 %va, %vb
+  %i.next = add nuw nsw i64 %i, 1
+  %a.next = getelementptr inbounds [101 x i32]* @A, i64 0, i64 %i.next
+  store i32 %add, i32* %a.next, align 4
+  %d = getelementptr inbounds [100 x i32]* @D, i64 0, i64 %i
+  %vd = load i32* %d, align 4
+  %mul = mul nsw i32 %vd, 3
+  %c = getelementptr inbounds [100 x i32]* @C, i64 0, i64 %i
+  store i32 %mul, i32* %c, align 4
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %exit, label %for.body
+
+exit:
+  ret void
+}
+
+; Without a recurrence the loop can be vectorized as it is.
+
+; CHECK-LABEL: @no_recurrence(
+; CHECK-NOT: ldist
+; CHECK: ret void
+
+define void @no_recurrence() {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %b = getelementptr inbounds [100 x i32]* @B, i64 0, i64 %i
+  %vb = load i32* %b, align 4
+  %a = getelementptr inbounds [101 x i32]* @A, i64 0, i64 %i
+  store i32 %vb, i32* %a, align 4
+  %d = getelementptr inbounds [100 x i32]* @D, i64 0, i64 %i
+  %vd = load i32* %d, align 4
+  %c = getelementptr inbounds [100 x i32]* @C, i64 0, i64 %i
+  store i32 %vd, i32* %c, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 100
+  br i1 %exitcond, label %exit, label %for.body
+
+exit:
+  ret void
+}
@@ -0,0 +1,94 @@
+; RUN: opt < %s -basicaa -loop-interchange -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [100 x [100 x i32]] zeroinitializer, align 16
+
+; The inner loop walks a column of the row-major array @A. After the
+; interchange it walks a row.
+;
+;   for (j = 0; j < 100; ++j)
+;     for (i = 0; i < 100; ++i)
+;       A[i][j] += 1;
+
+; CHECK-LABEL: @column_walk(
+; CHECK: outer:
+; CHECK-NEXT: %j = phi i64 [ 0, %entry ], [ %j.next, %outer.latch ]
+; CHECK: inner:
+; CHECK: %p = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %j, i64 %i
+; CHECK: %i.next = add nsw i64 %i, 1
+; CHECK-NEXT: %inner.cond = icmp eq i64 %i.next, 100
+; CHECK: outer.latch:
+; CHECK-NEXT: %j.next = add nsw i64 %j, 1
+; CHECK-NEXT: %outer.cond = icmp eq i64 %j.next, 100
+
+define void @column_walk() {
+entry:
+  br label %outer
+
+outer:
+  %j = phi i64 [ 0, %entry ], [ %j.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %i = phi i64 [ 0, %outer ], [ %i.next, %inner ]
+  %p = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %i, i64 %j
+  %v = load i32* %p, align 4
+  %add = add nsw i32 %v, 1
+  store i32 %add, i32* %p, align 4
+  %i.next = add nsw i64 %i, 1
+  %inner.cond = icmp eq i64 %i.next, 100
+  br i1 %inner.cond, label %outer.latch, label %inner
+
+outer.latch:
+  %j.next = add nsw i64 %j, 1
+  %outer.cond = icmp eq i64 %j.next, 100
+  br i1 %outer.cond, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; Each iteration reads the element the previous iteration of the outer loop
+; wrote in a later iteration of the inner loop. The dependence has a (<, >)
+; direction, so the loops cannot be interchanged.
+;
+;   for (j = 1; j < 100; ++j)
+;     for (i = 0; i < 99; ++i)
+;       A[i][j] = A[i + 1][j - 1] + 1;
+
+; CHECK-LABEL: @reversed_dependence(
+; CHECK: %i.succ = add nsw i64 %i, 1
+; CHECK-NEXT: %j.prev = add nsw i64 %j, -1
+; CHECK-NEXT: %src = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %i.succ, i64 %j.prev
+; CHECK: %dst = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %i, i64 %j
+
+define void @reversed_dependence() {
+entry:
+  br label %outer
+
+outer:
+  %j = phi i64 [ 1, %entry ], [ %j.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %i = phi i64 [ 0, %outer ], [ %i.next, %inner ]
+  %i.succ = add nsw i64 %i, 1
+  %j.prev = add nsw i64 %j, -1
+  %src = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %i.succ, i64 %j.prev
+  %v = load i32* %src, align 4
+  %add = add nsw i32 %v, 1
+  %dst = getelementptr inbounds [100 x [100 x i32]]* @A, i64 0, i64 %i, i64 %j
+  store i32 %add, i32* %dst, align 4
+  %i.next = add nsw i64 %i, 1
+  %inner.cond = icmp eq i64 %i.next, 99
+  br i1 %inner.cond, label %outer.latch, label %inner
+
+outer.latch:
+  %j.next = add nsw i64 %j, 1
+  %outer.cond = icmp eq i64 %j.next, 100
+  br i1 %outer.cond, label %exit, label %outer
+
+exit:
+  ret void
+}
@@ -0,0 +1,105 @@
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -mcpu=core-avx2 -S | FileCheck %s -check-prefix=AVX2
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -mcpu=knl -S | FileCheck %s -check-prefix=AVX512
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -mcpu=corei7 -S | FileCheck %s -check-prefix=SSE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The load of B[i] and the store to A[i] only happen when trigger[i] is less
+; than 100, so they can't be hoisted out of the condition.
+;
+; void foo1(int *A, int *B, int *trigger) {
+;   for (int i = 0; i < 10000; i++)
+;     if (trigger[i] < 100)
+;       A[i] = B[i] + trigger[i];
+; }
+
+; AVX2-LABEL: @foo1(
+; AVX2: icmp slt <8 x i32>
+; AVX2: call <8 x i32> @llvm.masked.load.v8i32.p0v8i32.v8i1(<8 x i32>* %{{.*}}, i32 4, <8 x i1> %{{.*}}, <8 x i32> undef)
+; AVX2: add nsw <8 x i32>
+; AVX2: call void @llvm.masked.store.v8i32.p0v8i32.v8i1(<8 x i32> %{{.*}}, <8 x i32>* %{{.*}}, i32 4, <8 x i1> %{{.*}})
+; AVX2: ret void
+
+; The vectorizer only uses 256-bit registers on AVX-512 targets.
+; AVX512-LABEL: @foo1(
+; AVX512: icmp slt <8 x i32>
+; AVX512: call <8 x i32> @llvm.masked.load.v8i32.p0v8i32.v8i1(
+; AVX512: add nsw <8 x i32>
+; AVX512: call void @llvm.masked.store.v8i32.p0v8i32.v8i1(
+; AVX512: ret void
+
+; SSE-LABEL: @foo1(
+; SSE-NOT: llvm.masked
+; SSE-NOT: <4 x i32>
+; SSE: ret void
+
+define void @foo1(i32* nocapture %A, i32* nocapture readonly %B, i32* nocapture readonly %trigger) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.inc ]
+  %arrayidx = getelementptr inbounds i32* %trigger, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %cmp1 = icmp slt i32 %0, 100
+  br i1 %cmp1, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx3 = getelementptr inbounds i32* %B, i64 %indvars.iv
+  %1 = load i32* %arrayidx3, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx7 = getelementptr inbounds i32* %A, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx7, align 4
+  br label %for.inc
+
+for.inc:
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 10000
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Reverse accesses reverse the mask as well.
+;
+; void foo2(double *A, double *B, int *trigger) {
+;   for (int i = 4095; i >= 0; i--)
+;     if (trigger[i] > 0)
+;       A[i] = B[i] + 0.5;
+; }
+
+; AVX2-LABEL: @foo2(
+; AVX2: shufflevector <4 x i1> %{{.*}}, <4 x i1> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+; AVX2: call <4 x double> @llvm.masked.load.v4f64.p0v4f64.v4i1(
+; AVX2: call void @llvm.masked.store.v4f64.p0v4f64.v4i1(
+; AVX2: ret void
+
+define void @foo2(double* nocapture %A, double* nocapture readonly %B, i32* nocapture readonly %trigger) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 4095, %entry ], [ %indvars.iv.next, %for.inc ]
+  %arrayidx = getelementptr inbounds i32* %trigger, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %cmp1 = icmp sgt i32 %0, 0
+  br i1 %cmp1, label %if.then, label %for.inc
+
+if.then:
+  %arrayidx3 = getelementptr inbounds double* %B, i64 %indvars.iv
+  %1 = load double* %arrayidx3, align 8
+  %add = fadd double %1, 5.000000e-01
+  %arrayidx5 = getelementptr inbounds double* %A, i64 %indvars.iv
+  store double %add, double* %arrayidx5, align 8
+  br label %for.inc
+
+for.inc:
+  %indvars.iv.next = add nsw i64 %indvars.iv, -1
+  %cmp = icmp sgt i64 %indvars.iv, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
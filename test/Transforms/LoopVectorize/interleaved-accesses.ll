@@ -0,0 +1,188 @@
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -force-vector-width=4 -enable-interleaved-mem-accesses -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -force-vector-width=4 -enable-interleaved-mem-accesses=false -S | FileCheck %s --check-prefix=DISABLED
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -force-vector-width=4 -mtriple=x86_64-unknown-linux -mcpu=corei7-avx -S | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; Check that groups of strided accesses that cover whole structures are
+; vectorized with one wide access and shuffles.
+
+; void load_pair(int *A, int *B) {
+;   for (int i = 0; i < 1024; ++i)
+;     B[i] = A[2 * i] + A[2 * i + 1];
+; }
+
+; CHECK-LABEL: @load_pair(
+; CHECK: %wide.vec = load <8 x i32>* %{{.*}}, align 4
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+; CHECK: add nsw <4 x i32>
+; CHECK: store <4 x i32>
+; CHECK: ret void
+
+define void @load_pair(i32* noalias nocapture %A, i32* noalias nocapture %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %idx0 = shl nsw i64 %iv, 1
+  %p0 = getelementptr inbounds i32* %A, i64 %idx0
+  %a0 = load i32* %p0, align 4
+  %idx1 = add nsw i64 %idx0, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %idx1
+  %a1 = load i32* %p1, align 4
+  %add = add nsw i32 %a0, %a1
+  %pb = getelementptr inbounds i32* %B, i64 %iv
+  store i32 %add, i32* %pb, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; void store_pair(int *A, int *B, int *C) {
+;   for (int i = 0; i < 1024; ++i) {
+;     int c = C[i], b = B[i];
+;     A[2 * i + 1] = c;
+;     A[2 * i] = b;
+;   }
+; }
+
+; CHECK-LABEL: @store_pair(
+; CHECK: %[[C:.*]] = load <4 x i32>
+; CHECK: %[[B:.*]] = load <4 x i32>
+; CHECK: %[[CAT:.*]] = shufflevector <4 x i32> %[[B]], <4 x i32> %[[C]], <8 x i32> <i32 0, i32 1, i32 2, i32 3, i32 4, i32 5, i32 6, i32 7>
+; CHECK: %interleaved.vec = shufflevector <8 x i32> %[[CAT]], <8 x i32> undef, <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+; CHECK: store <8 x i32> %interleaved.vec, <8 x i32>* %{{.*}}, align 4
+; CHECK: ret void
+
+; Without interleaved groups the dependence checker can't tell the two
+; stores to A apart, so the loop is not vectorized.
+
+; DISABLED-LABEL: @store_pair(
+; DISABLED-NOT: store <
+; DISABLED: ret void
+
+define void @store_pair(i32* noalias nocapture %A, i32* noalias nocapture %B, i32* noalias nocapture %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %pc = getelementptr inbounds i32* %C, i64 %iv
+  %c = load i32* %pc, align 4
+  %pb = getelementptr inbounds i32* %B, i64 %iv
+  %b = load i32* %pb, align 4
+  %idx0 = shl nsw i64 %iv, 1
+  %idx1 = add nsw i64 %idx0, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %idx1
+  store i32 %c, i32* %p1, align 4
+  %p0 = getelementptr inbounds i32* %A, i64 %idx0
+  store i32 %b, i32* %p0, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Three members: x, y and z coordinates.
+
+; CHECK-LABEL: @load_triple(
+; CHECK: %wide.vec = load <12 x float>* %{{.*}}, align 4
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 0, i32 3, i32 6, i32 9>
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 1, i32 4, i32 7, i32 10>
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 2, i32 5, i32 8, i32 11>
+; CHECK: ret void
+
+define void @load_triple(float* noalias nocapture %P, float* noalias nocapture %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %idx0 = mul nsw i64 %iv, 3
+  %p0 = getelementptr inbounds float* %P, i64 %idx0
+  %x = load float* %p0, align 4
+  %idx1 = add nsw i64 %idx0, 1
+  %p1 = getelementptr inbounds float* %P, i64 %idx1
+  %y = load float* %p1, align 4
+  %idx2 = add nsw i64 %idx0, 2
+  %p2 = getelementptr inbounds float* %P, i64 %idx2
+  %z = load float* %p2, align 4
+  %xy = fadd float %x, %y
+  %xyz = fadd float %xy, %z
+  %pb = getelementptr inbounds float* %B, i64 %iv
+  store float %xyz, float* %pb, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Don't combine the loads when a store between them would have to be moved.
+
+; CHECK-LABEL: @store_in_between(
+; CHECK-NOT: %wide.vec
+; CHECK: store <4 x i32>
+; CHECK-NOT: %wide.vec
+; CHECK: ret void
+
+define void @store_in_between(i32* noalias nocapture %A, i32* noalias nocapture %B, i32* noalias nocapture %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %idx0 = shl nsw i64 %iv, 1
+  %p0 = getelementptr inbounds i32* %A, i64 %idx0
+  %a0 = load i32* %p0, align 4
+  %pb = getelementptr inbounds i32* %B, i64 %iv
+  store i32 %a0, i32* %pb, align 4
+  %idx1 = add nsw i64 %idx0, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %idx1
+  %a1 = load i32* %p1, align 4
+  %pc = getelementptr inbounds i32* %C, i64 %iv
+  store i32 %a1, i32* %pc, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A gap in the structure is not supported.
+
+; CHECK-LABEL: @load_gap(
+; CHECK-NOT: %wide.vec
+; CHECK: ret void
+
+define void @load_gap(i32* noalias nocapture %A, i32* noalias nocapture %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %idx0 = mul nsw i64 %iv, 3
+  %p0 = getelementptr inbounds i32* %A, i64 %idx0
+  %a0 = load i32* %p0, align 4
+  %idx1 = add nsw i64 %idx0, 1
+  %p1 = getelementptr inbounds i32* %A, i64 %idx1
+  %a1 = load i32* %p1, align 4
+  %add = add nsw i32 %a0, %a1
+  %pb = getelementptr inbounds i32* %B, i64 %iv
+  store i32 %add, i32* %pb, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,63 @@
+; RUN: opt -S -mergefunc < %s | FileCheck %s
+; RUN: opt -mergefunc -disable-output -stats < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; The GEPs in @a and @c have constant offsets and the one in @b does not, and
+; each one indexes a different pointee type. GEPs with constant offsets are
+; ordered by offset, so the others must not be ordered against them by
+; pointee type, or the three would form a cycle. Each copy must find its
+; original.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; STATS: 3 mergefunc - Number of functions merged
+
+; CHECK-LABEL: define i8* @a(
+; CHECK: getelementptr i8* %p8, i64 8
+define i8* @a(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i8* %p8, i64 8
+  %c = bitcast i8* %g to i8*
+  ret i8* %c
+}
+
+; CHECK-LABEL: define i8* @b(
+; CHECK: getelementptr i16* %p16, i64 %i
+define i8* @b(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i16* %p16, i64 %i
+  %c = bitcast i16* %g to i8*
+  ret i8* %c
+}
+
+; CHECK-LABEL: define i8* @c(
+; CHECK: getelementptr i32* %p32, i64 1
+define i8* @c(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i32* %p32, i64 1
+  %c = bitcast i32* %g to i8*
+  ret i8* %c
+}
+
+define i8* @c_copy(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i32* %p32, i64 1
+  %c = bitcast i32* %g to i8*
+  ret i8* %c
+}
+
+define i8* @b_copy(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i16* %p16, i64 %i
+  %c = bitcast i16* %g to i8*
+  ret i8* %c
+}
+
+define i8* @a_copy(i8* %p8, i16* %p16, i32* %p32, i64 %i) {
+  %g = getelementptr i8* %p8, i64 8
+  %c = bitcast i8* %g to i8*
+  ret i8* %c
+}
+
+; CHECK-LABEL: define i8* @c_copy(
+; CHECK-NEXT: tail call i8* @c(
+; CHECK-LABEL: define i8* @b_copy(
+; CHECK-NEXT: tail call i8* @b(
+; CHECK-LABEL: define i8* @a_copy(
+; CHECK-NEXT: tail call i8* @a(
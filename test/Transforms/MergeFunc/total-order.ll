@@ -0,0 +1,67 @@
+; RUN: opt -S -mergefunc < %s | FileCheck %s
+; RUN: opt -mergefunc -disable-output -stats < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; All of these functions have the same structural hash and differ only in
+; their constants, so they have to be told apart by the ordering of the
+; function tree. Only the two copies of @c1 are equal.
+
+; STATS: 1 mergefunc - Number of functions merged
+; STATS: 1 mergefunc - Number of functions skipped because their hash is unique
+
+; CHECK-LABEL: define i32 @c1(
+; CHECK: mul i32 %x, 3
+define i32 @c1(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %x, 3
+  %c = xor i32 %a, %b
+  ret i32 %c
+}
+
+; CHECK-LABEL: define i32 @c2(
+; CHECK: mul i32 %x, 7
+define i32 @c2(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %x, 7
+  %c = xor i32 %a, %b
+  ret i32 %c
+}
+
+; CHECK-LABEL: define i32 @c3(
+; CHECK: add i32 %x, 2
+define i32 @c3(i32 %x) {
+  %a = add i32 %x, 2
+  %b = mul i32 %x, 3
+  %c = xor i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @c1_copy(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %x, 3
+  %c = xor i32 %a, %b
+  ret i32 %c
+}
+
+; CHECK-LABEL: define i32 @c4(
+; CHECK: xor i32 %b, %a
+define i32 @c4(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %x, 3
+  %c = xor i32 %b, %a
+  ret i32 %c
+}
+
+; The only function with this shape.
+; CHECK-LABEL: define i32 @unique(
+define i32 @unique(i32 %x) {
+  %a = sub i32 %x, 1
+  %b = sub i32 %a, 3
+  ret i32 %b
+}
+
+; The thunk replacing @c1_copy is emitted at the end of the module.
+; CHECK-LABEL: define i32 @c1_copy(
+; CHECK-NEXT: tail call i32 @c1(i32 %0)
+; CHECK-NEXT: ret i32
@@ -1,4 +1,6 @@
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof | opt -analyze -branch-prob | FileCheck %s
+; RUN: llvm-profdata merge -sample %S/Inputs/branch.prof -o %t.profdata
+; RUN: opt < %s -sample-profile -sample-profile-file=%t.profdata | opt -analyze -branch-prob | FileCheck %s
 
 ; Original C++ code for this test case:
 ;
@@ -0,0 +1,42 @@
+; RUN: opt < %s -simplifycfg -S | FileCheck %s
+; RUN: opt < %s -simplifycfg -simplifycfg -debug-pass=Executions -disable-output 2>&1 | FileCheck %s --check-prefix=AGAIN
+
+; Hoisting the call to @foo out of %a and %b leaves %b as an empty return
+; block.  It has to be merged with %a1 in the same run, so that the branches
+; can be folded and a second run has nothing left to do.
+
+; CHECK-LABEL: @h(
+; CHECK: call void @foo()
+; CHECK-NEXT: %c.not = xor i1 %c, true
+; CHECK-NEXT: %brmerge = or i1 %c.not, %d
+; CHECK-NEXT: br i1 %brmerge, label %a1, label %a2
+; CHECK: a1:
+; CHECK-NEXT: ret void
+; CHECK: a2:
+; CHECK-NEXT: call void @bar()
+; CHECK-NEXT: ret void
+; CHECK-NEXT: }
+
+; AGAIN: Executing Pass 'Simplify the CFG' on Function 'h'
+; AGAIN-NEXT: Made Modification 'Simplify the CFG' on Function 'h'
+; AGAIN: Executing Pass 'Simplify the CFG' on Function 'h'
+; AGAIN-NOT: Made Modification 'Simplify the CFG'
+
+declare void @foo()
+declare void @bar()
+
+define void @h(i1 %c, i1 %d) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  call void @foo()
+  br i1 %d, label %a1, label %a2
+a1:
+  ret void
+a2:
+  call void @bar()
+  ret void
+b:
+  call void @foo()
+  ret void
+}
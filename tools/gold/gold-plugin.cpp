@@ -14,6 +14,7 @@
 
 #include "llvm/Config/config.h" // plugin-api.h requires HAVE_STDINT_H
 #include "llvm-c/lto.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Errno.h"
 #include "llvm/Support/FileSystem.h"
@@ -85,6 +86,9 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of partitions to split the module into for parallel code
+  // generation, one object file each.
+  static unsigned jobs = 1;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -106,6 +110,11 @@ namespace options {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, jobs) || jobs == 0) {
+        (*message)(LDPL_FATAL, "Invalid parallelism level: %s", opt_);
+        jobs = 1;
+      }
     } else if (opt.startswith("obj-path=")) {
       obj_path = opt.substr(strlen("obj-path="));
     } else if (opt == "emit-llvm") {
@@ -446,13 +455,21 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  std::string ObjPath;
+  if (options::jobs > 1) {
+    std::string Partitions = "-lto-partitions=" + utostr(options::jobs);
+    lto_codegen_debug_options(code_gen, Partitions.c_str());
+  }
+
+  // Add the object files in partition order, so that the link does not
+  // depend on how the partitions were scheduled.
+  std::vector<std::string> ObjPaths;
   {
-    const char *Temp;
-    if (lto_codegen_compile_to_file(code_gen, &Temp)) {
+    unsigned NumObjs = 0;
+    if (lto_codegen_compile_to_files(code_gen, &NumObjs)) {
       (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
     }
-    ObjPath = Temp;
+    for (unsigned i = 0; i != NumObjs; ++i)
+      ObjPaths.push_back(lto_codegen_get_object_file(code_gen, i));
   }
 
   lto_codegen_dispose(code_gen);
@@ -464,10 +481,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(ObjPath.c_str()) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", ObjPath.c_str());
-    return LDPS_ERR;
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(ObjPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", ObjPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -477,7 +496,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(ObjPath);
+    Cleanup.insert(Cleanup.end(), ObjPaths.begin(), ObjPaths.end());
 
   return LDPS_OK;
 }
@@ -14,7 +14,9 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
@@ -31,7 +33,9 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
@@ -39,6 +43,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Target/CodeGenCache.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
 #include <memory>
@@ -83,6 +88,19 @@ DisableSimplifyLibCalls("disable-simplify-libcalls",
                         cl::desc("Disable simplify-libcalls"),
                         cl::init(false));
 
+static cl::opt<std::string>
+CodeGenCacheDir("codegen-cache-dir", cl::value_desc("directory"),
+                cl::desc("Reuse output from previous compilations of the same "
+                         "module with the same target options, cached in "
+                         "this directory"));
+
+static cl::opt<unsigned>
+CodeGenCacheMaxSize("codegen-cache-max-size", cl::value_desc("megabytes"),
+                    cl::init(0),
+                    cl::desc("Prune the least recently used entries of the "
+                             "codegen cache to stay under this size "
+                             "(default: unlimited)"));
+
 static int compileModule(char**, LLVMContext&);
 
 // GetFileNameRoot - Helper function to get the basename of a filename.
@@ -319,8 +337,57 @@ static int compileModule(char **argv, LLVMContext &Context) {
       Target.setMCRelaxAll(true);
   }
 
+  // If the output of an earlier compilation of the same module with the same
+  // options is in the codegen cache, just copy it out.  Partial pipelines
+  // (-start-after/-stop-after) are never cached.
+  std::unique_ptr<CodeGenCache> Cache;
+  std::unique_ptr<LockFileManager> CacheLock;
+  std::string CacheKey;
+  if (!CodeGenCacheDir.empty() && StartAfter.empty() && StopAfter.empty()) {
+    std::string Bitcode;
+    raw_string_ostream BOS(Bitcode);
+    WriteBitcodeToFile(mod, BOS);
+    BOS.flush();
+
+    std::string ExtraOptions;
+    raw_string_ostream EOS(ExtraOptions);
+    EOS << FileType << RelaxAll << DisableCFI << EnableDwarfDirectory
+        << DisableSimplifyLibCalls << NoVerify;
+    // Any option can change the generated code, so hash the whole command
+    // line except for the output file name.
+    for (char **Arg = argv + 1; *Arg; ++Arg) {
+      StringRef A(*Arg);
+      if (A == "-o" || A == "--o") {
+        if (Arg[1])
+          ++Arg;
+        continue;
+      }
+      if (A.startswith("-o=") || A.startswith("--o="))
+        continue;
+      EOS << '\0' << A;
+    }
+    EOS.flush();
+
+    Cache.reset(new CodeGenCache(CodeGenCacheDir,
+                                 uint64_t(CodeGenCacheMaxSize) << 20));
+    CacheKey = CodeGenCache::computeKey(Bitcode, mod->getModuleIdentifier(),
+                                        Target, ExtraOptions);
+    if (std::unique_ptr<MemoryBuffer> Cached =
+            Cache->acquire(CacheKey, CacheLock)) {
+      Out->os() << Cached->getBuffer();
+      Out->keep();
+      return 0;
+    }
+  }
+
+  // When caching, generate the output into memory first so that it can be
+  // added to the cache as well as written out.
+  SmallString<0> CacheBuffer;
+  raw_svector_ostream CacheOS(CacheBuffer);
+
   {
-    formatted_raw_ostream FOS(Out->os());
+    formatted_raw_ostream FOS(Cache ? static_cast<raw_ostream &>(CacheOS)
+                                    : Out->os());
 
     AnalysisID StartAfterID = nullptr;
     AnalysisID StopAfterID = nullptr;
@@ -356,6 +423,12 @@ static int compileModule(char **argv, LLVMContext &Context) {
     PM.run(*mod);
   }
 
+  if (Cache) {
+    StringRef Output = CacheOS.str();
+    Out->os() << Output;
+    Cache->store(CacheKey, Output);
+  }
+
   // Declare success.
   Out->keep();
 
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -19,6 +20,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -155,37 +157,53 @@ int main(int argc, char **argv) {
     CodeGen.setAttr(attrs.c_str());
 
   if (!OutputFilename.empty()) {
-    size_t len = 0;
     std::string ErrorInfo;
-    const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
-                                       DisableGVNLoadPRE, ErrorInfo);
-    if (!Code) {
+    std::vector<const char *> ObjectNames;
+    if (!CodeGen.compile_to_files(ObjectNames, DisableOpt, DisableInline,
+                                  DisableGVNLoadPRE, ErrorInfo)) {
       errs() << argv[0]
              << ": error compiling the code: " << ErrorInfo << "\n";
       return 1;
     }
 
-    raw_fd_ostream FileStream(OutputFilename.c_str(), ErrorInfo,
-                              sys::fs::F_None);
-    if (!ErrorInfo.empty()) {
-      errs() << argv[0] << ": error opening the file '" << OutputFilename
-             << "': " << ErrorInfo << "\n";
-      return 1;
+    // With more than one code generation partition, the object file of
+    // partition N is written to <output>.N.
+    for (unsigned i = 0, e = ObjectNames.size(); i != e; ++i) {
+      std::string Filename = OutputFilename;
+      if (e > 1)
+        Filename += "." + utostr(i);
+
+      std::unique_ptr<MemoryBuffer> Code;
+      if (error_code EC = MemoryBuffer::getFile(ObjectNames[i], Code, -1,
+                                                false)) {
+        errs() << argv[0] << ": error reading the file '" << ObjectNames[i]
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      sys::fs::remove(ObjectNames[i]);
+
+      raw_fd_ostream FileStream(Filename.c_str(), ErrorInfo, sys::fs::F_None);
+      if (!ErrorInfo.empty()) {
+        errs() << argv[0] << ": error opening the file '" << Filename
+               << "': " << ErrorInfo << "\n";
+        return 1;
+      }
+
+      FileStream << Code->getBuffer();
     }
-
-    FileStream.write(reinterpret_cast<const char *>(Code), len);
   } else {
     std::string ErrorInfo;
-    const char *OutputName = nullptr;
-    if (!CodeGen.compile_to_file(&OutputName, DisableOpt, DisableInline,
-                                 DisableGVNLoadPRE, ErrorInfo)) {
+    std::vector<const char *> ObjectNames;
+    if (!CodeGen.compile_to_files(ObjectNames, DisableOpt, DisableInline,
+                                  DisableGVNLoadPRE, ErrorInfo)) {
       errs() << argv[0]
              << ": error compiling the code: " << ErrorInfo
              << "\n";
       return 1;
     }
 
-    outs() << "Wrote native object file '" << OutputName << "'\n";
+    for (unsigned i = 0, e = ObjectNames.size(); i != e; ++i)
+      outs() << "Wrote native object file '" << ObjectNames[i] << "'\n";
   }
 
   return 0;
@@ -7,13 +7,16 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// llvm-profdata merges .profdata files.
+// llvm-profdata merges .profdata files, for both instrumentation based and
+// sample based profiles.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ProfileData/SampleProfWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
@@ -22,6 +25,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -33,6 +37,30 @@ static void exitWithError(const Twine &Message, StringRef Whence = "") {
   ::exit(1);
 }
 
+static void mergeSampleProfiles(const cl::list<std::string> &Inputs,
+                                raw_fd_ostream &Output, bool OutputText) {
+  SampleProfileWriter Writer;
+  for (const auto &Filename : Inputs) {
+    std::unique_ptr<SampleProfileReader> Reader;
+    if (error_code EC = SampleProfileReader::create(Filename, Reader)) {
+      if (Reader && Reader->getErrorLine())
+        exitWithError(Reader->getErrorMessage(),
+                      Filename + ":" + Twine(Reader->getErrorLine()).str());
+      exitWithError(EC.message(), Filename);
+    }
+
+    StringMap<FunctionSamples> Profiles;
+    if (error_code EC = Reader->getAllFunctionSamples(Profiles))
+      exitWithError(EC.message(), Filename);
+    for (const auto &I : Profiles)
+      Writer.addFunctionSamples(I.getKey(), I.getValue());
+  }
+  if (OutputText)
+    Writer.writeText(Output);
+  else
+    Writer.write(Output);
+}
+
 int merge_main(int argc, const char *argv[]) {
   cl::list<std::string> Inputs(cl::Positional, cl::Required, cl::OneOrMore,
                                cl::desc("<filenames...>"));
@@ -42,25 +70,44 @@ int merge_main(int argc, const char *argv[]) {
                                       cl::desc("Output file"));
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"), cl::Required,
                             cl::aliasopt(OutputFilename));
+  cl::opt<unsigned> MaxICallTargets(
+      "max-icall-targets", cl::init(8),
+      cl::desc("Number of most frequent targets to keep for each indirect "
+               "call site (0 keeps all of them)"));
+  cl::opt<bool> Sample("sample", cl::init(false),
+                       cl::desc("Merge sample profiles instead of "
+                                "instrumentation profiles"));
+  cl::opt<bool> OutputText("text", cl::init(false),
+                           cl::desc("Write a sample profile in the text "
+                                    "format instead of the indexed format"));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
-  if (OutputFilename.compare("-") == 0)
+  if (OutputText && !Sample)
+    exitWithError("-text is only supported for sample profiles.");
+  if (OutputFilename.compare("-") == 0 && !OutputText)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
   std::string ErrorInfo;
-  raw_fd_ostream Output(OutputFilename.data(), ErrorInfo, sys::fs::F_None);
+  raw_fd_ostream Output(OutputFilename.data(), ErrorInfo,
+                        OutputText ? sys::fs::F_Text : sys::fs::F_None);
   if (!ErrorInfo.empty())
     exitWithError(ErrorInfo, OutputFilename);
 
-  InstrProfWriter Writer;
+  if (Sample) {
+    mergeSampleProfiles(Inputs, Output, OutputText);
+    return 0;
+  }
+
+  InstrProfWriter Writer(MaxICallTargets);
   for (const auto &Filename : Inputs) {
     std::unique_ptr<InstrProfReader> Reader;
     if (error_code ec = InstrProfReader::create(Filename, Reader))
       exitWithError(ec.message(), Filename);
 
     for (const auto &I : *Reader)
-      if (error_code EC = Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
+      if (error_code EC = Writer.addFunctionCounts(I.Name, I.Hash, I.Counts,
+                                                   I.IndirectCallSites))
         errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
     if (Reader->hasError())
       exitWithError(Reader->getError().message(), Filename);
@@ -70,6 +117,50 @@ int merge_main(int argc, const char *argv[]) {
   return 0;
 }
 
+static int showSampleProfile(std::string Filename, bool ShowAllFunctions,
+                             std::string ShowFunction, raw_fd_ostream &OS) {
+  std::unique_ptr<SampleProfileReader> Reader;
+  if (error_code EC = SampleProfileReader::create(Filename, Reader)) {
+    if (Reader && Reader->getErrorLine())
+      exitWithError(Reader->getErrorMessage(),
+                    Filename + ":" + Twine(Reader->getErrorLine()).str());
+    exitWithError(EC.message(), Filename);
+  }
+
+  StringMap<FunctionSamples> Profiles;
+  if (error_code EC = Reader->getAllFunctionSamples(Profiles))
+    exitWithError(EC.message(), Filename);
+
+  std::vector<StringRef> Names;
+  for (const auto &I : Profiles)
+    Names.push_back(I.getKey());
+  std::sort(Names.begin(), Names.end());
+
+  unsigned MaxTotalSamples = 0;
+  size_t ShownFunctions = 0;
+  for (StringRef Name : Names) {
+    const FunctionSamples &Samples = Profiles[Name];
+    if (Samples.getTotalSamples() > MaxTotalSamples)
+      MaxTotalSamples = Samples.getTotalSamples();
+
+    bool Show = ShowAllFunctions ||
+                (!ShowFunction.empty() && Name.find(ShowFunction) != Name.npos);
+    if (!Show)
+      continue;
+    if (!ShownFunctions)
+      OS << "Samples:\n";
+    ++ShownFunctions;
+    OS << "  " << Name << ": ";
+    Samples.print(OS);
+  }
+
+  if (ShowAllFunctions || !ShowFunction.empty())
+    OS << "Functions shown: " << ShownFunctions << "\n";
+  OS << "Total functions: " << Names.size() << "\n";
+  OS << "Maximum function samples: " << MaxTotalSamples << "\n";
+  return 0;
+}
+
 int show_main(int argc, const char *argv[]) {
   cl::opt<std::string> Filename(cl::Positional, cl::Required,
                                 cl::desc("<profdata-file>"));
@@ -86,13 +177,12 @@ int show_main(int argc, const char *argv[]) {
                                       cl::desc("Output file"));
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                             cl::aliasopt(OutputFilename));
+  cl::opt<bool> Sample("sample", cl::init(false),
+                       cl::desc("Show a sample profile instead of an "
+                                "instrumentation profile"));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data summary\n");
 
-  std::unique_ptr<InstrProfReader> Reader;
-  if (error_code EC = InstrProfReader::create(Filename, Reader))
-    exitWithError(EC.message(), Filename);
-
   if (OutputFilename.empty())
     OutputFilename = "-";
 
@@ -104,6 +194,13 @@ int show_main(int argc, const char *argv[]) {
   if (ShowAllFunctions && !ShowFunction.empty())
     errs() << "warning: -function argument ignored: showing all functions\n";
 
+  if (Sample)
+    return showSampleProfile(Filename, ShowAllFunctions, ShowFunction, OS);
+
+  std::unique_ptr<InstrProfReader> Reader;
+  if (error_code EC = InstrProfReader::create(Filename, Reader))
+    exitWithError(EC.message(), Filename);
+
   uint64_t MaxFunctionCount = 0, MaxBlockCount = 0;
   size_t ShownFunctions = 0, TotalFunctions = 0;
   for (const auto &Func : *Reader) {
@@ -125,6 +222,9 @@ int show_main(int argc, const char *argv[]) {
          << "    Hash: " << format("0x%016" PRIx64, Func.Hash) << "\n"
          << "    Counters: " << Func.Counts.size() << "\n"
          << "    Function count: " << Func.Counts[0] << "\n";
+      if (!Func.IndirectCallSites.empty())
+        OS << "    Indirect call sites: " << Func.IndirectCallSites.size()
+           << "\n";
     }
 
     if (Show && ShowCounts)
@@ -137,6 +237,16 @@ int show_main(int argc, const char *argv[]) {
     }
     if (Show && ShowCounts)
       OS << "]\n";
+
+    if (Show && ShowCounts) {
+      for (size_t I = 0, E = Func.IndirectCallSites.size(); I < E; ++I) {
+        OS << "    Indirect call site " << I << ": [";
+        const InstrProfValueSite &Site = Func.IndirectCallSites[I];
+        for (size_t J = 0, JE = Site.size(); J < JE; ++J)
+          OS << (J == 0 ? "" : ", ") << Site[J].Name << ": " << Site[J].Count;
+        OS << "]\n";
+      }
+    }
   }
   if (Reader->hasError())
     exitWithError(Reader->getError().message(), Filename);
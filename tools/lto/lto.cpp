@@ -332,6 +332,29 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                               sLastErrorString);
 }
 
+/// lto_codegen_compile_to_files - Generates code for all added modules into one
+/// native object file per code generation partition. The number of files is
+/// written to count. Returns true on error.
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, unsigned *count) {
+  if (!parsedOptions) {
+    cg->parseCodeGenDebugOptions();
+    lto_add_attrs(cg);
+    parsedOptions = true;
+  }
+  std::vector<const char *> Names;
+  if (!cg->compile_to_files(Names, DisableOpt, DisableInline,
+                            DisableGVNLoadPRE, sLastErrorString))
+    return true;
+  *count = Names.size();
+  return false;
+}
+
+/// lto_codegen_get_object_file - Returns the name of the object file generated
+/// for the given partition by lto_codegen_compile_to_files().
+const char *lto_codegen_get_object_file(lto_code_gen_t cg, unsigned index) {
+  return cg->getObjectFile(index);
+}
+
 /// lto_codegen_debug_options - Used to pass extra options to the code
 /// generator.
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {